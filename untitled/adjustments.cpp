@@ -0,0 +1,468 @@
+#include "adjustments.h"
+#include "colorplanes.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+int channelCount(AdjustSpace s) {
+    return s == AdjustSpace::CMYK ? 4 : 3;
+}
+
+// пространства стоят в цепочку CMYK - RGB - Lab - LCh, переходы только между соседями
+int position(AdjustSpace s) {
+    switch (s) {
+    case AdjustSpace::CMYK: return 0;
+    case AdjustSpace::RGB: return 1;
+    case AdjustSpace::Lab: return 2;
+    case AdjustSpace::LCh: return 3;
+    }
+    return 1;
+}
+
+const AdjustSpace BY_POSITION[4] = { AdjustSpace::CMYK, AdjustSpace::RGB, AdjustSpace::Lab, AdjustSpace::LCh };
+
+const char *spaceName(AdjustSpace s) {
+    switch (s) {
+    case AdjustSpace::RGB: return "rgb";
+    case AdjustSpace::Lab: return "lab";
+    case AdjustSpace::LCh: return "lch";
+    case AdjustSpace::CMYK: return "cmyk";
+    }
+    return "?";
+}
+
+// аффинное преобразование 4 компонент в double на время компиляции
+struct Affine {
+    double m[4][5];
+
+    Affine() {
+        std::memset(m, 0, sizeof(m));
+        for (int i = 0; i < 4; ++i) m[i][i] = 1.0;
+    }
+
+    // сначала first, потом this
+    Affine after(const Affine &first) const {
+        Affine r;
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 5; ++j) {
+                double v = j == 4 ? m[i][4] : 0.0;
+                for (int k = 0; k < 4; ++k) v += m[i][k] * first.m[k][j];
+                r.m[i][j] = v;
+            }
+        }
+        return r;
+    }
+
+    // с допуском: матрицы ядер хранятся во float
+    bool identity() const {
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 5; ++j)
+                if (std::abs(m[i][j] - (i == j ? 1.0 : 0.0)) > 1e-6) return false;
+        return true;
+    }
+};
+
+// --- переходы над плоскостями p[0..3], n кратно 4 ---
+
+void rgbToLab(float (*p)[CompiledAdjustment::TILE], int n) {
+    for (int k = 0; k < 3; ++k) srgbToLinearPlane(p[k], p[k], n);
+    linearToXyzPlanes(p[0], p[1], p[2], p[0], p[1], p[2], n);
+    xyzToLabPlanes(p[0], p[1], p[2], p[0], p[1], p[2], n);
+}
+
+void labToRgb(float (*p)[CompiledAdjustment::TILE], int n) {
+    labToXyzPlanes(p[0], p[1], p[2], p[0], p[1], p[2], n);
+    xyzToLinearPlanes(p[0], p[1], p[2], p[0], p[1], p[2], n);
+    for (int k = 0; k < 3; ++k) linearToSrgbPlane(p[k], p[k], n);
+}
+
+void labToLch(float (*p)[CompiledAdjustment::TILE], int n) {
+    const float toDeg = float(180.0 / PI);
+    for (int i = 0; i < n; ++i) {
+        float a = p[1][i], b = p[2][i];
+        float h = std::atan2(b, a) * toDeg;
+        p[1][i] = std::sqrt(a * a + b * b);
+        p[2][i] = h < 0.0f ? h + 360.0f : h;
+    }
+}
+
+void lchToLab(float (*p)[CompiledAdjustment::TILE], int n) {
+    const float toRad = float(PI / 180.0);
+    for (int i = 0; i < n; ++i) {
+        float c = std::max(p[1][i], 0.0f), h = p[2][i] * toRad;
+        p[1][i] = c * std::cos(h);
+        p[2][i] = c * std::sin(h);
+    }
+}
+
+// как rgbToCmyk, RGB обрезается до 0..1
+void rgbToCmyk(float (*p)[CompiledAdjustment::TILE], int n) {
+    for (int i = 0; i < n; ++i) {
+        float r = std::min(std::max(p[0][i], 0.0f), 1.0f);
+        float g = std::min(std::max(p[1][i], 0.0f), 1.0f);
+        float b = std::min(std::max(p[2][i], 0.0f), 1.0f);
+        float mx = std::max(r, std::max(g, b));
+        float inv = mx > 0.0f ? 1.0f / mx : 0.0f;
+        p[0][i] = (mx - r) * inv;
+        p[1][i] = (mx - g) * inv;
+        p[2][i] = (mx - b) * inv;
+        p[3][i] = 1.0f - mx;
+    }
+}
+
+void cmykToRgb(float (*p)[CompiledAdjustment::TILE], int n) {
+    auto unit = [](float v){ return std::min(std::max(v, 0.0f), 1.0f); };
+    for (int i = 0; i < n; ++i) {
+        float w = 1.0f - unit(p[3][i]);
+        p[0][i] = (1.0f - unit(p[0][i])) * w;
+        p[1][i] = (1.0f - unit(p[1][i])) * w;
+        p[2][i] = (1.0f - unit(p[2][i])) * w;
+        p[3][i] = 0.0f;
+    }
+}
+
+// --- те же переходы в double над одним пикселем, для applyStepwise ---
+
+double unitClamp(double v) {
+    return std::min(std::max(v, 0.0), 1.0);
+}
+
+void convertPixel(double *v, AdjustSpace from, AdjustSpace to) {
+    if (from == AdjustSpace::RGB && to == AdjustSpace::Lab) {
+        XYZ xyz = linearRgbToXyz(invGamma(unitClamp(v[0])), invGamma(unitClamp(v[1])), invGamma(unitClamp(v[2])));
+        Lab lab = xyzToLab(xyz);
+        v[0] = lab.L; v[1] = lab.a; v[2] = lab.b;
+    } else if (from == AdjustSpace::Lab && to == AdjustSpace::RGB) {
+        double r, g, b;
+        xyzToLinearRgb(labToXyz({ v[0], v[1], v[2] }), r, g, b);
+        v[0] = gammaSRGB(unitClamp(r)); v[1] = gammaSRGB(unitClamp(g)); v[2] = gammaSRGB(unitClamp(b));
+    } else if (from == AdjustSpace::Lab) {
+        double h = std::atan2(v[2], v[1]) * 180.0 / PI;
+        v[1] = std::sqrt(v[1] * v[1] + v[2] * v[2]);
+        v[2] = h < 0.0 ? h + 360.0 : h;
+    } else if (from == AdjustSpace::LCh) {
+        double c = std::max(v[1], 0.0), h = v[2] * PI / 180.0;
+        v[1] = c * std::cos(h);
+        v[2] = c * std::sin(h);
+    } else if (from == AdjustSpace::RGB) {
+        double r = unitClamp(v[0]), g = unitClamp(v[1]), b = unitClamp(v[2]);
+        double mx = std::max(r, std::max(g, b)), inv = mx > 0.0 ? 1.0 / mx : 0.0;
+        v[0] = (mx - r) * inv; v[1] = (mx - g) * inv; v[2] = (mx - b) * inv; v[3] = 1.0 - mx;
+    } else {
+        double w = 1.0 - unitClamp(v[3]);
+        v[0] = (1.0 - unitClamp(v[0])) * w; v[1] = (1.0 - unitClamp(v[1])) * w; v[2] = (1.0 - unitClamp(v[2])) * w;
+        v[3] = 0.0;
+    }
+}
+
+// весь буфер через соседние пространства, как appendConversion
+void convertAll(std::vector<double> &px, AdjustSpace from, AdjustSpace to) {
+    int p = position(from), target = position(to);
+    while (p != target) {
+        int next = p < target ? p + 1 : p - 1;
+        for (std::size_t i = 0; i < px.size(); i += 4) convertPixel(&px[i], BY_POSITION[p], BY_POSITION[next]);
+        p = next;
+    }
+}
+
+// общий проход по строкам изображения
+template<typename Src, typename Dst, typename Fn>
+void forEachRow(const ImageView<Src> &src, const ImageView<Dst> &dst, Fn fn) {
+    parallelFor(src.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y) fn(src.row(y), dst.row(y), std::size_t(src.width));
+    });
+}
+
+}
+
+AdjustmentChain &AdjustmentChain::push(Step::Kind kind, int channel, double a, double b) {
+    if ((kind == Step::Chroma || kind == Step::Hue) &&
+        (current == AdjustSpace::RGB || current == AdjustSpace::CMYK))
+        to(AdjustSpace::Lab);
+    if ((kind == Step::Add || kind == Step::Scale || kind == Step::Clamp) &&
+        (channel < 0 || channel >= channelCount(current)))
+        return *this;
+    steps.push_back({ kind, current, channel, a, b });
+    return *this;
+}
+
+AdjustmentChain &AdjustmentChain::to(AdjustSpace space) {
+    if (space != current) steps.push_back({ Step::To, space, 0, 0.0, 0.0 });
+    current = space;
+    return *this;
+}
+
+AdjustmentChain &AdjustmentChain::add(int channel, double value) { return push(Step::Add, channel, value); }
+AdjustmentChain &AdjustmentChain::scale(int channel, double factor) { return push(Step::Scale, channel, factor); }
+AdjustmentChain &AdjustmentChain::clamp(int channel, double lo, double hi) { return push(Step::Clamp, channel, lo, hi); }
+AdjustmentChain &AdjustmentChain::scaleChroma(double factor) { return push(Step::Chroma, 0, factor); }
+AdjustmentChain &AdjustmentChain::rotateHue(double degrees) { return push(Step::Hue, 0, degrees); }
+
+CompiledAdjustment AdjustmentChain::compile() const {
+    using Kernel = CompiledAdjustment::Kernel;
+    std::vector<Kernel> prog;
+    AdjustSpace s = AdjustSpace::RGB;
+
+    for (const Step &step : steps) {
+        if (step.kind == Step::To) {
+            CompiledAdjustment::appendConversion(prog, s, step.space);
+            s = step.space;
+            continue;
+        }
+        if (step.kind == Step::Clamp) {
+            Kernel k{};
+            k.kind = Kernel::Clamp;
+            k.channel = step.channel;
+            k.lo = float(step.a);
+            k.hi = float(step.b);
+            CompiledAdjustment::append(prog, k);
+            continue;
+        }
+
+        Affine t;
+        const bool lch = s == AdjustSpace::LCh;
+        switch (step.kind) {
+        case Step::Add: t.m[step.channel][4] = step.a; break;
+        case Step::Scale: t.m[step.channel][step.channel] = step.a; break;
+        case Step::Chroma:
+            // в Lab масштаб a и b, в LCh — только C
+            t.m[1][1] = step.a;
+            if (!lch) t.m[2][2] = step.a;
+            break;
+        case Step::Hue:
+            if (lch) {
+                t.m[2][4] = step.a;
+            } else {
+                // поворот (a, b) на угол — тот же сдвиг h, но без перехода в LCh
+                double r = step.a * PI / 180.0, c = std::cos(r), sn = std::sin(r);
+                t.m[1][1] = c; t.m[1][2] = -sn;
+                t.m[2][1] = sn; t.m[2][2] = c;
+            }
+            break;
+        default: break;
+        }
+        Kernel k{};
+        k.kind = Kernel::Affine;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 5; ++j) k.m[i][j] = float(t.m[i][j]);
+        CompiledAdjustment::append(prog, k);
+    }
+
+    CompiledAdjustment c;
+    c.forRgb = c.forLab = c.forCmyk = prog;
+    CompiledAdjustment::appendConversion(c.forRgb, s, AdjustSpace::RGB);
+    CompiledAdjustment::appendConversion(c.forLab, s, AdjustSpace::Lab);
+    CompiledAdjustment::appendConversion(c.forCmyk, s, AdjustSpace::CMYK);
+    return c;
+}
+
+void AdjustmentChain::applyStepwise(const uint8_t *rgb, int channels, AdjustSpace output, double *out,
+                                    std::size_t count) const {
+    std::vector<double> px(count * 4, 0.0);
+    for (std::size_t i = 0; i < count; ++i)
+        for (int c = 0; c < 3; ++c) px[i * 4 + c] = rgb[i * channels + c] / 255.0;
+
+    AdjustSpace s = AdjustSpace::RGB;
+    for (const Step &step : steps) {
+        if (step.kind == Step::To) {
+            convertAll(px, s, step.space);
+            s = step.space;
+            continue;
+        }
+        const bool lch = s == AdjustSpace::LCh;
+        const double r = step.a * PI / 180.0, cs = std::cos(r), sn = std::sin(r);
+        for (std::size_t i = 0; i < px.size(); i += 4) {
+            double *v = &px[i];
+            switch (step.kind) {
+            case Step::Add: v[step.channel] += step.a; break;
+            case Step::Scale: v[step.channel] *= step.a; break;
+            case Step::Clamp: v[step.channel] = std::min(std::max(v[step.channel], step.a), step.b); break;
+            case Step::Chroma:
+                v[1] *= step.a;
+                if (!lch) v[2] *= step.a;
+                break;
+            case Step::Hue:
+                if (lch) {
+                    v[2] += step.a;
+                } else {
+                    const double a = v[1], b = v[2];
+                    v[1] = cs * a - sn * b;
+                    v[2] = sn * a + cs * b;
+                }
+                break;
+            default: break;
+            }
+        }
+    }
+    convertAll(px, s, output);
+    const int n = channelCount(output);
+    for (std::size_t i = 0; i < count; ++i)
+        for (int c = 0; c < n; ++c) out[i * n + c] = px[i * 4 + c];
+}
+
+void CompiledAdjustment::append(std::vector<Kernel> &prog, const Kernel &k) {
+    if (!prog.empty()) {
+        Kernel &prev = prog.back();
+        // Сокращаются только пары, которые ничего не теряют: Lab > LCh > Lab точна,
+        // RGB > Lab > RGB равна обрезке RGB до 0..1 (rgbToLab обрезает вход). Обратные
+        // им LCh > Lab > LCh (C < 0 -> 0), Lab > RGB > Lab (гамут RGB) и пары через
+        // CMYK (обрезка, пересчёт K) остаются как есть.
+        if (k.kind == Kernel::Convert && prev.kind == Kernel::Convert && prev.from == k.to && prev.to == k.from) {
+            if (prev.from == AdjustSpace::Lab && prev.to == AdjustSpace::LCh) {
+                prog.pop_back();
+                return;
+            }
+            if (prev.from == AdjustSpace::RGB && prev.to == AdjustSpace::Lab) {
+                prog.pop_back();
+                // в начале программы RGB — ещё вход 0..1, обрезать нечего
+                if (prog.empty()) return;
+                for (int c = 0; c < 3; ++c) {
+                    Kernel clip{};
+                    clip.kind = Kernel::Clamp;
+                    clip.channel = c;
+                    clip.lo = 0.0f;
+                    clip.hi = 1.0f;
+                    append(prog, clip);
+                }
+                return;
+            }
+        }
+        if (k.kind == Kernel::Affine && prev.kind == Kernel::Affine) {
+            Affine a, b;
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 5; ++j) { a.m[i][j] = prev.m[i][j]; b.m[i][j] = k.m[i][j]; }
+            Affine r = b.after(a);
+            if (r.identity()) {
+                prog.pop_back();
+                return;
+            }
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 5; ++j) prev.m[i][j] = float(r.m[i][j]);
+            return;
+        }
+    }
+    prog.push_back(k);
+}
+
+void CompiledAdjustment::appendConversion(std::vector<Kernel> &prog, AdjustSpace from, AdjustSpace to) {
+    int p = position(from), target = position(to);
+    while (p != target) {
+        int next = p < target ? p + 1 : p - 1;
+        Kernel k{};
+        k.kind = Kernel::Convert;
+        k.from = BY_POSITION[p];
+        k.to = BY_POSITION[next];
+        append(prog, k);
+        p = next;
+    }
+}
+
+const std::vector<CompiledAdjustment::Kernel> &CompiledAdjustment::program(AdjustSpace output) const {
+    switch (output) {
+    case AdjustSpace::Lab: return forLab;
+    case AdjustSpace::CMYK: return forCmyk;
+    default: return forRgb;
+    }
+}
+
+std::string CompiledAdjustment::describe(AdjustSpace output) const {
+    std::string s;
+    for (const Kernel &k : program(output)) {
+        if (!s.empty()) s += ' ';
+        switch (k.kind) {
+        case Kernel::Convert: s += std::string(spaceName(k.from)) + ">" + spaceName(k.to); break;
+        case Kernel::Affine: s += "affine"; break;
+        case Kernel::Clamp: s += "clamp"; break;
+        }
+    }
+    return s;
+}
+
+void CompiledAdjustment::runTile(const std::vector<Kernel> &prog, const uint8_t *rgb, int channels, int n,
+                                 float (*p)[TILE]) const {
+    static const auto unit = []{
+        static float t[256];
+        for (int i = 0; i < 256; ++i) t[i] = i / 255.0f;
+        return t;
+    }();
+    for (int i = 0; i < n; ++i, rgb += channels) {
+        p[0][i] = unit[rgb[0]]; p[1][i] = unit[rgb[1]]; p[2][i] = unit[rgb[2]]; p[3][i] = 0.0f;
+    }
+    const int n4 = (n + 3) & ~3;
+    for (int k = 0; k < 4; ++k) std::fill(p[k] + n, p[k] + n4, 0.0f);
+
+    for (const Kernel &k : prog) {
+        switch (k.kind) {
+        case Kernel::Convert:
+            if (k.from == AdjustSpace::RGB && k.to == AdjustSpace::Lab) rgbToLab(p, n4);
+            else if (k.from == AdjustSpace::Lab && k.to == AdjustSpace::RGB) labToRgb(p, n4);
+            else if (k.from == AdjustSpace::Lab) labToLch(p, n4);
+            else if (k.from == AdjustSpace::LCh) lchToLab(p, n4);
+            else if (k.from == AdjustSpace::RGB) rgbToCmyk(p, n4);
+            else cmykToRgb(p, n4);
+            break;
+        case Kernel::Affine:
+            for (int i = 0; i < n4; ++i) {
+                float in[4] = { p[0][i], p[1][i], p[2][i], p[3][i] };
+                for (int r = 0; r < 4; ++r)
+                    p[r][i] = k.m[r][0] * in[0] + k.m[r][1] * in[1] + k.m[r][2] * in[2] + k.m[r][3] * in[3] + k.m[r][4];
+            }
+            break;
+        case Kernel::Clamp:
+            for (int i = 0; i < n4; ++i) p[k.channel][i] = std::min(std::max(p[k.channel][i], k.lo), k.hi);
+            break;
+        }
+    }
+}
+
+void CompiledAdjustment::applyRgb(const uint8_t *rgb, int channels, uint8_t *out, int outChannels, std::size_t count) const {
+    alignas(16) float p[4][TILE];
+    for (std::size_t i = 0; i < count; i += TILE) {
+        int n = int(std::min<std::size_t>(TILE, count - i));
+        runTile(forRgb, rgb + i * channels, channels, n, p);
+        uint8_t *o = out + i * outChannels;
+        for (int j = 0; j < n; ++j, o += outChannels) {
+            for (int k = 0; k < 3; ++k)
+                o[k] = uint8_t(std::lround(std::min(std::max(p[k][j], 0.0f), 1.0f) * 255.0f));
+            if (outChannels == 4) o[3] = channels == 4 ? rgb[(i + j) * 4 + 3] : 255;
+        }
+    }
+}
+
+void CompiledAdjustment::applyLab(const uint8_t *rgb, int channels, Lab *out, std::size_t count) const {
+    alignas(16) float p[4][TILE];
+    for (std::size_t i = 0; i < count; i += TILE) {
+        int n = int(std::min<std::size_t>(TILE, count - i));
+        runTile(forLab, rgb + i * channels, channels, n, p);
+        for (int j = 0; j < n; ++j) out[i + j] = { p[0][j], p[1][j], p[2][j] };
+    }
+}
+
+void CompiledAdjustment::applyCmyk(const uint8_t *rgb, int channels, CMYK *out, std::size_t count) const {
+    alignas(16) float p[4][TILE];
+    auto unit = [](float v){ return double(std::min(std::max(v, 0.0f), 1.0f)); };
+    for (std::size_t i = 0; i < count; i += TILE) {
+        int n = int(std::min<std::size_t>(TILE, count - i));
+        runTile(forCmyk, rgb + i * channels, channels, n, p);
+        for (int j = 0; j < n; ++j) out[i + j] = { unit(p[0][j]), unit(p[1][j]), unit(p[2][j]), unit(p[3][j]) };
+    }
+}
+
+void CompiledAdjustment::applyRgbImage(const ImageView<const uint8_t> &rgb, const ImageView<uint8_t> &out) const {
+    forEachRow(rgb, out, [&](const uint8_t *src, uint8_t *dst, std::size_t n){ applyRgb(src, rgb.channels, dst, out.channels, n); });
+}
+
+void CompiledAdjustment::applyLabImage(const ImageView<const uint8_t> &rgb, const ImageView<Lab> &out) const {
+    forEachRow(rgb, out, [&](const uint8_t *src, Lab *dst, std::size_t n){ applyLab(src, rgb.channels, dst, n); });
+}
+
+void CompiledAdjustment::applyCmykImage(const ImageView<const uint8_t> &rgb, const ImageView<CMYK> &out) const {
+    forEachRow(rgb, out, [&](const uint8_t *src, CMYK *dst, std::size_t n){ applyCmyk(src, rgb.channels, dst, n); });
+}
@@ -0,0 +1,104 @@
+#ifndef ADJUSTMENTS_H
+#define ADJUSTMENTS_H
+
+#include "colormodels.h"
+#include "imagebuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Пространства для коррекций. Компоненты: RGB 0..1 (с гаммой sRGB),
+// Lab как в colormodels, LCh — L, C и h в градусах, CMYK 0..1.
+enum class AdjustSpace { RGB, Lab, LCh, CMYK };
+
+class CompiledAdjustment;
+
+// Цепочка коррекций: переходы между пространствами и поканальные операции
+// в текущем пространстве, например
+//     AdjustmentChain().to(AdjustSpace::Lab).add(0, 5).scaleChroma(0.9).to(AdjustSpace::CMYK)
+// Цепочка только описывает шаги, compile() превращает её в короткий список
+// ядер: соседние линейные операции сливаются в одну матрицу, взаимно обратные
+// переходы выбрасываются, если ничего не обрезают. Ядра применяются к тайлу
+// подряд, пока он в кэше, так что промежуточных изображений в каждом пространстве нет.
+class AdjustmentChain {
+public:
+    AdjustmentChain &to(AdjustSpace space);
+    // канал вне числа компонент текущего пространства игнорируется
+    AdjustmentChain &add(int channel, double value);
+    AdjustmentChain &scale(int channel, double factor);
+    AdjustmentChain &clamp(int channel, double lo, double hi);
+    // Насыщенность и оттенок; из RGB и CMYK цепочка сначала переходит в Lab.
+    AdjustmentChain &scaleChroma(double factor);
+    AdjustmentChain &rotateHue(double degrees);
+
+    AdjustSpace space() const { return current; }
+
+    // вход всегда 8-битный RGB
+    CompiledAdjustment compile() const;
+
+    // Эталон для проверки compile(): шаги по очереди над всем буфером в double,
+    // без сокращений. out — 3 или 4 значения на пиксель в пространстве output
+    // (RGB 0..1), как у CompiledAdjustment до округления.
+    void applyStepwise(const uint8_t *rgb, int channels, AdjustSpace output, double *out, std::size_t count) const;
+
+private:
+    struct Step {
+        enum Kind { To, Add, Scale, Clamp, Chroma, Hue } kind;
+        AdjustSpace space;      // пространство, в котором действует шаг (для To — куда)
+        int channel;
+        double a, b;
+    };
+
+    AdjustmentChain &push(Step::Kind kind, int channel, double a, double b = 0.0);
+
+    std::vector<Step> steps;
+    AdjustSpace current = AdjustSpace::RGB;
+};
+
+// Скомпилированная цепочка: неизменяема, можно применять из нескольких потоков.
+// Результат переводится в пространство вызванной функции (RGB, Lab или CMYK);
+// для каждого из трёх выходов программа ядер своя, с уже сокращёнными переходами.
+class CompiledAdjustment {
+public:
+    static const int TILE = 256;
+
+    void applyRgb(const uint8_t *rgb, int channels, uint8_t *out, int outChannels, std::size_t count) const;
+    void applyLab(const uint8_t *rgb, int channels, Lab *out, std::size_t count) const;
+    void applyCmyk(const uint8_t *rgb, int channels, CMYK *out, std::size_t count) const;
+
+    void applyRgbImage(const ImageView<const uint8_t> &rgb, const ImageView<uint8_t> &out) const;
+    void applyLabImage(const ImageView<const uint8_t> &rgb, const ImageView<Lab> &out) const;
+    void applyCmykImage(const ImageView<const uint8_t> &rgb, const ImageView<CMYK> &out) const;
+
+    // output — RGB, Lab или CMYK
+    std::size_t kernelCount(AdjustSpace output) const { return program(output).size(); }
+    // список ядер для журнала, например "rgb>lab affine clamp lab>rgb rgb>cmyk"
+    std::string describe(AdjustSpace output) const;
+
+private:
+    friend class AdjustmentChain;
+
+    struct Kernel {
+        enum Kind { Convert, Affine, Clamp } kind;
+        AdjustSpace from, to;      // для Convert — соседние пространства
+        float m[4][5];             // для Affine: out_i = sum m[i][j] * in_j + m[i][4]
+        int channel;               // для Clamp
+        float lo, hi;
+    };
+
+    // добавление ядра с сокращениями: Lab > LCh > Lab снимается, RGB > Lab > RGB
+    // заменяется обрезкой RGB до 0..1, соседние Affine перемножаются,
+    // тождественные выбрасываются
+    static void append(std::vector<Kernel> &prog, const Kernel &k);
+    static void appendConversion(std::vector<Kernel> &prog, AdjustSpace from, AdjustSpace to);
+
+    const std::vector<Kernel> &program(AdjustSpace output) const;
+    // загрузка n <= TILE пикселей в плоскости p и прогон программы
+    void runTile(const std::vector<Kernel> &prog, const uint8_t *rgb, int channels, int n, float (*p)[TILE]) const;
+
+    std::vector<Kernel> forRgb, forLab, forCmyk;
+};
+
+#endif // ADJUSTMENTS_H
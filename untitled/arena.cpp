@@ -0,0 +1,120 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <mutex>
+
+
+namespace {
+
+std::atomic<std::size_t> initialSize{256 * 1024};
+
+// список живых арен для статистики; намеренно не разрушается, чтобы
+// thread_local арены могли отписаться и при завершении программы
+struct Registry {
+    std::mutex mutex;
+    std::vector<ScratchArena *> arenas;
+};
+
+Registry &registry() {
+    static Registry *r = new Registry;
+    return *r;
+}
+
+}
+
+ScratchArena::ScratchArena() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.arenas.push_back(this);
+}
+
+ScratchArena::~ScratchArena() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.arenas.erase(std::remove(r.arenas.begin(), r.arenas.end(), this), r.arenas.end());
+}
+
+ScratchArena &ScratchArena::local() {
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+void ScratchArena::addBlock(std::size_t atLeast) {
+    std::size_t size = std::max(atLeast, initialSize.load(std::memory_order_relaxed));
+    if (!blocks.empty()) size = std::max(size, blocks.back().size * 2);
+    blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[size]), size });
+    usedBefore.push_back(0);
+    reserved.fetch_add(size, std::memory_order_relaxed);
+    allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void *ScratchArena::allocate(std::size_t bytes, std::size_t align) {
+    for (;;) {
+        if (current < blocks.size()) {
+            Block &b = blocks[current];
+            uintptr_t base = reinterpret_cast<uintptr_t>(b.data.get());
+            uintptr_t at = (base + offset + align - 1) & ~uintptr_t(align - 1);
+            if (at + bytes <= base + b.size) {
+                offset = std::size_t(at - base) + bytes;
+                used = usedBefore[current] + offset;
+                if (used > highWater.load(std::memory_order_relaxed))
+                    highWater.store(used, std::memory_order_relaxed);
+                return reinterpret_cast<void *>(at);
+            }
+            // не помещается — в следующий блок, остаток этого пропадает до отката
+            if (current + 1 < blocks.size()) {
+                usedBefore[current + 1] = usedBefore[current] + b.size;
+                ++current;
+                offset = 0;
+                continue;
+            }
+        }
+        addBlock(bytes + align);
+        if (blocks.size() > 1) {
+            current = blocks.size() - 1;
+            usedBefore[current] = usedBefore[current - 1] + blocks[current - 1].size;
+        }
+        offset = 0;
+    }
+}
+
+void ScratchArena::release(const Mark &m) {
+    current = m.block;
+    offset = m.offset;
+    used = (current < usedBefore.size() ? usedBefore[current] : 0) + offset;
+
+    // полностью свободна и разрослась на несколько блоков — сливаем их в один
+    // такого же общего размера, дальше пик помещается без новых выделений
+    if (used == 0 && blocks.size() > 1) {
+        std::size_t total = reserved.load(std::memory_order_relaxed);
+        blocks.clear();
+        usedBefore.clear();
+        reserved.store(0, std::memory_order_relaxed);
+        addBlock(total);
+        current = 0;
+    }
+}
+
+ArenaStats arenaStats() {
+    ArenaStats s;
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const ScratchArena *a : r.arenas) {
+        ++s.arenas;
+        s.highWaterBytes += a->highWaterBytes();
+        s.maxHighWaterBytes = std::max(s.maxHighWaterBytes, a->highWaterBytes());
+        s.reservedBytes += a->reservedBytes();
+        s.heapAllocations += a->heapAllocations();
+    }
+    return s;
+}
+
+void resetArenaHighWater() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (ScratchArena *a : r.arenas) a->resetHighWater();
+}
+
+void setArenaInitialSize(std::size_t bytes) {
+    initialSize.store(std::max<std::size_t>(bytes, 4096), std::memory_order_relaxed);
+}
@@ -0,0 +1,91 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Арена рабочих буферов (строки, тайлы, маски) одного потока. Память берётся
+// у системы блоками и не возвращается: после прогрева следующие тайлы и задания
+// работают без обращений к куче. Освобождение — откатом к отметке (ArenaScope).
+class ScratchArena {
+public:
+    struct Mark {
+        std::size_t block = 0;
+        std::size_t offset = 0;
+    };
+
+    ScratchArena();
+    ~ScratchArena();
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    // арена текущего потока
+    static ScratchArena &local();
+
+    void *allocate(std::size_t bytes, std::size_t align = 64);
+    template<typename T>
+    T *allocate(std::size_t count) { return static_cast<T *>(allocate(count * sizeof(T), alignof(T) > 64 ? alignof(T) : 64)); }
+
+    Mark mark() const { return { current, offset }; }
+    void release(const Mark &m);
+
+    std::size_t usedBytes() const { return used; }
+    std::size_t highWaterBytes() const { return highWater.load(std::memory_order_relaxed); }
+    std::size_t reservedBytes() const { return reserved.load(std::memory_order_relaxed); }
+    std::size_t heapAllocations() const { return allocations.load(std::memory_order_relaxed); }
+    // может вызываться из другого потока; пик снова поднимется при следующем выделении
+    void resetHighWater() { highWater.store(0, std::memory_order_relaxed); }
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        std::size_t size;
+    };
+
+    void addBlock(std::size_t atLeast);
+
+    std::vector<Block> blocks;
+    std::size_t current = 0;     // блок, из которого сейчас выделяем
+    std::size_t offset = 0;      // занято в нём
+    std::size_t used = 0;        // занято всего, с учётом предыдущих блоков
+    std::vector<std::size_t> usedBefore;   // used на начало каждого блока
+    // читаются из других потоков (arenaStats), пишутся только владельцем
+    std::atomic<std::size_t> highWater{0};
+    std::atomic<std::size_t> reserved{0};
+    std::atomic<std::size_t> allocations{0};
+};
+
+// Всё, что выделено через scope, освобождается в его деструкторе.
+class ArenaScope {
+public:
+    explicit ArenaScope(ScratchArena &arena = ScratchArena::local()) : a(arena), m(arena.mark()) {}
+    ~ArenaScope() { a.release(m); }
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+    template<typename T>
+    T *allocate(std::size_t count) { return a.allocate<T>(count); }
+
+private:
+    ScratchArena &a;
+    ScratchArena::Mark m;
+};
+
+// Сумма по всем живым аренам потоков — чтобы подобрать начальный размер пулов.
+struct ArenaStats {
+    std::size_t arenas = 0;
+    std::size_t highWaterBytes = 0;      // сумма пиков по потокам
+    std::size_t maxHighWaterBytes = 0;   // наибольший пик одного потока
+    std::size_t reservedBytes = 0;
+    std::size_t heapAllocations = 0;
+};
+ArenaStats arenaStats();
+void resetArenaHighWater();
+
+// Начальный размер блока новых арен (по умолчанию 256 КБ).
+void setArenaInitialSize(std::size_t bytes);
+
+#endif // ARENA_H
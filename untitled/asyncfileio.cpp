@@ -0,0 +1,559 @@
+#include "asyncfileio.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef COLOR_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+
+namespace {
+
+const int MAX_THREADS = 8;
+// одна операция ядра читает не больше этого; остаток — следующим запросом
+const std::size_t MAX_CHUNK = std::size_t(1) << 30;
+
+std::string systemError(const std::string &what, const std::string &path, int code) {
+    return what + " " + path + ": " + std::strerror(code);
+}
+
+// запасной путь: весь запрос целиком блокирующими вызовами
+std::string blockingIo(bool write, const std::string &path, std::vector<uint8_t> &data) {
+#ifdef _WIN32
+    std::FILE *f = std::fopen(path.c_str(), write ? "wb" : "rb");
+    if (!f) return systemError(write ? "не удалось создать" : "не удалось открыть", path, errno);
+    std::string error;
+    if (write) {
+        if (std::fwrite(data.data(), 1, data.size(), f) != data.size()) error = "ошибка записи " + path;
+    } else {
+        std::fseek(f, 0, SEEK_END);
+        long size = std::ftell(f);
+        std::fseek(f, 0, SEEK_SET);
+        data.resize(size > 0 ? std::size_t(size) : 0);
+        if (std::fread(data.data(), 1, data.size(), f) != data.size()) error = "ошибка чтения " + path;
+    }
+    if (std::fclose(f) != 0 && error.empty()) error = "ошибка записи " + path;
+    return error;
+#else
+    const int fd = write ? ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                         : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return systemError(write ? "не удалось создать" : "не удалось открыть", path, errno);
+    std::string error;
+    if (!write) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) error = systemError("ошибка чтения", path, errno);
+        else data.resize(std::size_t(st.st_size));
+    }
+    for (std::size_t done = 0; error.empty() && done < data.size(); ) {
+        const std::size_t n = std::min(data.size() - done, MAX_CHUNK);
+        const ssize_t r = write ? ::pwrite(fd, data.data() + done, n, off_t(done))
+                                : ::pread(fd, data.data() + done, n, off_t(done));
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) error = systemError(write ? "ошибка записи" : "ошибка чтения", path, errno);
+        else if (r == 0) error = "файл укоротился при чтении: " + path;
+        else done += std::size_t(r);
+    }
+    if (::close(fd) != 0 && error.empty()) error = systemError("ошибка записи", path, errno);
+    return error;
+#endif
+}
+
+}
+
+struct AsyncFileIO::Request {
+    // этапы запроса в кольце; без открытия через кольцо сразу Transfer
+    enum class Stage { Open, Stat, Transfer, Close };
+
+    Result result;
+    int fd = -1;
+    std::size_t size = 0;
+    std::size_t done = 0;
+    Stage stage = Stage::Transfer;
+#ifdef COLOR_URING
+    struct statx stat;
+#endif
+};
+
+#ifdef COLOR_URING
+// Кольца io_uring, отображённые в память: очередь запросов (SQ) и очередь
+// завершений (CQ). Заполнение SQ и разбор CQ — без системных вызовов, один
+// io_uring_enter отправляет всё накопленное и ждёт завершений.
+class AsyncFileIO::Ring {
+public:
+    static std::unique_ptr<Ring> create(unsigned entries) {
+        std::unique_ptr<Ring> r(new Ring);
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        r->fd = int(syscall(__NR_io_uring_setup, entries, &p));
+        if (r->fd < 0) return nullptr;
+        if (!r->probe()) return nullptr;
+
+        r->sqBytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        r->cqBytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) r->sqBytes = r->cqBytes = std::max(r->sqBytes, r->cqBytes);
+        r->sq = map(r->fd, r->sqBytes, IORING_OFF_SQ_RING);
+        r->cq = single ? r->sq : map(r->fd, r->cqBytes, IORING_OFF_CQ_RING);
+        r->sqeBytes = p.sq_entries * sizeof(io_uring_sqe);
+        r->sqes = static_cast<io_uring_sqe *>(map(r->fd, r->sqeBytes, IORING_OFF_SQES));
+        if (!r->sq || !r->cq || !r->sqes) return nullptr;
+
+        uint8_t *sq = static_cast<uint8_t *>(r->sq), *cq = static_cast<uint8_t *>(r->cq);
+        r->sqHead = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+        r->sqTail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        r->sqMask = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        r->sqArray = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        r->sqEntries = p.sq_entries;
+        r->cqHead = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        r->cqTail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        r->cqMask = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        r->cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        return r;
+    }
+
+    ~Ring() {
+        if (sqes) munmap(sqes, sqeBytes);
+        if (cq && cq != sq) munmap(cq, cqBytes);
+        if (sq) munmap(sq, sqBytes);
+        if (fd >= 0) ::close(fd);
+    }
+
+    // OPENAT, STATX и CLOSE: без них файлы открываются и закрываются в вызывающем потоке
+    bool openClose() const { return fileOps; }
+
+    // false — очередь запросов полна; opFlags — open_flags / statx_flags
+    bool push(uint8_t op, int file, const void *buf, std::size_t len, uint64_t offset, uint64_t userData,
+              uint32_t opFlags = 0) {
+        const unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) return false;
+        const unsigned i = tail & sqMask;
+        io_uring_sqe &e = sqes[i];
+        std::memset(&e, 0, sizeof(e));
+        e.opcode = op;
+        e.fd = file;
+        e.addr = reinterpret_cast<uint64_t>(buf);
+        e.len = unsigned(len);
+        e.off = offset;
+        e.open_flags = opFlags;
+        e.user_data = userData;
+        sqArray[i] = i;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted;
+        return true;
+    }
+
+    // отправляет накопленное и ждёт хотя бы minComplete завершений
+    bool enter(unsigned minComplete) {
+        if (unsubmitted == 0 && minComplete == 0) return true;
+        for (;;) {
+            const long r = syscall(__NR_io_uring_enter, fd, unsubmitted, minComplete,
+                                   minComplete ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (r >= 0) {
+                unsubmitted -= std::min(unsubmitted, unsigned(r));
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+        }
+    }
+
+    bool pop(uint64_t &userData, int &res) {
+        const unsigned head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) return false;
+        const io_uring_cqe &c = cqes[head & cqMask];
+        userData = c.user_data;
+        res = c.res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    Ring() = default;
+
+    static void *map(int fd, std::size_t bytes, off_t what) {
+        void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, what);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    // IORING_OP_READ / WRITE есть с ядра 5.6, как и сам запрос возможностей;
+    // false — кольцо непригодно
+    bool probe() {
+        const std::size_t bytes = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        std::vector<uint8_t> buf(bytes, 0);
+        io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(buf.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) return false;
+        auto has = [probe](int op){ return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED); };
+        fileOps = has(IORING_OP_OPENAT) && has(IORING_OP_STATX) && has(IORING_OP_CLOSE);
+        return has(IORING_OP_READ) && has(IORING_OP_WRITE);
+    }
+
+    int fd = -1;
+    void *sq = nullptr, *cq = nullptr;
+    std::size_t sqBytes = 0, cqBytes = 0, sqeBytes = 0;
+    unsigned *sqHead = nullptr, *sqTail = nullptr, *sqArray = nullptr;
+    unsigned sqMask = 0, sqEntries = 0;
+    io_uring_sqe *sqes = nullptr;
+    unsigned *cqHead = nullptr, *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+    unsigned unsubmitted = 0;
+    bool fileOps = false;
+};
+#else
+class AsyncFileIO::Ring {};
+#endif
+
+AsyncFileIO::AsyncFileIO(int depth, bool preferUring)
+    : depth(std::max(1, depth))
+{
+#ifdef COLOR_URING
+    if (preferUring) {
+        unsigned entries = 1;
+        while (entries < unsigned(this->depth)) entries <<= 1;
+        uring = Ring::create(entries);
+    }
+#else
+    (void)preferUring;
+#endif
+    if (uring) {
+        slots.resize(std::size_t(this->depth));
+        for (std::size_t i = slots.size(); i-- > 0; ) freeSlots.push_back(i);
+        return;
+    }
+    startWorkers();
+}
+
+AsyncFileIO::~AsyncFileIO() {
+    // незавершённые запросы io_uring дожидаемся: ядро пишет в их буферы
+    Result r;
+    while (uring && outstanding > 0 && wait(r)) {}
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : workers) t.join();
+    // сначала кольцо (ядро отменяет и дожидается его операций), потом буферы брошенных
+    // запросов; дескриптор закрываем, только если его не закрывала операция кольца
+    brokenRing.reset();
+#ifndef _WIN32
+    for (const std::unique_ptr<Request> &r : orphaned)
+        if (r->fd >= 0 && r->stage != Request::Stage::Close) ::close(r->fd);
+#endif
+}
+
+void AsyncFileIO::fallBackToThreads() {
+#ifdef COLOR_URING
+    if (uring) fallBack();
+#endif
+}
+
+void AsyncFileIO::read(std::size_t id, const std::string &path) {
+    std::unique_ptr<Request> r(new Request);
+    r->result.id = id;
+    r->result.path = path;
+    ++outstanding;
+    if (!uring) {
+        {
+            std::lock_guard<std::mutex> g(lock);
+            queued.push_back(std::move(r));
+        }
+        wake.notify_one();
+        return;
+    }
+    queued.push_back(std::move(r));
+    submitQueued();
+}
+
+void AsyncFileIO::write(std::size_t id, const std::string &path, std::vector<uint8_t> data) {
+    std::unique_ptr<Request> r(new Request);
+    r->result.id = id;
+    r->result.write = true;
+    r->result.path = path;
+    r->result.data = std::move(data);
+    ++outstanding;
+    if (!uring) {
+        {
+            std::lock_guard<std::mutex> g(lock);
+            queued.push_back(std::move(r));
+        }
+        wake.notify_one();
+        return;
+    }
+    queued.push_back(std::move(r));
+    submitQueued();
+}
+
+void AsyncFileIO::startWorkers() {
+    for (int i = 0; i < std::min(depth, MAX_THREADS); ++i)
+        workers.emplace_back([this]{ workerLoop(); });
+}
+
+void AsyncFileIO::workerLoop() {
+    for (;;) {
+        std::unique_ptr<Request> r;
+        {
+            std::unique_lock<std::mutex> g(lock);
+            wake.wait(g, [this]{ return stopping || !queued.empty(); });
+            if (queued.empty()) return;
+            r = std::move(queued.front());
+            queued.pop_front();
+        }
+        r->result.error = blockingIo(r->result.write, r->result.path, r->result.data);
+        if (r->result.write) std::vector<uint8_t>().swap(r->result.data);
+        {
+            std::lock_guard<std::mutex> g(lock);
+            ready.push_back(std::move(r));
+        }
+        completed.notify_one();
+    }
+}
+
+void AsyncFileIO::finish(std::unique_ptr<Request> r, const std::string &error) {
+#ifndef _WIN32
+    if (r->fd >= 0 && ::close(r->fd) != 0 && error.empty() && r->result.error.empty() && r->result.write)
+        r->result.error = systemError("ошибка записи", r->result.path, errno);
+#endif
+    r->fd = -1;
+    if (!error.empty()) r->result.error = error;
+    if (r->result.write) std::vector<uint8_t>().swap(r->result.data);
+    ready.push_back(std::move(r));
+}
+
+// открывает файл в вызывающем потоке (ядро без OPENAT в io_uring); true — нужна
+// операция ядра, false — запрос уже завершён (ошибка или пустой файл)
+bool AsyncFileIO::start(Request &r) {
+#ifndef _WIN32
+    const bool write = r.result.write;
+    r.fd = write ? ::open(r.result.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                 : ::open(r.result.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (r.fd < 0) {
+        r.result.error = systemError(write ? "не удалось создать" : "не удалось открыть", r.result.path, errno);
+        return false;
+    }
+    if (!write) {
+        struct stat st;
+        if (fstat(r.fd, &st) != 0) {
+            r.result.error = systemError("ошибка чтения", r.result.path, errno);
+            return false;
+        }
+        r.result.data.resize(std::size_t(st.st_size));
+    }
+    r.size = r.result.data.size();
+    return r.size > 0;
+#else
+    (void)r;
+    return false;
+#endif
+}
+
+void AsyncFileIO::submitQueued() {
+#ifdef COLOR_URING
+    while (uring && !freeSlots.empty() && !queued.empty()) {
+        std::unique_ptr<Request> r = std::move(queued.front());
+        queued.pop_front();
+        if (uring->openClose()) {
+            r->stage = Request::Stage::Open;
+        } else if (!start(*r)) {
+            const std::string error = r->result.error;
+            finish(std::move(r), error);
+            continue;
+        }
+        const std::size_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        slots[slot] = std::move(r);
+        issue(slot);
+    }
+    if (uring && !uring->enter(0)) fallBack();
+#endif
+}
+
+#ifdef COLOR_URING
+// ставит в кольцо операцию текущего этапа запроса из слота
+void AsyncFileIO::issue(std::size_t slot) {
+    Request &r = *slots[slot];
+    auto push = [this, &r, slot]{
+        switch (r.stage) {
+        case Request::Stage::Open:
+            return r.result.write
+                ? uring->push(IORING_OP_OPENAT, AT_FDCWD, r.result.path.c_str(), 0644, 0, slot,
+                              O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC)
+                : uring->push(IORING_OP_OPENAT, AT_FDCWD, r.result.path.c_str(), 0, 0, slot, O_RDONLY | O_CLOEXEC);
+        case Request::Stage::Stat:
+            return uring->push(IORING_OP_STATX, r.fd, "", STATX_SIZE, reinterpret_cast<uint64_t>(&r.stat), slot,
+                               AT_EMPTY_PATH);
+        case Request::Stage::Transfer:
+            return uring->push(r.result.write ? IORING_OP_WRITE : IORING_OP_READ, r.fd, r.result.data.data() + r.done,
+                               std::min(r.size - r.done, MAX_CHUNK), r.done, slot);
+        case Request::Stage::Close:
+            return uring->push(IORING_OP_CLOSE, r.fd, nullptr, 0, 0, slot);
+        }
+        return false;
+    };
+    // у каждого слота в кольце не больше одной операции, так что места хватает;
+    // на всякий случай — отправить накопленное и попробовать ещё раз
+    if (push() || (uring->enter(0) && push())) return;
+    r.result.error = "io_uring: очередь запросов переполнена, " + r.result.path;
+    finish(std::move(slots[slot]));
+    freeSlots.push_back(slot);
+}
+
+// разбирает завершение операции запроса из слота и ставит следующую
+void AsyncFileIO::advance(std::size_t slot, int res) {
+    Request &r = *slots[slot];
+    const bool write = r.result.write;
+    if (res == -EINTR || res == -EAGAIN) {
+        issue(slot);
+        return;
+    }
+    switch (r.stage) {
+    case Request::Stage::Open:
+        if (res < 0) {
+            complete(slot, systemError(write ? "не удалось создать" : "не удалось открыть", r.result.path, -res));
+            return;
+        }
+        r.fd = res;
+        if (!write) {
+            r.stage = Request::Stage::Stat;
+            issue(slot);
+            return;
+        }
+        r.size = r.result.data.size();
+        break;
+    case Request::Stage::Stat:
+        if (res < 0) {
+            complete(slot, systemError("ошибка чтения", r.result.path, -res));
+            return;
+        }
+        r.result.data.resize(std::size_t(r.stat.stx_size));
+        r.size = r.result.data.size();
+        break;
+    case Request::Stage::Transfer:
+        if (res < 0) {
+            complete(slot, systemError(write ? "ошибка записи" : "ошибка чтения", r.result.path, -res));
+            return;
+        }
+        if (res == 0 && !write) {
+            complete(slot, "файл укоротился при чтении: " + r.result.path);
+            return;
+        }
+        r.done += std::size_t(res);
+        break;
+    case Request::Stage::Close:
+        // закрыт ядром; у записи ошибка закрытия — ошибка записи
+        r.fd = -1;
+        if (res < 0 && write && r.result.error.empty())
+            r.result.error = systemError("ошибка записи", r.result.path, -res);
+        finish(std::move(slots[slot]));
+        freeSlots.push_back(slot);
+        return;
+    }
+    if (r.done < r.size) {
+        // первая операция или короткая — дочитываем (дописываем) остаток тем же слотом
+        r.stage = Request::Stage::Transfer;
+        issue(slot);
+        return;
+    }
+    complete(slot);
+}
+
+// запрос из слота завершён (error — с ошибкой): закрыть файл через кольцо, если можно
+void AsyncFileIO::complete(std::size_t slot, const std::string &error) {
+    Request &r = *slots[slot];
+    if (!error.empty()) r.result.error = error;
+    if (r.fd >= 0 && uring->openClose()) {
+        r.stage = Request::Stage::Close;
+        issue(slot);
+        return;
+    }
+    finish(std::move(slots[slot]));
+    freeSlots.push_back(slot);
+}
+
+// Кольцо сломалось. Операции в полёте сначала пробуем дождаться: завершённая
+// ядром больше ничего не тронет, её файл можно закрыть. Те, которых не
+// дождались, не завершаем: ядро ещё может писать в их буферы и дескрипторы,
+// так что они вместе с кольцом живут до деструктора. Все запросы из слотов
+// потоки запасного пути выполняют заново с начала; остальное и всё новое — тоже.
+void AsyncFileIO::fallBack() {
+    std::size_t inFlight = 0;
+    for (const std::unique_ptr<Request> &r : slots) inFlight += r ? 1 : 0;
+    std::vector<bool> settled(slots.size(), false);
+    uint64_t slot;
+    int res;
+    while (inFlight > 0 && uring->enter(1))
+        while (uring->pop(slot, res)) {
+            if (slot >= slots.size() || !slots[slot] || settled[slot]) continue;
+            Request &r = *slots[slot];
+            if (r.stage == Request::Stage::Open && res >= 0) r.fd = res;
+            if (r.stage == Request::Stage::Close) r.fd = -1;
+            settled[slot] = true;
+            --inFlight;
+        }
+
+    std::deque<std::unique_ptr<Request>> again;
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        std::unique_ptr<Request> &r = slots[i];
+        if (!r) continue;
+        std::unique_ptr<Request> copy(new Request);
+        copy->result.id = r->result.id;
+        copy->result.write = r->result.write;
+        copy->result.path = r->result.path;
+        if (settled[i]) {
+            if (r->result.write) copy->result.data = std::move(r->result.data);
+#ifndef _WIN32
+            if (r->fd >= 0) ::close(r->fd);
+#endif
+        } else {
+            // буфер записи ядро только читает — копия ему не мешает
+            if (r->result.write) copy->result.data = r->result.data;
+            orphaned.push_back(std::move(r));
+        }
+        again.push_back(std::move(copy));
+    }
+    slots.clear();
+    freeSlots.clear();
+    brokenRing = std::move(uring);
+    {
+        std::lock_guard<std::mutex> g(lock);
+        queued.insert(queued.begin(), std::make_move_iterator(again.begin()), std::make_move_iterator(again.end()));
+    }
+    startWorkers();
+    wake.notify_all();
+}
+#endif
+
+bool AsyncFileIO::wait(Result &done) {
+#ifdef COLOR_URING
+    while (uring && ready.empty()) {
+        if (outstanding == 0) return false;
+        if (!uring->enter(1)) {
+            fallBack();
+            break;
+        }
+        uint64_t slot;
+        int res;
+        while (uring && uring->pop(slot, res)) advance(std::size_t(slot), res);
+        submitQueued();
+    }
+#endif
+    // потоки (и кольцо после отказа) — ready под замком
+    std::unique_lock<std::mutex> g(lock);
+    if (outstanding == 0) return false;
+    completed.wait(g, [this]{ return !ready.empty(); });
+    done = std::move(ready.front()->result);
+    ready.pop_front();
+    --outstanding;
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef ASYNCFILEIO_H
+#define ASYNCFILEIO_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define COLOR_URING 1
+#endif
+#endif
+
+// Чтение и запись целых файлов с многими запросами в полёте — для пакетной
+// обработки каталогов. На Linux — io_uring (системными вызовами, без liburing),
+// открытие, размер и закрытие тоже через кольцо, если ядро это умеет; если
+// io_uring нет (или кольцо сломалось посреди работы), и на других системах —
+// блокирующие pread / pwrite в нескольких потоках. Запросы сверх глубины
+// очереди ждут своей очереди.
+class AsyncFileIO {
+public:
+    enum class Backend { Uring, Threads };
+
+    struct Result {
+        std::size_t id = 0;
+        bool write = false;
+        std::string path;
+        std::vector<uint8_t> data;      // прочитанное; у записи — пусто
+        std::string error;              // пусто, если всё хорошо
+    };
+
+    // preferUring = false — сразу потоки (для сравнения)
+    explicit AsyncFileIO(int depth = 32, bool preferUring = true);
+    ~AsyncFileIO();
+    AsyncFileIO(const AsyncFileIO &) = delete;
+    AsyncFileIO &operator=(const AsyncFileIO &) = delete;
+
+    Backend backend() const { return uring ? Backend::Uring : Backend::Threads; }
+
+    void read(std::size_t id, const std::string &path);
+    void write(std::size_t id, const std::string &path, std::vector<uint8_t> data);
+
+    // ждёт завершения любого запроса; false — ни одного не осталось
+    bool wait(Result &done);
+    std::size_t pending() const { return outstanding; }
+
+    // перейти на потоки посреди работы, как при отказе кольца (для проверки запасного пути)
+    void fallBackToThreads();
+
+private:
+    struct Request;
+    class Ring;
+
+    void submitQueued();
+    bool start(Request &r);
+    void issue(std::size_t slot);
+    void advance(std::size_t slot, int res);
+    void complete(std::size_t slot, const std::string &error = std::string());
+    void fallBack();
+    void finish(std::unique_ptr<Request> r, const std::string &error = std::string());
+    void startWorkers();
+    void workerLoop();
+
+    int depth;
+    std::size_t outstanding = 0;
+    std::unique_ptr<Ring> uring;
+    std::deque<std::unique_ptr<Request>> queued;      // ещё не начаты
+    std::vector<std::unique_ptr<Request>> slots;      // в полёте (io_uring), индекс — user_data
+    std::vector<std::size_t> freeSlots;
+    // после отказа кольца: оно само и запросы, которые были в полёте, — до деструктора,
+    // ядро ещё может писать в их буферы; сами запросы заново выполняют потоки
+    std::unique_ptr<Ring> brokenRing;
+    std::vector<std::unique_ptr<Request>> orphaned;
+
+    // запасной путь
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake, completed;
+    bool stopping = false;
+    std::deque<std::unique_ptr<Request>> ready;       // завершённые
+};
+
+#endif // ASYNCFILEIO_H
@@ -0,0 +1,49 @@
+#ifndef BACKGROUND_H
+#define BACKGROUND_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Когда строить таблицы: сразу в конструкторе, в фоновом потоке
+// или позже по явному вызову buildTables().
+enum class TableBuild { Now, Background, Later };
+
+// Значение, которое может строиться в отдельном потоке. Пока оно не готово,
+// get() возвращает nullptr, и вызывающий код считает по точным формулам.
+// Владелец должен жить дольше потока: деструктор дожидается завершения.
+template<typename T>
+class BackgroundValue {
+public:
+    BackgroundValue() = default;
+    BackgroundValue(const BackgroundValue &) = delete;
+    BackgroundValue &operator=(const BackgroundValue &) = delete;
+    ~BackgroundValue() { wait(); }
+
+    // build() -> T; повторный вызов после запуска ничего не делает
+    template<typename Fn>
+    void run(TableBuild mode, Fn build) {
+        if (mode == TableBuild::Later || started.exchange(true)) return;
+        if (mode == TableBuild::Now) {
+            publish(build());
+        } else {
+            worker = std::thread([this, build]{ publish(build()); });
+        }
+    }
+
+    const T *get() const { return ready.load(std::memory_order_acquire); }
+    void wait() { if (worker.joinable()) worker.join(); }
+
+private:
+    void publish(T v) {
+        value = std::make_unique<T>(std::move(v));
+        ready.store(value.get(), std::memory_order_release);
+    }
+
+    std::unique_ptr<T> value;
+    std::atomic<const T *> ready{nullptr};
+    std::atomic<bool> started{false};
+    std::thread worker;
+};
+
+#endif // BACKGROUND_H
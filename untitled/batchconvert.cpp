@@ -0,0 +1,542 @@
+#include "batchconvert.h"
+#include "arena.h"
+#include "colorplanes.h"
+#include "lutcache.h"
+#include "parallel.h"
+#include "simdpixels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+
+namespace {
+
+// invGamma для всех 256 значений канала
+const double *linearTable8() {
+    static const auto table = []{
+        static double t[256];
+        for (int i = 0; i < 256; ++i) t[i] = invGamma(i / 255.0);
+        return t;
+    }();
+    return table;
+}
+
+// то же для 16 бит; float хватает по точности и вдвое экономит кэш (256 КБ).
+// Берётся из LutCache, если для него задан каталог.
+const float *linearTable16() {
+    static const std::shared_ptr<const float> table = LutCache::obtain("srgb-linear16", 0, 65536, [](float *t){
+        for (int i = 0; i < 65536; ++i) t[i] = float(invGamma(i / 65535.0));
+    });
+    return table.get();
+}
+
+static inline uint8_t toByte(double v01) {
+    return uint8_t(clampInt(int(std::lround(v01 * 255.0)), 0, 255));
+}
+
+static inline uint16_t toWord(double v01) {
+    return uint16_t(clampInt(int(std::lround(v01 * 65535.0)), 0, 65535));
+}
+
+// Упакованный Lab считается во float по кускам из LAB_CHUNK пикселей: отсчёты
+// раскладываются в плоскости на стеке, XYZ -> Lab и обратно идут по 4 пикселя
+// в регистре, а кодирование в Lab8 / Lab16 — сразу из этих плоскостей, без
+// промежуточного массива Lab из double.
+const int LAB_CHUNK = 64;
+
+// Кодирование ICC: Lab8 — L * 255 / 100, a + 128, b + 128; Lab16 — как encodeLab16.
+// Округление к ближайшему, значения вне диапазона обрезаются.
+void packLab8(const float *L, const float *A, const float *B, Lab8 *dst, int n) {
+    int i = 0;
+#ifdef COLOR_SSE2
+    const __m128 sL = _mm_set1_ps(2.55f);
+    const __m128i off = _mm_set1_epi16(128);
+    // обрезка во float до cvtps (за пределами int32 он даёт 0x80000000; NaN -> lo,
+    // как в encodeLab8) и сложение с насыщением: результат тот же, что у хвоста,
+    // где бы пиксель ни стоял в блоке из 16
+    const __m128 lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+    auto codes = [&](const float *p, __m128 scale, __m128i offset) {
+        __m128i q[4];
+        for (int k = 0; k < 4; ++k)
+            q[k] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(p + 4 * k), scale), lo), hi));
+        return _mm_packus_epi16(_mm_adds_epi16(_mm_packs_epi32(q[0], q[1]), offset),
+                                _mm_adds_epi16(_mm_packs_epi32(q[2], q[3]), offset));
+    };
+    for (; i + 16 <= n; i += 16) {
+        __m128i l = codes(L + i, sL, _mm_setzero_si128());
+        __m128i a = codes(A + i, _mm_set1_ps(1.0f), off);
+        __m128i b = codes(B + i, _mm_set1_ps(1.0f), off);
+        storeInterleave3(reinterpret_cast<uint8_t *>(dst + i), l, a, b);
+    }
+#endif
+    for (; i < n; ++i) dst[i] = encodeLab8({ L[i], A[i], B[i] });
+}
+
+void unpackLab8(const Lab8 *src, float *L, float *A, float *B, int n) {
+    int i = 0;
+#ifdef COLOR_SSE2
+    const __m128i z = _mm_setzero_si128();
+    auto spread = [&](__m128i v, float *p, __m128 scale, __m128 offset) {
+        __m128i w[2] = { _mm_unpacklo_epi8(v, z), _mm_unpackhi_epi8(v, z) };
+        for (int k = 0; k < 2; ++k) {
+            _mm_storeu_ps(p + 8 * k, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(w[k], z)), scale), offset));
+            _mm_storeu_ps(p + 8 * k + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(w[k], z)), scale), offset));
+        }
+    };
+    for (; i + 16 <= n; i += 16) {
+        __m128i l, a, b;
+        loadDeinterleave3(reinterpret_cast<const uint8_t *>(src + i), l, a, b);
+        spread(l, L + i, _mm_set1_ps(100.0f / 255.0f), _mm_setzero_ps());
+        spread(a, A + i, _mm_set1_ps(1.0f), _mm_set1_ps(-128.0f));
+        spread(b, B + i, _mm_set1_ps(1.0f), _mm_set1_ps(-128.0f));
+    }
+#endif
+    for (; i < n; ++i) {
+        Lab lab = decodeLab8(src[i]);
+        L[i] = float(lab.L); A[i] = float(lab.a); B[i] = float(lab.b);
+    }
+}
+
+void packLab16(const float *L, const float *A, const float *B, Lab16 *dst, int n) {
+    int i = 0;
+#ifdef COLOR_SSE2
+    // без packus_epi32 (SSE4.1): обрезаем во float, сдвигаем в знаковый диапазон и обратно
+    const __m128 lo = _mm_setzero_ps(), hi = _mm_set1_ps(65535.0f);
+    const __m128i bias32 = _mm_set1_epi32(32768), bias16 = _mm_set1_epi16(short(0x8000));
+    auto codes = [&](const float *p, __m128 scale, __m128 offset) {
+        __m128i q[2];
+        for (int k = 0; k < 2; ++k) {
+            __m128 v = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(p + 4 * k), offset), scale);
+            q[k] = _mm_sub_epi32(_mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi)), bias32);
+        }
+        return _mm_xor_si128(_mm_packs_epi32(q[0], q[1]), bias16);
+    };
+    alignas(16) uint16_t l[8], a[8], b[8];
+    for (; i + 8 <= n; i += 8) {
+        _mm_store_si128(reinterpret_cast<__m128i *>(l), codes(L + i, _mm_set1_ps(655.35f), _mm_setzero_ps()));
+        _mm_store_si128(reinterpret_cast<__m128i *>(a), codes(A + i, _mm_set1_ps(257.0f), _mm_set1_ps(128.0f)));
+        _mm_store_si128(reinterpret_cast<__m128i *>(b), codes(B + i, _mm_set1_ps(257.0f), _mm_set1_ps(128.0f)));
+        for (int k = 0; k < 8; ++k) dst[i + k] = { l[k], a[k], b[k] };
+    }
+#endif
+    for (; i < n; ++i) dst[i] = encodeLab16({ L[i], A[i], B[i] });
+}
+
+void unpackLab16(const Lab16 *src, float *L, float *A, float *B, int n) {
+    for (int i = 0; i < n; ++i) {
+        L[i] = src[i].L * (1.0f / 655.35f);
+        A[i] = src[i].a * (1.0f / 257.0f) - 128.0f;
+        B[i] = src[i].b * (1.0f / 257.0f) - 128.0f;
+    }
+}
+
+// float-таблица линеаризации 8 бит для плоскостного пути
+const float *linearTable8f() {
+    static const auto table = []{
+        static float t[256];
+        for (int i = 0; i < 256; ++i) t[i] = float(linearTable8()[i]);
+        return t;
+    }();
+    return table;
+}
+
+// Рабочие плоскости одного куска: три входных и три выходных.
+struct LabChunk {
+    float p[6][LAB_CHUNK];
+};
+
+// линеаризованный RGB куска -> XYZ в c.p[3..5]; хвост до кратного 4 обнуляется
+template<typename T>
+void rgbChunkToXyz(const T *rgb, int channels, const float *lin, LabChunk &c, int n) {
+    int n4 = (n + 3) & ~3;
+    for (int i = 0; i < n; ++i, rgb += channels) {
+        c.p[0][i] = lin[rgb[0]]; c.p[1][i] = lin[rgb[1]]; c.p[2][i] = lin[rgb[2]];
+    }
+    for (int i = n; i < n4; ++i) c.p[0][i] = c.p[1][i] = c.p[2][i] = 0.0f;
+    linearToXyzPlanes(c.p[0], c.p[1], c.p[2], c.p[3], c.p[4], c.p[5], n4);
+}
+
+// то же и дальше в Lab, тоже в c.p[3..5]
+template<typename T>
+void rgbChunkToLab(const T *rgb, int channels, const float *lin, LabChunk &c, int n) {
+    rgbChunkToXyz(rgb, channels, lin, c, n);
+    xyzToLabPlanes(c.p[3], c.p[4], c.p[5], c.p[3], c.p[4], c.p[5], (n + 3) & ~3);
+}
+
+// XYZ из double в плоскости куска и Lab в c.p[3..5]
+void xyzChunkToLab(const XYZ *xyz, LabChunk &c, int n) {
+    int n4 = (n + 3) & ~3;
+    for (int i = 0; i < n; ++i) {
+        c.p[0][i] = float(xyz[i].X); c.p[1][i] = float(xyz[i].Y); c.p[2][i] = float(xyz[i].Z);
+    }
+    for (int i = n; i < n4; ++i) c.p[0][i] = c.p[1][i] = c.p[2][i] = 0.0f;
+    xyzToLabPlanes(c.p[0], c.p[1], c.p[2], c.p[3], c.p[4], c.p[5], n4);
+}
+
+// Lab в c.p[0..2] (хвост обнулён) -> XYZ
+void labChunkToXyz(LabChunk &c, XYZ *xyz, int n) {
+    int n4 = (n + 3) & ~3;
+    for (int i = n; i < n4; ++i) c.p[0][i] = c.p[1][i] = c.p[2][i] = 0.0f;
+    labToXyzPlanes(c.p[0], c.p[1], c.p[2], c.p[3], c.p[4], c.p[5], n4);
+    for (int i = 0; i < n; ++i) xyz[i] = { c.p[3][i], c.p[4][i], c.p[5][i] };
+}
+
+// общий проход по строкам изображения для функций без счётчика обрезаний
+template<typename Src, typename Dst, typename Fn>
+void forEachRow(const ImageView<Src> &src, const ImageView<Dst> &dst, Fn fn) {
+    parallelFor(src.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y) fn(src.row(y), dst.row(y), std::size_t(src.width));
+    });
+}
+
+// Тайл в пикселях для преобразований на месте: 1024 пикселя RGB16 — 6 КБ,
+// копия и результат остаются в L1
+const std::size_t IN_PLACE_TILE = 1024;
+
+// Тайл копируется в арену, и уже из копии результат пишется в исходную память:
+// чтение тайла всегда завершено до первой записи в него.
+// fn(const T *src, T *dst, n) возвращает счётчик (число обрезанных пикселей или 0).
+template<typename T, typename Fn>
+std::size_t inPlaceTiles(T *pixels, int channels, std::size_t count, Fn fn) {
+    ArenaScope scratch;
+    T *tile = scratch.allocate<T>(IN_PLACE_TILE * channels);
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < count; i += IN_PLACE_TILE) {
+        std::size_t n = std::min(IN_PLACE_TILE, count - i);
+        T *at = pixels + i * channels;
+        std::copy(at, at + n * channels, tile);
+        total += fn(tile, at, n);
+    }
+    return total;
+}
+
+// строки изображения на месте
+template<typename T, typename Fn>
+std::size_t forEachRowInPlace(const ImageView<T> &image, Fn fn) {
+    ArenaScope scratch;
+    std::size_t *perRow = scratch.allocate<std::size_t>(std::size_t(std::max(0, image.height)));
+    parallelFor(image.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y) perRow[y] = fn(image.row(y), std::size_t(image.width));
+    });
+    std::size_t total = 0;
+    for (int y = 0; y < image.height; ++y) total += perRow[y];
+    return total;
+}
+
+template<typename Src, typename Dst, typename Fn>
+std::size_t forEachRowCounted(const ImageView<Src> &src, const ImageView<Dst> &dst, Fn fn) {
+    ArenaScope scratch;
+    std::size_t *perRow = scratch.allocate<std::size_t>(std::size_t(std::max(0, src.height)));
+    parallelFor(src.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y) perRow[y] = fn(src.row(y), dst.row(y), std::size_t(src.width));
+    });
+    std::size_t total = 0;
+    for (int y = 0; y < src.height; ++y) total += perRow[y];
+    return total;
+}
+
+}
+
+void rgbToLabBatch(const uint8_t *rgb, int channels, Lab *lab, std::size_t count) {
+    const double *lin = linearTable8();
+    for (std::size_t i = 0; i < count; ++i, rgb += channels)
+        lab[i] = xyzToLab(linearRgbToXyz(lin[rgb[0]], lin[rgb[1]], lin[rgb[2]]));
+}
+
+void rgbToCmykBatch(const uint8_t *rgb, int channels, CMYK *cmyk, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        int mx = std::max({rgb[0], rgb[1], rgb[2]});
+        if (mx == 0) { cmyk[i] = {0.0, 0.0, 0.0, 1.0}; continue; }
+        // (1 - v/255 - k) / (1 - k) при k = 1 - max/255 сводится к (max - v) / max
+        double inv = 1.0 / mx;
+        cmyk[i] = { (mx - rgb[0]) * inv, (mx - rgb[1]) * inv, (mx - rgb[2]) * inv, 1.0 - mx / 255.0 };
+    }
+}
+
+void cmykToRgbBatch(const CMYK *cmyk, uint8_t *rgb, int channels, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        double w = 1.0 - cmyk[i].k;
+        rgb[0] = toByte((1.0 - cmyk[i].c) * w);
+        rgb[1] = toByte((1.0 - cmyk[i].m) * w);
+        rgb[2] = toByte((1.0 - cmyk[i].y) * w);
+    }
+}
+
+std::size_t labToRgbBatch(const Lab *lab, uint8_t *rgb, int channels, std::size_t count,
+                          uint8_t *clipMask) {
+    std::size_t clipped = 0;
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        auto [px, clip] = labToRgb(lab[i]);
+        rgb[0] = uint8_t(px.r); rgb[1] = uint8_t(px.g); rgb[2] = uint8_t(px.b);
+        if (clipMask) clipMask[i] = clip ? 1 : 0;
+        clipped += clip ? 1 : 0;
+    }
+    return clipped;
+}
+
+void rgb16ToLabBatch(const uint16_t *rgb, int channels, Lab *lab, std::size_t count) {
+    const float *lin = linearTable16();
+    for (std::size_t i = 0; i < count; ++i, rgb += channels)
+        lab[i] = xyzToLab(linearRgbToXyz(lin[rgb[0]], lin[rgb[1]], lin[rgb[2]]));
+}
+
+void rgb16ToLab16Batch(const uint16_t *rgb, int channels, Lab16 *lab, std::size_t count) {
+    const float *lin = linearTable16();
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        rgbChunkToLab(rgb + i * channels, channels, lin, c, n);
+        packLab16(c.p[3], c.p[4], c.p[5], lab + i, n);
+    }
+}
+
+void rgb16ToCmyk16Batch(const uint16_t *rgb, int channels, CMYK16 *cmyk, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        int mx = std::max({rgb[0], rgb[1], rgb[2]});
+        if (mx == 0) { cmyk[i] = {0, 0, 0, 65535}; continue; }
+        double s = 65535.0 / mx;
+        cmyk[i] = { uint16_t(std::lround((mx - rgb[0]) * s)), uint16_t(std::lround((mx - rgb[1]) * s)),
+                    uint16_t(std::lround((mx - rgb[2]) * s)), uint16_t(65535 - mx) };
+    }
+}
+
+void cmyk16ToRgb16Batch(const CMYK16 *cmyk, uint16_t *rgb, int channels, std::size_t count) {
+    const double inv = 1.0 / (65535.0 * 65535.0);
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        double w = 65535.0 - cmyk[i].k;
+        rgb[0] = toWord((65535.0 - cmyk[i].c) * w * inv);
+        rgb[1] = toWord((65535.0 - cmyk[i].m) * w * inv);
+        rgb[2] = toWord((65535.0 - cmyk[i].y) * w * inv);
+    }
+}
+
+std::size_t lab16ToRgb16Batch(const Lab16 *lab, uint16_t *rgb, int channels, std::size_t count,
+                              uint8_t *clipMask) {
+    std::size_t clipped = 0;
+    LabChunk c;
+    XYZ xyz[LAB_CHUNK];
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        std::size_t j = i % LAB_CHUNK;
+        if (j == 0) {
+            int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+            unpackLab16(lab + i, c.p[0], c.p[1], c.p[2], n);
+            labChunkToXyz(c, xyz, n);
+        }
+        auto [px, clip] = xyzToRgb16(xyz[j]);
+        rgb[0] = uint16_t(px.r); rgb[1] = uint16_t(px.g); rgb[2] = uint16_t(px.b);
+        if (clipMask) clipMask[i] = clip ? 1 : 0;
+        clipped += clip ? 1 : 0;
+    }
+    return clipped;
+}
+
+void rgbToLab8Batch(const uint8_t *rgb, int channels, Lab8 *lab, std::size_t count) {
+    const float *lin = linearTable8f();
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        rgbChunkToLab(rgb + i * channels, channels, lin, c, n);
+        packLab8(c.p[3], c.p[4], c.p[5], lab + i, n);
+    }
+}
+
+std::size_t lab8ToRgbBatch(const Lab8 *lab, uint8_t *rgb, int channels, std::size_t count,
+                           uint8_t *clipMask) {
+    std::size_t clipped = 0;
+    LabChunk c;
+    XYZ xyz[LAB_CHUNK];
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        std::size_t j = i % LAB_CHUNK;
+        if (j == 0) {
+            int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+            unpackLab8(lab + i, c.p[0], c.p[1], c.p[2], n);
+            labChunkToXyz(c, xyz, n);
+        }
+        auto [px, clip] = xyzToRgb(xyz[j]);
+        rgb[0] = uint8_t(px.r); rgb[1] = uint8_t(px.g); rgb[2] = uint8_t(px.b);
+        if (clipMask) clipMask[i] = clip ? 1 : 0;
+        clipped += clip ? 1 : 0;
+    }
+    return clipped;
+}
+
+void rgbToXyzBatch(const uint8_t *rgb, int channels, XYZ *xyz, std::size_t count) {
+    const float *lin = linearTable8f();
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        rgbChunkToXyz(rgb + i * channels, channels, lin, c, n);
+        for (int j = 0; j < n; ++j) xyz[i + j] = { c.p[3][j], c.p[4][j], c.p[5][j] };
+    }
+}
+
+void rgb16ToXyzBatch(const uint16_t *rgb, int channels, XYZ *xyz, std::size_t count) {
+    const float *lin = linearTable16();
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        rgbChunkToXyz(rgb + i * channels, channels, lin, c, n);
+        for (int j = 0; j < n; ++j) xyz[i + j] = { c.p[3][j], c.p[4][j], c.p[5][j] };
+    }
+}
+
+void xyzToLabBatch(const XYZ *xyz, Lab *lab, std::size_t count) {
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        xyzChunkToLab(xyz + i, c, n);
+        for (int j = 0; j < n; ++j) lab[i + j] = { c.p[3][j], c.p[4][j], c.p[5][j] };
+    }
+}
+
+void deltaEBatch(const Lab *lab, const Lab &ref, double *dE, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) dE[i] = deltaE76(lab[i], ref);
+}
+
+void xyzToLab8Batch(const XYZ *xyz, Lab8 *lab, std::size_t count) {
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        xyzChunkToLab(xyz + i, c, n);
+        packLab8(c.p[3], c.p[4], c.p[5], lab + i, n);
+    }
+}
+
+void lab8ToXyzBatch(const Lab8 *lab, XYZ *xyz, std::size_t count) {
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        unpackLab8(lab + i, c.p[0], c.p[1], c.p[2], n);
+        labChunkToXyz(c, xyz + i, n);
+    }
+}
+
+void xyzToLab16Batch(const XYZ *xyz, Lab16 *lab, std::size_t count) {
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        xyzChunkToLab(xyz + i, c, n);
+        packLab16(c.p[3], c.p[4], c.p[5], lab + i, n);
+    }
+}
+
+void lab16ToXyzBatch(const Lab16 *lab, XYZ *xyz, std::size_t count) {
+    LabChunk c;
+    for (std::size_t i = 0; i < count; i += LAB_CHUNK) {
+        int n = int(std::min<std::size_t>(LAB_CHUNK, count - i));
+        unpackLab16(lab + i, c.p[0], c.p[1], c.p[2], n);
+        labChunkToXyz(c, xyz + i, n);
+    }
+}
+
+void rgbToCmyk8Batch(const uint8_t *rgb, int channels, CMYK8 *cmyk, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        int mx = std::max({rgb[0], rgb[1], rgb[2]});
+        if (mx == 0) { cmyk[i] = {0, 0, 0, 255}; continue; }
+        // как в rgbToCmykBatch, в целых: (max - v) * 255 / max с округлением
+        auto ink = [mx](int v){ return uint8_t(((mx - v) * 510 + mx) / (2 * mx)); };
+        cmyk[i] = { ink(rgb[0]), ink(rgb[1]), ink(rgb[2]), uint8_t(255 - mx) };
+    }
+}
+
+void rgbToLab8InPlace(uint8_t *pixels, std::size_t count) {
+    inPlaceTiles(pixels, 3, count, [](const uint8_t *src, uint8_t *dst, std::size_t n){
+        rgbToLab8Batch(src, 3, reinterpret_cast<Lab8 *>(dst), n);
+        return std::size_t(0);
+    });
+}
+
+std::size_t lab8ToRgbInPlace(uint8_t *pixels, std::size_t count) {
+    return inPlaceTiles(pixels, 3, count, [](const uint8_t *src, uint8_t *dst, std::size_t n){
+        return lab8ToRgbBatch(reinterpret_cast<const Lab8 *>(src), dst, 3, n);
+    });
+}
+
+void rgb16ToLab16InPlace(uint16_t *pixels, std::size_t count) {
+    inPlaceTiles(pixels, 3, count, [](const uint16_t *src, uint16_t *dst, std::size_t n){
+        rgb16ToLab16Batch(src, 3, reinterpret_cast<Lab16 *>(dst), n);
+        return std::size_t(0);
+    });
+}
+
+std::size_t lab16ToRgb16InPlace(uint16_t *pixels, std::size_t count) {
+    return inPlaceTiles(pixels, 3, count, [](const uint16_t *src, uint16_t *dst, std::size_t n){
+        return lab16ToRgb16Batch(reinterpret_cast<const Lab16 *>(src), dst, 3, n);
+    });
+}
+
+void rgbaToCmyk8InPlace(uint8_t *pixels, std::size_t count) {
+    inPlaceTiles(pixels, 4, count, [](const uint8_t *src, uint8_t *dst, std::size_t n){
+        rgbToCmyk8Batch(src, 4, reinterpret_cast<CMYK8 *>(dst), n);
+        return std::size_t(0);
+    });
+}
+
+void rgbToLabImage(const ImageView<const uint8_t> &rgb, const ImageView<Lab> &lab) {
+    forEachRow(rgb, lab, [&](const uint8_t *src, Lab *dst, std::size_t n){ rgbToLabBatch(src, rgb.channels, dst, n); });
+}
+
+void rgbToCmykImage(const ImageView<const uint8_t> &rgb, const ImageView<CMYK> &cmyk) {
+    forEachRow(rgb, cmyk, [&](const uint8_t *src, CMYK *dst, std::size_t n){ rgbToCmykBatch(src, rgb.channels, dst, n); });
+}
+
+void cmykToRgbImage(const ImageView<const CMYK> &cmyk, const ImageView<uint8_t> &rgb) {
+    forEachRow(cmyk, rgb, [&](const CMYK *src, uint8_t *dst, std::size_t n){ cmykToRgbBatch(src, dst, rgb.channels, n); });
+}
+
+std::size_t labToRgbImage(const ImageView<const Lab> &lab, const ImageView<uint8_t> &rgb) {
+    return forEachRowCounted(lab, rgb, [&](const Lab *src, uint8_t *dst, std::size_t n){
+        return labToRgbBatch(src, dst, rgb.channels, n);
+    });
+}
+
+void rgb16ToLab16Image(const ImageView<const uint16_t> &rgb, const ImageView<Lab16> &lab) {
+    forEachRow(rgb, lab, [&](const uint16_t *src, Lab16 *dst, std::size_t n){ rgb16ToLab16Batch(src, rgb.channels, dst, n); });
+}
+
+void rgb16ToCmyk16Image(const ImageView<const uint16_t> &rgb, const ImageView<CMYK16> &cmyk) {
+    forEachRow(rgb, cmyk, [&](const uint16_t *src, CMYK16 *dst, std::size_t n){ rgb16ToCmyk16Batch(src, rgb.channels, dst, n); });
+}
+
+void cmyk16ToRgb16Image(const ImageView<const CMYK16> &cmyk, const ImageView<uint16_t> &rgb) {
+    forEachRow(cmyk, rgb, [&](const CMYK16 *src, uint16_t *dst, std::size_t n){ cmyk16ToRgb16Batch(src, dst, rgb.channels, n); });
+}
+
+std::size_t lab16ToRgb16Image(const ImageView<const Lab16> &lab, const ImageView<uint16_t> &rgb) {
+    return forEachRowCounted(lab, rgb, [&](const Lab16 *src, uint16_t *dst, std::size_t n){
+        return lab16ToRgb16Batch(src, dst, rgb.channels, n);
+    });
+}
+
+bool rgbToLab8ImageInPlace(const ImageView<uint8_t> &image) {
+    if (image.channels != 3) return false;
+    forEachRowInPlace(image, [](uint8_t *row, std::size_t n){ rgbToLab8InPlace(row, n); return std::size_t(0); });
+    return true;
+}
+
+bool lab8ToRgbImageInPlace(const ImageView<uint8_t> &image, std::size_t *outOfGamut) {
+    if (image.channels != 3) return false;
+    std::size_t clipped = forEachRowInPlace(image, [](uint8_t *row, std::size_t n){ return lab8ToRgbInPlace(row, n); });
+    if (outOfGamut) *outOfGamut = clipped;
+    return true;
+}
+
+bool rgb16ToLab16ImageInPlace(const ImageView<uint16_t> &image) {
+    if (image.channels != 3) return false;
+    forEachRowInPlace(image, [](uint16_t *row, std::size_t n){ rgb16ToLab16InPlace(row, n); return std::size_t(0); });
+    return true;
+}
+
+bool lab16ToRgb16ImageInPlace(const ImageView<uint16_t> &image, std::size_t *outOfGamut) {
+    if (image.channels != 3) return false;
+    std::size_t clipped = forEachRowInPlace(image, [](uint16_t *row, std::size_t n){ return lab16ToRgb16InPlace(row, n); });
+    if (outOfGamut) *outOfGamut = clipped;
+    return true;
+}
+
+bool rgbaToCmyk8ImageInPlace(const ImageView<uint8_t> &image) {
+    if (image.channels != 4) return false;
+    forEachRowInPlace(image, [](uint8_t *row, std::size_t n){ rgbaToCmyk8InPlace(row, n); return std::size_t(0); });
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef BATCHCONVERT_H
+#define BATCHCONVERT_H
+
+#include "colormodels.h"
+#include "imagebuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Пакетные преобразования над непрерывными массивами пикселей.
+// rgb — 8-битные отсчёты, channels = 3 (RGB) или 4 (RGBA, альфа игнорируется).
+void rgbToLabBatch(const uint8_t *rgb, int channels, Lab *lab, std::size_t count);
+void rgbToCmykBatch(const uint8_t *rgb, int channels, CMYK *cmyk, std::size_t count);
+void cmykToRgbBatch(const CMYK *cmyk, uint8_t *rgb, int channels, std::size_t count);
+
+// Возвращает число пикселей, вышедших за 0..255; clipMask (если задан) получает 1 для них.
+std::size_t labToRgbBatch(const Lab *lab, uint8_t *rgb, int channels, std::size_t count,
+                          uint8_t *clipMask = nullptr);
+
+// 16-битные варианты: rgb — uint16_t 0..65535, channels = 3 или 4.
+// Линеаризация идёт по таблице на все 65536 значений, без перехода через 8 бит.
+void rgb16ToLabBatch(const uint16_t *rgb, int channels, Lab *lab, std::size_t count);
+void rgb16ToLab16Batch(const uint16_t *rgb, int channels, Lab16 *lab, std::size_t count);
+void rgb16ToCmyk16Batch(const uint16_t *rgb, int channels, CMYK16 *cmyk, std::size_t count);
+void cmyk16ToRgb16Batch(const CMYK16 *cmyk, uint16_t *rgb, int channels, std::size_t count);
+std::size_t lab16ToRgb16Batch(const Lab16 *lab, uint16_t *rgb, int channels, std::size_t count,
+                              uint8_t *clipMask = nullptr);
+
+// Промежуточные шаги тем же float-путём (для цепочек из pixelviews.h).
+void rgbToXyzBatch(const uint8_t *rgb, int channels, XYZ *xyz, std::size_t count);
+void rgb16ToXyzBatch(const uint16_t *rgb, int channels, XYZ *xyz, std::size_t count);
+void xyzToLabBatch(const XYZ *xyz, Lab *lab, std::size_t count);
+void deltaEBatch(const Lab *lab, const Lab &ref, double *dE, std::size_t count);
+
+// 8-битные Lab8 / CMYK8 (кодировки см. colormodels.h).
+// Пути в упакованный Lab и обратно (в т.ч. rgb16ToLab16Batch / lab16ToRgb16Batch)
+// считают XYZ <-> Lab во float по 4 пикселя в регистре и кодируют результат сразу
+// из регистров; от точных формул отличаются не больше чем на единицу кода.
+void xyzToLab8Batch(const XYZ *xyz, Lab8 *lab, std::size_t count);
+void lab8ToXyzBatch(const Lab8 *lab, XYZ *xyz, std::size_t count);
+void xyzToLab16Batch(const XYZ *xyz, Lab16 *lab, std::size_t count);
+void lab16ToXyzBatch(const Lab16 *lab, XYZ *xyz, std::size_t count);
+void rgbToLab8Batch(const uint8_t *rgb, int channels, Lab8 *lab, std::size_t count);
+std::size_t lab8ToRgbBatch(const Lab8 *lab, uint8_t *rgb, int channels, std::size_t count,
+                           uint8_t *clipMask = nullptr);
+void rgbToCmyk8Batch(const uint8_t *rgb, int channels, CMYK8 *cmyk, std::size_t count);
+
+// Преобразования на месте для кодировок одного размера: RGB8 <-> Lab8 (3 байта),
+// RGB16 <-> Lab16 (3 слова), RGBA8 -> CMYK8 (4 байта). Буфер обрабатывается
+// тайлами: тайл сначала целиком читается во временный буфер арены и только
+// потом перезаписывается, так что второй буфер на всё изображение не нужен.
+void rgbToLab8InPlace(uint8_t *pixels, std::size_t count);
+std::size_t lab8ToRgbInPlace(uint8_t *pixels, std::size_t count);
+void rgb16ToLab16InPlace(uint16_t *pixels, std::size_t count);
+std::size_t lab16ToRgb16InPlace(uint16_t *pixels, std::size_t count);
+void rgbaToCmyk8InPlace(uint8_t *pixels, std::size_t count);
+
+// Те же преобразования для целых изображений, строки обрабатываются параллельно.
+// Изображения Lab/CMYK — по одному элементу на пиксель (channels = 1).
+void rgbToLabImage(const ImageView<const uint8_t> &rgb, const ImageView<Lab> &lab);
+void rgbToCmykImage(const ImageView<const uint8_t> &rgb, const ImageView<CMYK> &cmyk);
+void cmykToRgbImage(const ImageView<const CMYK> &cmyk, const ImageView<uint8_t> &rgb);
+std::size_t labToRgbImage(const ImageView<const Lab> &lab, const ImageView<uint8_t> &rgb);
+
+void rgb16ToLab16Image(const ImageView<const uint16_t> &rgb, const ImageView<Lab16> &lab);
+void rgb16ToCmyk16Image(const ImageView<const uint16_t> &rgb, const ImageView<CMYK16> &cmyk);
+void cmyk16ToRgb16Image(const ImageView<const CMYK16> &cmyk, const ImageView<uint16_t> &rgb);
+std::size_t lab16ToRgb16Image(const ImageView<const Lab16> &lab, const ImageView<uint16_t> &rgb);
+
+// На месте: channels = 3 (Lab) или 4 (CMYK8); строки параллельно, внутри строки — тайлами.
+// Изображение с другим числом каналов не трогается, функции возвращают false;
+// outOfGamut получает число обрезанных пикселей.
+bool rgbToLab8ImageInPlace(const ImageView<uint8_t> &image);
+bool lab8ToRgbImageInPlace(const ImageView<uint8_t> &image, std::size_t *outOfGamut = nullptr);
+bool rgb16ToLab16ImageInPlace(const ImageView<uint16_t> &image);
+bool lab16ToRgb16ImageInPlace(const ImageView<uint16_t> &image, std::size_t *outOfGamut = nullptr);
+bool rgbaToCmyk8ImageInPlace(const ImageView<uint8_t> &image);
+
+#endif // BATCHCONVERT_H
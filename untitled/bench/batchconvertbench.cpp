@@ -0,0 +1,40 @@
+#include "batchconvert.h"
+#include "bench.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+
+// кадр 1080p RGB8 <-> Lab8: плоскости float с кодированием из регистров против
+// точной формулы в double по пикселю (rgbToLab + encodeLab8)
+BENCH(lab8Frame) {
+    const int w = 1920, h = 1080;
+    Image<uint8_t> rgb(w, h, 3), back(w, h, 3);
+    Image<Lab8> lab(w, h, 1), exact(w, h, 1);
+    for (std::size_t i = 0; i < rgb.pixels.size(); ++i) rgb.pixels[i] = uint8_t(i * 7 + (i >> 10));
+
+    auto rows = [&](auto fn){ parallelFor(h, ROWS_PER_TASK, [&](int y0, int y1){ for (int y = y0; y < y1; ++y) fn(y); }); };
+    const double batch = medianMs([&]{
+        rows([&](int y){ rgbToLab8Batch(rgb.view().row(y), 3, lab.view().row(y), std::size_t(w)); });
+    });
+    const double scalar = medianMs([&]{
+        rows([&](int y){
+            const uint8_t *p = rgb.view().row(y);
+            Lab8 *out = exact.view().row(y);
+            for (int x = 0; x < w; ++x, p += 3) out[x] = encodeLab8(rgbToLab(RGB{ p[0], p[1], p[2] }));
+        });
+    });
+    const double inverse = medianMs([&]{
+        rows([&](int y){ lab8ToRgbBatch(lab.view().row(y), back.view().row(y), 3, std::size_t(w)); });
+    });
+
+    int worst = 0;
+    for (std::size_t i = 0; i < lab.pixels.size(); ++i) {
+        const Lab8 &a = lab.pixels[i], &b = exact.pixels[i];
+        worst = std::max({ worst, std::abs(a.L - b.L), std::abs(a.a - b.a), std::abs(a.b - b.b) });
+    }
+    std::fprintf(stderr, "  rgb8 -> lab8  batch %6.2f ms   double per pixel %7.2f ms   x%.1f, max diff %d code\n",
+                 batch, scalar, scalar / batch, worst);
+    std::fprintf(stderr, "  lab8 -> rgb8  batch %6.2f ms\n", inverse);
+}
@@ -0,0 +1,20 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdio>
+#include <functional>
+
+// Замеры ядер, на которые ссылаются описания изменений: BENCH(имя) регистрирует
+// функцию, medianMs — медиана времени нескольких запусков. Запуск:
+// bench [часть имени] [--rounds N]; результаты — в stderr.
+
+int registerBench(const char *name, void (*fn)());
+int benchRounds();
+double medianMs(const std::function<void()> &run);
+
+#define BENCH(name) \
+    static void name(); \
+    static const int name##Registered = registerBench(#name, name); \
+    static void name()
+
+#endif // BENCH_H
@@ -0,0 +1,49 @@
+# Замеры ядер: консольная программа без Qt, собирается вместе с исходниками
+# из ../ (всё, кроме окна). Запуск: bench [часть имени] [--rounds N].
+
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= qt app_bundle
+TARGET = bench
+
+INCLUDEPATH += ..
+unix: LIBS += -pthread
+
+SOURCES += \
+    benchmain.cpp \
+    adjustmentsbench.cpp \
+    batchconvertbench.cpp \
+    gamutmapbench.cpp \
+    pixelviewsbench.cpp \
+    ycbcrbench.cpp \
+    ../adjustments.cpp \
+    ../arena.cpp \
+    ../asyncfileio.cpp \
+    ../batchconvert.cpp \
+    ../cmyklab.cpp \
+    ../colorgraph.cpp \
+    ../colorlist.cpp \
+    ../colormodels.cpp \
+    ../colorplanes.cpp \
+    ../conversiondaemon.cpp \
+    ../gamutmap.cpp \
+    ../hdrinput.cpp \
+    ../iccprofile.cpp \
+    ../icctransform.cpp \
+    ../inkcoverage.cpp \
+    ../lut.cpp \
+    ../lutcache.cpp \
+    ../mappedfile.cpp \
+    ../parallel.cpp \
+    ../pipeline.cpp \
+    ../separation.cpp \
+    ../separationwriter.cpp \
+    ../softproof.cpp \
+    ../swatchlibrary.cpp \
+    ../tiffconvert.cpp \
+    ../tiffio.cpp \
+    ../tiledimage.cpp \
+    ../ycbcr.cpp
+
+HEADERS += \
+    bench.h
@@ -0,0 +1,59 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+struct BenchCase {
+    const char *name;
+    void (*fn)();
+};
+
+std::vector<BenchCase> &registry() {
+    static std::vector<BenchCase> benches;
+    return benches;
+}
+
+int rounds = 7;
+
+}
+
+int registerBench(const char *name, void (*fn)()) {
+    registry().push_back({ name, fn });
+    return 0;
+}
+
+int benchRounds() {
+    return rounds;
+}
+
+double medianMs(const std::function<void()> &run) {
+    run();      // прогрев: таблицы, арены, пул потоков
+    std::vector<double> times;
+    for (int r = 0; r < rounds; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char *argv[]) {
+    const char *filter = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) rounds = std::max(1, std::atoi(argv[++i]));
+        else filter = argv[i];
+    }
+    for (const BenchCase &b : registry()) {
+        if (filter && !std::strstr(b.name, filter)) continue;
+        std::fprintf(stderr, "%s\n", b.name);
+        b.fn();
+    }
+    return 0;
+}
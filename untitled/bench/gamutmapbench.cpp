@@ -0,0 +1,23 @@
+#include "bench.h"
+#include "gamutmap.h"
+#include "parallel.h"
+
+
+// кадр 1080p Lab -> RGB8, большая часть за охватом: отображение по хроме
+// (таблица границы и бисекция у выступов) против простой обрезки
+BENCH(gamutMapFrame) {
+    const int w = 1920, h = 1080;
+    Image<Lab> lab(w, h, 1);
+    Image<uint8_t> clip(w, h, 3), chroma(w, h, 3);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            lab.pixels[std::size_t(y) * w + x] = Lab{ 100.0 * y / (h - 1), 256.0 * x / w - 128.0,
+                                                       120.0 * ((x * 7 + y * 13) % 257) / 128.0 - 120.0 };
+
+    std::size_t outside = 0;
+    const double clipMs = medianMs([&]{ outside = labToRgbMappedImage(lab.view(), clip.view(), GamutMapping::Clip); });
+    const double chromaMs = medianMs([&]{ labToRgbMappedImage(lab.view(), chroma.view(), GamutMapping::Chroma); });
+
+    std::fprintf(stderr, "  clip %6.2f ms   chroma %6.2f ms   x%.2f, %.0f%% out of gamut\n",
+                 clipMs, chromaMs, chromaMs / clipMs, 100.0 * double(outside) / double(lab.pixels.size()));
+}
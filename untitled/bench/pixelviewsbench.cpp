@@ -0,0 +1,36 @@
+#include "bench.h"
+#include "pixelviews.h"
+
+#include <vector>
+
+
+// 6 Мп RGBA, средний и максимальный ΔE к образцу: ленивая цепочка кусками
+// против Lab на всё изображение и отдельного прохода ΔE
+BENCH(pixelViewsDeltaE) {
+    const int w = 3000, h = 2000;
+    Image<uint8_t> rgba(w, h, 4);
+    for (std::size_t i = 0; i < rgba.pixels.size(); ++i) rgba.pixels[i] = uint8_t(i * 13 + (i >> 12));
+    const Lab ref = { 50.0, 10.0, -20.0 };
+
+    PixelViews::Summary lazy;
+    const double chained = medianMs([&]{
+        using namespace PixelViews;
+        lazy = summarize(pixels(rgba.view()) | toXyz() | toLab() | deltaE(ref), 2.0);
+    });
+
+    Image<Lab> lab(w, h, 1);
+    std::vector<double> rowMax(h), rowSum(h);
+    const double materialised = medianMs([&]{
+        rgbToLabImage(rgba.view(), lab.view());
+        parallelFor(h, ROWS_PER_TASK, [&](int y0, int y1){
+            std::vector<double> d(w);
+            for (int y = y0; y < y1; ++y) {
+                deltaEBatch(lab.view().row(y), ref, d.data(), std::size_t(w));
+                rowMax[y] = 0.0; rowSum[y] = 0.0;
+                for (double v : d) { rowSum[y] += v; rowMax[y] = std::max(rowMax[y], v); }
+            }
+        });
+    });
+    std::fprintf(stderr, "  chain %7.2f ms   materialised Lab %7.2f ms   x%.1f   mean dE %.3f\n",
+                 chained, materialised, materialised / chained, lazy.mean());
+}
@@ -0,0 +1,38 @@
+#include "bench.h"
+#include "parallel.h"
+#include "ycbcr.h"
+
+
+// кадр 1080p: целочисленное ядро SSE2 против точной формулы в double по пикселю
+BENCH(ycbcrFrame) {
+    const int w = 1920, h = 1080;
+    Image<uint8_t> rgb(w, h, 3);
+    for (std::size_t i = 0; i < rgb.pixels.size(); ++i) rgb.pixels[i] = uint8_t(i * 7 + (i >> 10));
+    for (ChromaSubsampling s : { ChromaSubsampling::S444, ChromaSubsampling::S420 }) {
+        YCbCrFormat fmt;
+        fmt.subsampling = s;
+        YCbCrFrame<uint8_t> frame(w, h, s);
+        Image<uint8_t> back(w, h, 3);
+        const double forward = medianMs([&]{ rgbToYCbCr(rgb.view(), frame.view(), fmt); });
+        const double inverse = medianMs([&]{ yCbCrToRgb(frame.view(), back.view(), fmt); });
+        std::fprintf(stderr, "  %s  rgb -> ycbcr %6.2f ms   ycbcr -> rgb %6.2f ms\n",
+                     s == ChromaSubsampling::S444 ? "4:4:4" : "4:2:0", forward, inverse);
+    }
+    // точная формула — только 4:4:4, строки так же параллельно
+    YCbCrFormat fmt;
+    fmt.subsampling = ChromaSubsampling::S444;
+    YCbCrFrame<uint8_t> frame(w, h, fmt.subsampling);
+    const double exact = medianMs([&]{
+        parallelFor(h, ROWS_PER_TASK, [&](int y0, int y1){
+            for (int y = y0; y < y1; ++y)
+                for (int x = 0; x < w; ++x) {
+                    const uint8_t *p = rgb.view().row(y) + x * 3;
+                    const YCbCr c = rgbToYCbCr(RGB{ p[0], p[1], p[2] }, fmt);
+                    frame.y.view().row(y)[x] = uint8_t(c.y);
+                    frame.cb.view().row(y)[x] = uint8_t(c.cb);
+                    frame.cr.view().row(y)[x] = uint8_t(c.cr);
+                }
+        });
+    });
+    std::fprintf(stderr, "  4:4:4  rgb -> ycbcr, double per pixel %6.2f ms\n", exact);
+}
@@ -0,0 +1,109 @@
+#include "cmyklab.h"
+#include "parallel.h"
+
+#include <algorithm>
+
+
+namespace {
+
+const std::size_t BLOCK = 256;
+
+static_assert(sizeof(CMYK16) == 4 * sizeof(uint16_t), "CMYK16 должен быть плотной четвёркой отсчётов");
+
+template<typename Src, typename Dst, typename Fn>
+void forEachRow(const ImageView<Src> &src, const ImageView<Dst> &dst, Fn fn) {
+    parallelFor(src.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y) fn(src.row(y), dst.row(y), std::size_t(src.width));
+    });
+}
+
+}
+
+CmykLabTransform::CmykLabTransform(const Characterization &model, int grid, TableBuild build)
+    : model(model), gridSize(grid)
+{
+    buildTables(build);
+}
+
+CmykLabTransform::CmykLabTransform(const Characterization &model, int grid, const std::string &cacheName,
+                                   uint64_t cacheKey, TableBuild build)
+    : model(model), gridSize(grid), cacheName(cacheName), cacheKey(cacheKey)
+{
+    buildTables(build);
+}
+
+void CmykLabTransform::buildTables(TableBuild build) {
+    lut.run(build, [this]{
+        Lut4D t(gridSize, 3);
+        auto node = [this](double c, double m, double y, double k, float *out){
+            Lab lab = model({c, m, y, k});
+            out[0] = float(lab.L); out[1] = float(lab.a); out[2] = float(lab.b);
+        };
+        if (cacheName.empty()) t.fill(node);
+        else t.fillCached(cacheName, cacheKey, node);
+        return t;
+    });
+}
+
+Lab CmykLabTransform::convert(const CMYK &cmyk) const {
+    const Lut4D *t = lut.get();
+    if (!t) return model(cmyk);
+    float v[3];
+    t->lookup(cmyk.c, cmyk.m, cmyk.y, cmyk.k, v);
+    return { v[0], v[1], v[2] };
+}
+
+void CmykLabTransform::convertBatch(const CMYK *cmyk, Lab *lab, std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i)
+        lab[i] = convert(cmyk[i]);
+}
+
+void CmykLabTransform::convertBatch8(const uint8_t *cmyk, int channels, Lab *lab, std::size_t count) const {
+    const Lut4D *t = lut.get();
+    if (!t) {
+        for (std::size_t i = 0; i < count; ++i, cmyk += channels)
+            lab[i] = model({ cmyk[0] / 255.0, cmyk[1] / 255.0, cmyk[2] / 255.0, cmyk[3] / 255.0 });
+        return;
+    }
+    float v[BLOCK * 3];
+    for (std::size_t i0 = 0; i0 < count; i0 += BLOCK) {
+        std::size_t m = std::min(BLOCK, count - i0);
+        t->lookup8(cmyk + i0 * channels, channels, v, m);
+        for (std::size_t i = 0; i < m; ++i)
+            lab[i0 + i] = { v[3 * i], v[3 * i + 1], v[3 * i + 2] };
+    }
+}
+
+void CmykLabTransform::convertBatch16(const CMYK16 *cmyk, Lab16 *lab, std::size_t count) const {
+    const Lut4D *t = lut.get();
+    if (!t) {
+        for (std::size_t i = 0; i < count; ++i)
+            lab[i] = encodeLab16(model(decodeCmyk16(cmyk[i])));
+        return;
+    }
+    float v[BLOCK * 3];
+    for (std::size_t i0 = 0; i0 < count; i0 += BLOCK) {
+        std::size_t m = std::min(BLOCK, count - i0);
+        t->lookup16(reinterpret_cast<const uint16_t *>(cmyk + i0), 4, v, m);
+        for (std::size_t i = 0; i < m; ++i) {
+            // кодировка ICC, как в encodeLab16, но без перехода через double
+            float L = std::clamp(v[3 * i], 0.0f, 100.0f);
+            float a = std::clamp(v[3 * i + 1], -128.0f, 127.0f);
+            float b = std::clamp(v[3 * i + 2], -128.0f, 127.0f);
+            lab[i0 + i] = { uint16_t(L * 655.35f + 0.5f), uint16_t((a + 128.0f) * 257.0f + 0.5f),
+                            uint16_t((b + 128.0f) * 257.0f + 0.5f) };
+        }
+    }
+}
+
+void CmykLabTransform::convertImage(const ImageView<const CMYK> &cmyk, const ImageView<Lab> &lab) const {
+    forEachRow(cmyk, lab, [&](const CMYK *src, Lab *dst, std::size_t n){ convertBatch(src, dst, n); });
+}
+
+void CmykLabTransform::convertImage8(const ImageView<const uint8_t> &cmyk, const ImageView<Lab> &lab) const {
+    forEachRow(cmyk, lab, [&](const uint8_t *src, Lab *dst, std::size_t n){ convertBatch8(src, cmyk.channels, dst, n); });
+}
+
+void CmykLabTransform::convertImage16(const ImageView<const CMYK16> &cmyk, const ImageView<Lab16> &lab) const {
+    forEachRow(cmyk, lab, [&](const CMYK16 *src, Lab16 *dst, std::size_t n){ convertBatch16(src, dst, n); });
+}
@@ -0,0 +1,59 @@
+#ifndef CMYKLAB_H
+#define CMYKLAB_H
+
+#include "background.h"
+#include "colormodels.h"
+#include "imagebuffer.h"
+#include "lut.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Прямое преобразование CMYK -> Lab через 4D-таблицу, без промежуточного 8-битного RGB.
+// Таблица строится один раз из характеризации — любой функции CMYK -> Lab
+// (по умолчанию простая модель cmykToLab, позже — профиль принтера).
+// Пока таблица не готова (TableBuild::Background/Later), всё считается
+// по самой характеризации, поэтому она должна быть потокобезопасной.
+class CmykLabTransform {
+public:
+    static const int GRID = 17;
+    using Characterization = std::function<Lab(const CMYK &)>;
+
+    // ключ встроенной модели cmykToLab: её формулы меняются только с LutCache::ENGINE_VERSION
+    static const uint64_t BUILTIN_KEY = 1;
+
+    // без кэша: таблица строится заново
+    explicit CmykLabTransform(const Characterization &model = cmykToLab, int grid = GRID,
+                              TableBuild build = TableBuild::Now);
+    // cacheName — имя таблицы в LutCache, cacheKey — хэш того, от чего зависит model
+    // (параметров характеризации, содержимого профиля). По самой функции ключ не
+    // вывести, поэтому его задаёт вызывающий: с тем же ключом чужая таблица подхватится.
+    CmykLabTransform(const Characterization &model, int grid, const std::string &cacheName, uint64_t cacheKey,
+                     TableBuild build = TableBuild::Now);
+
+    void buildTables(TableBuild build);
+    bool tablesReady() const { return lut.get() != nullptr; }
+    const Lut4D *table() const { return lut.get(); }
+
+    Lab convert(const CMYK &cmyk) const;
+
+    void convertBatch(const CMYK *cmyk, Lab *lab, std::size_t count) const;
+    // cmyk — 8-битные отсчёты, channels = 4 (или больше, лишние игнорируются)
+    void convertBatch8(const uint8_t *cmyk, int channels, Lab *lab, std::size_t count) const;
+    void convertBatch16(const CMYK16 *cmyk, Lab16 *lab, std::size_t count) const;
+
+    void convertImage(const ImageView<const CMYK> &cmyk, const ImageView<Lab> &lab) const;
+    void convertImage8(const ImageView<const uint8_t> &cmyk, const ImageView<Lab> &lab) const;
+    void convertImage16(const ImageView<const CMYK16> &cmyk, const ImageView<Lab16> &lab) const;
+
+private:
+    Characterization model;
+    int gridSize;
+    std::string cacheName;
+    uint64_t cacheKey = 0;
+    BackgroundValue<Lut4D> lut;
+};
+
+#endif // CMYKLAB_H
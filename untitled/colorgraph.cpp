@@ -0,0 +1,90 @@
+#include "colorgraph.h"
+
+#include <deque>
+
+
+bool operator==(const ColorValue &x, const ColorValue &y) {
+    for (int i = 0; i < 4; ++i)
+        if (x.c[i] != y.c[i]) return false;
+    return x.clipped == y.clipped && x.moved == y.moved;
+}
+
+int ColorGraph::addSpace(const std::string &name) {
+    Node n;
+    n.name = name;
+    nodes.push_back(std::move(n));
+    return int(nodes.size()) - 1;
+}
+
+void ColorGraph::addConversion(int from, int to, Convert fn) {
+    nodes[from].edges.push_back({ to, std::move(fn) });
+}
+
+void ColorGraph::store(int space, const ColorValue &value, int parent) {
+    Node &n = nodes[space];
+    if (n.version == 0 || n.value != value) {
+        n.value = value;
+        ++n.version;
+    }
+    n.dirty = false;
+    n.parent = parent;
+}
+
+void ColorGraph::set(int space, const ColorValue &value) {
+    if (space == src && !nodes[space].dirty && nodes[space].value == value) return;
+    src = space;
+    for (Node &n : nodes) n.dirty = true;
+    store(space, value, -1);
+}
+
+const ColorValue &ColorGraph::get(int space) {
+    Node &target = nodes[space];
+    if (!target.dirty || src < 0) return target.value;
+
+    // поиск в ширину от всех посчитанных узлов, источник первым: при равной
+    // длине цепочки считаем прямо из заданного пользователем значения
+    std::vector<int> prev(nodes.size(), -2);
+    std::deque<int> queue;
+    if (!nodes[src].dirty) { queue.push_back(src); prev[src] = -1; }
+    for (int i = 0; i < int(nodes.size()); ++i)
+        if (i != src && !nodes[i].dirty) { queue.push_back(i); prev[i] = -1; }
+
+    while (!queue.empty() && prev[space] == -2) {
+        int u = queue.front();
+        queue.pop_front();
+        for (const Edge &e : nodes[u].edges) {
+            if (prev[e.to] != -2) continue;
+            prev[e.to] = u;
+            queue.push_back(e.to);
+        }
+    }
+    if (prev[space] == -2) return target.value;   // недостижим — оставляем прежнее
+
+    std::vector<int> path;
+    for (int v = space; prev[v] != -1; v = prev[v]) path.push_back(v);
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        int from = prev[*it];
+        for (const Edge &e : nodes[from].edges) {
+            if (e.to != *it) continue;
+            ++converted;
+            store(*it, e.fn(nodes[from].value), from);
+            break;
+        }
+    }
+    return target.value;
+}
+
+void ColorGraph::invalidate(int space) {
+    if (space == src) return;   // заданное значение не пересчитывается
+    nodes[space].dirty = true;
+    // грязными становятся и узлы, посчитанные через него
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (Node &n : nodes) {
+            if (n.dirty || n.parent < 0 || !nodes[n.parent].dirty) continue;
+            n.dirty = true;
+            changed = true;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef COLORGRAPH_H
+#define COLORGRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Значение цвета в одном пространстве: до четырёх компонент в единицах
+// этого пространства (RGB 0..255, Lab, CMYK 0..1).
+struct ColorValue {
+    double c[4] = {0.0, 0.0, 0.0, 0.0};
+    bool clipped = false;   // при получении значения цвет был вне охвата
+    double moved = 0.0;     // на сколько (ΔE76) его пришлось сдвинуть в охват
+};
+
+bool operator==(const ColorValue &x, const ColorValue &y);
+static inline bool operator!=(const ColorValue &x, const ColorValue &y) { return !(x == y); }
+
+// Граф пересчёта цвета между пространствами. Значение задаётся в одном узле
+// (источнике), остальные только помечаются грязными и пересчитываются при
+// первом запросе — по кратчайшей цепочке преобразований от уже посчитанных
+// узлов. Последний результат каждого узла кэшируется, так что цена изменения
+// не растёт с числом пространств, которые сейчас никто не показывает.
+class ColorGraph {
+public:
+    using Convert = std::function<ColorValue(const ColorValue &)>;
+
+    int addSpace(const std::string &name);
+    void addConversion(int from, int to, Convert fn);
+
+    // Ничего не делает, если тот же узел уже источник с тем же значением.
+    void set(int space, const ColorValue &value);
+    const ColorValue &get(int space);
+
+    // Изменились настройки преобразований в space: он и всё, что посчитано
+    // через него, будут пересчитаны при следующем запросе.
+    void invalidate(int space);
+
+    int source() const { return src; }
+    bool isDirty(int space) const { return nodes[space].dirty; }
+    // растёт, когда значение узла действительно меняется — по нему
+    // представления узнают, что виджеты надо переписать
+    uint64_t version(int space) const { return nodes[space].version; }
+    const std::string &name(int space) const { return nodes[space].name; }
+    std::size_t spaceCount() const { return nodes.size(); }
+    // сколько раз вызывались преобразования (для отладки и метрик)
+    std::size_t conversions() const { return converted; }
+
+private:
+    struct Edge {
+        int to;
+        Convert fn;
+    };
+    struct Node {
+        std::string name;
+        ColorValue value;
+        bool dirty = true;
+        int parent = -1;        // из какого узла посчитано значение
+        uint64_t version = 0;
+        std::vector<Edge> edges;
+    };
+
+    void store(int space, const ColorValue &value, int parent);
+
+    std::vector<Node> nodes;
+    int src = -1;
+    std::size_t converted = 0;
+};
+
+#endif // COLORGRAPH_H
@@ -0,0 +1,527 @@
+#include "colorlist.h"
+#include "arena.h"
+#include "batchconvert.h"
+#include "cmyklab.h"
+#include "colormodels.h"
+#include "parallel.h"
+#include "swatchlibrary.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+
+namespace {
+
+const std::size_t BLOCK = 8u << 20;       // читаем по 8 МБ
+const std::size_t PIECE = 256u << 10;     // кусок блока на одну задачу
+const std::size_t BATCH = 1024;           // строк на один вызов пакетных функций
+
+enum Format : uint8_t { Invalid, Csv, Tsv, Json };
+
+struct Row {
+    ListSpace space;
+    Format format;
+    double v[4];
+};
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+int componentCount(ListSpace s) {
+    return s == ListSpace::CMYK ? 4 : (s == ListSpace::Hex ? 1 : 3);
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool isWordChar(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// rrggbb или rgb с позиции p; следующий символ не должен быть цифрой
+bool parseHex(const char *p, const char *last, double v[4]) {
+    int n = 0;
+    while (p + n < last && n < 7 && hexDigit(p[n]) >= 0) ++n;
+    if (n == 6) {
+        for (int k = 0; k < 3; ++k) v[k] = hexDigit(p[2 * k]) * 16 + hexDigit(p[2 * k + 1]);
+        return true;
+    }
+    if (n == 3) {
+        for (int k = 0; k < 3; ++k) v[k] = hexDigit(p[k]) * 17;
+        return true;
+    }
+    return false;
+}
+
+// count чисел через запятые, пробелы, ';' или табуляцию; '%' после числа пропускается.
+// Чтение останавливается на close (если задан); лишние числа — ошибка, как и
+// nan/inf, которые from_chars тоже принимает.
+bool parseNumbers(const char *p, const char *last, char close, double *v, int count) {
+    int got = 0;
+    for (;;) {
+        while (p < last && (*p == ' ' || *p == ',' || *p == ';' || *p == '\t' || *p == '%' || *p == '+' || *p == '"'))
+            ++p;
+        if (p == last || *p == close) return got == count;
+        if (got == count) return false;
+        auto r = std::from_chars(p, last, v[got]);
+        if (r.ec != std::errc() || !std::isfinite(v[got])) return false;
+        ++got;
+        p = r.ptr;
+    }
+}
+
+bool matchWord(const char *p, const char *last, const char *word) {
+    std::size_t n = std::strlen(word);
+    return std::size_t(last - p) >= n && std::memcmp(p, word, n) == 0;
+}
+
+void clampComponents(ListSpace s, double v[4]) {
+    if (s == ListSpace::RGB || s == ListSpace::Hex)
+        for (int k = 0; k < 3; ++k) v[k] = std::clamp(v[k], 0.0, 255.0);
+    // Lab не обрезается по смыслу, только чтобы ядра во float не переполнялись
+    if (s == ListSpace::Lab)
+        for (int k = 0; k < 3; ++k) v[k] = std::clamp(v[k], -10000.0, 10000.0);
+    if (s == ListSpace::CMYK)
+        for (int k = 0; k < 4; ++k) v[k] = std::clamp(v[k], 0.0, 100.0);
+}
+
+// --- вывод ---
+
+// Строка собирается в буфере на стеке и добавляется в вывод одним куском.
+// Числа — фиксированная точка через целые: в разы быстрее to_chars(fixed) и без "-0.00".
+char *putNumber(char *p, double v, int precision) {
+    static const double scales[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+    long long q = std::llround(std::clamp(v, -1e9, 1e9) * scales[precision]);
+    if (q < 0) { *p++ = '-'; q = -q; }
+    const long long scale = (long long)scales[precision];
+    p = std::to_chars(p, p + 24, q / scale).ptr;
+    if (precision == 0) return p;
+    *p++ = '.';
+    long long frac = q % scale;
+    for (int k = precision - 1; k >= 0; --k) {
+        p[k] = char('0' + frac % 10);
+        frac /= 10;
+    }
+    return p + precision;
+}
+
+char *putText(char *p, const char *text) {
+    while (*text) *p++ = *text++;
+    return p;
+}
+
+const char *spaceKey(ListSpace s) {
+    switch (s) {
+    case ListSpace::Hex: return "\"hex\": ";
+    case ListSpace::RGB: return "\"rgb\": ";
+    case ListSpace::Lab: return "\"lab\": ";
+    case ListSpace::CMYK: return "\"cmyk\": ";
+    }
+    return "";
+}
+
+// результаты одной пачки строк во всех нужных пространствах
+struct BatchValues {
+    uint8_t *rgb;
+    Lab *lab;
+    CMYK *cmyk;
+    uint32_t *swatch;       // ближайший образец, если задана библиотека
+    float *swatchDe;
+};
+
+// имя образца: в CSV/TSV в кавычках, если в нём разделитель или кавычка; в JSON — строка
+void appendName(std::string &out, std::string_view name, Format format) {
+    if (format == Json) {
+        out += '"';
+        for (char c : name) {
+            if (c == '"' || c == '\\') { out += '\\'; out += c; }
+            else if (uint8_t(c) < 0x20) {
+                static const char digits[] = "0123456789abcdef";
+                out += "\\u00";
+                out += digits[uint8_t(c) >> 4];
+                out += digits[uint8_t(c) & 15];
+            }
+            else out += c;
+        }
+        out += '"';
+        return;
+    }
+    const char sep = format == Tsv ? '\t' : ',';
+    if (name.find(sep) == std::string_view::npos && name.find('"') == std::string_view::npos) {
+        out += name;
+        return;
+    }
+    out += '"';
+    for (char c : name) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+void appendRow(std::string &out, const Row &row, const BatchValues &b, std::size_t i,
+               const ColorListOptions &opt) {
+    if (row.format == Invalid) { out += '\n'; return; }
+    const bool json = row.format == Json;
+    const char sep = row.format == Tsv ? '\t' : ',';
+    const int precision = std::clamp(opt.precision, 0, 6);
+    char line[64 * 4 * 4];      // на пространство не больше 4 чисел по 20 знаков
+    char *p = line;
+    // пространства не повторяются (parseListSpaces), так что их не больше четырёх
+    const std::size_t outputs = std::min<std::size_t>(opt.outputs.size(), 4);
+
+    if (json) *p++ = '{';
+    for (std::size_t o = 0; o < outputs; ++o) {
+        const ListSpace s = opt.outputs[o];
+        if (o) p = json ? putText(p, ", ") : (*p = sep, p + 1);
+        if (json) p = putText(p, spaceKey(s));
+        const char inner = json ? ',' : sep;
+        switch (s) {
+        case ListSpace::Hex: {
+            static const char digits[] = "0123456789abcdef";
+            const uint8_t *c = b.rgb + 3 * i;
+            if (json) *p++ = '"';
+            *p++ = '#';
+            for (int k = 0; k < 3; ++k) {
+                *p++ = digits[c[k] >> 4];
+                *p++ = digits[c[k] & 15];
+            }
+            if (json) *p++ = '"';
+            break;
+        }
+        case ListSpace::RGB:
+            if (json) *p++ = '[';
+            for (int k = 0; k < 3; ++k) {
+                if (k) *p++ = inner;
+                p = std::to_chars(p, p + 4, int(b.rgb[3 * i + k])).ptr;
+            }
+            if (json) *p++ = ']';
+            break;
+        case ListSpace::Lab: {
+            const double v[3] = { b.lab[i].L, b.lab[i].a, b.lab[i].b };
+            if (json) *p++ = '[';
+            for (int k = 0; k < 3; ++k) {
+                if (k) *p++ = inner;
+                p = putNumber(p, v[k], precision);
+            }
+            if (json) *p++ = ']';
+            break;
+        }
+        case ListSpace::CMYK: {
+            const double v[4] = { b.cmyk[i].c, b.cmyk[i].m, b.cmyk[i].y, b.cmyk[i].k };
+            if (json) *p++ = '[';
+            for (int k = 0; k < 4; ++k) {
+                if (k) *p++ = inner;
+                p = putNumber(p, v[k] * 100.0, precision);
+            }
+            if (json) *p++ = ']';
+            break;
+        }
+        }
+    }
+    if (!opt.swatches) {
+        if (json) *p++ = '}';
+        *p++ = '\n';
+        out.append(line, p);
+        return;
+    }
+
+    // имя ближайшего образца и ΔE до него
+    if (outputs) p = json ? putText(p, ", ") : (*p = sep, p + 1);
+    if (json) p = putText(p, "\"swatch\": ");
+    out.append(line, p);
+    appendName(out, opt.swatches->at(b.swatch[i]).name, row.format);
+    p = line;
+    p = json ? putText(p, ", \"dE\": ") : (*p = sep, p + 1);
+    p = putNumber(p, b.swatchDe[i], precision);
+    if (json) *p++ = '}';
+    *p++ = '\n';
+    out.append(line, p);
+}
+
+const CmykLabTransform &cmykLab() {
+    // та же таблица, что и в окне: при заданном каталоге LutCache берётся из кэша
+    static const CmykLabTransform t(cmykToLab, CmykLabTransform::GRID, "cmykToLab",
+                                    CmykLabTransform::BUILTIN_KEY);
+    return t;
+}
+
+struct PieceResult {
+    std::string out;
+    std::size_t rows = 0, invalid = 0, clipped = 0;
+};
+
+// Считает пачку строк: для каждого исходного пространства собираем его строки
+// подряд, прогоняем через пакетную функцию и раскладываем обратно.
+void convertBatch(const Row *rows, std::size_t n, const ColorListOptions &opt, PieceResult &res) {
+    bool needRgb = false, needLab = false, needCmyk = false;
+    for (ListSpace s : opt.outputs) {
+        needRgb |= s == ListSpace::Hex || s == ListSpace::RGB;
+        needLab |= s == ListSpace::Lab;
+        needCmyk |= s == ListSpace::CMYK;
+    }
+    needLab |= opt.swatches != nullptr;
+
+    ArenaScope scratch;
+    BatchValues b{ scratch.allocate<uint8_t>(n * 3), scratch.allocate<Lab>(n), scratch.allocate<CMYK>(n),
+                   scratch.allocate<uint32_t>(n), scratch.allocate<float>(n) };
+    uint32_t *idx = scratch.allocate<uint32_t>(n);
+    uint8_t *rgbTmp = scratch.allocate<uint8_t>(n * 3);
+    Lab *labTmp = scratch.allocate<Lab>(n);
+    CMYK *cmykTmp = scratch.allocate<CMYK>(n);
+    uint8_t *clip = scratch.allocate<uint8_t>(n);
+
+    auto gather = [&](bool (*pick)(const Row &)) {
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            if (rows[i].format != Invalid && pick(rows[i])) idx[k++] = uint32_t(i);
+        return k;
+    };
+    auto isRgb = [](const Row &r){ return r.space == ListSpace::RGB || r.space == ListSpace::Hex; };
+    auto isLab = [](const Row &r){ return r.space == ListSpace::Lab; };
+    auto isCmyk = [](const Row &r){ return r.space == ListSpace::CMYK; };
+
+    // RGB и Hex
+    std::size_t k = gather(isRgb);
+    for (std::size_t j = 0; j < k; ++j) {
+        const Row &r = rows[idx[j]];
+        for (int c = 0; c < 3; ++c) b.rgb[3 * idx[j] + c] = uint8_t(int(r.v[c] + 0.5));
+        std::memcpy(rgbTmp + 3 * j, b.rgb + 3 * idx[j], 3);
+    }
+    if (needLab) {
+        rgbToLabBatch(rgbTmp, 3, labTmp, k);
+        for (std::size_t j = 0; j < k; ++j) b.lab[idx[j]] = labTmp[j];
+    }
+    if (needCmyk) {
+        rgbToCmykBatch(rgbTmp, 3, cmykTmp, k);
+        for (std::size_t j = 0; j < k; ++j) b.cmyk[idx[j]] = cmykTmp[j];
+    }
+
+    // Lab; в CMYK — через обрезанный RGB, как в окне
+    k = gather(isLab);
+    for (std::size_t j = 0; j < k; ++j) {
+        const Row &r = rows[idx[j]];
+        labTmp[j] = b.lab[idx[j]] = { r.v[0], r.v[1], r.v[2] };
+    }
+    if (needRgb || needCmyk) {
+        labToRgbBatch(labTmp, rgbTmp, 3, k, clip);
+        for (std::size_t j = 0; j < k; ++j) {
+            std::memcpy(b.rgb + 3 * idx[j], rgbTmp + 3 * j, 3);
+            res.clipped += clip[j];
+        }
+    }
+    if (needCmyk) {
+        rgbToCmykBatch(rgbTmp, 3, cmykTmp, k);
+        for (std::size_t j = 0; j < k; ++j) b.cmyk[idx[j]] = cmykTmp[j];
+    }
+
+    // CMYK
+    k = gather(isCmyk);
+    for (std::size_t j = 0; j < k; ++j) {
+        const Row &r = rows[idx[j]];
+        cmykTmp[j] = b.cmyk[idx[j]] = { r.v[0] / 100.0, r.v[1] / 100.0, r.v[2] / 100.0, r.v[3] / 100.0 };
+    }
+    if (needRgb) {
+        cmykToRgbBatch(cmykTmp, rgbTmp, 3, k);
+        for (std::size_t j = 0; j < k; ++j) std::memcpy(b.rgb + 3 * idx[j], rgbTmp + 3 * j, 3);
+    }
+    if (needLab && k) {
+        cmykLab().convertBatch(cmykTmp, labTmp, k);
+        for (std::size_t j = 0; j < k; ++j) b.lab[idx[j]] = labTmp[j];
+    }
+
+    if (opt.swatches) {
+        k = gather([](const Row &){ return true; });
+        uint32_t *swatchTmp = scratch.allocate<uint32_t>(k);
+        float *deTmp = scratch.allocate<float>(k);
+        for (std::size_t j = 0; j < k; ++j) labTmp[j] = b.lab[idx[j]];
+        opt.swatches->nearestBatch(labTmp, swatchTmp, deTmp, k);
+        for (std::size_t j = 0; j < k; ++j) {
+            b.swatch[idx[j]] = swatchTmp[j];
+            b.swatchDe[idx[j]] = deTmp[j];
+        }
+    }
+
+    for (std::size_t i = 0; i < n; ++i) appendRow(res.out, rows[i], b, i, opt);
+}
+
+// строки [first, last) — целые, последняя может быть без '\n'
+void convertPiece(const char *first, const char *last, const ColorListOptions &opt, PieceResult &res) {
+    ArenaScope scratch;
+    Row *rows = scratch.allocate<Row>(BATCH);
+    std::size_t n = 0;
+    res.out.reserve(std::size_t(last - first) * 2);
+
+    for (const char *p = first; p < last;) {
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', std::size_t(last - p)));
+        const char *end = eol ? eol : last;
+        const char *lineEnd = end > p && end[-1] == '\r' ? end - 1 : end;
+
+        Row &r = rows[n++];
+        const char *s = p;
+        while (s < lineEnd && (*s == ' ' || *s == '\t')) ++s;
+        r.format = s < lineEnd && *s == '{' ? Json
+                 : std::memchr(p, '\t', std::size_t(lineEnd - p)) ? Tsv : Csv;
+        if (!parseColor(p, lineEnd, opt.bareInput, r.space, r.v)) {
+            r.format = Invalid;
+            ++res.invalid;
+        }
+        ++res.rows;
+
+        if (n == BATCH) {
+            convertBatch(rows, n, opt, res);
+            n = 0;
+        }
+        p = eol ? eol + 1 : last;
+    }
+    if (n) convertBatch(rows, n, opt, res);
+}
+
+// Блок [0, size) делится на куски по границам строк и считается параллельно.
+void convertBlock(const char *data, std::size_t size, const ColorListOptions &opt, std::vector<PieceResult> &pieces) {
+    int count = int(std::max<std::size_t>(1, (size + PIECE - 1) / PIECE));
+    std::vector<std::size_t> bounds(std::size_t(count) + 1);
+    bounds[0] = 0;
+    bounds[std::size_t(count)] = size;
+    for (int i = 1; i < count; ++i) {
+        std::size_t at = std::max(bounds[std::size_t(i) - 1], std::size_t(i) * size / std::size_t(count));
+        const void *nl = at < size ? std::memchr(data + at, '\n', size - at) : nullptr;
+        bounds[std::size_t(i)] = nl ? std::size_t(static_cast<const char *>(nl) - data) + 1 : size;
+    }
+    pieces.assign(std::size_t(count), PieceResult());
+    parallelFor(count, 1, [&](int i0, int i1){
+        for (int i = i0; i < i1; ++i)
+            convertPiece(data + bounds[std::size_t(i)], data + bounds[std::size_t(i) + 1], opt, pieces[std::size_t(i)]);
+    });
+}
+
+}
+
+bool parseListSpaces(const std::string &text, std::vector<ListSpace> &spaces, std::string *error) {
+    spaces.clear();
+    std::size_t pos = 0;
+    while (pos <= text.size()) {
+        std::size_t comma = text.find(',', pos);
+        std::string name = text.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        if (name == "hex") spaces.push_back(ListSpace::Hex);
+        else if (name == "rgb") spaces.push_back(ListSpace::RGB);
+        else if (name == "lab") spaces.push_back(ListSpace::Lab);
+        else if (name == "cmyk") spaces.push_back(ListSpace::CMYK);
+        else return fail(error, "неизвестное пространство: " + name);
+        if (std::find(spaces.begin(), spaces.end() - 1, spaces.back()) != spaces.end() - 1)
+            return fail(error, "пространство указано дважды: " + name);
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return !spaces.empty() || fail(error, "не заданы пространства");
+}
+
+bool parseColor(const char *first, const char *last, ListSpace bareInput, ListSpace &space, double v[4]) {
+    for (const char *p = first; p < last; ++p) {
+        if (*p == '#') {
+            if (parseHex(p + 1, last, v)) { space = ListSpace::Hex; return true; }
+            continue;
+        }
+        if (p > first && isWordChar(p[-1])) continue;
+        ListSpace s;
+        std::size_t len;
+        if (matchWord(p, last, "rgb")) { s = ListSpace::RGB; len = 3; }
+        else if (matchWord(p, last, "lab")) { s = ListSpace::Lab; len = 3; }
+        else if (matchWord(p, last, "cmyk")) { s = ListSpace::CMYK; len = 4; }
+        else continue;
+
+        // rgb(...) или "rgb": [...]
+        const char *q = p + len;
+        while (q < last && (*q == '"' || *q == ':' || *q == ' ')) ++q;
+        if (q == last || (*q != '(' && *q != '[')) continue;
+        const char close = *q == '(' ? ')' : ']';
+        if (!parseNumbers(q + 1, last, close, v, componentCount(s))) continue;
+        clampComponents(s, v);
+        space = s;
+        return true;
+    }
+
+    // строка из одних чисел
+    if (bareInput == ListSpace::Hex) {
+        const char *p = first;
+        while (p < last && (*p == ' ' || *p == '\t' || *p == '"')) ++p;
+        if (!parseHex(p, last, v)) return false;
+        space = ListSpace::Hex;
+        return true;
+    }
+    if (!parseNumbers(first, last, 0, v, componentCount(bareInput))) return false;
+    clampComponents(bareInput, v);
+    space = bareInput;
+    return true;
+}
+
+bool convertColorList(std::FILE *in, std::FILE *out, const ColorListOptions &options,
+                      ColorListStats *stats, std::string *error) {
+    if (options.outputs.empty() && !options.swatches) return fail(error, "не заданы пространства");
+    if (options.swatches && options.swatches->size() == 0) return fail(error, "пустая библиотека образцов");
+    ColorListStats total;
+    std::vector<char> buf(BLOCK);
+    std::vector<PieceResult> pieces;
+    std::size_t carry = 0;
+    bool eof = false;
+
+    while (!eof || carry) {
+        if (!eof) {
+            std::size_t got = std::fread(buf.data() + carry, 1, buf.size() - carry, in);
+            if (got < buf.size() - carry) {
+                if (std::ferror(in)) return fail(error, "ошибка чтения");
+                eof = true;
+            }
+            carry += got;
+            total.bytesIn += got;
+        }
+        // обрабатываем до последнего '\n'; в конце файла — всё
+        std::size_t end = carry;
+        if (!eof) {
+            while (end > 0 && buf[end - 1] != '\n') --end;
+            if (end == 0) {   // строка длиннее буфера
+                buf.resize(buf.size() * 2);
+                continue;
+            }
+        }
+        if (end == 0) break;
+
+        convertBlock(buf.data(), end, options, pieces);
+        for (const PieceResult &p : pieces) {
+            if (std::fwrite(p.out.data(), 1, p.out.size(), out) != p.out.size())
+                return fail(error, "ошибка записи");
+            total.rows += p.rows;
+            total.invalid += p.invalid;
+            total.clipped += p.clipped;
+        }
+        std::memmove(buf.data(), buf.data() + end, carry - end);
+        carry -= end;
+    }
+    if (std::fflush(out) != 0) return fail(error, "ошибка записи");
+    if (stats) *stats = total;
+    return true;
+}
+
+bool convertColorListFile(const std::string &inPath, const std::string &outPath, const ColorListOptions &options,
+                          ColorListStats *stats, std::string *error) {
+    std::FILE *in = inPath == "-" ? stdin : std::fopen(inPath.c_str(), "rb");
+    if (!in) return fail(error, "не удалось открыть " + inPath);
+    std::FILE *out = outPath == "-" ? stdout : std::fopen(outPath.c_str(), "wb");
+    if (!out) {
+        if (in != stdin) std::fclose(in);
+        return fail(error, "не удалось создать " + outPath);
+    }
+    bool ok = convertColorList(in, out, options, stats, error);
+    if (in != stdin) std::fclose(in);
+    if (out != stdout && std::fclose(out) != 0 && ok) ok = fail(error, "ошибка записи");
+    return ok;
+}
@@ -0,0 +1,48 @@
+#ifndef COLORLIST_H
+#define COLORLIST_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class SwatchLibrary;
+
+// Пакетное преобразование текстовых списков цветов (CSV, TSV, JSON-строки).
+// В каждой строке ищется первый цвет: #rrggbb / #rgb, rgb(r, g, b), lab(L, a, b),
+// cmyk(c, m, y, k) в процентах; в JSON допускается и "rgb": [r, g, b].
+// Строка из одних чисел читается как цвет в пространстве bareInput.
+enum class ListSpace { Hex, RGB, Lab, CMYK };
+
+struct ColorListOptions {
+    std::vector<ListSpace> outputs = { ListSpace::Lab };
+    ListSpace bareInput = ListSpace::RGB;
+    int precision = 2;      // знаков после запятой для Lab и CMYK, 0..6
+    // если задана — в конце строки имя ближайшего образца и ΔE до него
+    const SwatchLibrary *swatches = nullptr;
+};
+
+struct ColorListStats {
+    std::size_t rows = 0;
+    std::size_t invalid = 0;     // строк без цвета (заголовки и т.п.) — на выходе пустая строка
+    std::size_t clipped = 0;     // Lab вне охвата sRGB при переводе в RGB/CMYK
+    std::size_t bytesIn = 0;
+};
+
+// Разбор списка пространств вида "lab,cmyk,hex".
+bool parseListSpaces(const std::string &text, std::vector<ListSpace> &spaces, std::string *error = nullptr);
+
+// Первый цвет в строке [first, last); v — компоненты в единицах записи
+// (RGB 0..255, Lab, CMYK в процентах).
+bool parseColor(const char *first, const char *last, ListSpace bareInput, ListSpace &space, double v[4]);
+
+// Потоковое преобразование: вход читается блоками, строки блока разбираются,
+// считаются и форматируются параллельно, результат пишется по порядку строк.
+// Каждой входной строке соответствует одна выходная: для JSON-строк — объект
+// {"lab": [...], ...}, для строк с табуляцией — TSV, иначе CSV.
+bool convertColorList(std::FILE *in, std::FILE *out, const ColorListOptions &options,
+                      ColorListStats *stats = nullptr, std::string *error = nullptr);
+bool convertColorListFile(const std::string &inPath, const std::string &outPath, const ColorListOptions &options,
+                          ColorListStats *stats = nullptr, std::string *error = nullptr);
+
+#endif // COLORLIST_H
@@ -0,0 +1,232 @@
+#include "colormodels.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+namespace {
+
+// результат в 0..1 без обрезания; clipped — вышел ли хоть один канал за пределы
+void xyzToUnitRgb(const XYZ &xyz, double &r, double &g, double &b, bool &clipped) {
+    double rl, gl, bl;
+    xyzToLinearRgb(xyz, rl, gl, bl);
+    r = gammaSRGB(rl);
+    g = gammaSRGB(gl);
+    b = gammaSRGB(bl);
+    clipped = r < 0.0 || r > 1.0 || g < 0.0 || g > 1.0 || b < 0.0 || b > 1.0;
+}
+
+// обрезка до перевода в int: большие значения не переполняют его, NaN даёт 0
+static inline int toCode(double v01, int maxCode) {
+    const double v = std::round(v01 * maxCode);
+    return v >= 0.0 ? (v < maxCode ? int(v) : maxCode) : 0;
+}
+
+// a, b в Lab8: a + 128 с обрезкой, так же, как в пакетном packLab8
+static inline int abCode(double v) {
+    const double r = std::round(v);
+    return r >= -128.0 ? (r < 127.0 ? int(r) + 128 : 255) : 0;
+}
+
+}
+
+
+CMYK unitRgbToCmyk(double r, double g, double b) {
+    double k = 1.0 - std::max({r, g, b});
+    if (k >= 1.0 - 1e-12) return {0.0, 0.0, 0.0, k};
+    return { (1.0 - r - k) / (1.0 - k), (1.0 - g - k) / (1.0 - k), (1.0 - b - k) / (1.0 - k), k };
+}
+
+CMYK rgbToCmyk(const RGB &rgb) {
+    return unitRgbToCmyk(rgb.r / 255.0, rgb.g / 255.0, rgb.b / 255.0);
+}
+
+
+RGB cmykToRgb(const CMYK &cmyk) {
+    double r = 255.0 * (1.0 - cmyk.c) * (1.0 - cmyk.k);
+    double g = 255.0 * (1.0 - cmyk.m) * (1.0 - cmyk.k);
+    double b = 255.0 * (1.0 - cmyk.y) * (1.0 - cmyk.k);
+    return { clampInt(int(std::round(r)), 0, 255),
+            clampInt(int(std::round(g)), 0, 255),
+            clampInt(int(std::round(b)), 0, 255) };
+}
+
+
+double invGamma(double v) {
+    if (v <= 0.04045) return v / 12.92;
+    else return std::pow((v + 0.055) / 1.055, 2.4);
+}
+
+
+double gammaSRGB(double v) {
+    if (v <= 0.0031308) return 12.92 * v;
+    else return 1.055 * std::pow(v, 1.0/2.4) - 0.055;
+}
+
+XYZ linearRgbToXyz(double rl, double gl, double bl) {
+    double X = rl * 0.4124564 + gl * 0.3575761 + bl * 0.1804375;
+    double Y = rl * 0.2126729 + gl * 0.7151522 + bl * 0.0721750;
+    double Z = rl * 0.0193339 + gl * 0.1191920 + bl * 0.9503041;
+
+    return { X * 100.0, Y * 100.0, Z * 100.0 };
+}
+
+void xyzToLinearRgb(const XYZ &xyz, double &rl, double &gl, double &bl) {
+    double x = xyz.X / 100.0;
+    double y = xyz.Y / 100.0;
+    double z = xyz.Z / 100.0;
+
+    rl =  x *  3.2406 + y * (-1.5372) + z * (-0.4986);
+    gl =  x * (-0.9689) + y *  1.8758 + z *  0.0415;
+    bl =  x *  0.0557 + y * (-0.2040) + z *  1.0570;
+}
+
+XYZ rgbToXyz(const RGB &rgb) {
+    double r = rgb.r / 255.0;
+    double g = rgb.g / 255.0;
+    double b = rgb.b / 255.0;
+
+    return linearRgbToXyz(invGamma(r), invGamma(g), invGamma(b));
+}
+
+
+std::pair<RGB,bool> xyzToRgb(const XYZ &xyz) {
+    double r, g, b;
+    bool clipped;
+    xyzToUnitRgb(xyz, r, g, b, clipped);
+    return { { toCode(r, 255), toCode(g, 255), toCode(b, 255) }, clipped };
+}
+
+
+Lab xyzToLab(const XYZ &xyz) {
+    auto f = [](double t)->double {
+        const double thresh = 0.008856;
+        if (t > thresh) return std::cbrt(t);
+        else return (7.787 * t) + (16.0/116.0);
+    };
+
+    double xr = xyz.X / REF_X;
+    double yr = xyz.Y / REF_Y;
+    double zr = xyz.Z / REF_Z;
+
+    double fx = f(xr);
+    double fy = f(yr);
+    double fz = f(zr);
+
+    double L = 116.0 * fy - 16.0;
+    double a = 500.0 * (fx - fy);
+    double b = 200.0 * (fy - fz);
+
+    return {L, a, b};
+}
+
+XYZ labToXyz(const Lab &lab) {
+    double fy = (lab.L + 16.0) / 116.0;
+    double fx = lab.a / 500.0 + fy;
+    double fz = fy - lab.b / 200.0;
+
+    auto invf = [](double t)->double {
+        const double thresh = 0.008856;
+        if (t*t*t > thresh) return t*t*t;
+        else return (t - 16.0/116.0) / 7.787;
+    };
+
+    double xr = invf(fx);
+    double yr = invf(fy);
+    double zr = invf(fz);
+
+    return { xr * REF_X, yr * REF_Y, zr * REF_Z };
+}
+
+Lab rgbToLab(const RGB &rgb) {
+    XYZ xyz = rgbToXyz(rgb);
+    return xyzToLab(xyz);
+}
+
+std::pair<RGB, bool> labToRgb(const Lab &lab) {
+    XYZ xyz = labToXyz(lab);
+    return xyzToRgb(xyz);
+}
+
+Lab cmykToLab(const CMYK &cmyk) {
+    double r = (1.0 - cmyk.c) * (1.0 - cmyk.k);
+    double g = (1.0 - cmyk.m) * (1.0 - cmyk.k);
+    double b = (1.0 - cmyk.y) * (1.0 - cmyk.k);
+    return xyzToLab(linearRgbToXyz(invGamma(r), invGamma(g), invGamma(b)));
+}
+
+
+Lab16 encodeLab16(const Lab &lab) {
+    double L = std::clamp(lab.L, 0.0, 100.0);
+    double a = std::clamp(lab.a, -128.0, 127.0);
+    double b = std::clamp(lab.b, -128.0, 127.0);
+    return { uint16_t(std::lround(L * 655.35)),
+             uint16_t(std::lround((a + 128.0) * 257.0)),
+             uint16_t(std::lround((b + 128.0) * 257.0)) };
+}
+
+Lab decodeLab16(const Lab16 &lab) {
+    return { lab.L / 655.35, lab.a / 257.0 - 128.0, lab.b / 257.0 - 128.0 };
+}
+
+CMYK16 encodeCmyk16(const CMYK &cmyk) {
+    return { uint16_t(toCode(cmyk.c, 65535)), uint16_t(toCode(cmyk.m, 65535)),
+             uint16_t(toCode(cmyk.y, 65535)), uint16_t(toCode(cmyk.k, 65535)) };
+}
+
+CMYK decodeCmyk16(const CMYK16 &cmyk) {
+    return { cmyk.c / 65535.0, cmyk.m / 65535.0, cmyk.y / 65535.0, cmyk.k / 65535.0 };
+}
+
+double deltaE76(const Lab &x, const Lab &y) {
+    double dL = x.L - y.L, da = x.a - y.a, db = x.b - y.b;
+    return std::sqrt(dL * dL + da * da + db * db);
+}
+
+Lab8 encodeLab8(const Lab &lab) {
+    return { uint8_t(toCode(lab.L / 100.0, 255)),
+             uint8_t(abCode(lab.a)), uint8_t(abCode(lab.b)) };
+}
+
+Lab decodeLab8(const Lab8 &lab) {
+    return { lab.L * (100.0 / 255.0), lab.a - 128.0, lab.b - 128.0 };
+}
+
+CMYK8 encodeCmyk8(const CMYK &cmyk) {
+    return { uint8_t(toCode(cmyk.c, 255)), uint8_t(toCode(cmyk.m, 255)),
+             uint8_t(toCode(cmyk.y, 255)), uint8_t(toCode(cmyk.k, 255)) };
+}
+
+CMYK decodeCmyk8(const CMYK8 &cmyk) {
+    return { cmyk.c / 255.0, cmyk.m / 255.0, cmyk.y / 255.0, cmyk.k / 255.0 };
+}
+
+
+CMYK rgb16ToCmyk(const RGB16 &rgb) {
+    return unitRgbToCmyk(rgb.r / 65535.0, rgb.g / 65535.0, rgb.b / 65535.0);
+}
+
+RGB16 cmykToRgb16(const CMYK &cmyk) {
+    return { toCode((1.0 - cmyk.c) * (1.0 - cmyk.k), 65535),
+             toCode((1.0 - cmyk.m) * (1.0 - cmyk.k), 65535),
+             toCode((1.0 - cmyk.y) * (1.0 - cmyk.k), 65535) };
+}
+
+XYZ rgb16ToXyz(const RGB16 &rgb) {
+    return linearRgbToXyz(invGamma(rgb.r / 65535.0), invGamma(rgb.g / 65535.0), invGamma(rgb.b / 65535.0));
+}
+
+std::pair<RGB16,bool> xyzToRgb16(const XYZ &xyz) {
+    double r, g, b;
+    bool clipped;
+    xyzToUnitRgb(xyz, r, g, b, clipped);
+    return { { toCode(r, 65535), toCode(g, 65535), toCode(b, 65535) }, clipped };
+}
+
+Lab rgb16ToLab(const RGB16 &rgb) {
+    return xyzToLab(rgb16ToXyz(rgb));
+}
+
+std::pair<RGB16, bool> labToRgb16(const Lab &lab) {
+    return xyzToRgb16(labToXyz(lab));
+}
@@ -0,0 +1,74 @@
+#ifndef COLORMODELS_H
+#define COLORMODELS_H
+
+#include <cstdint>
+#include <utility>
+
+struct RGB { int r, g, b; };
+struct CMYK { double c, m, y, k; };
+struct XYZ { double X, Y, Z; };
+struct Lab  { double L, a, b; };
+
+// 16 бит на канал: RGB16 0..65535; Lab16 в кодировке ICC
+// (L * 65535 / 100, (a + 128) * 257, (b + 128) * 257); CMYK16 0..65535 = 0..100 %
+struct RGB16 { int r, g, b; };
+struct Lab16 { uint16_t L, a, b; };
+struct CMYK16 { uint16_t c, m, y, k; };
+
+// 8 бит на канал: Lab8 в кодировке ICC (L * 255 / 100, a + 128, b + 128);
+// CMYK8 0..255 = 0..100 %. Размер совпадает с RGB8 / RGBA8, что даёт
+// преобразования на месте.
+struct Lab8 { uint8_t L, a, b; };
+struct CMYK8 { uint8_t c, m, y, k; };
+static_assert(sizeof(Lab8) == 3 && sizeof(CMYK8) == 4, "упакованные форматы без выравнивания");
+
+// белая точка D65
+const double REF_X = 95.047;
+const double REF_Y = 100.0;
+const double REF_Z = 108.883;
+
+static inline int clampInt(int v, int lo, int hi){ return v < lo ? lo : (v > hi ? hi : v); }
+
+double invGamma(double v);
+double gammaSRGB(double v);
+
+CMYK rgbToCmyk(const RGB &rgb);
+CMYK unitRgbToCmyk(double r, double g, double b);    // sRGB 0..1 (с гаммой)
+RGB cmykToRgb(const CMYK &cmyk);
+
+// линейные (без гаммы) sRGB 0..1 <-> XYZ 0..100
+XYZ linearRgbToXyz(double rl, double gl, double bl);
+void xyzToLinearRgb(const XYZ &xyz, double &rl, double &gl, double &bl);
+
+XYZ rgbToXyz(const RGB &rgb);
+std::pair<RGB,bool> xyzToRgb(const XYZ &xyz);
+
+Lab xyzToLab(const XYZ &xyz);
+XYZ labToXyz(const Lab &lab);
+
+Lab rgbToLab(const RGB &rgb);
+std::pair<RGB, bool> labToRgb(const Lab &lab);
+
+// CMYK -> Lab без округления до 8-битного RGB по дороге
+Lab cmykToLab(const CMYK &cmyk);
+
+// цветовое отличие CIE76 (евклидово расстояние в Lab)
+double deltaE76(const Lab &x, const Lab &y);
+
+Lab16 encodeLab16(const Lab &lab);
+Lab decodeLab16(const Lab16 &lab);
+CMYK16 encodeCmyk16(const CMYK &cmyk);
+CMYK decodeCmyk16(const CMYK16 &cmyk);
+Lab8 encodeLab8(const Lab &lab);
+Lab decodeLab8(const Lab8 &lab);
+CMYK8 encodeCmyk8(const CMYK &cmyk);
+CMYK decodeCmyk8(const CMYK8 &cmyk);
+
+CMYK rgb16ToCmyk(const RGB16 &rgb);
+RGB16 cmykToRgb16(const CMYK &cmyk);
+XYZ rgb16ToXyz(const RGB16 &rgb);
+std::pair<RGB16,bool> xyzToRgb16(const XYZ &xyz);
+Lab rgb16ToLab(const RGB16 &rgb);
+std::pair<RGB16, bool> labToRgb16(const Lab &lab);
+
+#endif // COLORMODELS_H
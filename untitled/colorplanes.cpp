@@ -0,0 +1,167 @@
+#include "colorplanes.h"
+#include "colormodels.h"
+#include "simdpixels.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+#ifdef COLOR_SSE2
+// кубический корень для t > 0: начальное приближение делением битов float
+// на 3, дальше три шага Ньютона (точность float)
+static inline __m128 cbrt4(__m128 t) {
+    __m128i bits = _mm_castps_si128(t);
+    __m128 third = _mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_set1_ps(1.0f / 3.0f));
+    __m128 y = _mm_castsi128_ps(_mm_add_epi32(_mm_cvtps_epi32(third), _mm_set1_epi32(709921077)));
+    const __m128 k = _mm_set1_ps(1.0f / 3.0f);
+    for (int i = 0; i < 3; ++i)
+        y = _mm_mul_ps(_mm_add_ps(_mm_add_ps(y, y), _mm_div_ps(t, _mm_mul_ps(y, y))), k);
+    return y;
+}
+
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// f(t) из xyzToLab
+static inline __m128 labF4(__m128 t) {
+    const __m128 thresh = _mm_set1_ps(0.008856f);
+    __m128 lin = _mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(7.787f)), _mm_set1_ps(16.0f / 116.0f));
+    return select4(_mm_cmpgt_ps(t, thresh), cbrt4(_mm_max_ps(t, thresh)), lin);
+}
+
+// обратная к f, как в labToXyz
+static inline __m128 labInvF4(__m128 t) {
+    __m128 cube = _mm_mul_ps(_mm_mul_ps(t, t), t);
+    __m128 lin = _mm_mul_ps(_mm_sub_ps(t, _mm_set1_ps(16.0f / 116.0f)), _mm_set1_ps(1.0f / 7.787f));
+    return select4(_mm_cmpgt_ps(cube, _mm_set1_ps(0.008856f)), cube, lin);
+}
+#endif
+
+// таблицы гаммы: GAMMA_STEPS отрезков на 0..1
+const int GAMMA_STEPS = 4096;
+
+const float *gammaTable(bool toLinear) {
+    static const auto tables = []{
+        static float t[2][GAMMA_STEPS + 2];
+        for (int i = 0; i <= GAMMA_STEPS; ++i) {
+            t[0][i] = float(gammaSRGB(double(i) / GAMMA_STEPS));
+            t[1][i] = float(invGamma(double(i) / GAMMA_STEPS));
+        }
+        // лишний узел: интерполяция в v = 1 не выходит за таблицу
+        t[0][GAMMA_STEPS + 1] = t[0][GAMMA_STEPS];
+        t[1][GAMMA_STEPS + 1] = t[1][GAMMA_STEPS];
+        return t;
+    }();
+    return tables[toLinear ? 1 : 0];
+}
+
+void gammaPlane(const float *table, const float *v, float *out, int n) {
+    for (int i = 0; i < n; ++i) {
+        float x = std::min(std::max(v[i], 0.0f), 1.0f) * GAMMA_STEPS;
+        int k = int(x);
+        float f = x - float(k);
+        out[i] = table[k] + (table[k + 1] - table[k]) * f;
+    }
+}
+
+}
+
+// X, Y, Z (0..100) -> L, a, b
+void xyzToLabPlanes(const float *X, const float *Y, const float *Z, float *L, float *A, float *B, int n) {
+    int i = 0;
+#ifdef COLOR_SSE2
+    const __m128 ix = _mm_set1_ps(float(1.0 / REF_X)), iy = _mm_set1_ps(float(1.0 / REF_Y)), iz = _mm_set1_ps(float(1.0 / REF_Z));
+    for (; i + 4 <= n; i += 4) {
+        __m128 fx = labF4(_mm_mul_ps(_mm_loadu_ps(X + i), ix));
+        __m128 fy = labF4(_mm_mul_ps(_mm_loadu_ps(Y + i), iy));
+        __m128 fz = labF4(_mm_mul_ps(_mm_loadu_ps(Z + i), iz));
+        _mm_storeu_ps(L + i, _mm_sub_ps(_mm_mul_ps(fy, _mm_set1_ps(116.0f)), _mm_set1_ps(16.0f)));
+        _mm_storeu_ps(A + i, _mm_mul_ps(_mm_sub_ps(fx, fy), _mm_set1_ps(500.0f)));
+        _mm_storeu_ps(B + i, _mm_mul_ps(_mm_sub_ps(fy, fz), _mm_set1_ps(200.0f)));
+    }
+#endif
+    for (; i < n; ++i) {
+        Lab lab = xyzToLab({ X[i], Y[i], Z[i] });
+        L[i] = float(lab.L); A[i] = float(lab.a); B[i] = float(lab.b);
+    }
+}
+
+void labToXyzPlanes(const float *L, const float *A, const float *B, float *X, float *Y, float *Z, int n) {
+    int i = 0;
+#ifdef COLOR_SSE2
+    const __m128 rx = _mm_set1_ps(float(REF_X)), ry = _mm_set1_ps(float(REF_Y)), rz = _mm_set1_ps(float(REF_Z));
+    for (; i + 4 <= n; i += 4) {
+        __m128 fy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(L + i), _mm_set1_ps(16.0f)), _mm_set1_ps(1.0f / 116.0f));
+        __m128 fx = _mm_add_ps(fy, _mm_mul_ps(_mm_loadu_ps(A + i), _mm_set1_ps(1.0f / 500.0f)));
+        __m128 fz = _mm_sub_ps(fy, _mm_mul_ps(_mm_loadu_ps(B + i), _mm_set1_ps(1.0f / 200.0f)));
+        _mm_storeu_ps(X + i, _mm_mul_ps(labInvF4(fx), rx));
+        _mm_storeu_ps(Y + i, _mm_mul_ps(labInvF4(fy), ry));
+        _mm_storeu_ps(Z + i, _mm_mul_ps(labInvF4(fz), rz));
+    }
+#endif
+    for (; i < n; ++i) {
+        XYZ xyz = labToXyz({ L[i], A[i], B[i] });
+        X[i] = float(xyz.X); Y[i] = float(xyz.Y); Z[i] = float(xyz.Z);
+    }
+}
+
+// линейный RGB 0..1 -> XYZ 0..100 (матрица linearRgbToXyz)
+void linearToXyzPlanes(const float *R, const float *G, const float *B, float *X, float *Y, float *Z, int n) {
+    const float m[9] = { 41.24564f, 35.75761f, 18.04375f,
+                         21.26729f, 71.51522f,  7.21750f,
+                          1.93339f, 11.91920f, 95.03041f };
+    int i = 0;
+#ifdef COLOR_SSE2
+    for (; i + 4 <= n; i += 4) {
+        __m128 r = _mm_loadu_ps(R + i), g = _mm_loadu_ps(G + i), b = _mm_loadu_ps(B + i);
+        float *out[3] = { X, Y, Z };
+        for (int k = 0; k < 3; ++k) {
+            __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(m[3 * k])), _mm_mul_ps(g, _mm_set1_ps(m[3 * k + 1]))),
+                                  _mm_mul_ps(b, _mm_set1_ps(m[3 * k + 2])));
+            _mm_storeu_ps(out[k] + i, v);
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        float r = R[i], g = G[i], b = B[i];
+        X[i] = m[0] * r + m[1] * g + m[2] * b;
+        Y[i] = m[3] * r + m[4] * g + m[5] * b;
+        Z[i] = m[6] * r + m[7] * g + m[8] * b;
+    }
+}
+
+// матрица xyzToLinearRgb с учётом XYZ в 0..100
+void xyzToLinearPlanes(const float *X, const float *Y, const float *Z, float *R, float *G, float *B, int n) {
+    const float m[9] = {  0.032406f, -0.015372f, -0.004986f,
+                         -0.009689f,  0.018758f,  0.000415f,
+                          0.000557f, -0.002040f,  0.010570f };
+    int i = 0;
+#ifdef COLOR_SSE2
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(X + i), y = _mm_loadu_ps(Y + i), z = _mm_loadu_ps(Z + i);
+        float *out[3] = { R, G, B };
+        for (int k = 0; k < 3; ++k) {
+            __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[3 * k])), _mm_mul_ps(y, _mm_set1_ps(m[3 * k + 1]))),
+                                  _mm_mul_ps(z, _mm_set1_ps(m[3 * k + 2])));
+            _mm_storeu_ps(out[k] + i, v);
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        float x = X[i], y = Y[i], z = Z[i];
+        R[i] = m[0] * x + m[1] * y + m[2] * z;
+        G[i] = m[3] * x + m[4] * y + m[5] * z;
+        B[i] = m[6] * x + m[7] * y + m[8] * z;
+    }
+}
+
+void srgbToLinearPlane(const float *v, float *out, int n) {
+    gammaPlane(gammaTable(true), v, out, n);
+}
+
+void linearToSrgbPlane(const float *v, float *out, int n) {
+    gammaPlane(gammaTable(false), v, out, n);
+}
@@ -0,0 +1,21 @@
+#ifndef COLORPLANES_H
+#define COLORPLANES_H
+
+// Формулы colormodels над плоскостями float (по одному массиву на компоненту).
+// Ядра считают по 4 значения в регистре SSE2, хвост из n % 4 значений — скалярными
+// формулами colormodels; n любое. Выход может совпадать со входом.
+
+// X, Y, Z (0..100) <-> L, a, b
+void xyzToLabPlanes(const float *X, const float *Y, const float *Z, float *L, float *A, float *B, int n);
+void labToXyzPlanes(const float *L, const float *A, const float *B, float *X, float *Y, float *Z, int n);
+
+// линейный RGB 0..1 <-> XYZ 0..100
+void linearToXyzPlanes(const float *R, const float *G, const float *B, float *X, float *Y, float *Z, int n);
+void xyzToLinearPlanes(const float *X, const float *Y, const float *Z, float *R, float *G, float *B, int n);
+
+// Гамма sRGB по таблице с линейной интерполяцией (ошибка меньше 1e-4),
+// вход обрезается до 0..1.
+void srgbToLinearPlane(const float *v, float *out, int n);
+void linearToSrgbPlane(const float *v, float *out, int n);
+
+#endif // COLORPLANES_H
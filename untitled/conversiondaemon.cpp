@@ -0,0 +1,519 @@
+#include "conversiondaemon.h"
+#include "batchconvert.h"
+#include "colormodels.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+// пикселей в одной задаче пула
+const std::size_t CHUNK = std::size_t(1) << 16;
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+}
+
+void daemonConvert(const uint8_t *rgb, int channels, std::size_t pixels, DaemonTarget to, uint8_t *out) {
+    const int chunks = int((pixels + CHUNK - 1) / CHUNK);
+    parallelFor(chunks, 1, [&](int c0, int c1){
+        const std::size_t begin = std::size_t(c0) * CHUNK, end = std::min(pixels, std::size_t(c1) * CHUNK);
+        const uint8_t *src = rgb + begin * std::size_t(channels);
+        if (to == DaemonTarget::Cmyk8) rgbToCmyk8Batch(src, channels, reinterpret_cast<CMYK8 *>(out) + begin, end - begin);
+        else rgbToLab8Batch(src, channels, reinterpret_cast<Lab8 *>(out) + begin, end - begin);
+    });
+}
+
+#ifndef _WIN32
+
+namespace {
+
+const uint32_t MAGIC = 0x434c5244;      // "DRLC"
+const uint32_t KIND_COPY = 1;
+const uint32_t KIND_SHARED = 2;
+// отображений общей памяти на клиента
+const std::size_t MAPPINGS = 8;
+
+struct Header {
+    uint32_t magic;
+    uint32_t kind;
+    uint32_t target;
+    uint32_t channels;
+    uint64_t pixels;
+};
+
+enum Status : uint32_t { Ok = 0, BadRequest = 1, BadBuffer = 2 };
+
+struct Reply {
+    uint32_t magic;
+    uint32_t status;
+    uint64_t bytes;         // результата: в сокете после ответа или в общем буфере
+};
+
+const char *statusText(uint32_t status) {
+    switch (status) {
+    case BadRequest: return "демон отклонил запрос";
+    case BadBuffer: return "демон не смог отобразить общий буфер";
+    default: return "неизвестный ответ демона";
+    }
+}
+
+std::string systemError(const std::string &what) {
+    return what + ": " + std::strerror(errno);
+}
+
+int sendFlags() {
+#ifdef MSG_NOSIGNAL
+    return MSG_NOSIGNAL;
+#else
+    return 0;
+#endif
+}
+
+bool sendAll(int fd, const void *data, std::size_t size) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t n = ::send(fd, p, size, sendFlags());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= std::size_t(n);
+    }
+    return true;
+}
+
+bool receiveAll(int fd, void *data, std::size_t size) {
+    uint8_t *p = static_cast<uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t n = ::recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= std::size_t(n);
+    }
+    return true;
+}
+
+// заголовок, затем payload; дескрипторы — вместе с первым байтом заголовка
+bool sendMessage(int fd, const void *header, std::size_t headerSize, const uint8_t *payload, std::size_t payloadSize,
+                 const int *fds, int fdCount) {
+    iovec parts[2] = { { const_cast<void *>(header), headerSize },
+                       { const_cast<uint8_t *>(payload), payloadSize } };
+    msghdr msg = {};
+    msg.msg_iov = parts;
+    msg.msg_iovlen = payloadSize ? 2 : 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * 2)] = {};
+    if (fdCount > 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * std::size_t(fdCount));
+        cmsghdr *c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int) * std::size_t(fdCount));
+        std::memcpy(CMSG_DATA(c), fds, sizeof(int) * std::size_t(fdCount));
+    }
+    ssize_t n;
+    do n = ::sendmsg(fd, &msg, sendFlags()); while (n < 0 && errno == EINTR);
+    if (n <= 0) return false;
+    // остаток без дескрипторов — они уже ушли с первой порцией
+    std::size_t sent = std::size_t(n);
+    if (sent < headerSize) {
+        if (!sendAll(fd, static_cast<const uint8_t *>(header) + sent, headerSize - sent)) return false;
+        sent = headerSize;
+    }
+    return sendAll(fd, payload + (sent - headerSize), payloadSize - (sent - headerSize));
+}
+
+// false — соединение закрыто или сломано; пришедшие дескрипторы — в fds
+bool receiveHeader(int fd, Header &header, int *fds, int &fdCount) {
+    fdCount = 0;
+    iovec part = { &header, sizeof(header) };
+    msghdr msg = {};
+    msg.msg_iov = &part;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * 2)];
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+    ssize_t n;
+    do n = ::recvmsg(fd, &msg, flags); while (n < 0 && errno == EINTR);
+    if (n <= 0) return false;
+    for (cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        const int count = int((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        for (int i = 0; i < count; ++i) {
+            int received;
+            std::memcpy(&received, CMSG_DATA(c) + sizeof(int) * std::size_t(i), sizeof(int));
+            if (fdCount < 2) fds[fdCount++] = received;
+            else ::close(received);
+        }
+    }
+    return std::size_t(n) == sizeof(header)
+        || receiveAll(fd, reinterpret_cast<uint8_t *>(&header) + n, sizeof(header) - std::size_t(n));
+}
+
+void closeOnExec(int fd) {
+    ::fcntl(fd, F_SETFD, ::fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+bool socketAddress(const std::string &path, sockaddr_un &address, std::string *error) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return fail(error, "слишком длинный путь сокета: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Общие буферы клиента, отображённые в демоне. Один и тот же memfd приходит
+// новым дескриптором в каждом запросе — узнаём его по устройству и inode
+// и не отображаем заново. Пока отображение живо, inode не освобождается.
+class MappingCache {
+public:
+    ~MappingCache() {
+        for (const Mapping &m : mappings) ::munmap(m.base, m.size);
+    }
+
+    // дескриптор закрывается в любом случае
+    uint8_t *map(int fd, std::size_t &size) {
+        struct stat st;
+        uint8_t *p = nullptr;
+        size = 0;
+        if (sealed(fd) && ::fstat(fd, &st) == 0 && st.st_size > 0) {
+            for (std::size_t i = 0; i < mappings.size() && !p; ++i) {
+                Mapping &m = mappings[i];
+                if (m.device == st.st_dev && m.inode == st.st_ino && m.size == std::size_t(st.st_size)) {
+                    m.used = ++tick;
+                    p = m.base;
+                }
+            }
+            if (!p) p = insert(fd, st);
+            if (p) size = std::size_t(st.st_size);
+        }
+        ::close(fd);
+        return p;
+    }
+
+private:
+    // Уменьшенный клиентом файл — SIGBUS при обращении к отображению, поэтому
+    // на Linux берём только memfd с F_SEAL_SHRINK: снять печать нельзя. У
+    // shm_open печатей нет — там остаётся доверять клиенту.
+    static bool sealed(int fd) {
+#ifdef F_SEAL_SHRINK
+        const int seals = ::fcntl(fd, F_GET_SEALS);
+        return seals >= 0 && (seals & F_SEAL_SHRINK);
+#else
+        (void)fd;
+        return true;
+#endif
+    }
+
+    struct Mapping {
+        dev_t device;
+        ino_t inode;
+        uint8_t *base;
+        std::size_t size;
+        uint64_t used;
+    };
+
+    uint8_t *insert(int fd, const struct stat &st) {
+        void *p = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return nullptr;
+        if (mappings.size() == MAPPINGS) {
+            auto oldest = std::min_element(mappings.begin(), mappings.end(),
+                                           [](const Mapping &a, const Mapping &b){ return a.used < b.used; });
+            ::munmap(oldest->base, oldest->size);
+            mappings.erase(oldest);
+        }
+        mappings.push_back({ st.st_dev, st.st_ino, static_cast<uint8_t *>(p), std::size_t(st.st_size), ++tick });
+        return static_cast<uint8_t *>(p);
+    }
+
+    std::vector<Mapping> mappings;
+    uint64_t tick = 0;
+};
+
+}
+
+SharedBuffer::~SharedBuffer() {
+    reset();
+}
+
+void SharedBuffer::reset() {
+    if (base) ::munmap(base, length);
+    if (fd >= 0) ::close(fd);
+    base = nullptr;
+    length = 0;
+    fd = -1;
+}
+
+bool SharedBuffer::create(std::size_t bytes, std::string *error) {
+    reset();
+    if (bytes == 0) return fail(error, "пустой общий буфер");
+#ifdef __linux__
+    fd = ::memfd_create("colour-buffer", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    // имя нужно только на время shm_open
+    static std::atomic<unsigned> serial{0};
+    char name[64];
+    std::snprintf(name, sizeof(name), "/colour-%ld-%u", long(::getpid()), serial++);
+    fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        ::shm_unlink(name);
+        closeOnExec(fd);
+    }
+#endif
+    if (fd < 0) return fail(error, systemError("не удалось создать общий буфер"));
+    if (::ftruncate(fd, off_t(bytes)) != 0) {
+        const std::string msg = systemError("не удалось задать размер общего буфера");
+        reset();
+        return fail(error, msg);
+    }
+#ifdef __linux__
+    // без печати демон буфер не примет
+    if (::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0) {
+        const std::string msg = systemError("не удалось запечатать общий буфер");
+        reset();
+        return fail(error, msg);
+    }
+#endif
+    void *p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        const std::string msg = systemError("не удалось отобразить общий буфер");
+        reset();
+        return fail(error, msg);
+    }
+    base = static_cast<uint8_t *>(p);
+    length = bytes;
+    return true;
+}
+
+ConversionDaemon::~ConversionDaemon() {
+    stop();
+    if (listener >= 0) ::close(listener);
+    if (!socketPath.empty()) ::unlink(socketPath.c_str());
+}
+
+bool ConversionDaemon::listen(const std::string &path, std::string *error) {
+    sockaddr_un address;
+    if (!socketAddress(path, address, error)) return false;
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) return fail(error, systemError("не удалось создать сокет"));
+    closeOnExec(listener);
+    ::unlink(path.c_str());
+    if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+            || ::listen(listener, 16) != 0) {
+        const std::string msg = systemError("не удалось слушать " + path);
+        ::close(listener);
+        listener = -1;
+        return fail(error, msg);
+    }
+    socketPath = path;
+    return true;
+}
+
+void ConversionDaemon::serve() {
+    while (!stopping) {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        closeOnExec(fd);
+        std::vector<std::thread> done;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (stopping) {
+                ::close(fd);
+                break;
+            }
+            // потоки отключившихся клиентов забираем сразу, а не в stop()
+            for (auto it = clients.begin(); it != clients.end(); ) {
+                if (std::find(finished.begin(), finished.end(), it->get_id()) == finished.end()) {
+                    ++it;
+                    continue;
+                }
+                done.push_back(std::move(*it));
+                it = clients.erase(it);
+            }
+            finished.clear();
+            clientFds.push_back(fd);
+            clients.emplace_back(&ConversionDaemon::client, this, fd);
+        }
+        // им осталось только выйти из client()
+        for (std::thread &t : done) t.join();
+    }
+}
+
+void ConversionDaemon::stop() {
+    std::vector<std::thread> running;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (stopping.exchange(true)) return;
+        // accept и recv в потоках клиентов возвращаются с ошибкой
+        if (listener >= 0) ::shutdown(listener, SHUT_RDWR);
+        for (int fd : clientFds) ::shutdown(fd, SHUT_RDWR);
+        running.swap(clients);
+    }
+    for (std::thread &t : running) t.join();
+}
+
+void ConversionDaemon::client(int fd) {
+    MappingCache cache;
+    std::vector<uint8_t> input, output;     // путь с копированием: буферы живут между запросами
+    Header header;
+    int fds[2];
+    int fdCount = 0;
+    while (receiveHeader(fd, header, fds, fdCount)) {
+        const DaemonTarget to = DaemonTarget(header.target);
+        const std::size_t channels = header.channels;
+        const std::size_t pixels = std::size_t(header.pixels);
+        const bool valid = header.magic == MAGIC && (to == DaemonTarget::Lab8 || to == DaemonTarget::Cmyk8)
+                && (channels == 3 || channels == 4) && pixels > 0 && header.pixels < (uint64_t(1) << 36);
+        // с копированием память выделяет демон: размер — в пределах maxRequestBytes
+        const bool fits = valid && pixels <= maxRequestBytes / (channels + daemonOutputBytes(to));
+        Reply reply = { MAGIC, Ok, 0 };
+
+        if (fits && header.kind == KIND_COPY && fdCount == 0) {
+            input.resize(pixels * channels);
+            if (!receiveAll(fd, input.data(), input.size())) break;
+            output.resize(pixels * daemonOutputBytes(to));
+            daemonConvert(input.data(), int(channels), pixels, to, output.data());
+            reply.bytes = output.size();
+            if (!sendMessage(fd, &reply, sizeof(reply), output.data(), output.size(), nullptr, 0)) break;
+            continue;
+        }
+
+        if (valid && header.kind == KIND_SHARED && fdCount == 2) {
+            std::size_t inSize = 0, outSize = 0;
+            const uint8_t *in = cache.map(fds[0], inSize);
+            uint8_t *out = cache.map(fds[1], outSize);
+            fdCount = 0;
+            if (in && out && inSize >= pixels * channels && outSize >= pixels * daemonOutputBytes(to)) {
+                daemonConvert(in, int(channels), pixels, to, out);
+                reply.bytes = pixels * daemonOutputBytes(to);
+            } else {
+                reply.status = BadBuffer;
+            }
+        } else {
+            // тело запроса с копированием не прочитано — продолжать нельзя
+            if (header.kind == KIND_COPY) {
+                reply.status = BadRequest;
+                sendMessage(fd, &reply, sizeof(reply), nullptr, 0, nullptr, 0);
+                break;
+            }
+            reply.status = BadRequest;
+        }
+        for (int i = 0; i < fdCount; ++i) ::close(fds[i]);
+        if (!sendMessage(fd, &reply, sizeof(reply), nullptr, 0, nullptr, 0)) break;
+    }
+    for (int i = 0; i < fdCount; ++i) ::close(fds[i]);
+
+    std::lock_guard<std::mutex> guard(lock);
+    ::close(fd);
+    clientFds.erase(std::remove(clientFds.begin(), clientFds.end(), fd), clientFds.end());
+    if (!stopping) finished.push_back(std::this_thread::get_id());
+}
+
+DaemonClient::~DaemonClient() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool DaemonClient::connect(const std::string &path, std::string *error) {
+    sockaddr_un address;
+    if (!socketAddress(path, address, error)) return false;
+    if (fd >= 0) ::close(fd);
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return fail(error, systemError("не удалось создать сокет"));
+    closeOnExec(fd);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        const std::string msg = systemError("не удалось подключиться к " + path);
+        ::close(fd);
+        fd = -1;
+        return fail(error, msg);
+    }
+    return true;
+}
+
+bool DaemonClient::exchange(uint32_t kind, int channels, std::size_t pixels, DaemonTarget to, const uint8_t *payload,
+                            const int *fds, int fdCount, std::vector<uint8_t> *out, std::string *error) {
+    if (fd < 0) return fail(error, "нет соединения с демоном");
+    const Header header = { MAGIC, kind, uint32_t(to), uint32_t(channels), uint64_t(pixels) };
+    const std::size_t payloadSize = payload ? pixels * std::size_t(channels) : 0;
+    if (!sendMessage(fd, &header, sizeof(header), payload, payloadSize, fds, fdCount))
+        return fail(error, systemError("ошибка отправки демону"));
+    Reply reply;
+    if (!receiveAll(fd, &reply, sizeof(reply)) || reply.magic != MAGIC)
+        return fail(error, "демон закрыл соединение");
+    if (reply.status != Ok) return fail(error, statusText(reply.status));
+    if (out) {
+        out->resize(std::size_t(reply.bytes));
+        if (!receiveAll(fd, out->data(), out->size())) return fail(error, "демон закрыл соединение");
+    }
+    return true;
+}
+
+bool DaemonClient::convertCopy(const uint8_t *rgb, int channels, std::size_t pixels, DaemonTarget to,
+                               std::vector<uint8_t> *out, std::string *error) {
+    return exchange(KIND_COPY, channels, pixels, to, rgb, nullptr, 0, out, error);
+}
+
+bool DaemonClient::convertShared(const SharedBuffer &in, int channels, std::size_t pixels, DaemonTarget to,
+                                 const SharedBuffer &out, std::string *error) {
+    if (in.size() < pixels * std::size_t(channels) || out.size() < pixels * daemonOutputBytes(to))
+        return fail(error, "общий буфер меньше изображения");
+    const int fds[2] = { in.handle(), out.handle() };
+    return exchange(KIND_SHARED, channels, pixels, to, nullptr, fds, 2, nullptr, error);
+}
+
+#else
+
+SharedBuffer::~SharedBuffer() {}
+void SharedBuffer::reset() {}
+bool SharedBuffer::create(std::size_t, std::string *error) { return fail(error, "общая память не поддерживается"); }
+
+ConversionDaemon::~ConversionDaemon() {}
+bool ConversionDaemon::listen(const std::string &, std::string *error) {
+    return fail(error, "демон на этой системе не поддерживается");
+}
+void ConversionDaemon::serve() {}
+void ConversionDaemon::stop() {}
+void ConversionDaemon::client(int) {}
+
+DaemonClient::~DaemonClient() {}
+bool DaemonClient::connect(const std::string &, std::string *error) {
+    return fail(error, "демон на этой системе не поддерживается");
+}
+bool DaemonClient::exchange(uint32_t, int, std::size_t, DaemonTarget, const uint8_t *, const int *, int,
+                            std::vector<uint8_t> *, std::string *error) {
+    return fail(error, "демон на этой системе не поддерживается");
+}
+bool DaemonClient::convertCopy(const uint8_t *, int, std::size_t, DaemonTarget, std::vector<uint8_t> *,
+                               std::string *error) {
+    return fail(error, "демон на этой системе не поддерживается");
+}
+bool DaemonClient::convertShared(const SharedBuffer &, int, std::size_t, DaemonTarget, const SharedBuffer &,
+                                 std::string *error) {
+    return fail(error, "демон на этой системе не поддерживается");
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef CONVERSIONDAEMON_H
+#define CONVERSIONDAEMON_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Локальный демон перевода RGB8 -> Lab8 / CMYK8 через Unix-сокет. Два способа
+// передачи: пиксели в самом сокете (две копии в каждую сторону — в ядро и из
+// него) и общая память — клиент передаёт дескрипторы memfd со входом и местом
+// для результата (SCM_RIGHTS), по сокету идут только заголовки. На Windows
+// не поддерживается: функции возвращают ошибку.
+
+enum class DaemonTarget : uint32_t { Lab8 = 1, Cmyk8 = 2 };
+
+// байт результата на пиксель
+inline std::size_t daemonOutputBytes(DaemonTarget to) { return to == DaemonTarget::Cmyk8 ? 4 : 3; }
+
+// Сам перевод, как его делает демон, — куски пикселей параллельно; rgb — 3 или 4 канала.
+void daemonConvert(const uint8_t *rgb, int channels, std::size_t pixels, DaemonTarget to, uint8_t *out);
+
+// Буфер в общей памяти (memfd на Linux, безымянный shm_open на других Unix).
+// memfd запечатан от уменьшения (F_SEAL_SHRINK): демон, отобразивший его,
+// не получит SIGBUS, если клиент урежет файл; незапечатанные memfd демон не берёт.
+class SharedBuffer {
+public:
+    SharedBuffer() = default;
+    ~SharedBuffer();
+    SharedBuffer(const SharedBuffer &) = delete;
+    SharedBuffer &operator=(const SharedBuffer &) = delete;
+
+    bool create(std::size_t bytes, std::string *error = nullptr);
+    uint8_t *data() const { return base; }
+    std::size_t size() const { return length; }
+    int handle() const { return fd; }
+
+private:
+    void reset();
+
+    int fd = -1;
+    uint8_t *base = nullptr;
+    std::size_t length = 0;
+};
+
+class ConversionDaemon {
+public:
+    // запрос с копированием больше maxRequestMb мегабайт (вход и результат вместе)
+    // отклоняется — память под него демон выделяет сам
+    explicit ConversionDaemon(std::size_t maxRequestMb = 256) : maxRequestBytes(maxRequestMb << 20) {}
+    ~ConversionDaemon();
+    ConversionDaemon(const ConversionDaemon &) = delete;
+    ConversionDaemon &operator=(const ConversionDaemon &) = delete;
+
+    // прежний файл сокета по этому пути удаляется
+    bool listen(const std::string &path, std::string *error = nullptr);
+    // принимает клиентов до stop(), каждого — в своём потоке
+    void serve();
+    // из другого потока; ждёт завершения клиентов
+    void stop();
+
+private:
+    void client(int fd);
+
+    std::size_t maxRequestBytes;
+    int listener = -1;
+    std::string socketPath;
+    std::atomic<bool> stopping{false};
+    std::mutex lock;
+    std::vector<std::thread> clients;
+    std::vector<int> clientFds;
+    std::vector<std::thread::id> finished;    // клиент отключился, поток ещё не присоединён
+};
+
+class DaemonClient {
+public:
+    DaemonClient() = default;
+    ~DaemonClient();
+    DaemonClient(const DaemonClient &) = delete;
+    DaemonClient &operator=(const DaemonClient &) = delete;
+
+    bool connect(const std::string &path, std::string *error = nullptr);
+
+    // пиксели через сокет; out получает pixels * daemonOutputBytes(to) байт
+    bool convertCopy(const uint8_t *rgb, int channels, std::size_t pixels, DaemonTarget to,
+                     std::vector<uint8_t> *out, std::string *error = nullptr);
+    // без копий: демон читает in и пишет результат прямо в out. Буферы стоит
+    // переиспользовать — демон держит их отображёнными, пока клиент подключён.
+    bool convertShared(const SharedBuffer &in, int channels, std::size_t pixels, DaemonTarget to,
+                       const SharedBuffer &out, std::string *error = nullptr);
+
+private:
+    bool exchange(uint32_t kind, int channels, std::size_t pixels, DaemonTarget to, const uint8_t *payload,
+                  const int *fds, int fdCount, std::vector<uint8_t> *out, std::string *error);
+
+    int fd = -1;
+};
+
+#endif // CONVERSIONDAEMON_H
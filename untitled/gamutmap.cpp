@@ -0,0 +1,161 @@
+#include "gamutmap.h"
+#include "lutcache.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+
+namespace {
+
+const int L_PER_UNIT = 4;
+const int L_STEPS = 100 * L_PER_UNIT + 1;
+// Тон в таблице — не угол, а псевдоугол p = 0..4 (см. pseudoAngle): он считается
+// без atan2 и монотонен по углу; 512 шагов — не реже 1° на всём круге.
+const int HUE_STEPS = 512;
+const double MAX_CHROMA = 200.0;    // заведомо вне охвата sRGB при любых L и h
+const double PI = 3.14159265358979323846;
+
+// допуск на погрешность double в переходе Lab -> линейный RGB
+const double EPS = 1e-9;
+// выход за охват после шага по таблице, который ещё можно обрезать (около кода 8 бит)
+const double RESIDUAL = 1e-3;
+
+bool linearInGamut(double r, double g, double b) {
+    return r >= -EPS && r <= 1.0 + EPS && g >= -EPS && g <= 1.0 + EPS && b >= -EPS && b <= 1.0 + EPS;
+}
+
+bool inGamut(const Lab &lab) {
+    double r, g, b;
+    xyzToLinearRgb(labToXyz(lab), r, g, b);
+    return linearInGamut(r, g, b);
+}
+
+// граница по лучу (ca, sa) из оси делением пополам в [0, hi]; 30 делений — ~2e-7 по хроме
+double bisectChroma(double L, double ca, double sa, double hi) {
+    double lo = 0.0;
+    for (int i = 0; i < 30; ++i) {
+        double mid = 0.5 * (lo + hi);
+        if (inGamut({ L, mid * ca, mid * sa })) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// p(a, b): 0 при h = 0°, 1 при 90°, 2 при 180°, 3 при 270°, между ними монотонно
+double pseudoAngle(double a, double b) {
+    double t = b / (std::fabs(a) + std::fabs(b));     // -1..1
+    return a >= 0.0 ? (t >= 0.0 ? t : 4.0 + t) : 2.0 - t;
+}
+
+// угол в градусах по псевдоуглу
+double hueOf(double p) {
+    double t = p <= 1.0 ? p : (p <= 3.0 ? 2.0 - p : p - 4.0);   // b / (|a| + |b|)
+    double a = (p > 1.0 && p <= 3.0) ? -(1.0 - std::fabs(t)) : 1.0 - std::fabs(t);
+    return std::atan2(t, a) * (180.0 / PI);
+}
+
+// граница охвата: строки — L, столбцы — тон
+const float *boundaryTable() {
+    static const std::shared_ptr<const float> table = LutCache::obtain("gamut-chroma", 0, std::size_t(L_STEPS) * HUE_STEPS,
+                                                                       [](float *t){
+        for (int i = 0; i < L_STEPS; ++i)
+            for (int h = 0; h < HUE_STEPS; ++h)
+                t[i * HUE_STEPS + h] = float(maxChroma(double(i) / L_PER_UNIT, hueOf(h * (4.0 / HUE_STEPS))));
+    });
+    return table.get();
+}
+
+double lookup(double L, double p) {
+    const float *t = boundaryTable();
+    double x = std::clamp(L, 0.0, 100.0) * L_PER_UNIT;
+    double y = p * (HUE_STEPS / 4.0);
+    int i0 = std::min(int(x), L_STEPS - 2), h0 = std::min(int(y), HUE_STEPS - 1);
+    int h1 = h0 + 1 == HUE_STEPS ? 0 : h0 + 1;
+    double fx = x - i0, fy = y - h0;
+    const float *r0 = t + i0 * HUE_STEPS, *r1 = r0 + HUE_STEPS;
+    double c0 = r0[h0] + (r0[h1] - r0[h0]) * fy;
+    double c1 = r1[h0] + (r1[h1] - r1[h0]) * fy;
+    return c0 + (c1 - c0) * fx;
+}
+
+static inline uint8_t toByte(double linear) {
+    return uint8_t(clampInt(int(std::lround(gammaSRGB(linear) * 255.0)), 0, 255));
+}
+
+// r, g, b — линейный RGB цвета lab, уже посчитанный вызывающим
+GamutMapped mapOne(const Lab &lab, double r, double g, double b, GamutMapping mode, bool wantDe) {
+    GamutMapped m;
+    m.outOfGamut = !linearInGamut(r, g, b);
+    if (m.outOfGamut && mode == GamutMapping::Chroma) {
+        Lab in{ std::clamp(lab.L, 0.0, 100.0), lab.a, lab.b };
+        const double C = std::sqrt(lab.a * lab.a + lab.b * lab.b);
+        if (C > 0.0) {
+            const double cmax = lookup(in.L, pseudoAngle(lab.a, lab.b));
+            const double s = C > cmax ? cmax / C : 1.0;
+            in.a *= s;
+            in.b *= s;
+        }
+        xyzToLinearRgb(labToXyz(in), r, g, b);
+        // Остаток погрешности интерполяции — доли кода, его обрезаем. Заметный
+        // промах бывает только у острых выступов границы (жёлтый, синий) — там ищем точно.
+        if (r < -RESIDUAL || r > 1.0 + RESIDUAL || g < -RESIDUAL || g > 1.0 + RESIDUAL ||
+            b < -RESIDUAL || b > 1.0 + RESIDUAL) {
+            const double c = bisectChroma(in.L, lab.a / C, lab.b / C, std::min(C, MAX_CHROMA));
+            in.a = lab.a / C * c;
+            in.b = lab.b / C * c;
+            xyzToLinearRgb(labToXyz(in), r, g, b);
+        }
+        if (wantDe) m.dE = deltaE76(lab, in);
+    }
+    m.rgb = { toByte(r), toByte(g), toByte(b) };
+    if (m.outOfGamut && mode == GamutMapping::Clip && wantDe) m.dE = deltaE76(lab, rgbToLab(m.rgb));
+    return m;
+}
+
+}
+
+double maxChroma(double L, double hue) {
+    if (L <= 0.0 || L >= 100.0) return 0.0;
+    return bisectChroma(L, std::cos(hue * (PI / 180.0)), std::sin(hue * (PI / 180.0)), MAX_CHROMA);
+}
+
+double maxChromaTable(double L, double hue) {
+    const double h = hue * (PI / 180.0);
+    return lookup(L, pseudoAngle(std::cos(h), std::sin(h)));
+}
+
+GamutMapped labToRgbMapped(const Lab &lab, GamutMapping mode) {
+    double r, g, b;
+    xyzToLinearRgb(labToXyz(lab), r, g, b);
+    return mapOne(lab, r, g, b, mode, true);
+}
+
+std::size_t labToRgbMappedBatch(const Lab *lab, uint8_t *rgb, int channels, std::size_t count,
+                                GamutMapping mode, float *dE) {
+    std::size_t outside = 0;
+    for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+        double r, g, b;
+        xyzToLinearRgb(labToXyz(lab[i]), r, g, b);
+        GamutMapped m = mapOne(lab[i], r, g, b, mode, dE != nullptr);
+        rgb[0] = uint8_t(m.rgb.r); rgb[1] = uint8_t(m.rgb.g); rgb[2] = uint8_t(m.rgb.b);
+        if (dE) dE[i] = float(m.dE);
+        outside += m.outOfGamut ? 1 : 0;
+    }
+    return outside;
+}
+
+std::size_t labToRgbMappedImage(const ImageView<const Lab> &lab, const ImageView<uint8_t> &rgb, GamutMapping mode) {
+    // таблица строится до раздачи строк, а не в первом потоке, который до неё дойдёт
+    if (mode == GamutMapping::Chroma) boundaryTable();
+    std::atomic<std::size_t> outside{0};
+    parallelFor(lab.height, ROWS_PER_TASK, [&](int y0, int y1){
+        std::size_t n = 0;
+        for (int y = y0; y < y1; ++y)
+            n += labToRgbMappedBatch(lab.row(y), rgb.row(y), rgb.channels, std::size_t(lab.width), mode);
+        outside += n;
+    });
+    return outside;
+}
@@ -0,0 +1,38 @@
+#ifndef GAMUTMAP_H
+#define GAMUTMAP_H
+
+#include "colormodels.h"
+#include "imagebuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Как переводить в RGB цвет Lab вне охвата sRGB:
+//   Clip   — обрезание каждого канала до 0..255 (как labToRgb), оттенок при этом уплывает;
+//   Chroma — L и тон h сохраняются, хрома уменьшается до границы охвата.
+enum class GamutMapping { Clip, Chroma };
+
+struct GamutMapped {
+    RGB rgb;
+    bool outOfGamut = false;
+    double dE = 0.0;            // ΔE76 между исходным Lab и Lab полученного цвета
+};
+
+// Наибольшая хрома в охвате sRGB при данных L (0..100) и тоне h (градусы):
+// точно, делением пополам.
+double maxChroma(double L, double hue);
+// То же по кэшированной таблице границы охвата, билинейно: шаг L 0.25,
+// тон — 512 шагов псевдоугла (не реже 1°).
+double maxChromaTable(double L, double hue);
+
+GamutMapped labToRgbMapped(const Lab &lab, GamutMapping mode);
+
+// Возвращает число цветов вне охвата; dE (если задан) получает сдвиг каждого цвета.
+// Chroma обычно стоит два перевода Lab -> RGB на цвет вне охвата: граница берётся
+// из таблицы. Если после шага по таблице цвет всё ещё заметно вне охвата (острые
+// выступы у жёлтого и синего), граница ищется делением пополам — ещё 30 переводов.
+std::size_t labToRgbMappedBatch(const Lab *lab, uint8_t *rgb, int channels, std::size_t count,
+                                GamutMapping mode, float *dE = nullptr);
+std::size_t labToRgbMappedImage(const ImageView<const Lab> &lab, const ImageView<uint8_t> &rgb, GamutMapping mode);
+
+#endif // GAMUTMAP_H
@@ -0,0 +1,163 @@
+#include "hdrinput.h"
+#include "arena.h"
+#include "parallel.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+
+namespace {
+
+// все 65536 значений half заранее, чтобы не разбирать биты на каждый отсчёт
+const float *halfTable() {
+    static const auto table = []{
+        static float t[65536];
+        for (int i = 0; i < 65536; ++i) {
+            uint32_t sign = uint32_t(i & 0x8000) << 16;
+            uint32_t exp = (i >> 10) & 0x1f;
+            uint32_t mant = i & 0x3ff;
+            uint32_t bits;
+            if (exp == 0) {
+                if (mant == 0) {
+                    bits = sign;
+                } else {
+                    // денормализованное: нормализуем мантиссу
+                    int e = -1;
+                    do { ++e; mant <<= 1; } while (!(mant & 0x400));
+                    bits = sign | uint32_t(127 - 15 - e) << 23 | (mant & 0x3ff) << 13;
+                }
+            } else if (exp == 31) {
+                bits = sign | 0x7f800000u | mant << 13;
+            } else {
+                bits = sign | (exp + 127 - 15) << 23 | mant << 13;
+            }
+            std::memcpy(&t[i], &bits, sizeof(float));
+        }
+        return t;
+    }();
+    return table;
+}
+
+bool isLittleEndian() {
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+struct FileCloser { void operator()(std::FILE *f) const { if (f) std::fclose(f); } };
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+}
+
+float halfToFloat(uint16_t h) {
+    return halfTable()[h];
+}
+
+void linearFloatToXyzBatch(const float *rgb, int channels, XYZ *xyz, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i, rgb += channels)
+        xyz[i] = linearRgbToXyz(rgb[0], rgb[1], rgb[2]);
+}
+
+void linearFloatToLabBatch(const float *rgb, int channels, Lab *lab, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i, rgb += channels)
+        lab[i] = xyzToLab(linearRgbToXyz(rgb[0], rgb[1], rgb[2]));
+}
+
+void linearHalfToLabBatch(const uint16_t *rgb, int channels, Lab *lab, std::size_t count) {
+    const float *h = halfTable();
+    for (std::size_t i = 0; i < count; ++i, rgb += channels)
+        lab[i] = xyzToLab(linearRgbToXyz(h[rgb[0]], h[rgb[1]], h[rgb[2]]));
+}
+
+void linearFloatToLabImage(const ImageView<const float> &rgb, const ImageView<Lab> &lab) {
+    parallelFor(rgb.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y)
+            linearFloatToLabBatch(rgb.row(y), rgb.channels, lab.row(y), std::size_t(rgb.width));
+    });
+}
+
+void linearHalfToLabImage(const ImageView<const uint16_t> &rgb, const ImageView<Lab> &lab) {
+    parallelFor(rgb.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y)
+            linearHalfToLabBatch(rgb.row(y), rgb.channels, lab.row(y), std::size_t(rgb.width));
+    });
+}
+
+bool loadPfm(const std::string &path, Image<float> &img, std::string *error) {
+    FilePtr f(std::fopen(path.c_str(), "rb"));
+    if (!f) return fail(error, "не удалось открыть " + path);
+
+    char magic[3] = {};
+    int w = 0, h = 0;
+    double scale = 0.0;
+    if (std::fscanf(f.get(), "%2s %d %d %lf", magic, &w, &h, &scale) != 4)
+        return fail(error, "повреждён заголовок PFM");
+    std::fgetc(f.get());   // ровно один пробельный символ перед данными
+
+    int channels;
+    if (std::strcmp(magic, "PF") == 0) channels = 3;
+    else if (std::strcmp(magic, "Pf") == 0) channels = 1;
+    else return fail(error, "не PFM-файл");
+    if (w <= 0 || h <= 0 || scale == 0.0) return fail(error, "некорректные размеры PFM");
+
+    // размеры из заголовка сверяем с остатком файла до выделения памяти:
+    // испорченный заголовок не должен просить гигабайты
+    const long dataStart = std::ftell(f.get());
+    if (dataStart < 0 || std::fseek(f.get(), 0, SEEK_END) != 0) return fail(error, "не удалось прочитать " + path);
+    const long fileEnd = std::ftell(f.get());
+    if (fileEnd < dataStart || std::fseek(f.get(), dataStart, SEEK_SET) != 0)
+        return fail(error, "не удалось прочитать " + path);
+    const uint64_t available = uint64_t(fileEnd - dataStart);
+    const uint64_t pixels = uint64_t(w) * uint64_t(h);     // оба < 2^31, не переполняется
+    if (pixels > available / (uint64_t(channels) * sizeof(float)))
+        return fail(error, "файл PFM обрезан");
+
+    const bool swap = (scale < 0.0) != isLittleEndian();
+    ArenaScope scratch;
+    const std::size_t rowSize = std::size_t(w) * channels;
+    float *row = scratch.allocate<float>(rowSize);
+    img = Image<float>(w, h, 3);
+    for (int y = h - 1; y >= 0; --y) {
+        if (std::fread(row, sizeof(float), rowSize, f.get()) != rowSize)
+            return fail(error, "файл PFM обрезан");
+        if (swap) {
+            for (std::size_t i = 0; i < rowSize; ++i) {
+                uint32_t bits;
+                std::memcpy(&bits, &row[i], 4);
+                bits = (bits >> 24) | ((bits >> 8) & 0xff00) | ((bits << 8) & 0xff0000) | (bits << 24);
+                std::memcpy(&row[i], &bits, 4);
+            }
+        }
+        float *dst = img.view().row(y);
+        if (channels == 3) {
+            std::memcpy(dst, row, rowSize * sizeof(float));
+        } else {
+            for (int x = 0; x < w; ++x) dst[3 * x] = dst[3 * x + 1] = dst[3 * x + 2] = row[x];
+        }
+    }
+    return true;
+}
+
+bool savePfm(const std::string &path, const ImageView<const float> &img, std::string *error) {
+    if (img.channels != 3 && img.channels != 1) return fail(error, "PFM хранит только 1 или 3 канала");
+    FilePtr f(std::fopen(path.c_str(), "wb"));
+    if (!f) return fail(error, "не удалось создать " + path);
+
+    std::fprintf(f.get(), "%s\n%d %d\n%s\n", img.channels == 3 ? "PF" : "Pf", img.width, img.height,
+                 isLittleEndian() ? "-1.0" : "1.0");
+    const std::size_t n = std::size_t(img.width) * img.channels;
+    for (int y = img.height - 1; y >= 0; --y) {
+        if (std::fwrite(img.row(y), sizeof(float), n, f.get()) != n)
+            return fail(error, "ошибка записи " + path);
+    }
+    // буферизованные данные уходят на диск только здесь
+    if (std::fclose(f.release()) != 0) return fail(error, "ошибка записи " + path);
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef HDRINPUT_H
+#define HDRINPUT_H
+
+#include "colormodels.h"
+#include "imagebuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Вход в линейном RGB (float32 или half), как в рендерах и EXR/PFM.
+// Гамма sRGB не применяется, значения идут сразу в матрицу XYZ; отрицательные
+// и большие 1.0 значения сохраняются, Lab не обрезается.
+
+float halfToFloat(uint16_t h);
+
+void linearFloatToXyzBatch(const float *rgb, int channels, XYZ *xyz, std::size_t count);
+void linearFloatToLabBatch(const float *rgb, int channels, Lab *lab, std::size_t count);
+void linearHalfToLabBatch(const uint16_t *rgb, int channels, Lab *lab, std::size_t count);
+
+void linearFloatToLabImage(const ImageView<const float> &rgb, const ImageView<Lab> &lab);
+void linearHalfToLabImage(const ImageView<const uint16_t> &rgb, const ImageView<Lab> &lab);
+
+// Portable Float Map: "PF" (RGB) или "Pf" (оттенки серого, разворачиваются в RGB).
+// Строки переворачиваются сверху вниз, порядок байт приводится к текущей машине.
+bool loadPfm(const std::string &path, Image<float> &img, std::string *error = nullptr);
+bool savePfm(const std::string &path, const ImageView<const float> &img, std::string *error = nullptr);
+
+#endif // HDRINPUT_H
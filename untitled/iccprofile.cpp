@@ -0,0 +1,636 @@
+#include "iccprofile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+// Кривая тона: curv (тождество, гамма, таблица) или para (функции 0..4).
+struct IccCurve {
+    enum class Type { Identity, Gamma, Table, Parametric };
+
+    Type type = Type::Identity;
+    int function = 0;
+    double p[7] = { 1.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0 };   // g a b c d e f
+    std::vector<double> table;                           // отсчёты 0..1
+
+    double eval(double x) const;
+    double inverse(double y) const;
+};
+
+// Одна цепочка тега. Для lut8/lut16 input-кривые лежат в a, output — в b.
+struct IccPipeline {
+    enum class Kind { MatrixTrc, InverseMatrixTrc, Lut8, Lut16, AtoB, BtoA };
+    // как закодирована сторона PCS: XYZ как есть (matrix/TRC), XYZ u1Fixed15,
+    // Lab v2 (lut16: 0xFF00 = 100) или Lab v4 (0xFFFF = 100)
+    enum class Pcs { XyzDirect, XyzEncoded, LabV2, LabV4 };
+
+    Kind kind = Kind::Lut16;
+    Pcs pcs = Pcs::LabV4;
+    int inChannels = 0;
+    int outChannels = 0;
+    std::vector<IccCurve> a, m, b;
+    bool hasMatrix = false;
+    double matrix[12] = {};            // 3x3 по строкам, затем смещение
+    std::vector<int> grid;
+    std::vector<float> clut;           // 0..1
+
+    void eval(const double *in, double *out) const;
+
+private:
+    void applyMatrix(double *v) const;
+    void applyInverseMatrix(double *v) const;
+    void interpolate(const double *in, double *out) const;
+};
+
+
+namespace {
+
+const XYZ D50{0.9642, 1.0, 0.8249};
+
+// Брэдфорд D50 -> D65 и обратно
+const double TO_D65[3][3] = {
+    {  0.9555766, -0.0230393,  0.0631636 },
+    { -0.0282895,  1.0099416,  0.0210077 },
+    {  0.0122982, -0.0204830,  1.3299098 }
+};
+const double TO_D50[3][3] = {
+    {  1.0478112,  0.0228866, -0.0501270 },
+    {  0.0295424,  0.9904844, -0.0170491 },
+    { -0.0092345,  0.0150436,  0.7521316 }
+};
+
+XYZ mul(const double m[3][3], const XYZ &v) {
+    return { m[0][0] * v.X + m[0][1] * v.Y + m[0][2] * v.Z,
+             m[1][0] * v.X + m[1][1] * v.Y + m[1][2] * v.Z,
+             m[2][0] * v.X + m[2][1] * v.Y + m[2][2] * v.Z };
+}
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+uint32_t sig(const char *s) {
+    return uint32_t(uint8_t(s[0])) << 24 | uint32_t(uint8_t(s[1])) << 16 | uint32_t(uint8_t(s[2])) << 8 | uint8_t(s[3]);
+}
+
+// Чтение big-endian с проверкой границ: выход за тег делает reader невалидным,
+// дальше возвращаются нули, а ошибка проверяется один раз в конце.
+class Reader {
+public:
+    Reader(const uint8_t *d, std::size_t n) : data(d), size(n) {}
+
+    bool ok() const { return good; }
+    std::size_t length() const { return size; }
+    Reader sub(std::size_t offset, std::size_t n = std::size_t(-1)) {
+        if (offset > size) { good = false; return Reader(data, 0); }
+        return Reader(data + offset, std::min(n, size - offset));
+    }
+
+    uint8_t u8(std::size_t at) { return check(at, 1) ? data[at] : 0; }
+    uint16_t u16(std::size_t at) { return check(at, 2) ? uint16_t(data[at] << 8 | data[at + 1]) : 0; }
+    uint32_t u32(std::size_t at) {
+        return check(at, 4) ? uint32_t(data[at]) << 24 | uint32_t(data[at + 1]) << 16 | uint32_t(data[at + 2]) << 8 | data[at + 3] : 0;
+    }
+    double s15f16(std::size_t at) { return int32_t(u32(at)) / 65536.0; }
+
+private:
+    bool check(std::size_t at, std::size_t n) {
+        if (at + n > size) good = false;
+        return good;
+    }
+
+    const uint8_t *data;
+    std::size_t size;
+    bool good = true;
+};
+
+// curv или para; consumed — размер тега с выравниванием на 4 (для кривых внутри mAB/mBA)
+bool readCurve(Reader r, IccCurve &c, std::size_t *consumed = nullptr) {
+    uint32_t type = r.u32(0);
+    std::size_t used = 0;
+    if (type == sig("curv")) {
+        uint32_t n = r.u32(8);
+        if (n == 0) {
+            c.type = IccCurve::Type::Identity;
+        } else if (n == 1) {
+            c.type = IccCurve::Type::Gamma;
+            c.p[0] = r.u16(12) / 256.0;
+        } else {
+            if (n > 65536) return false;
+            c.type = IccCurve::Type::Table;
+            c.table.resize(n);
+            for (uint32_t i = 0; i < n; ++i) c.table[i] = r.u16(12 + 2 * i) / 65535.0;
+        }
+        used = 12 + 2 * std::size_t(n);
+    } else if (type == sig("para")) {
+        static const int COUNT[5] = { 1, 3, 4, 5, 7 };
+        int fn = r.u16(8);
+        if (fn > 4) return false;
+        c.type = IccCurve::Type::Parametric;
+        c.function = fn;
+        for (int i = 0; i < COUNT[fn]; ++i) c.p[i] = r.s15f16(12 + 4 * i);
+        used = 12 + 4 * std::size_t(COUNT[fn]);
+    } else {
+        return false;
+    }
+    if (consumed) *consumed = (used + 3) & ~std::size_t(3);
+    return r.ok();
+}
+
+bool readCurves(Reader r, std::size_t offset, int count, std::vector<IccCurve> &curves) {
+    curves.resize(count);
+    for (int i = 0; i < count; ++i) {
+        std::size_t used = 0;
+        if (!readCurve(r.sub(offset), curves[i], &used)) return false;
+        offset += used;
+    }
+    return true;
+}
+
+std::size_t clutSize(const std::vector<int> &grid, int outChannels) {
+    std::size_t n = std::size_t(outChannels);
+    for (int g : grid) n *= std::size_t(g);
+    return n;
+}
+
+// Размер CLUT из заголовка тега до выделения памяти: сетка до 255^8 легко
+// переполняет size_t, а таблица обязана целиком лежать в оставшихся байтах тега.
+bool clutFits(const std::vector<int> &grid, int outChannels, std::size_t sampleBytes, std::size_t available,
+              std::size_t &count) {
+    const std::size_t limit = available / sampleBytes;
+    count = std::size_t(outChannels);
+    if (count > limit) return false;
+    for (int g : grid) {
+        if (count > limit / std::size_t(g)) return false;
+        count *= std::size_t(g);
+    }
+    return true;
+}
+
+// lut8 ('mft1') и lut16 ('mft2'): матрица, входные кривые, CLUT, выходные кривые
+bool readLutN(Reader r, bool sixteen, IccPipeline &p) {
+    p.kind = sixteen ? IccPipeline::Kind::Lut16 : IccPipeline::Kind::Lut8;
+    p.inChannels = r.u8(8);
+    p.outChannels = r.u8(9);
+    int g = r.u8(10);
+    if (p.inChannels < 1 || p.inChannels > 8 || p.outChannels < 1 || p.outChannels > 8 || g < 2) return false;
+    for (int i = 0; i < 9; ++i) p.matrix[i] = r.s15f16(12 + 4 * i);
+    p.hasMatrix = true;
+
+    std::size_t inEntries = 256, outEntries = 256, at = 48;
+    if (sixteen) {
+        inEntries = r.u16(48);
+        outEntries = r.u16(50);
+        at = 52;
+        if (inEntries < 2 || outEntries < 2) return false;
+    }
+    const std::size_t bytes = sixteen ? 2 : 1;
+    auto sample = [&](std::size_t pos){ return sixteen ? r.u16(pos) / 65535.0 : r.u8(pos) / 255.0; };
+    auto table = [&](std::size_t entries, std::vector<IccCurve> &curves, int count){
+        curves.resize(count);
+        for (IccCurve &c : curves) {
+            c.type = IccCurve::Type::Table;
+            c.table.resize(entries);
+            for (std::size_t i = 0; i < entries; ++i, at += bytes) c.table[i] = sample(at);
+        }
+    };
+
+    // кривые и CLUT должны поместиться в тег до того, как под них выделяется память
+    const std::size_t curveBytes = (inEntries * std::size_t(p.inChannels) + outEntries * std::size_t(p.outChannels)) * bytes;
+    if (at + curveBytes > r.length()) return false;
+    p.grid.assign(p.inChannels, g);
+    std::size_t clutCount = 0;
+    if (!clutFits(p.grid, p.outChannels, bytes, r.length() - at - curveBytes, clutCount)) return false;
+
+    table(inEntries, p.a, p.inChannels);
+    p.clut.resize(clutCount);
+    for (float &v : p.clut) { v = float(sample(at)); at += bytes; }
+    table(outEntries, p.b, p.outChannels);
+    return r.ok();
+}
+
+// lutAtoB ('mAB ') и lutBtoA ('mBA '): кривые B/M/A, матрица 3x4 и CLUT по смещениям
+bool readLutAB(Reader r, bool atob, IccPipeline &p) {
+    p.kind = atob ? IccPipeline::Kind::AtoB : IccPipeline::Kind::BtoA;
+    p.inChannels = r.u8(8);
+    p.outChannels = r.u8(9);
+    if (p.inChannels < 1 || p.inChannels > 8 || p.outChannels < 1 || p.outChannels > 8) return false;
+    const uint32_t offB = r.u32(12), offMatrix = r.u32(16), offM = r.u32(20), offClut = r.u32(24), offA = r.u32(28);
+    // у A2B кривые A на входе, B на выходе; у B2A наоборот
+    const int aCount = atob ? p.inChannels : p.outChannels;
+    const int bCount = atob ? p.outChannels : p.inChannels;
+
+    if (!offB || !readCurves(r, offB, bCount, p.b)) return false;
+    if (offM && !readCurves(r, offM, 3, p.m)) return false;
+    if (offA && !readCurves(r, offA, aCount, p.a)) return false;
+    if (offMatrix) {
+        for (int i = 0; i < 12; ++i) p.matrix[i] = r.s15f16(offMatrix + 4 * i);
+        p.hasMatrix = true;
+    }
+    if (offClut) {
+        const int clutIn = atob ? p.inChannels : 3;
+        const int clutOut = atob ? 3 : p.outChannels;
+        p.grid.resize(clutIn);
+        for (int i = 0; i < clutIn; ++i) {
+            p.grid[i] = r.u8(offClut + i);
+            if (p.grid[i] < 2) return false;
+        }
+        const int precision = r.u8(offClut + 16);
+        if (precision != 1 && precision != 2) return false;
+        std::size_t at = offClut + 20, clutCount = 0;
+        if (at > r.length() || !clutFits(p.grid, clutOut, std::size_t(precision), r.length() - at, clutCount))
+            return false;
+        p.clut.resize(clutCount);
+        for (float &v : p.clut) {
+            v = precision == 2 ? float(r.u16(at) / 65535.0) : float(r.u8(at) / 255.0);
+            at += precision;
+        }
+    } else if (p.inChannels != p.outChannels) {
+        return false;
+    }
+    return r.ok();
+}
+
+bool readPipeline(Reader r, IccPipeline &p, bool pcsLab) {
+    uint32_t type = r.u32(0);
+    bool ok;
+    if (type == sig("mft1")) ok = readLutN(r, false, p);
+    else if (type == sig("mft2")) ok = readLutN(r, true, p);
+    else if (type == sig("mAB ")) ok = readLutAB(r, true, p);
+    else if (type == sig("mBA ")) ok = readLutAB(r, false, p);
+    else return false;
+    if (!pcsLab) p.pcs = IccPipeline::Pcs::XyzEncoded;
+    else p.pcs = p.kind == IccPipeline::Kind::Lut16 ? IccPipeline::Pcs::LabV2 : IccPipeline::Pcs::LabV4;
+    // матрица lut8/lut16 применяется только к входу XYZ
+    if ((p.kind == IccPipeline::Kind::Lut8 || p.kind == IccPipeline::Kind::Lut16) && pcsLab) p.hasMatrix = false;
+    return ok;
+}
+
+bool readXyz(Reader r, XYZ &xyz) {
+    if (r.u32(0) != sig("XYZ ")) return false;
+    xyz = { r.s15f16(8), r.s15f16(12), r.s15f16(16) };
+    return r.ok();
+}
+
+// 'desc' (v2, ASCII) или 'mluc' (v4, первая запись UTF-16BE; берём только ASCII)
+std::string readDescription(Reader r) {
+    std::string s;
+    if (r.u32(0) == sig("desc")) {
+        uint32_t n = r.u32(8);
+        for (uint32_t i = 0; i < n && r.ok(); ++i) {
+            char ch = char(r.u8(12 + i));
+            if (!ch) break;
+            s += ch;
+        }
+    } else if (r.u32(0) == sig("mluc") && r.u32(8) > 0) {
+        uint32_t len = r.u32(20), off = r.u32(24);
+        for (uint32_t i = 0; i + 1 < len && r.ok(); i += 2) {
+            uint16_t ch = r.u16(off + i);
+            s += ch < 128 ? char(ch) : '?';
+        }
+    }
+    return r.ok() ? s : std::string();
+}
+
+double solve3(const double m[9], double *v) {
+    // обратная 3x3 по алгебраическим дополнениям, v := m^-1 v
+    double det = m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) + m[2] * (m[3] * m[7] - m[4] * m[6]);
+    if (std::fabs(det) < 1e-12) return 0.0;
+    double inv[9] = {
+        (m[4] * m[8] - m[5] * m[7]) / det, (m[2] * m[7] - m[1] * m[8]) / det, (m[1] * m[5] - m[2] * m[4]) / det,
+        (m[5] * m[6] - m[3] * m[8]) / det, (m[0] * m[8] - m[2] * m[6]) / det, (m[2] * m[3] - m[0] * m[5]) / det,
+        (m[3] * m[7] - m[4] * m[6]) / det, (m[1] * m[6] - m[0] * m[7]) / det, (m[0] * m[4] - m[1] * m[3]) / det };
+    double x = v[0], y = v[1], z = v[2];
+    v[0] = inv[0] * x + inv[1] * y + inv[2] * z;
+    v[1] = inv[3] * x + inv[4] * y + inv[5] * z;
+    v[2] = inv[6] * x + inv[7] * y + inv[8] * z;
+    return det;
+}
+
+}
+
+
+double IccCurve::eval(double x) const {
+    x = std::clamp(x, 0.0, 1.0);
+    switch (type) {
+    case Type::Identity:
+        return x;
+    case Type::Gamma:
+        return std::pow(x, p[0]);
+    case Type::Table: {
+        double pos = x * (table.size() - 1);
+        std::size_t i = std::min(std::size_t(pos), table.size() - 2);
+        return table[i] + (pos - i) * (table[i + 1] - table[i]);
+    }
+    case Type::Parametric: {
+        const double g = p[0], a = p[1], b = p[2], c = p[3], d = p[4], e = p[5], f = p[6];
+        auto powPos = [g](double v){ return v > 0.0 ? std::pow(v, g) : 0.0; };
+        switch (function) {
+        case 0: return powPos(x);
+        case 1: return x >= -b / a ? powPos(a * x + b) : 0.0;
+        case 2: return x >= -b / a ? powPos(a * x + b) + c : c;
+        case 3: return x >= d ? powPos(a * x + b) : c * x;
+        default: return x >= d ? powPos(a * x + b) + e : c * x + f;
+        }
+    }
+    }
+    return x;
+}
+
+// Кривые в профилях монотонны; обращаем бисекцией, так что годится любой тип
+double IccCurve::inverse(double y) const {
+    if (type == Type::Identity) return std::clamp(y, 0.0, 1.0);
+    if (type == Type::Gamma && p[0] > 0.0) return std::pow(std::clamp(y, 0.0, 1.0), 1.0 / p[0]);
+    const bool rising = eval(1.0) >= eval(0.0);
+    double lo = 0.0, hi = 1.0;
+    for (int it = 0; it < 40; ++it) {
+        double mid = 0.5 * (lo + hi);
+        if ((eval(mid) < y) == rising) lo = mid;
+        else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+void IccPipeline::applyMatrix(double *v) const {
+    const double *m = matrix;
+    double x = v[0], y = v[1], z = v[2];
+    v[0] = m[0] * x + m[1] * y + m[2] * z + m[9];
+    v[1] = m[3] * x + m[4] * y + m[5] * z + m[10];
+    v[2] = m[6] * x + m[7] * y + m[8] * z + m[11];
+}
+
+void IccPipeline::applyInverseMatrix(double *v) const {
+    solve3(matrix, v);
+}
+
+// Мультилинейная интерполяция по сетке любой размерности (до 8 входов).
+// Вызывается только при компиляции преобразований, так что скорость не важна.
+void IccPipeline::interpolate(const double *in, double *out) const {
+    const int dims = int(grid.size());
+    const int outs = int(clut.size() / clutSize(grid, 1));
+    int base[8];
+    double frac[8];
+    std::size_t stride[8];
+    std::size_t s = std::size_t(outs);
+    for (int d = dims - 1; d >= 0; --d) {
+        stride[d] = s;
+        s *= std::size_t(grid[d]);
+        double pos = std::clamp(in[d], 0.0, 1.0) * (grid[d] - 1);
+        base[d] = std::min(int(pos), grid[d] - 2);
+        frac[d] = pos - base[d];
+    }
+    std::size_t origin = 0;
+    for (int d = 0; d < dims; ++d) origin += base[d] * stride[d];
+
+    for (int k = 0; k < outs; ++k) out[k] = 0.0;
+    for (int corner = 0; corner < (1 << dims); ++corner) {
+        double w = 1.0;
+        std::size_t at = origin;
+        for (int d = 0; d < dims; ++d) {
+            if (corner & (1 << d)) { w *= frac[d]; at += stride[d]; }
+            else w *= 1.0 - frac[d];
+        }
+        if (w == 0.0) continue;
+        for (int k = 0; k < outs; ++k) out[k] += w * clut[at + k];
+    }
+}
+
+void IccPipeline::eval(const double *in, double *out) const {
+    double v[8], t[8];
+    for (int i = 0; i < inChannels; ++i) v[i] = in[i];
+
+    switch (kind) {
+    case Kind::MatrixTrc:
+        for (int i = 0; i < 3; ++i) v[i] = a[i].eval(v[i]);
+        applyMatrix(v);
+        break;
+    case Kind::InverseMatrixTrc:
+        applyInverseMatrix(v);
+        for (int i = 0; i < 3; ++i) v[i] = a[i].inverse(std::clamp(v[i], 0.0, 1.0));
+        break;
+    case Kind::Lut8:
+    case Kind::Lut16:
+        if (hasMatrix) applyMatrix(v);
+        for (int i = 0; i < inChannels; ++i) v[i] = a[i].eval(v[i]);
+        interpolate(v, t);
+        for (int i = 0; i < outChannels; ++i) v[i] = b[i].eval(t[i]);
+        break;
+    case Kind::AtoB:
+        for (int i = 0; i < inChannels && !a.empty(); ++i) v[i] = a[i].eval(v[i]);
+        if (!clut.empty()) { interpolate(v, t); std::copy(t, t + 3, v); }
+        for (int i = 0; i < 3 && !m.empty(); ++i) v[i] = m[i].eval(v[i]);
+        if (hasMatrix) applyMatrix(v);
+        for (int i = 0; i < outChannels; ++i) v[i] = b[i].eval(v[i]);
+        break;
+    case Kind::BtoA:
+        for (int i = 0; i < inChannels; ++i) v[i] = b[i].eval(v[i]);
+        if (hasMatrix) applyMatrix(v);
+        for (int i = 0; i < 3 && !m.empty(); ++i) v[i] = m[i].eval(v[i]);
+        if (!clut.empty()) { interpolate(v, t); std::copy(t, t + outChannels, v); }
+        for (int i = 0; i < outChannels && !a.empty(); ++i) v[i] = a[i].eval(v[i]);
+        break;
+    }
+    for (int i = 0; i < outChannels; ++i) out[i] = v[i];
+}
+
+
+IccProfile::IccProfile() = default;
+IccProfile::~IccProfile() = default;
+IccProfile::IccProfile(IccProfile &&) noexcept = default;
+IccProfile &IccProfile::operator=(IccProfile &&) noexcept = default;
+
+int IccProfile::channels() const {
+    return space == IccColorSpace::CMYK ? 4 : 3;
+}
+
+const IccPipeline *IccProfile::toPcs(RenderingIntent intent) const {
+    int i = intent == RenderingIntent::AbsoluteColorimetric ? 1 : int(intent);
+    return a2b[i] ? a2b[i].get() : a2b[0].get();
+}
+
+const IccPipeline *IccProfile::fromPcs(RenderingIntent intent) const {
+    int i = intent == RenderingIntent::AbsoluteColorimetric ? 1 : int(intent);
+    return b2a[i] ? b2a[i].get() : b2a[0].get();
+}
+
+bool IccProfile::canConvertToLab(RenderingIntent intent) const {
+    return isValid() && toPcs(intent) != nullptr;
+}
+
+bool IccProfile::canConvertFromLab(RenderingIntent intent) const {
+    return isValid() && fromPcs(intent) != nullptr;
+}
+
+// PCS-значения тега -> XYZ D50 (Y белого = 1)
+XYZ IccProfile::pcsToXyz(const double *pcs, const IccPipeline &p) const {
+    switch (p.pcs) {
+    case IccPipeline::Pcs::XyzDirect:
+        return { pcs[0], pcs[1], pcs[2] };
+    case IccPipeline::Pcs::XyzEncoded: {
+        const double s = 65535.0 / 32768.0;
+        return { pcs[0] * s, pcs[1] * s, pcs[2] * s };
+    }
+    default: {
+        const double s = p.pcs == IccPipeline::Pcs::LabV2 ? 65535.0 / 65280.0 : 1.0;
+        Lab lab{ pcs[0] * s * 100.0, pcs[1] * s * 255.0 - 128.0, pcs[2] * s * 255.0 - 128.0 };
+        XYZ xyz = labToXyz(lab);
+        // labToXyz работает с белым D65 приложения — переносим на D50
+        return { xyz.X / REF_X * D50.X, xyz.Y / REF_Y * D50.Y, xyz.Z / REF_Z * D50.Z };
+    }
+    }
+}
+
+void IccProfile::xyzToPcs(const XYZ &xyz, const IccPipeline &p, double *pcs) const {
+    switch (p.pcs) {
+    case IccPipeline::Pcs::XyzDirect:
+        pcs[0] = xyz.X; pcs[1] = xyz.Y; pcs[2] = xyz.Z;
+        break;
+    case IccPipeline::Pcs::XyzEncoded: {
+        const double s = 32768.0 / 65535.0;
+        pcs[0] = xyz.X * s; pcs[1] = xyz.Y * s; pcs[2] = xyz.Z * s;
+        break;
+    }
+    default: {
+        Lab lab = xyzToLab({ xyz.X / D50.X * REF_X, xyz.Y / D50.Y * REF_Y, xyz.Z / D50.Z * REF_Z });
+        const double s = p.pcs == IccPipeline::Pcs::LabV2 ? 65280.0 / 65535.0 : 1.0;
+        pcs[0] = std::clamp(lab.L / 100.0, 0.0, 1.0) * s;
+        pcs[1] = std::clamp((lab.a + 128.0) / 255.0, 0.0, 1.0) * s;
+        pcs[2] = std::clamp((lab.b + 128.0) / 255.0, 0.0, 1.0) * s;
+        break;
+    }
+    }
+}
+
+Lab IccProfile::toLab(const double *device, RenderingIntent intent) const {
+    const IccPipeline *p = toPcs(intent);
+    if (!p) return {0.0, 0.0, 0.0};
+    double pcs[8];
+    p->eval(device, pcs);
+    XYZ xyz = pcsToXyz(pcs, *p);
+    if (intent == RenderingIntent::AbsoluteColorimetric)
+        xyz = { xyz.X * mediaWhite.X / D50.X, xyz.Y * mediaWhite.Y / D50.Y, xyz.Z * mediaWhite.Z / D50.Z };
+    XYZ d65 = mul(TO_D65, xyz);
+    return xyzToLab({ d65.X * 100.0, d65.Y * 100.0, d65.Z * 100.0 });
+}
+
+void IccProfile::fromLab(const Lab &lab, RenderingIntent intent, double *device) const {
+    const IccPipeline *p = fromPcs(intent);
+    if (!p) {
+        std::fill(device, device + channels(), 0.0);
+        return;
+    }
+    XYZ d65 = labToXyz(lab);
+    XYZ xyz = mul(TO_D50, { d65.X / 100.0, d65.Y / 100.0, d65.Z / 100.0 });
+    if (intent == RenderingIntent::AbsoluteColorimetric)
+        xyz = { xyz.X * D50.X / mediaWhite.X, xyz.Y * D50.Y / mediaWhite.Y, xyz.Z * D50.Z / mediaWhite.Z };
+    double pcs[3];
+    xyzToPcs(xyz, *p, pcs);
+    p->eval(pcs, device);
+    for (int i = 0; i < channels(); ++i) device[i] = std::clamp(device[i], 0.0, 1.0);
+}
+
+
+bool parseIccProfile(const uint8_t *data, std::size_t size, IccProfile &profile, std::string *error) {
+    Reader r(data, size);
+    if (size < 132 || r.u32(36) != sig("acsp")) return fail(error, "не ICC-профиль");
+    if (r.u32(0) > size) return fail(error, "профиль обрезан");
+
+    IccProfile p;
+    p.version = r.u8(8);
+    if (p.version != 2 && p.version != 4) return fail(error, "поддерживаются только профили ICC v2 и v4");
+
+    const uint32_t space = r.u32(16), pcs = r.u32(20);
+    if (space == sig("RGB ")) p.space = IccColorSpace::RGB;
+    else if (space == sig("CMYK")) p.space = IccColorSpace::CMYK;
+    else if (space == sig("Lab ")) p.space = IccColorSpace::Lab;
+    else return fail(error, "поддерживаются профили RGB, CMYK и Lab");
+    if (pcs != sig("XYZ ") && pcs != sig("Lab ")) return fail(error, "неизвестное пространство PCS");
+    p.pcsIsLab = pcs == sig("Lab ");
+
+    // хэш как у ICC Profile ID: флаги, намерение и сам ID обнуляются
+    uint64_t h = 1469598103934665603ull;
+    const std::size_t total = std::min<std::size_t>(r.u32(0), size);
+    for (std::size_t i = 0; i < total; ++i) {
+        bool zeroed = (i >= 44 && i < 48) || (i >= 64 && i < 68) || (i >= 84 && i < 100);
+        h = (h ^ (zeroed ? 0 : data[i])) * 1099511628211ull;
+    }
+    p.digest = h;
+
+    const uint32_t count = r.u32(128);
+    if (count > 1000) return fail(error, "повреждена таблица тегов");
+    XYZ rgbColumns[3];
+    bool haveColumn[3] = {}, haveTrc[3] = {};
+    IccCurve trc[3];
+    static const char *const A2B[3] = { "A2B0", "A2B1", "A2B2" };
+    static const char *const B2A[3] = { "B2A0", "B2A1", "B2A2" };
+    static const char *const COLUMN[3] = { "rXYZ", "gXYZ", "bXYZ" };
+    static const char *const TRC[3] = { "rTRC", "gTRC", "bTRC" };
+
+    for (uint32_t t = 0; t < count; ++t) {
+        const uint32_t tag = r.u32(132 + 12 * t), offset = r.u32(136 + 12 * t), length = r.u32(140 + 12 * t);
+        if (!r.ok() || offset > total || length > total - offset) return fail(error, "тег за пределами профиля");
+        Reader body = r.sub(offset, length);
+
+        for (int i = 0; i < 3; ++i) {
+            if (tag == sig(A2B[i]) || tag == sig(B2A[i])) {
+                auto pipe = std::make_unique<IccPipeline>();
+                if (!readPipeline(body, *pipe, p.pcsIsLab))
+                    return fail(error, "не удалось разобрать тег " + std::string(tag == sig(A2B[i]) ? A2B[i] : B2A[i]));
+                (tag == sig(A2B[i]) ? p.a2b[i] : p.b2a[i]) = std::move(pipe);
+            }
+            if (tag == sig(COLUMN[i])) haveColumn[i] = readXyz(body, rgbColumns[i]);
+            if (tag == sig(TRC[i])) haveTrc[i] = readCurve(body, trc[i]);
+        }
+        if (tag == sig("wtpt")) readXyz(body, p.mediaWhite);
+        if (tag == sig("desc")) p.desc = readDescription(body);
+    }
+
+    const int deviceChannels = p.channels();
+    for (int i = 0; i < 3; ++i) {
+        if ((p.a2b[i] && p.a2b[i]->inChannels != deviceChannels) || (p.a2b[i] && p.a2b[i]->outChannels != 3) ||
+            (p.b2a[i] && p.b2a[i]->inChannels != 3) || (p.b2a[i] && p.b2a[i]->outChannels != deviceChannels))
+            return fail(error, "число каналов в таблицах не совпадает с пространством профиля");
+    }
+
+    // matrix/TRC — только если нет табличных A2B0/B2A0
+    if (p.space == IccColorSpace::RGB && haveColumn[0] && haveColumn[1] && haveColumn[2] &&
+        haveTrc[0] && haveTrc[1] && haveTrc[2]) {
+        auto makeMatrixTrc = [&](IccPipeline::Kind kind){
+            auto pipe = std::make_unique<IccPipeline>();
+            pipe->kind = kind;
+            pipe->pcs = IccPipeline::Pcs::XyzDirect;
+            pipe->inChannels = pipe->outChannels = 3;
+            pipe->a.assign(trc, trc + 3);
+            for (int i = 0; i < 3; ++i) {
+                pipe->matrix[i] = rgbColumns[i].X;
+                pipe->matrix[3 + i] = rgbColumns[i].Y;
+                pipe->matrix[6 + i] = rgbColumns[i].Z;
+            }
+            pipe->hasMatrix = true;
+            return pipe;
+        };
+        if (!p.a2b[0]) p.a2b[0] = makeMatrixTrc(IccPipeline::Kind::MatrixTrc);
+        if (!p.b2a[0]) p.b2a[0] = makeMatrixTrc(IccPipeline::Kind::InverseMatrixTrc);
+    }
+    if (!p.a2b[0] && !p.a2b[1] && !p.b2a[0] && !p.b2a[1])
+        return fail(error, "в профиле нет ни A2B/B2A, ни matrix/TRC");
+    if (p.desc.empty()) p.desc = "ICC v" + std::to_string(p.version);
+
+    profile = std::move(p);
+    return true;
+}
+
+bool loadIccProfile(const std::string &path, IccProfile &profile, std::string *error) {
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) return fail(error, "не удалось открыть " + path);
+    std::vector<uint8_t> bytes;
+    uint8_t chunk[65536];
+    std::size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) bytes.insert(bytes.end(), chunk, chunk + n);
+    std::fclose(f);
+    return parseIccProfile(bytes.data(), bytes.size(), profile, error);
+}
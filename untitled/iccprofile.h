@@ -0,0 +1,70 @@
+#ifndef ICCPROFILE_H
+#define ICCPROFILE_H
+
+#include "colormodels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Разбор ICC-профилей v2/v4 (локальные файлы): matrix/TRC для RGB и табличные
+// A2Bx/B2Ax (lut8, lut16, lutAtoB, lutBtoA) для RGB и CMYK.
+// Профиль работает в PCS с белым D50; наружу отдаётся Lab приложения (D65,
+// как в colormodels), переход — по Брэдфорду.
+
+enum class RenderingIntent {
+    Perceptual = 0,
+    RelativeColorimetric = 1,
+    Saturation = 2,
+    AbsoluteColorimetric = 3
+};
+
+enum class IccColorSpace { RGB, CMYK, Lab, Other };
+
+struct IccPipeline;
+
+class IccProfile {
+public:
+    IccProfile();
+    ~IccProfile();
+    IccProfile(IccProfile &&) noexcept;
+    IccProfile &operator=(IccProfile &&) noexcept;
+
+    bool isValid() const { return space != IccColorSpace::Other; }
+    IccColorSpace colorSpace() const { return space; }
+    int channels() const;                       // 3 для RGB/Lab, 4 для CMYK
+    int majorVersion() const { return version; }
+    const std::string &description() const { return desc; }
+    // FNV-1a по байтам профиля без полей флагов, намерения и ID (как считается ICC ID)
+    uint64_t hash() const { return digest; }
+
+    bool canConvertToLab(RenderingIntent intent) const;
+    bool canConvertFromLab(RenderingIntent intent) const;
+
+    // device — значения каналов 0..1; при отсутствии нужного тега берётся A2B0/B2A0
+    Lab toLab(const double *device, RenderingIntent intent) const;
+    void fromLab(const Lab &lab, RenderingIntent intent, double *device) const;
+
+private:
+    friend bool parseIccProfile(const uint8_t *, std::size_t, IccProfile &, std::string *);
+
+    const IccPipeline *toPcs(RenderingIntent intent) const;
+    const IccPipeline *fromPcs(RenderingIntent intent) const;
+    XYZ pcsToXyz(const double *pcs, const IccPipeline &p) const;
+    void xyzToPcs(const XYZ &xyz, const IccPipeline &p, double *pcs) const;
+
+    IccColorSpace space = IccColorSpace::Other;
+    bool pcsIsLab = false;
+    int version = 0;
+    std::string desc;
+    uint64_t digest = 0;
+    XYZ mediaWhite{0.9642, 1.0, 0.8249};
+    std::unique_ptr<IccPipeline> a2b[3];
+    std::unique_ptr<IccPipeline> b2a[3];
+};
+
+bool parseIccProfile(const uint8_t *data, std::size_t size, IccProfile &profile, std::string *error = nullptr);
+bool loadIccProfile(const std::string &path, IccProfile &profile, std::string *error = nullptr);
+
+#endif // ICCPROFILE_H
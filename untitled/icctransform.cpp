@@ -0,0 +1,127 @@
+#include "icctransform.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+
+namespace {
+
+// координаты узла 0..1 <-> Lab приложения
+Lab nodeToLab(const double *v) {
+    return { v[0] * 100.0, v[1] * 255.0 - 128.0, v[2] * 255.0 - 128.0 };
+}
+
+void labToNode(const Lab &lab, double *v) {
+    v[0] = std::clamp(lab.L / 100.0, 0.0, 1.0);
+    v[1] = std::clamp((lab.a + 128.0) / 255.0, 0.0, 1.0);
+    v[2] = std::clamp((lab.b + 128.0) / 255.0, 0.0, 1.0);
+}
+
+// точное преобразование одного узла через Lab приложения
+void evalNode(const IccProfile *src, const IccProfile *dst, RenderingIntent intent, const double *node, float *out) {
+    Lab lab = src ? src->toLab(node, intent) : nodeToLab(node);
+    if (dst) {
+        double v[4];
+        dst->fromLab(lab, intent, v);
+        for (int i = 0; i < dst->channels(); ++i) out[i] = float(v[i]);
+    } else {
+        out[0] = float(lab.L); out[1] = float(lab.a); out[2] = float(lab.b);
+    }
+}
+
+}
+
+// таблица кэшируется на диске по тому же ключу, что и в памяти
+IccTransform::IccTransform(const IccProfile *src, const IccProfile *dst, RenderingIntent intent)
+    : in(src ? src->channels() : 3), out(dst ? dst->channels() : 3), labIn(!src || src->colorSpace() == IccColorSpace::Lab),
+      labOut(!dst || dst->colorSpace() == IccColorSpace::Lab)
+{
+    uint64_t key = LutCache::hashValue(src ? src->hash() : 0);
+    key = LutCache::hashValue(dst ? dst->hash() : 0, key);
+    key = LutCache::hashValue(int(intent), key);
+    if (in == 4) {
+        lut4 = Lut4D(GRID_4D, out);
+        lut4.fillCached("icc4", key, [&](double c, double m, double y, double k, float *o){
+            const double node[4] = { c, m, y, k };
+            evalNode(src, dst, intent, node, o);
+        });
+    } else {
+        lut3 = Lut3D(GRID_3D, out);
+        lut3.fillCached("icc3", key, [&](double r, double g, double b, float *o){
+            const double node[3] = { r, g, b };
+            evalNode(src, dst, intent, node, o);
+        });
+    }
+}
+
+void IccTransform::apply(const double *src, double *dst) const {
+    double node[4];
+    if (labIn) labToNode({ src[0], src[1], src[2] }, node);
+    else std::copy(src, src + in, node);
+    float v[4];
+    if (in == 4) lut4.lookup(node[0], node[1], node[2], node[3], v);
+    else lut3.lookup(node[0], node[1], node[2], v);
+    for (int i = 0; i < out; ++i) dst[i] = v[i];
+}
+
+void IccTransform::applyBatch8(const uint8_t *src, int channels, float *dst, std::size_t count) const {
+    if (in == 4) lut4.lookup8(src, channels, dst, count);
+    else lut3.lookup8(src, channels, dst, count);
+}
+
+bool IccTransform::applyLabBatch(const Lab *src, float *dst, std::size_t count) const {
+    // у CMYK-источника нет lut3, у RGB узлы — коды устройства, а не Lab
+    if (!labIn || in != 3) return false;
+    for (std::size_t i = 0; i < count; ++i, dst += out) {
+        double node[3];
+        labToNode(src[i], node);
+        lut3.lookup(node[0], node[1], node[2], dst);
+    }
+    return true;
+}
+
+
+namespace TransformCache {
+
+namespace {
+
+using Key = std::tuple<uint64_t, uint64_t, int>;
+
+std::mutex mutex;
+std::map<Key, std::shared_ptr<const IccTransform>> memory;
+Stats counters;
+
+}
+
+std::shared_ptr<const IccTransform> get(const IccProfile *src, const IccProfile *dst, RenderingIntent intent) {
+    const Key key{ src ? src->hash() : 0, dst ? dst->hash() : 0, int(intent) };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = memory.find(key);
+        if (it != memory.end()) {
+            ++counters.memoryHits;
+            return it->second;
+        }
+    }
+
+    // компиляция (или отображение из LutCache) — без блокировки, иначе один долгий профиль держит всех
+    auto t = std::make_shared<const IccTransform>(src, dst, intent);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++counters.created;
+    return memory.emplace(key, t).first->second;
+}
+
+void clearMemory() {
+    std::lock_guard<std::mutex> lock(mutex);
+    memory.clear();
+}
+
+Stats stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef ICCTRANSFORM_H
+#define ICCTRANSFORM_H
+
+#include "colormodels.h"
+#include "iccprofile.h"
+#include "lut.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Преобразование между профилями, скомпилированное в таблицу: 3D (Lut3D) для
+// входа RGB/Lab, 4D (Lut4D) для CMYK. Любая сторона может быть Lab приложения
+// (профиль = nullptr). Отсчёты устройств — 0..1, Lab — в обычных единицах.
+class IccTransform {
+public:
+    static const int GRID_3D = 33;
+    static const int GRID_4D = 17;
+
+    IccTransform(const IccProfile *src, const IccProfile *dst, RenderingIntent intent);
+
+    int inChannels() const { return in; }
+    int outChannels() const { return out; }
+    bool labInput() const { return labIn; }
+    bool labOutput() const { return labOut; }
+    int grid() const { return in == 4 ? GRID_4D : GRID_3D; }
+    const float *data() const { return in == 4 ? lut4.data() : lut3.data(); }
+    std::size_t size() const { return in == 4 ? lut4.size() : lut3.size(); }
+
+    void apply(const double *src, double *dst) const;
+    // 8-битный вход устройства, channels >= inChannels(); dst — outChannels() float на пиксель
+    void applyBatch8(const uint8_t *src, int channels, float *dst, std::size_t count) const;
+    // только для преобразований со входом Lab; иначе false и dst не трогается
+    bool applyLabBatch(const Lab *src, float *dst, std::size_t count) const;
+
+private:
+    int in, out;
+    bool labIn, labOut;
+    Lut3D lut3;
+    Lut4D lut4;
+};
+
+// Кэш скомпилированных преобразований по ключу (хэш источника, хэш приёмника,
+// намерение) в памяти процесса. На диске таблицы хранит LutCache, если для него
+// задан каталог: тогда повторный запуск не компилирует, а отображает файл.
+namespace TransformCache {
+
+std::shared_ptr<const IccTransform> get(const IccProfile *src, const IccProfile *dst, RenderingIntent intent);
+void clearMemory();
+
+struct Stats {
+    std::size_t memoryHits = 0;
+    std::size_t created = 0;     // построены или взяты из LutCache
+};
+Stats stats();
+
+}
+
+#endif // ICCTRANSFORM_H
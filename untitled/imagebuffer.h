@@ -0,0 +1,71 @@
+#ifndef IMAGEBUFFER_H
+#define IMAGEBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Окно в чередующийся (packed) буфер: channels отсчётов на пиксель,
+// stride — расстояние между строками в элементах T.
+template<typename T>
+struct ImageView {
+    T *data = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::ptrdiff_t stride = 0;
+
+    ImageView() = default;
+    ImageView(T *d, int w, int h, int c, std::ptrdiff_t s) : data(d), width(w), height(h), channels(c), stride(s) {}
+    template<typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    ImageView(const ImageView<U> &o) : data(o.data), width(o.width), height(o.height), channels(o.channels), stride(o.stride) {}
+
+    T *row(int y) const { return data + y * stride; }
+};
+
+// Одна плоскость планарного изображения (Y, Cb, C, M, ...).
+template<typename T>
+struct PlaneView {
+    T *data = nullptr;
+    int width = 0;
+    int height = 0;
+    std::ptrdiff_t stride = 0;
+
+    PlaneView() = default;
+    PlaneView(T *d, int w, int h, std::ptrdiff_t s) : data(d), width(w), height(h), stride(s) {}
+    template<typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    PlaneView(const PlaneView<U> &o) : data(o.data), width(o.width), height(o.height), stride(o.stride) {}
+
+    T *row(int y) const { return data + y * stride; }
+};
+
+// Владеющий буфер с плотной упаковкой строк.
+template<typename T>
+struct Image {
+    std::vector<T> pixels;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    Image() = default;
+    Image(int w, int h, int c) : pixels(std::size_t(w) * h * c), width(w), height(h), channels(c) {}
+
+    ImageView<T> view() { return { pixels.data(), width, height, channels, std::ptrdiff_t(width) * channels }; }
+    ImageView<const T> view() const { return { pixels.data(), width, height, channels, std::ptrdiff_t(width) * channels }; }
+};
+
+template<typename T>
+struct Plane {
+    std::vector<T> samples;
+    int width = 0;
+    int height = 0;
+
+    Plane() = default;
+    Plane(int w, int h) : samples(std::size_t(w) * h), width(w), height(h) {}
+
+    PlaneView<T> view() { return { samples.data(), width, height, width }; }
+    PlaneView<const T> view() const { return { samples.data(), width, height, width }; }
+};
+
+#endif // IMAGEBUFFER_H
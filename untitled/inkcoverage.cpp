@@ -0,0 +1,175 @@
+#include "inkcoverage.h"
+#include "arena.h"
+#include "batchconvert.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+const int TILE = 256;
+
+static inline uint8_t toByte(double v01) {
+    return uint8_t(std::clamp(int(v01 * 255.0 + 0.5), 0, 255));
+}
+
+}
+
+InkCoverageMeter::InkCoverageMeter(int width, int height, const InkCoverageOptions &options)
+    : width(std::max(0, width)), height(std::max(0, height)), options(options)
+{
+    const int cols = std::max(1, options.heatWidth);
+    cell = std::max(1, (this->width + cols - 1) / cols);
+    heatWidth = (this->width + cell - 1) / cell;
+    heatHeight = (this->height + cell - 1) / cell;
+    totals.histogram.assign(InkCoverage::HISTOGRAM_BINS, 0);
+    bands.resize(std::size_t(heatHeight));
+    for (Band &b : bands) {
+        b.cellSum.assign(std::size_t(heatWidth), 0.0);
+        b.cellMax.assign(std::size_t(heatWidth), 0.0f);
+    }
+}
+
+void InkCoverageMeter::Totals::merge(const Totals &o) {
+    for (int c = 0; c < 4; ++c) {
+        sum[c] += o.sum[c];
+        max[c] = std::max(max[c], o.max[c]);
+    }
+    tacSum += o.tacSum;
+    tacMax = std::max(tacMax, o.tacMax);
+    over += o.over;
+    count += o.count;
+    for (std::size_t i = 0; i < histogram.size(); ++i) histogram[i] += o.histogram[i];
+}
+
+void InkCoverageMeter::addBlock(const ImageView<const uint8_t> &rgb, int y, int y0, int y1, int x0, int x1,
+                                Band &band, Totals &totals) const {
+    ArenaScope scratch;
+    CMYK *cmyk = scratch.allocate<CMYK>(TILE);
+    const float limit = float(options.tac);
+    for (int row = y0; row < y1; ++row) {
+        // суммы строки в локальных, в totals — один раз
+        double sum[4] = {}, tacSum = 0.0;
+        float mx[4] = {}, tacMax = 0.0f;
+        std::size_t over = 0;
+        const uint8_t *src = rgb.row(row - y);
+        for (int t0 = x0; t0 < x1; t0 += TILE) {
+            const int n = std::min(TILE, x1 - t0);
+            const uint8_t *in = src + std::ptrdiff_t(t0) * rgb.channels;
+            if (options.separation) options.separation->separateBatch(in, rgb.channels, cmyk, std::size_t(n));
+            else rgbToCmykBatch(in, rgb.channels, cmyk, std::size_t(n));
+
+            float ts[4] = {}, tileTac = 0.0f;
+            for (int i = 0; i < n; ++i) {
+                const float c = float(cmyk[i].c), m = float(cmyk[i].m), ye = float(cmyk[i].y), k = float(cmyk[i].k);
+                const float tac = c + m + ye + k;
+                ts[0] += c; ts[1] += m; ts[2] += ye; ts[3] += k;
+                mx[0] = std::max(mx[0], c); mx[1] = std::max(mx[1], m);
+                mx[2] = std::max(mx[2], ye); mx[3] = std::max(mx[3], k);
+                tileTac += tac;
+                tacMax = std::max(tacMax, tac);
+                over += tac > limit + 1e-6f ? 1 : 0;
+                ++totals.histogram[std::size_t(std::min(int(tac * 100.0f + 0.5f), InkCoverage::HISTOGRAM_BINS - 1))];
+                const std::size_t cx = std::size_t((t0 + i) / cell);
+                band.cellSum[cx] += tac;
+                band.cellMax[cx] = std::max(band.cellMax[cx], tac);
+            }
+            for (int c = 0; c < 4; ++c) sum[c] += ts[c];
+            tacSum += tileTac;
+        }
+        for (int c = 0; c < 4; ++c) {
+            totals.sum[c] += sum[c];
+            totals.max[c] = std::max(totals.max[c], mx[c]);
+        }
+        totals.tacSum += tacSum;
+        totals.tacMax = std::max(totals.tacMax, tacMax);
+        totals.over += over;
+        totals.count += std::size_t(x1 - x0);
+    }
+}
+
+void InkCoverageMeter::add(const ImageView<const uint8_t> &rgb, int y) {
+    const int yEnd = std::min(height, y + rgb.height);
+    const int w = std::min(width, rgb.width);
+    if (y < 0 || y >= yEnd || w <= 0) return;
+    // Задание — строка карты (или её часть внутри полосы) на группу столбцов клеток:
+    // клетки без блокировок. При крупных клетках строк карты в полосе мало, тогда
+    // их режем ещё и по столбцам, чтобы заданий было с запасом на все потоки.
+    const int first = y / cell, last = (yEnd - 1) / cell;
+    const int rowsOfCells = last - first + 1;
+    const int usedCells = (w + cell - 1) / cell;
+    const int groups = std::clamp((4 * workerCount() + rowsOfCells - 1) / rowsOfCells, 1, usedCells);
+    const int items = rowsOfCells * groups;
+
+    Totals empty;
+    empty.histogram.assign(InkCoverage::HISTOGRAM_BINS, 0);
+    std::vector<Totals> partial(std::size_t(items), empty);
+    parallelFor(items, 1, [&](int i0, int i1){
+        for (int i = i0; i < i1; ++i) {
+            const int b = first + i / groups, g = i % groups;
+            const int x0 = std::min(w, usedCells * g / groups * cell), x1 = std::min(w, usedCells * (g + 1) / groups * cell);
+            if (x0 < x1)
+                addBlock(rgb, y, std::max(y, b * cell), std::min(yEnd, (b + 1) * cell), x0, x1,
+                         bands[std::size_t(b)], partial[std::size_t(i)]);
+        }
+    });
+    for (const Totals &t : partial) totals.merge(t);
+}
+
+InkCoverage InkCoverageMeter::result() const {
+    InkCoverage r;
+    r.histogram = totals.histogram;
+    r.heatWidth = heatWidth;
+    r.heatHeight = heatHeight;
+    r.cell = cell;
+    r.heatMean.assign(std::size_t(heatWidth) * std::size_t(heatHeight), 0.0f);
+    r.heatMax.assign(r.heatMean.size(), 0.0f);
+    for (int c = 0; c < 4; ++c) r.max[c] = double(totals.max[c]);
+    r.maxTac = double(totals.tacMax);
+    r.overTac = totals.over;
+    r.count = totals.count;
+    for (int b = 0; b < heatHeight; ++b) {
+        const Band &band = bands[std::size_t(b)];
+        // крайние клетки бывают неполными
+        const int rows = std::min(height, (b + 1) * cell) - b * cell;
+        for (int x = 0; x < heatWidth; ++x) {
+            const int cols = std::min(width, (x + 1) * cell) - x * cell;
+            const std::size_t at = std::size_t(b) * std::size_t(heatWidth) + std::size_t(x);
+            r.heatMean[at] = float(band.cellSum[std::size_t(x)] / (double(rows) * double(cols)));
+            r.heatMax[at] = band.cellMax[std::size_t(x)];
+        }
+    }
+    if (r.count) {
+        for (int c = 0; c < 4; ++c) r.mean[c] = totals.sum[c] / double(r.count);
+        r.meanTac = totals.tacSum / double(r.count);
+    }
+    return r;
+}
+
+InkCoverage measureInkCoverage(const ImageView<const uint8_t> &rgb, const InkCoverageOptions &options) {
+    InkCoverageMeter meter(rgb.width, rgb.height, options);
+    meter.add(rgb, 0);
+    return meter.result();
+}
+
+void tacHeatmapImage(const InkCoverage &coverage, double tac, const ImageView<uint8_t> &rgb) {
+    const int w = std::min(coverage.heatWidth, rgb.width), h = std::min(coverage.heatHeight, rgb.height);
+    const double limit = std::max(tac, 1e-6);
+    for (int y = 0; y < h; ++y) {
+        uint8_t *px = rgb.row(y);
+        for (int x = 0; x < w; ++x, px += rgb.channels) {
+            // по наибольшему TAC клетки: одна точка сверх предела уже брак
+            const double v = coverage.heatMax[std::size_t(y) * std::size_t(coverage.heatWidth) + std::size_t(x)];
+            if (v <= limit + 1e-6) {
+                const double t = v / limit;
+                px[0] = toByte(1.0 - t); px[1] = toByte(1.0 - 0.4 * t); px[2] = toByte(1.0 - t);
+            } else {
+                const double t = std::min(1.0, (v - limit) / std::max(4.0 - limit, 0.25));
+                px[0] = toByte(1.0 - 0.5 * t); px[1] = 0; px[2] = 0;
+            }
+            if (rgb.channels == 4) px[3] = 255;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef INKCOVERAGE_H
+#define INKCOVERAGE_H
+
+#include "colormodels.h"
+#include "imagebuffer.h"
+#include "separation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Статистика красок изображения для контроля печати: покрытие по каналам,
+// гистограмма суммы красок (TAC), доля пикселей сверх предела и уменьшенная
+// карта TAC. CMYK считается тайлами во временном буфере и сразу сворачивается
+// в суммы — изображение CMYK целиком нигде не хранится.
+struct InkCoverageOptions {
+    double tac = 3.0;               // предел C+M+Y+K (3.0 = 300 %)
+    int heatWidth = 256;            // ширина карты, клетки квадратные
+    // nullptr — простое rgbToCmyk, иначе цветоделение с GCR и пределом
+    const CmykSeparation *separation = nullptr;
+};
+
+struct InkCoverage {
+    static const int HISTOGRAM_BINS = 401;   // TAC 0..400 % с шагом 1 %
+
+    std::size_t count = 0;
+    double mean[4] = {};            // C, M, Y, K 0..1
+    double max[4] = {};
+    double meanTac = 0.0;
+    double maxTac = 0.0;
+    std::size_t overTac = 0;        // пикселей с TAC выше предела
+    std::vector<uint64_t> histogram;
+
+    // карта: средний и наибольший TAC в клетке cell x cell пикселей
+    int heatWidth = 0;
+    int heatHeight = 0;
+    int cell = 1;
+    std::vector<float> heatMean;
+    std::vector<float> heatMax;
+};
+
+// Для изображений, которые читаются полосами (из файла, с декодера):
+// add принимает очередную полосу строк. Полоса делится на куски по строкам карты
+// и по столбцам клеток, так что параллельных заданий хватает и при крупных клетках.
+class InkCoverageMeter {
+public:
+    InkCoverageMeter(int width, int height, const InkCoverageOptions &options = InkCoverageOptions());
+
+    // rgb — строки y .. y + rgb.height - 1 изображения, 8 бит, 3 или 4 канала
+    void add(const ImageView<const uint8_t> &rgb, int y);
+    InkCoverage result() const;
+
+private:
+    // суммы по всему изображению; у каждого задания add свои, потом складываются
+    struct Totals {
+        double sum[4] = {};
+        float max[4] = {};
+        double tacSum = 0.0;
+        float tacMax = 0.0f;
+        std::size_t over = 0;
+        std::size_t count = 0;
+        std::vector<uint64_t> histogram;
+
+        void merge(const Totals &o);
+    };
+    // строка карты; её клетки пишет только задание, которому они достались
+    struct Band {
+        std::vector<double> cellSum;
+        std::vector<float> cellMax;
+    };
+
+    // строки y0..y1-1 (внутри одной строки карты), столбцы x0..x1-1 (по границам клеток)
+    void addBlock(const ImageView<const uint8_t> &rgb, int y, int y0, int y1, int x0, int x1, Band &band,
+                  Totals &totals) const;
+
+    int width;
+    int height;
+    InkCoverageOptions options;
+    int cell;
+    int heatWidth;
+    int heatHeight;
+    Totals totals;
+    std::vector<Band> bands;         // по строке карты
+};
+
+InkCoverage measureInkCoverage(const ImageView<const uint8_t> &rgb, const InkCoverageOptions &options = InkCoverageOptions());
+
+// Карта TAC в RGB (heatWidth x heatHeight): ниже предела — от белого к зелёному,
+// выше — красный, тем темнее, чем больше превышение.
+void tacHeatmapImage(const InkCoverage &coverage, double tac, const ImageView<uint8_t> &rgb);
+
+#endif // INKCOVERAGE_H
@@ -0,0 +1,218 @@
+#include "lut.h"
+#include "parallel.h"
+#include "simdpixels.h"
+
+#include <algorithm>
+
+
+Lut3D::Lut3D(int grid, int outChannels)
+    : n(grid), outCh(outChannels), count(std::size_t(grid) * grid * grid * outChannels),
+      base8(256), frac8(256)
+{
+    const double scale = (grid - 1) / 255.0;
+    for (int v = 0; v < 256; ++v) {
+        double pos = v * scale;
+        int i = std::min(int(pos), grid - 2);
+        base8[v] = i;
+        frac8[v] = float(pos - i);
+    }
+}
+
+void Lut3D::fillSlices(float *dst, NodeFn fn, void *ctx) const {
+    const double step = 1.0 / (n - 1);
+    parallelFor(n, 1, [&](int r0, int r1){
+        for (int ri = r0; ri < r1; ++ri)
+            for (int gi = 0; gi < n; ++gi)
+                for (int bi = 0; bi < n; ++bi)
+                    fn(ctx, ri * step, gi * step, bi * step,
+                       dst + ((std::size_t(ri) * n + gi) * n + bi) * outCh);
+    });
+}
+
+void Lut3D::fillOwned(NodeFn fn, void *ctx) {
+    std::shared_ptr<float> values(new float[count], std::default_delete<float[]>());
+    fillSlices(values.get(), fn, ctx);
+    nodes = values;
+}
+
+// в ключ входят и размеры таблицы, чтобы смена сетки не подхватила старый файл
+void Lut3D::fillShared(const std::string &name, uint64_t params, NodeFn fn, void *ctx) {
+    params = LutCache::hashValue(outCh, LutCache::hashValue(n, params));
+    nodes = LutCache::obtain(name, params, count, [&](float *dst){ fillSlices(dst, fn, ctx); });
+}
+
+// Тетраэдр выбирается по порядку дробных частей: первый шаг по оси с наибольшей
+// долей, второй — ещё и по средней. Выбор без ветвлений, иначе на реальных
+// изображениях процессор постоянно ошибается в предсказании.
+// N > 0 — число выходов известно при компиляции, N = 0 — берётся outCh.
+template<int N>
+void Lut3D::interpolate(int ri, int gi, int bi, float rf, float gf, float bf, float *out) const {
+    const int ch = N > 0 ? N : outCh;
+    const std::size_t sB = std::size_t(ch), sG = sB * n, sR = sG * n;
+    const float *c000 = nodes.get() + ri * sR + gi * sG + bi * sB;
+    const float *c111 = c000 + sR + sG + sB;
+
+    const bool rg = rf >= gf, gb = gf >= bf, rb = rf >= bf;
+    const std::size_t sMax = rg ? (rb ? sR : sB) : (gb ? sG : sB);
+    const std::size_t sMin = rg ? (gb ? sB : sG) : (rb ? sB : sR);
+    const float fMax = std::max(std::max(rf, gf), bf);
+    const float fMin = std::min(std::min(rf, gf), bf);
+    const float fMid = rf + gf + bf - fMax - fMin;
+    const float *p1 = c000 + sMax;
+    const float *p2 = c111 - sMin;
+
+#ifdef COLOR_SSE2
+    if (N > 0 && N % 4 == 0) {
+        // по четыре выхода в регистре
+        const __m128 wMax = _mm_set1_ps(fMax), wMid = _mm_set1_ps(fMid), wMin = _mm_set1_ps(fMin);
+        for (int k = 0; k < N; k += 4) {
+            const __m128 v0 = _mm_loadu_ps(c000 + k), v1 = _mm_loadu_ps(p1 + k);
+            const __m128 v2 = _mm_loadu_ps(p2 + k), v3 = _mm_loadu_ps(c111 + k);
+            __m128 r = _mm_add_ps(v0, _mm_mul_ps(wMax, _mm_sub_ps(v1, v0)));
+            r = _mm_add_ps(r, _mm_mul_ps(wMid, _mm_sub_ps(v2, v1)));
+            r = _mm_add_ps(r, _mm_mul_ps(wMin, _mm_sub_ps(v3, v2)));
+            _mm_storeu_ps(out + k, r);
+        }
+        return;
+    }
+#endif
+    for (int k = 0; k < ch; ++k)
+        out[k] = c000[k] + fMax * (p1[k] - c000[k]) + fMid * (p2[k] - p1[k]) + fMin * (c111[k] - p2[k]);
+}
+
+void Lut3D::lookup(double r, double g, double b, float *out) const {
+    auto axis = [this](double v, int &i, float &f){
+        double pos = std::clamp(v, 0.0, 1.0) * (n - 1);
+        i = std::min(int(pos), n - 2);
+        f = float(pos - i);
+    };
+    int ri, gi, bi;
+    float rf, gf, bf;
+    axis(r, ri, rf); axis(g, gi, gf); axis(b, bi, bf);
+    interpolate<0>(ri, gi, bi, rf, gf, bf, out);
+}
+
+template<int N>
+void Lut3D::lookup8N(const uint8_t *in, int inChannels, float *out, std::size_t count) const {
+    const int *base = base8.data();
+    const float *frac = frac8.data();
+    const int ch = N > 0 ? N : outCh;
+    for (std::size_t i = 0; i < count; ++i, in += inChannels, out += ch)
+        interpolate<N>(base[in[0]], base[in[1]], base[in[2]], frac[in[0]], frac[in[1]], frac[in[2]], out);
+}
+
+void Lut3D::lookup8(const uint8_t *in, int inChannels, float *out, std::size_t count) const {
+    switch (outCh) {
+    case 3: lookup8N<3>(in, inChannels, out, count); break;
+    case 4: lookup8N<4>(in, inChannels, out, count); break;
+    case 8: lookup8N<8>(in, inChannels, out, count); break;
+    default: lookup8N<0>(in, inChannels, out, count); break;
+    }
+}
+
+
+Lut4D::Lut4D(int grid, int outChannels)
+    : n(grid), outCh(outChannels), count(std::size_t(grid) * grid * grid * grid * outChannels),
+      base8(256), frac8(256)
+{
+    const double scale = (grid - 1) / 255.0;
+    for (int v = 0; v < 256; ++v) {
+        double pos = v * scale;
+        int i = std::min(int(pos), grid - 2);
+        base8[v] = i;
+        frac8[v] = float(pos - i);
+    }
+}
+
+void Lut4D::fillSlices(float *dst, NodeFn fn, void *ctx) const {
+    const double step = 1.0 / (n - 1);
+    parallelFor(n, 1, [&](int c0, int c1){
+        for (int ci = c0; ci < c1; ++ci)
+            for (int mi = 0; mi < n; ++mi)
+                for (int yi = 0; yi < n; ++yi)
+                    for (int ki = 0; ki < n; ++ki)
+                        fn(ctx, ci * step, mi * step, yi * step, ki * step,
+                           dst + (((std::size_t(ci) * n + mi) * n + yi) * n + ki) * outCh);
+    });
+}
+
+void Lut4D::fillOwned(NodeFn fn, void *ctx) {
+    std::shared_ptr<float> values(new float[count], std::default_delete<float[]>());
+    fillSlices(values.get(), fn, ctx);
+    nodes = values;
+}
+
+void Lut4D::fillShared(const std::string &name, uint64_t params, NodeFn fn, void *ctx) {
+    params = LutCache::hashValue(outCh, LutCache::hashValue(n, params));
+    nodes = LutCache::obtain(name, params, count, [&](float *dst){ fillSlices(dst, fn, ctx); });
+}
+
+// Оси упорядочиваются по убыванию дробной части: место каждой оси — число
+// осей с большей долей (при равенстве раньше идёт меньший номер). Так обходимся
+// без ветвлений, на случайных данных сортировка обменами постоянно промахивается.
+// Затем идём от узла c0000 к c1111, добавляя по одной оси.
+void Lut4D::interpolate(const int *idx, const float *frac, float *out) const {
+    std::size_t stride[4];
+    stride[3] = std::size_t(outCh);
+    stride[2] = stride[3] * n;
+    stride[1] = stride[2] * n;
+    stride[0] = stride[1] * n;
+
+    const float *p0 = nodes.get() + idx[0] * stride[0] + idx[1] * stride[1] + idx[2] * stride[2] + idx[3] * stride[3];
+
+    float f[4];
+    std::size_t s[4];
+    for (int a = 0; a < 4; ++a) {
+        int rank = 0;
+        for (int b = 0; b < 4; ++b)
+            rank += b < a ? frac[b] >= frac[a] : frac[b] > frac[a];
+        f[rank] = frac[a];
+        s[rank] = stride[a];
+    }
+
+    const float *p1 = p0 + s[0];
+    const float *p2 = p1 + s[1];
+    const float *p3 = p2 + s[2];
+    const float *p4 = p3 + s[3];
+    for (int k = 0; k < outCh; ++k)
+        out[k] = p0[k] + f[0] * (p1[k] - p0[k]) + f[1] * (p2[k] - p1[k])
+               + f[2] * (p3[k] - p2[k]) + f[3] * (p4[k] - p3[k]);
+}
+
+void Lut4D::lookup(double c, double m, double y, double k, float *out) const {
+    const double in[4] = { c, m, y, k };
+    int idx[4];
+    float frac[4];
+    for (int a = 0; a < 4; ++a) {
+        double pos = std::clamp(in[a], 0.0, 1.0) * (n - 1);
+        idx[a] = std::min(int(pos), n - 2);
+        frac[a] = float(pos - idx[a]);
+    }
+    interpolate(idx, frac, out);
+}
+
+void Lut4D::lookup8(const uint8_t *in, int inChannels, float *out, std::size_t count) const {
+    int idx[4];
+    float frac[4];
+    for (std::size_t i = 0; i < count; ++i, in += inChannels, out += outCh) {
+        for (int a = 0; a < 4; ++a) {
+            idx[a] = base8[in[a]];
+            frac[a] = frac8[in[a]];
+        }
+        interpolate(idx, frac, out);
+    }
+}
+
+void Lut4D::lookup16(const uint16_t *in, int inChannels, float *out, std::size_t count) const {
+    const float scale = float(n - 1) / 65535.0f;
+    int idx[4];
+    float frac[4];
+    for (std::size_t i = 0; i < count; ++i, in += inChannels, out += outCh) {
+        for (int a = 0; a < 4; ++a) {
+            float pos = in[a] * scale;
+            idx[a] = std::min(int(pos), n - 2);
+            frac[a] = pos - float(idx[a]);
+        }
+        interpolate(idx, frac, out);
+    }
+}
@@ -0,0 +1,120 @@
+#ifndef LUT_H
+#define LUT_H
+
+#include "lutcache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Трёхмерная таблица преобразования: grid^3 узлов по outChannels значений float,
+// вход — три канала 0..1, интерполяция тетраэдрическая.
+class Lut3D {
+public:
+    Lut3D() = default;
+    Lut3D(int grid, int outChannels);
+
+    // fn(r, g, b, out) вызывается для каждого узла, r/g/b в 0..1; узлы заполняются параллельно.
+    template<typename Fn>
+    void fill(Fn fn);
+    // то же через LutCache: name и params (хэш всего, от чего зависит fn) задают файл
+    template<typename Fn>
+    void fillCached(const std::string &name, uint64_t params, Fn fn);
+
+    bool isEmpty() const { return n == 0; }
+    int grid() const { return n; }
+    int outChannels() const { return outCh; }
+    const float *data() const { return nodes.get(); }
+    std::size_t size() const { return count; }
+
+    void lookup(double r, double g, double b, float *out) const;
+    // in — 8-битные пиксели с inChannels отсчётами, out — outChannels значений на пиксель
+    void lookup8(const uint8_t *in, int inChannels, float *out, std::size_t count) const;
+
+private:
+    using NodeFn = void (*)(void *, double, double, double, float *);
+    template<typename Fn>
+    static void callNode(void *ctx, double r, double g, double b, float *out) { (*static_cast<Fn *>(ctx))(r, g, b, out); }
+
+    void fillSlices(float *dst, NodeFn fn, void *ctx) const;
+    void fillOwned(NodeFn fn, void *ctx);
+    void fillShared(const std::string &name, uint64_t params, NodeFn fn, void *ctx);
+    template<int N>
+    void interpolate(int ri, int gi, int bi, float rf, float gf, float bf, float *out) const;
+    template<int N>
+    void lookup8N(const uint8_t *in, int inChannels, float *out, std::size_t count) const;
+
+    int n = 0;
+    int outCh = 0;
+    std::size_t count = 0;
+    std::shared_ptr<const float> nodes;   // свой буфер или отображённый файл кэша
+    std::vector<int> base8;      // индекс узла для каждого 8-битного значения
+    std::vector<float> frac8;    // и доля до следующего узла
+};
+
+template<typename Fn>
+void Lut3D::fill(Fn fn) {
+    fillOwned(&callNode<Fn>, &fn);
+}
+
+template<typename Fn>
+void Lut3D::fillCached(const std::string &name, uint64_t params, Fn fn) {
+    fillShared(name, params, &callNode<Fn>, &fn);
+}
+
+// Четырёхмерная таблица (CMYK -> ...): grid^4 узлов, вход — четыре канала 0..1.
+// Интерполяция пентаэдрическая: гиперкуб делится на 24 симплекса по порядку
+// дробных частей, значение собирается из пяти узлов вместо шестнадцати.
+class Lut4D {
+public:
+    Lut4D() = default;
+    Lut4D(int grid, int outChannels);
+
+    // fn(c, m, y, k, out) вызывается для каждого узла; узлы заполняются параллельно.
+    template<typename Fn>
+    void fill(Fn fn);
+    template<typename Fn>
+    void fillCached(const std::string &name, uint64_t params, Fn fn);
+
+    bool isEmpty() const { return n == 0; }
+    int grid() const { return n; }
+    int outChannels() const { return outCh; }
+    const float *data() const { return nodes.get(); }
+    std::size_t size() const { return count; }
+
+    void lookup(double c, double m, double y, double k, float *out) const;
+    // in — inChannels отсчётов на пиксель, используются первые четыре
+    void lookup8(const uint8_t *in, int inChannels, float *out, std::size_t count) const;
+    void lookup16(const uint16_t *in, int inChannels, float *out, std::size_t count) const;
+
+private:
+    using NodeFn = void (*)(void *, double, double, double, double, float *);
+    template<typename Fn>
+    static void callNode(void *ctx, double c, double m, double y, double k, float *out) { (*static_cast<Fn *>(ctx))(c, m, y, k, out); }
+
+    void fillSlices(float *dst, NodeFn fn, void *ctx) const;
+    void fillOwned(NodeFn fn, void *ctx);
+    void fillShared(const std::string &name, uint64_t params, NodeFn fn, void *ctx);
+    void interpolate(const int *idx, const float *frac, float *out) const;
+
+    int n = 0;
+    int outCh = 0;
+    std::size_t count = 0;
+    std::shared_ptr<const float> nodes;
+    std::vector<int> base8;
+    std::vector<float> frac8;
+};
+
+template<typename Fn>
+void Lut4D::fill(Fn fn) {
+    fillOwned(&callNode<Fn>, &fn);
+}
+
+template<typename Fn>
+void Lut4D::fillCached(const std::string &name, uint64_t params, Fn fn) {
+    fillShared(name, params, &callNode<Fn>, &fn);
+}
+
+#endif // LUT_H
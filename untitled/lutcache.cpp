@@ -0,0 +1,178 @@
+#include "lutcache.h"
+#include "mappedfile.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace LutCache {
+
+namespace {
+
+const uint32_t FORMAT_VERSION = 1;
+const std::size_t PAGE = 4096;
+
+struct Header {
+    char magic[4];
+    uint32_t formatVersion;
+    uint32_t engineVersion;
+    uint32_t reserved;
+    uint64_t params;
+    uint64_t count;
+    uint64_t checksum;
+    char name[64];
+};
+static_assert(sizeof(Header) <= PAGE, "заголовок должен помещаться в страницу");
+
+std::mutex mutex;
+std::string cacheDir;
+std::vector<Metric> collected;
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+}
+
+std::string fileName(const std::string &dir, const std::string &name, uint64_t params) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "-%016llx.lut", (unsigned long long)params);
+    return dir + "/" + name + buf;
+}
+
+void fillHeader(Header &h, const std::string &name, uint64_t params, std::size_t count, uint64_t checksum) {
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "LUTC", 4);
+    h.formatVersion = FORMAT_VERSION;
+    h.engineVersion = ENGINE_VERSION;
+    h.params = params;
+    h.count = count;
+    h.checksum = checksum;
+    std::strncpy(h.name, name.c_str(), sizeof(h.name) - 1);
+}
+
+// nullptr, если файла нет или он не подходит
+std::shared_ptr<const float> mapFile(const std::string &path, const std::string &name, uint64_t params, std::size_t count) {
+    auto m = std::make_shared<MappedFile>();
+    if (!m->open(path) || m->size() != PAGE + count * sizeof(float)) return nullptr;
+    Header expected, actual;
+    std::memcpy(&actual, m->data(), sizeof(actual));
+    const float *values = reinterpret_cast<const float *>(m->data() + PAGE);
+    fillHeader(expected, name, params, count, actual.checksum);
+    if (std::memcmp(&expected, &actual, sizeof(Header)) != 0) return nullptr;
+    if (hashBytes(values, count * sizeof(float)) != actual.checksum) return nullptr;
+    // aliasing: указатель на данные, владение — отображением
+    return std::shared_ptr<const float>(m, values);
+}
+
+// имя временного файла своё у каждого писателя: процессы, собирающие ту же
+// таблицу одновременно, не пишут в один файл (pid) и потоки процесса — тоже (счётчик)
+std::string tempName(const std::string &path) {
+    static std::atomic<unsigned> serial{0};
+#ifdef _WIN32
+    const unsigned long pid = GetCurrentProcessId();
+#else
+    const unsigned long pid = (unsigned long)::getpid();
+#endif
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), ".%lu-%u.tmp", pid, serial++);
+    return path + buf;
+}
+
+// пишем во временный файл и переименовываем: читатели видят либо старый файл, либо целый новый
+bool writeFile(const std::string &path, const std::string &name, uint64_t params, const std::vector<float> &values) {
+    const std::string tmp = tempName(path);
+    std::FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    uint8_t page[PAGE] = {};
+    Header h;
+    fillHeader(h, name, params, values.size(), hashBytes(values.data(), values.size() * sizeof(float)));
+    std::memcpy(page, &h, sizeof(h));
+    bool ok = std::fwrite(page, 1, PAGE, f) == PAGE &&
+              std::fwrite(values.data(), sizeof(float), values.size(), f) == values.size();
+    ok = std::fclose(f) == 0 && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+    if (!ok) std::remove(tmp.c_str());
+    return ok;
+}
+
+}
+
+void setDirectory(const std::string &dir) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cacheDir = dir;
+}
+
+std::string directory() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cacheDir;
+}
+
+std::shared_ptr<const float> obtain(const std::string &name, uint64_t params, std::size_t count,
+                                    const std::function<void(float *)> &build) {
+    Metric metric;
+    metric.name = name;
+    metric.bytes = count * sizeof(float);
+    const std::string dir = directory();
+    const std::string path = dir.empty() ? std::string() : fileName(dir, name, params);
+
+    std::shared_ptr<const float> result;
+    if (!dir.empty()) {
+        auto t = Clock::now();
+        result = mapFile(path, name, params, count);
+        metric.loadMs = msSince(t);
+        metric.fromCache = result != nullptr;
+    }
+
+    if (!result) {
+        auto t = Clock::now();
+        auto values = std::make_shared<std::vector<float>>(count);
+        build(values->data());
+        metric.buildMs = msSince(t);
+        // после записи отображаем сам файл, чтобы и этот процесс делил страницы с остальными
+        if (!dir.empty() && writeFile(path, name, params, *values))
+            result = mapFile(path, name, params, count);
+        if (!result) result = std::shared_ptr<const float>(values, values->data());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    collected.push_back(metric);
+    return result;
+}
+
+// FNV-1a по 8-байтным словам (с перемешиванием старших бит вниз): на проверке
+// больших таблиц при старте побайтовый вариант заметно медленнее
+uint64_t hashBytes(const void *data, std::size_t size, uint64_t seed) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    uint64_t h = seed;
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * 1099511628211ull;
+        h ^= h >> 32;
+    }
+    for (; i < size; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+std::vector<Metric> metrics() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return collected;
+}
+
+}
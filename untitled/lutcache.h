@@ -0,0 +1,46 @@
+#ifndef LUTCACHE_H
+#define LUTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Постоянный кэш таблиц на диске. Файл: заголовок на одну страницу (магия,
+// версия формата и движка, имя и хэш параметров, число значений, контрольная
+// сумма), дальше float-данные с границы страницы. Файл отображается в память
+// только для чтения, так что несколько процессов делят одни страницы через
+// page cache. При любом несовпадении таблица строится заново и перезаписывается.
+namespace LutCache {
+
+// меняется, когда меняются формулы, по которым строятся таблицы
+const uint32_t ENGINE_VERSION = 2;
+
+// пустой каталог (по умолчанию) — кэш выключен, таблицы живут только в памяти
+void setDirectory(const std::string &dir);
+std::string directory();
+
+// Таблица из count значений float: отображённая из файла или построенная build.
+// Указатель остаётся валиден, пока жив хотя бы один shared_ptr.
+std::shared_ptr<const float> obtain(const std::string &name, uint64_t params, std::size_t count,
+                                    const std::function<void(float *)> &build);
+
+// Хэш для ключей и контрольных сумм; можно продолжать с предыдущего значения.
+uint64_t hashBytes(const void *data, std::size_t size, uint64_t seed = 1469598103934665603ull);
+template<typename T>
+uint64_t hashValue(const T &v, uint64_t seed = 1469598103934665603ull) { return hashBytes(&v, sizeof(v), seed); }
+
+struct Metric {
+    std::string name;
+    std::size_t bytes = 0;
+    double buildMs = 0.0;       // 0, если таблица взята из кэша
+    double loadMs = 0.0;        // отображение и проверка файла (в т.ч. неудачная попытка)
+    bool fromCache = false;
+};
+std::vector<Metric> metrics();
+
+}
+
+#endif // LUTCACHE_H
@@ -1,10 +1,820 @@
 #include "mainwindow.h"
+#include "colorlist.h"
+#include "conversiondaemon.h"
+#include "iccprofile.h"
+#include "icctransform.h"
+#include "inkcoverage.h"
+#include "lutcache.h"
+#include "separation.h"
+#include "separationwriter.h"
+#include "softproof.h"
+#include "swatchlibrary.h"
+#include "tiffconvert.h"
+#include "tiffio.h"
+#include "tiledimage.h"
+
 #include <QApplication>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtDebug>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// таблицы движка кэшируются между запусками
+void setUpLutCache()
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/luts";
+    if (QDir().mkpath(cacheDir))
+        LutCache::setDirectory(QDir::toNativeSeparators(cacheDir).toStdString());
+}
+
+bool spaceByName(const QString &name, ListSpace &space)
+{
+    std::vector<ListSpace> spaces;
+    if (!parseListSpaces(name.toStdString(), spaces) || spaces.size() != 1) return false;
+    space = spaces[0];
+    return true;
+}
+
+// untitled --convert-list <вход|-> <выход|-> [--to lab,cmyk,hex,rgb] [--from rgb|lab|cmyk|hex] [--precision N]
+//          [--swatches библиотека.swl]
+int convertListMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--convert-list");
+    if (at + 2 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --convert-list <in|-> <out|-> [--to lab,cmyk,hex,rgb] "
+                             "[--from rgb|lab|cmyk|hex] [--precision N] [--swatches lib.swl]\n", argv[0]);
+        return 2;
+    }
+    ColorListOptions options;
+    SwatchLibrary swatches;
+    for (int i = 1; i + 1 < args.size(); ++i) {
+        std::string error;
+        if (args[i] == "--swatches") {
+            if (!swatches.open(args[i + 1].toStdString(), &error)) {
+                std::fprintf(stderr, "--swatches: %s\n", error.c_str());
+                return 2;
+            }
+            options.swatches = &swatches;
+        }
+        if (args[i] == "--to" && !parseListSpaces(args[i + 1].toStdString(), options.outputs, &error)) {
+            std::fprintf(stderr, "--to: %s\n", error.c_str());
+            return 2;
+        }
+        if (args[i] == "--from" && !spaceByName(args[i + 1], options.bareInput)) {
+            std::fprintf(stderr, "--from: неизвестное пространство\n");
+            return 2;
+        }
+        if (args[i] == "--precision")
+            options.precision = qBound(0, args[i + 1].toInt(), 6);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ColorListStats stats;
+    std::string error;
+    if (!convertColorListFile(args[at + 1].toStdString(), args[at + 2].toStdString(), options, &stats, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const double seconds = std::max<qint64>(1, timer.elapsed()) / 1000.0;
+    std::fprintf(stderr, "%zu rows (%zu invalid, %zu clipped), %.1f MB in %.2f s, %.1f M rows/s\n",
+                 stats.rows, stats.invalid, stats.clipped, stats.bytesIn / 1e6, seconds, stats.rows / seconds / 1e6);
+    return 0;
+}
+
+// untitled --build-swatches <список> <библиотека.swl>
+int buildSwatchesMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--build-swatches");
+    if (at + 2 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --build-swatches <list> <out.swl>\n", argv[0]);
+        return 2;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<SwatchEntry> entries;
+    std::string error;
+    if (!readSwatchList(args[at + 1].toStdString(), entries, &error) ||
+        !writeSwatchLibrary(args[at + 2].toStdString(), entries, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "%zu swatches in %lld ms\n", entries.size(), (long long)timer.elapsed());
+    return 0;
+}
+
+// untitled --soft-proof <изображение> <оттиск> [--heatmap карта] [--ink-limit | --profile принтер.icc]
+int softProofMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--soft-proof");
+    if (at + 2 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --soft-proof <in> <proof> [--heatmap heat] [--ink-limit | --profile printer.icc]\n",
+                     argv[0]);
+        return 2;
+    }
+    int heatAt = args.indexOf("--heatmap");
+    const QString heatPath = heatAt > 0 && heatAt + 1 < args.size() ? args[heatAt + 1] : QString();
+
+    // --profile: цветоделение (B2A) и печать (A2B) по CMYK-профилю принтера, относительная
+    // колориметрия. Таблицы профиля и самого оттиска лежат в LutCache — повторный запуск
+    // с тем же профилем их не компилирует, а отображает из файлов.
+    const RenderingIntent intent = RenderingIntent::RelativeColorimetric;
+    IccProfile printer;
+    std::shared_ptr<const IccTransform> toPrinter, fromPrinter;
+    int profileAt = args.indexOf("--profile");
+    if (profileAt > 0 && profileAt + 1 < args.size()) {
+        std::string error;
+        if (!loadIccProfile(QDir::toNativeSeparators(args[profileAt + 1]).toStdString(), printer, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (printer.colorSpace() != IccColorSpace::CMYK || !printer.canConvertToLab(intent)
+                || !printer.canConvertFromLab(intent)) {
+            std::fprintf(stderr, "%s is not a CMYK output profile\n", qPrintable(args[profileAt + 1]));
+            return 2;
+        }
+        toPrinter = TransformCache::get(nullptr, &printer, intent);
+        fromPrinter = TransformCache::get(&printer, nullptr, intent);
+    }
+
+    QImage src(args[at + 1]);
+    if (src.isNull()) {
+        std::fprintf(stderr, "cannot read %s\n", qPrintable(args[at + 1]));
+        return 1;
+    }
+    src = src.convertToFormat(QImage::Format_RGB888);
+    QImage proofImage(src.size(), QImage::Format_RGB888), heat;
+    if (!heatPath.isEmpty()) heat = QImage(src.size(), QImage::Format_RGB888);
+
+    // как в окне: GCR с пределом TAC или простое цветоделение
+    CmykSeparation separation(SeparationParams(), TableBuild::Later);
+    const bool inkLimit = args.contains("--ink-limit");
+    std::unique_ptr<SoftProof> proof;
+    if (toPrinter) {
+        const uint64_t key = LutCache::hashValue(int(intent), LutCache::hashValue(printer.hash()));
+        proof = std::make_unique<SoftProof>([&toPrinter](double r, double g, double b){
+            const Lab lab = xyzToLab(linearRgbToXyz(invGamma(r), invGamma(g), invGamma(b)));
+            const double in[3] = { lab.L, lab.a, lab.b };
+            double out[4];
+            toPrinter->apply(in, out);
+            return CMYK{ out[0], out[1], out[2], out[3] };
+        }, [&fromPrinter](const CMYK &cmyk){
+            const double in[4] = { cmyk.c, cmyk.m, cmyk.y, cmyk.k };
+            double out[3];
+            fromPrinter->apply(in, out);
+            return Lab{ out[0], out[1], out[2] };
+        }, "softProofIcc", key);
+    } else {
+        proof = std::make_unique<SoftProof>([&separation, inkLimit](double r, double g, double b){
+            return inkLimit ? separation.separate(r, g, b) : unitRgbToCmyk(r, g, b);
+        });
+    }
+
+    auto view = [](QImage &img){
+        return img.isNull() ? ImageView<uint8_t>() : ImageView<uint8_t>(img.bits(), img.width(), img.height(), 3, img.bytesPerLine());
+    };
+    QElapsedTimer timer;
+    timer.start();
+    SoftProof::Stats st = proof->proofImage(ImageView<const uint8_t>(src.constBits(), src.width(), src.height(), 3, src.bytesPerLine()),
+                                           view(proofImage), view(heat));
+    const qint64 elapsed = timer.elapsed();
+
+    if (!proofImage.save(args[at + 2]) || (!heatPath.isEmpty() && !heat.save(heatPath))) {
+        std::fprintf(stderr, "cannot write output\n");
+        return 1;
+    }
+    std::fprintf(stderr, "%dx%d in %lld ms: dE mean %.2f, max %.2f, over 2: %.1f%%\n",
+                 src.width(), src.height(), (long long)elapsed, st.mean, st.max,
+                 st.count ? 100.0 * double(st.over) / double(st.count) : 0.0);
+    return 0;
+}
+
+// untitled --ink-coverage <изображение> [--heatmap карта] [--tac 300] [--ink-limit]
+int inkCoverageMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--ink-coverage");
+    if (at + 1 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --ink-coverage <in> [--heatmap heat] [--tac percent] [--ink-limit]\n", argv[0]);
+        return 2;
+    }
+    int heatAt = args.indexOf("--heatmap");
+    const QString heatPath = heatAt > 0 && heatAt + 1 < args.size() ? args[heatAt + 1] : QString();
+    InkCoverageOptions options;
+    int tacAt = args.indexOf("--tac");
+    if (tacAt > 0 && tacAt + 1 < args.size()) {
+        bool ok = false;
+        double percent = args[tacAt + 1].toDouble(&ok);
+        if (!ok || percent <= 0.0 || percent > 400.0) {
+            std::fprintf(stderr, "bad --tac %s\n", qPrintable(args[tacAt + 1]));
+            return 2;
+        }
+        options.tac = percent / 100.0;
+    }
+    // предел цветоделения тот же, что и у проверки
+    SeparationParams separationParams;
+    separationParams.tac = options.tac;
+    CmykSeparation separation(separationParams, TableBuild::Later);
+    if (args.contains("--ink-limit")) {
+        separation.buildTables(TableBuild::Now);
+        options.separation = &separation;
+    }
+
+    // RGB TIFF 8/16 бит читается полосами через TiffReader, изображение целиком
+    // в памяти не бывает; прочие форматы QImage умеет только целиком
+    const int STRIP = 256;
+    int width = 0, height = 0;
+    std::unique_ptr<InkCoverageMeter> meter;
+    QElapsedTimer timer;
+    TiffReader tiff;
+    std::string error;
+    if (tiff.open(args[at + 1].toStdString(), &error) && tiff.info().photometric == TiffPhotometric::RGB
+            && (tiff.info().channels == 3 || tiff.info().channels == 4)) {
+        const TiffInfo &info = tiff.info();
+        width = info.width;
+        height = info.height;
+        timer.start();
+        meter.reset(new InkCoverageMeter(width, height, options));
+        const std::size_t samples = std::size_t(width) * std::size_t(info.channels);
+        std::vector<uint8_t> strip(samples * std::size_t(STRIP));
+        std::vector<uint16_t> wide(info.bits == 16 ? strip.size() : 0);
+        for (int y = 0; y < height; y += STRIP) {
+            const int rows = std::min(STRIP, height - y);
+            bool ok;
+            if (info.bits == 16) {
+                ok = tiff.readRows(y, rows, reinterpret_cast<uint8_t *>(wide.data()), std::ptrdiff_t(samples * 2), &error);
+                for (std::size_t i = 0; ok && i < samples * std::size_t(rows); ++i) strip[i] = uint8_t(wide[i] >> 8);
+            } else {
+                ok = tiff.readRows(y, rows, strip.data(), std::ptrdiff_t(samples), &error);
+            }
+            if (!ok) {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+            meter->add(ImageView<const uint8_t>(strip.data(), width, rows, info.channels, std::ptrdiff_t(samples)), y);
+        }
+    } else {
+        QImage src(args[at + 1]);
+        if (src.isNull()) {
+            std::fprintf(stderr, "cannot read %s\n", qPrintable(args[at + 1]));
+            return 1;
+        }
+        width = src.width();
+        height = src.height();
+        timer.start();
+        // в RGB888 переводим полосами, а не копией всего изображения
+        meter.reset(new InkCoverageMeter(width, height, options));
+        for (int y = 0; y < height; y += STRIP) {
+            const QImage strip = src.copy(0, y, width, std::min(STRIP, height - y)).convertToFormat(QImage::Format_RGB888);
+            meter->add(ImageView<const uint8_t>(strip.constBits(), strip.width(), strip.height(), 3, strip.bytesPerLine()), y);
+        }
+    }
+    const InkCoverage c = meter->result();
+    const qint64 elapsed = timer.elapsed();
+
+    if (!heatPath.isEmpty()) {
+        QImage heat(c.heatWidth, c.heatHeight, QImage::Format_RGB888);
+        tacHeatmapImage(c, options.tac, ImageView<uint8_t>(heat.bits(), heat.width(), heat.height(), 3, heat.bytesPerLine()));
+        if (!heat.save(heatPath)) {
+            std::fprintf(stderr, "cannot write %s\n", qPrintable(heatPath));
+            return 1;
+        }
+    }
+    std::printf("pixels\t%zu\n", c.count);
+    const char *names = "CMYK";
+    for (int i = 0; i < 4; ++i)
+        std::printf("%c\tmean %.1f%%\tmax %.1f%%\n", names[i], 100.0 * c.mean[i], 100.0 * c.max[i]);
+    std::printf("TAC\tmean %.1f%%\tmax %.1f%%\n", 100.0 * c.meanTac, 100.0 * c.maxTac);
+    std::printf("over %.0f%%\t%zu\t%.3f%%\n", 100.0 * options.tac, c.overTac,
+                c.count ? 100.0 * double(c.overTac) / double(c.count) : 0.0);
+    // гистограмма TAC по 1 %, пустые столбцы пропускаются
+    for (int i = 0; i < InkCoverage::HISTOGRAM_BINS; ++i)
+        if (c.histogram[std::size_t(i)]) std::printf("hist\t%d\t%llu\n", i, (unsigned long long)c.histogram[std::size_t(i)]);
+    std::fprintf(stderr, "%dx%d in %lld ms\n", width, height, (long long)elapsed);
+    return 0;
+}
+
+// untitled --separate <изображение> <префикс> [--ink-limit]: префикс-C.pgm … префикс-K.pgm
+int separateMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--separate");
+    if (at + 2 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --separate <in> <prefix> [--ink-limit]\n", argv[0]);
+        return 2;
+    }
+    CmykSeparation separation(SeparationParams(), TableBuild::Later);
+    const bool inkLimit = args.contains("--ink-limit");
+    // как в --ink-coverage: пакет идёт через 3D-таблицу, а не точным путём по пикселю
+    if (inkLimit) separation.buildTables(TableBuild::Now);
+
+    std::array<std::string, 4> paths;
+    for (int p = 0; p < 4; ++p)
+        paths[std::size_t(p)] = (args[at + 2] + '-' + QChar(SeparationWriter::PLANES[p]) + ".pgm").toStdString();
+
+    // как в --ink-coverage: RGB TIFF 8/16 бит полосами через TiffReader, прочее — через QImage
+    const int STRIP = 256;
+    int width = 0, height = 0;
+    QElapsedTimer timer;
+    std::string error;
+    SeparationWriter writer;
+    bool ok;
+    TiffReader tiff;
+    if (tiff.open(args[at + 1].toStdString(), &error) && tiff.info().photometric == TiffPhotometric::RGB
+            && (tiff.info().channels == 3 || tiff.info().channels == 4)) {
+        const TiffInfo &info = tiff.info();
+        width = info.width;
+        height = info.height;
+        timer.start();
+        ok = writer.open(paths, width, height, inkLimit ? &separation : nullptr, &error);
+        const std::size_t samples = std::size_t(width) * std::size_t(info.channels);
+        std::vector<uint8_t> strip(samples * std::size_t(STRIP));
+        std::vector<uint16_t> wide(info.bits == 16 ? strip.size() : 0);
+        for (int y = 0; ok && y < height; y += STRIP) {
+            const int rows = std::min(STRIP, height - y);
+            if (info.bits == 16) {
+                ok = tiff.readRows(y, rows, reinterpret_cast<uint8_t *>(wide.data()), std::ptrdiff_t(samples * 2), &error);
+                for (std::size_t i = 0; ok && i < samples * std::size_t(rows); ++i) strip[i] = uint8_t(wide[i] >> 8);
+            } else {
+                ok = tiff.readRows(y, rows, strip.data(), std::ptrdiff_t(samples), &error);
+            }
+            ok = ok && writer.add(ImageView<const uint8_t>(strip.data(), width, rows, info.channels, std::ptrdiff_t(samples)), &error);
+        }
+    } else {
+        QImage src(args[at + 1]);
+        if (src.isNull()) {
+            std::fprintf(stderr, "cannot read %s\n", qPrintable(args[at + 1]));
+            return 1;
+        }
+        width = src.width();
+        height = src.height();
+        timer.start();
+        ok = writer.open(paths, width, height, inkLimit ? &separation : nullptr, &error);
+        // в RGB888 полосами
+        for (int y = 0; ok && y < height; y += STRIP) {
+            const QImage strip = src.copy(0, y, width, std::min(STRIP, height - y)).convertToFormat(QImage::Format_RGB888);
+            ok = writer.add(ImageView<const uint8_t>(strip.constBits(), strip.width(), strip.height(), 3, strip.bytesPerLine()), &error);
+        }
+    }
+    // недописанные плоскости не оставляем
+    if (!ok || !writer.close(&error)) {
+        writer.discard();
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "%dx%d in %lld ms\n", width, height, (long long)timer.elapsed());
+    return 0;
+}
+
+// untitled --convert-tiff <вход.tif> <выход.tif> --to rgb|lab|cmyk [--compression none|packbits|lzw] [--tile N]
+// --to, --compression, --tile после позиции from — общие для --convert-tiff и --convert-dir
+bool parseTiffOptions(const QStringList &args, int from, TiffPhotometric *to, TiffWriteOptions *options)
+{
+    for (int i = from; i + 1 < args.size(); ++i) {
+        const QString value = args[i + 1].toLower();
+        if (args[i] == "--to") {
+            if (value == "rgb") *to = TiffPhotometric::RGB;
+            else if (value == "lab") *to = TiffPhotometric::CIELab;
+            else if (value == "cmyk") *to = TiffPhotometric::Separated;
+            else {
+                std::fprintf(stderr, "--to: неизвестная модель %s\n", qPrintable(value));
+                return false;
+            }
+        } else if (args[i] == "--compression") {
+            if (value == "none") options->compression = TiffCompression::None;
+            else if (value == "packbits") options->compression = TiffCompression::PackBits;
+            else if (value == "lzw") options->compression = TiffCompression::LZW;
+            else {
+                std::fprintf(stderr, "--compression: неизвестное сжатие %s\n", qPrintable(value));
+                return false;
+            }
+        } else if (args[i] == "--tile") {
+            options->tileSize = value.toInt();
+        }
+    }
+    return true;
+}
+
+int convertTiffMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--convert-tiff");
+    if (at + 2 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --convert-tiff <in.tif> <out.tif> --to rgb|lab|cmyk"
+                             " [--compression none|packbits|lzw] [--tile N]\n", argv[0]);
+        return 2;
+    }
+    TiffPhotometric to = TiffPhotometric::RGB;
+    TiffWriteOptions options;
+    if (!parseTiffOptions(args, at + 3, &to, &options)) return 2;
+
+    QElapsedTimer timer;
+    timer.start();
+    std::string error;
+    PipelineStats stats;
+    if (!convertTiff(args[at + 1].toStdString(), args[at + 2].toStdString(), to, options, &error, &stats)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "converted in %lld ms\n", (long long)timer.elapsed());
+    // самая загруженная стадия и задаёт время всего перевода
+    const char *stages[3] = { "read", "convert", "write" };
+    for (int i = 0; i < 3; ++i)
+        std::fprintf(stderr, "  %-7s %3.0f%% busy, waited %.2f s for input, %.2f s for buffers\n", stages[i],
+                     100.0 * stats.utilisation(i), stats.stages[i].waitInput, stats.stages[i].waitOutput);
+    return 0;
+}
+
+const char *backendName(AsyncFileIO::Backend backend)
+{
+    return backend == AsyncFileIO::Backend::Uring ? "io_uring" : "threads";
+}
+
+void printBatchStats(const TiffBatchStats &stats)
+{
+    std::fprintf(stderr, "%s: %zu converted, %zu failed in %.2f s (%.0f files/s, %.1f MB/s read, %.1f MB/s written)\n",
+                 backendName(stats.backend), stats.converted, stats.failed, stats.seconds,
+                 double(stats.converted) / std::max(stats.seconds, 1e-9),
+                 double(stats.bytesRead) / 1e6 / std::max(stats.seconds, 1e-9),
+                 double(stats.bytesWritten) / 1e6 / std::max(stats.seconds, 1e-9));
+}
+
+int convertDirMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--convert-dir");
+    if (at + 2 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --convert-dir <indir> <outdir> --to rgb|lab|cmyk"
+                             " [--compression none|packbits|lzw] [--tile N] [--depth N] [--no-uring]\n", argv[0]);
+        return 2;
+    }
+    TiffPhotometric to = TiffPhotometric::RGB;
+    TiffWriteOptions options;
+    if (!parseTiffOptions(args, at + 3, &to, &options)) return 2;
+    int depth = 32;
+    int d = args.indexOf("--depth");
+    if (d > 0 && d + 1 < args.size()) depth = std::max(1, args[d + 1].toInt());
+
+    const QDir in(args[at + 1]);
+    QDir out(args[at + 2]);
+    if (!out.exists() && !out.mkpath(".")) {
+        std::fprintf(stderr, "не удалось создать каталог %s\n", qPrintable(args[at + 2]));
+        return 1;
+    }
+    std::vector<TiffFileJob> jobs;
+    for (const QString &name : in.entryList({ "*.tif", "*.tiff" }, QDir::Files, QDir::Name))
+        jobs.push_back({ in.filePath(name).toStdString(), out.filePath(name).toStdString() });
+    if (jobs.empty()) {
+        std::fprintf(stderr, "в %s нет файлов TIFF\n", qPrintable(args[at + 1]));
+        return 1;
+    }
+
+    const TiffBatchStats stats = convertTiffFiles(jobs, to, options, depth, !args.contains("--no-uring"));
+    for (const std::string &e : stats.errors) std::fprintf(stderr, "%s\n", e.c_str());
+    printBatchStats(stats);
+    return stats.failed ? 1 : 0;
+}
+
+// пакет мелких файлов обоими способами ввода-вывода: io_uring против потоков с pread
+int benchIoMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--bench-io");
+    if (at + 1 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --bench-io <dir> [--files N] [--size N] [--depth N]\n", argv[0]);
+        return 2;
+    }
+    int files = 2000, size = 256, depth = 32;
+    for (int i = at + 2; i + 1 < args.size(); ++i) {
+        if (args[i] == "--files") files = std::max(1, args[i + 1].toInt());
+        else if (args[i] == "--size") size = std::max(1, args[i + 1].toInt());
+        else if (args[i] == "--depth") depth = std::max(1, args[i + 1].toInt());
+    }
+    QDir dir(args[at + 1]);
+    if (!dir.mkpath("in") || !dir.mkpath("out")) {
+        std::fprintf(stderr, "не удалось создать каталоги в %s\n", qPrintable(args[at + 1]));
+        return 1;
+    }
+
+    std::vector<uint8_t> pixels(std::size_t(size) * std::size_t(size) * 3);
+    std::vector<TiffFileJob> jobs;
+    std::string error;
+    for (int i = 0; i < files; ++i) {
+        for (std::size_t k = 0; k < pixels.size(); ++k) pixels[k] = uint8_t(k * 7 + std::size_t(i) * 13 + (k >> 9));
+        const QString name = QString("%1.tif").arg(i, 5, 10, QChar('0'));
+        const std::string src = dir.filePath("in/" + name).toStdString();
+        TiffWriter writer;
+        if (!writer.open(src, size, size, 3, 8, TiffPhotometric::RGB, TiffWriteOptions(), &error)
+                || !writer.writeRows(pixels.data(), std::ptrdiff_t(size) * 3, size, &error) || !writer.close(&error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        jobs.push_back({ src, dir.filePath("out/" + name).toStdString() });
+    }
+    std::fprintf(stderr, "%d files of %dx%d RGB, depth %d\n", files, size, size, depth);
+
+    for (bool uring : { true, false }) {
+        const TiffBatchStats stats = convertTiffFiles(jobs, TiffPhotometric::CIELab, TiffWriteOptions(), depth, uring);
+        if (uring && stats.backend != AsyncFileIO::Backend::Uring)
+            std::fprintf(stderr, "io_uring недоступен, сравнение — только с потоками\n");
+        printBatchStats(stats);
+    }
+    return 0;
+}
+
+
+void printTileStats(const char *name, const TiledImage &image)
+{
+    const TileCacheStats s = image.stats();
+    std::fprintf(stderr, "  %-6s %zu hits, %zu misses, %zu loaded, %zu spilled, peak %zu tiles%s\n", name,
+                 s.hits, s.misses, s.loads, s.spills, s.peakResident, s.overBudget ? " (over budget)" : "");
+}
+
+// untitled --equalize-tiff <in.tif> <out.tif> [--budget МБ] [--tile N] [--levels N] [--spill каталог]
+// выравнивание L в Lab и, по желанию, квантование — для файлов больше памяти
+int equalizeTiffMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--equalize-tiff");
+    if (at + 2 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --equalize-tiff <in.tif> <out.tif> [--budget MB] [--tile N] [--levels N]"
+                             " [--spill dir]\n", argv[0]);
+        return 2;
+    }
+    TiledImageOptions options;
+    int levels = 0;
+    for (int i = at + 3; i + 1 < args.size(); ++i) {
+        if (args[i] == "--budget") options.memoryBudget = std::size_t(std::max(1, args[i + 1].toInt())) << 20;
+        else if (args[i] == "--tile") options.tileSize = args[i + 1].toInt();
+        else if (args[i] == "--levels") levels = args[i + 1].toInt();
+        else if (args[i] == "--spill") options.spillDirectory = QDir::toNativeSeparators(args[i + 1]).toStdString();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    std::string error;
+    TiledImage source, lab;
+    TiffInfo info;
+    if (!readTiffTiled(args[at + 1].toStdString(), source, &info, options, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    // в Lab и обратно в модель файла; Lab уже на месте
+    const bool isLab = info.photometric == TiffPhotometric::CIELab;
+    if (!isLab && !convertTiled(source, info.photometric, lab, TiffPhotometric::CIELab, options, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (!equalizeLightness(isLab ? source : lab, &error)
+            || (!isLab && !convertTiled(lab, TiffPhotometric::CIELab, source, info.photometric, options, &error))
+            || (levels > 1 && !isLab && !quantizeTiled(source, levels, &error))
+            || !writeTiffTiled(source, args[at + 2].toStdString(), info.photometric, TiffWriteOptions(), &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "processed %dx%d in %lld ms, budget %zu MB\n", info.width, info.height,
+                 (long long)timer.elapsed(), options.memoryBudget >> 20);
+    printTileStats("source", source);
+    if (!isLab) printTileStats("lab", lab);
+    return 0;
+}
+
+
+// untitled --proof-tiff <in.tif> <оттиск.tif> [--heatmap карта.tif] [--radius N] [--budget МБ] [--tile N]
+//                       [--spill каталог] [--ink-limit]
+// пробный оттиск RGB 8 бит по тайлам — для файлов больше памяти; карта ΔE усреднена по окну
+int proofTiffMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--proof-tiff");
+    if (at + 2 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --proof-tiff <in.tif> <proof.tif> [--heatmap heat.tif] [--radius N]"
+                             " [--budget MB] [--tile N] [--spill dir] [--ink-limit]\n", argv[0]);
+        return 2;
+    }
+    TiledImageOptions options;
+    QString heatPath;
+    int radius = 2;
+    for (int i = at + 3; i + 1 < args.size(); ++i) {
+        if (args[i] == "--heatmap") heatPath = args[i + 1];
+        else if (args[i] == "--radius") radius = args[i + 1].toInt();
+        else if (args[i] == "--budget") options.memoryBudget = std::size_t(std::max(1, args[i + 1].toInt())) << 20;
+        else if (args[i] == "--tile") options.tileSize = args[i + 1].toInt();
+        else if (args[i] == "--spill") options.spillDirectory = QDir::toNativeSeparators(args[i + 1]).toStdString();
+    }
+
+    // как в --soft-proof: GCR с пределом TAC или простое цветоделение
+    CmykSeparation separation(SeparationParams(), TableBuild::Later);
+    const bool inkLimit = args.contains("--ink-limit");
+    SoftProof proof([&separation, inkLimit](double r, double g, double b){
+        return inkLimit ? separation.separate(r, g, b) : unitRgbToCmyk(r, g, b);
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    std::string error;
+    TiledImage source, proofed, heat;
+    TiffInfo info;
+    SoftProof::Stats st;
+    if (!readTiffTiled(args[at + 1].toStdString(), source, &info, options, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (info.photometric != TiffPhotometric::RGB) {
+        std::fprintf(stderr, "expected an RGB TIFF\n");
+        return 1;
+    }
+    if (!softProofTiled(source, proof, proofed, heatPath.isEmpty() ? nullptr : &heat, &st, radius, options, &error)
+            || !writeTiffTiled(proofed, args[at + 2].toStdString(), TiffPhotometric::RGB, TiffWriteOptions(), &error)
+            || (!heatPath.isEmpty()
+                && !writeTiffTiled(heat, QDir::toNativeSeparators(heatPath).toStdString(), TiffPhotometric::RGB,
+                                   TiffWriteOptions(), &error))) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "%dx%d in %lld ms: dE mean %.2f, max %.2f, over 2: %.1f%%\n", info.width, info.height,
+                 (long long)timer.elapsed(), st.mean, st.max, st.count ? 100.0 * double(st.over) / double(st.count) : 0.0);
+    printTileStats("source", source);
+    printTileStats("proof", proofed);
+    return 0;
+}
+
+// untitled --daemon <сокет> [--max-request MB] — перевод RGB8 -> Lab8 / CMYK8 для других процессов
+int daemonMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--daemon");
+    if (at + 1 >= args.size()) {
+        std::fprintf(stderr, "usage: %s --daemon <socket> [--max-request MB]\n", argv[0]);
+        return 2;
+    }
+    // наибольший запрос с копированием; больше — отказ
+    std::size_t maxRequestMb = 256;
+    int maxAt = args.indexOf("--max-request");
+    if (maxAt > 0 && maxAt + 1 < args.size()) {
+        bool ok = false;
+        const qulonglong mb = args[maxAt + 1].toULongLong(&ok);
+        if (!ok || mb == 0 || mb > (1u << 20)) {
+            std::fprintf(stderr, "bad --max-request %s\n", qPrintable(args[maxAt + 1]));
+            return 2;
+        }
+        maxRequestMb = std::size_t(mb);
+    }
+    ConversionDaemon daemon(maxRequestMb);
+    std::string error;
+    if (!daemon.listen(QDir::toNativeSeparators(args[at + 1]).toStdString(), &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "listening on %s\n", qPrintable(args[at + 1]));
+    daemon.serve();
+    return 0;
+}
+
+// задержка одного запроса к демону: пиксели в сокете против общей памяти,
+// для сравнения — тот же перевод в своём процессе; медиана из --rounds
+int benchDaemonMode(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setUpLutCache();
+    const QStringList args = a.arguments();
+    int at = args.indexOf("--bench-daemon");
+    int rounds = 15;
+    QList<int> sizes = { 1, 4, 16 };
+    for (int i = at + 1; i + 1 < args.size(); ++i) {
+        if (args[i] == "--rounds") rounds = std::max(1, args[i + 1].toInt());
+        else if (args[i] == "--megapixels") sizes = { std::max(1, args[i + 1].toInt()) };
+    }
+
+    const std::string socket = QDir::temp().filePath(QString("colour-daemon-%1.sock")
+                                                     .arg(QCoreApplication::applicationPid())).toStdString();
+    ConversionDaemon daemon;
+    DaemonClient client;
+    std::string error;
+    if (!daemon.listen(socket, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::thread server([&daemon]{ daemon.serve(); });
+    bool ok = client.connect(socket, &error);
+
+    auto median = [rounds](const std::function<bool()> &run, double &ms) {
+        std::vector<double> times;
+        for (int r = 0; r < rounds; ++r) {
+            QElapsedTimer timer;
+            timer.start();
+            if (!run()) return false;
+            times.push_back(timer.nsecsElapsed() / 1e6);
+        }
+        std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+        ms = times[times.size() / 2];
+        return true;
+    };
+
+    for (int mp : sizes) {
+        const std::size_t pixels = std::size_t(mp) << 20;
+        for (DaemonTarget to : { DaemonTarget::Lab8, DaemonTarget::Cmyk8 }) {
+            if (!ok) break;
+            SharedBuffer in, out;
+            ok = in.create(pixels * 3, &error) && out.create(pixels * daemonOutputBytes(to), &error);
+            if (!ok) break;
+            for (std::size_t i = 0; i < in.size(); ++i) in.data()[i] = uint8_t(i * 31 + (i >> 11));
+            std::vector<uint8_t> local(out.size()), copied;
+            double localMs = 0.0, copyMs = 0.0, sharedMs = 0.0;
+            ok = median([&]{ daemonConvert(in.data(), 3, pixels, to, local.data()); return true; }, localMs)
+                    && median([&]{ return client.convertCopy(in.data(), 3, pixels, to, &copied, &error); }, copyMs)
+                    && median([&]{ return client.convertShared(in, 3, pixels, to, out, &error); }, sharedMs);
+            if (!ok) break;
+            const bool same = copied == local && std::equal(local.begin(), local.end(), out.data());
+            std::fprintf(stderr, "%3d MP -> %-4s  in-process %7.1f ms  socket copy %7.1f ms (+%.1f)"
+                                 "  shared memory %7.1f ms (+%.1f)%s\n",
+                         mp, to == DaemonTarget::Lab8 ? "lab" : "cmyk", localMs, copyMs, copyMs - localMs,
+                         sharedMs, sharedMs - localMs, same ? "" : "  RESULTS DIFFER");
+        }
+    }
+    if (!ok) std::fprintf(stderr, "%s\n", error.c_str());
+    daemon.stop();
+    server.join();
+    return ok ? 0 : 1;
+}
+
+}
 
 int main(int argc, char *argv[])
 {
+    // пакетный режим без окна
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--convert-list") == 0) return convertListMode(argc, argv);
+        if (std::strcmp(argv[i], "--build-swatches") == 0) return buildSwatchesMode(argc, argv);
+        if (std::strcmp(argv[i], "--soft-proof") == 0) return softProofMode(argc, argv);
+        if (std::strcmp(argv[i], "--ink-coverage") == 0) return inkCoverageMode(argc, argv);
+        if (std::strcmp(argv[i], "--separate") == 0) return separateMode(argc, argv);
+        if (std::strcmp(argv[i], "--convert-tiff") == 0) return convertTiffMode(argc, argv);
+        if (std::strcmp(argv[i], "--convert-dir") == 0) return convertDirMode(argc, argv);
+        if (std::strcmp(argv[i], "--bench-io") == 0) return benchIoMode(argc, argv);
+        if (std::strcmp(argv[i], "--equalize-tiff") == 0) return equalizeTiffMode(argc, argv);
+        if (std::strcmp(argv[i], "--proof-tiff") == 0) return proofTiffMode(argc, argv);
+        if (std::strcmp(argv[i], "--daemon") == 0) return daemonMode(argc, argv);
+        if (std::strcmp(argv[i], "--bench-daemon") == 0) return benchDaemonMode(argc, argv);
+    }
+
     QApplication a(argc, argv);
+    setUpLutCache();
+
+    // --eager-tables: старое поведение, таблицы строятся до показа окна (для сравнения метрик)
+    const bool eager = a.arguments().contains("--eager-tables");
+
+    QElapsedTimer startup;
+    startup.start();
     MainWindow w;
+    if (eager) w.warmUpTables(TableBuild::Now);
     w.show();
+
+    // первый проход цикла событий после show() — окно уже отрисовано
+    QTimer::singleShot(0, &w, [&w, &startup, eager](){
+        qInfo().noquote() << QString("first frame: %1 ms (%2 tables)")
+                             .arg(startup.elapsed()).arg(eager ? "eager" : "background");
+        if (!eager) w.warmUpTables(TableBuild::Background);
+    });
     return a.exec();
 }
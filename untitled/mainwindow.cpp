@@ -1,151 +1,20 @@
 #include "mainwindow.h"
 
+#include "cmyklab.h"
+#include "colormodels.h"
+#include "gamutmap.h"
+#include "inkcoverage.h"
+#include "lutcache.h"
+#include "separation.h"
+#include "softproof.h"
+#include "swatchlibrary.h"
+
 #include <QtWidgets>
 #include <cmath>
 #include <algorithm>
 #include <utility>
 
 
-namespace {
-
-struct RGB { int r, g, b; };
-struct CMYK { double c, m, y, k; };
-struct XYZ { double X, Y, Z; };
-struct Lab  { double L, a, b; };
-
-const double REF_X = 95.047;
-const double REF_Y = 100.0;
-const double REF_Z = 108.883;
-
-static inline int clampInt(int v, int lo, int hi){ return std::max(lo, std::min(hi, v)); }
-
-
-CMYK rgbToCmyk(const RGB &rgb) {
-    double k = 1.0 - std::max({rgb.r / 255.0, rgb.g / 255.0, rgb.b / 255.0});
-    double c = 0, m = 0, y = 0;
-    if (k < 1.0 - 1e-12) {
-        c = (1.0 - rgb.r / 255.0 - k) / (1.0 - k);
-        m = (1.0 - rgb.g / 255.0 - k) / (1.0 - k);
-        y = (1.0 - rgb.b / 255.0 - k) / (1.0 - k);
-    } else {
-        c = m = y = 0.0;
-    }
-    return {c,m,y,k};
-}
-
-
-RGB cmykToRgb(const CMYK &cmyk) {
-    double r = 255.0 * (1.0 - cmyk.c) * (1.0 - cmyk.k);
-    double g = 255.0 * (1.0 - cmyk.m) * (1.0 - cmyk.k);
-    double b = 255.0 * (1.0 - cmyk.y) * (1.0 - cmyk.k);
-    return { clampInt(int(std::round(r)), 0, 255),
-            clampInt(int(std::round(g)), 0, 255),
-            clampInt(int(std::round(b)), 0, 255) };
-}
-
-
-static double invGamma(double v) {
-    if (v <= 0.04045) return v / 12.92;
-    else return std::pow((v + 0.055) / 1.055, 2.4);
-}
-
-
-static double gammaSRGB(double v) {
-    if (v <= 0.0031308) return 12.92 * v;
-    else return 1.055 * std::pow(v, 1.0/2.4) - 0.055;
-}
-
-XYZ rgbToXyz(const RGB &rgb) {
-    double r = rgb.r / 255.0;
-    double g = rgb.g / 255.0;
-    double b = rgb.b / 255.0;
-
-    double rl = invGamma(r);
-    double gl = invGamma(g);
-    double bl = invGamma(b);
-
-    double X = rl * 0.4124564 + gl * 0.3575761 + bl * 0.1804375;
-    double Y = rl * 0.2126729 + gl * 0.7151522 + bl * 0.0721750;
-    double Z = rl * 0.0193339 + gl * 0.1191920 + bl * 0.9503041;
-
-    return { X * 100.0, Y * 100.0, Z * 100.0 };
-}
-
-
-std::pair<RGB,bool> xyzToRgb(const XYZ &xyz) {
-    double x = xyz.X / 100.0;
-    double y = xyz.Y / 100.0;
-    double z = xyz.Z / 100.0;
-
-    double rl =  x *  3.2406 + y * (-1.5372) + z * (-0.4986);
-    double gl =  x * (-0.9689) + y *  1.8758 + z *  0.0415;
-    double bl =  x *  0.0557 + y * (-0.2040) + z *  1.0570;
-
-    bool clipped = false;
-    double r = gammaSRGB(rl);
-    double g = gammaSRGB(gl);
-    double b = gammaSRGB(bl);
-
-    if (r < 0.0 || r > 1.0 || g < 0.0 || g > 1.0 || b < 0.0 || b > 1.0) clipped = true;
-    int Ri = clampInt(int(std::round(r * 255.0)), 0, 255);
-    int Gi = clampInt(int(std::round(g * 255.0)), 0, 255);
-    int Bi = clampInt(int(std::round(b * 255.0)), 0, 255);
-    return { {Ri, Gi, Bi}, clipped };
-}
-
-
-Lab xyzToLab(const XYZ &xyz) {
-    auto f = [](double t)->double {
-        const double thresh = 0.008856;
-        if (t > thresh) return std::cbrt(t);
-        else return (7.787 * t) + (16.0/116.0);
-    };
-
-    double xr = xyz.X / REF_X;
-    double yr = xyz.Y / REF_Y;
-    double zr = xyz.Z / REF_Z;
-
-    double fx = f(xr);
-    double fy = f(yr);
-    double fz = f(zr);
-
-    double L = 116.0 * fy - 16.0;
-    double a = 500.0 * (fx - fy);
-    double b = 200.0 * (fy - fz);
-
-    return {L, a, b};
-}
-
-XYZ labToXyz(const Lab &lab) {
-    double fy = (lab.L + 16.0) / 116.0;
-    double fx = lab.a / 500.0 + fy;
-    double fz = fy - lab.b / 200.0;
-
-    auto invf = [](double t)->double {
-        const double thresh = 0.008856;
-        if (t*t*t > thresh) return t*t*t;
-        else return (t - 16.0/116.0) / 7.787;
-    };
-
-    double xr = invf(fx);
-    double yr = invf(fy);
-    double zr = invf(fz);
-
-    return { xr * REF_X, yr * REF_Y, zr * REF_Z };
-}
-
-Lab rgbToLab(const RGB &rgb) {
-    XYZ xyz = rgbToXyz(rgb);
-    return xyzToLab(xyz);
-}
-
-std::pair<RGB, bool> labToRgb(const Lab &lab) {
-    XYZ xyz = labToXyz(lab);
-    return xyzToRgb(xyz);
-}
-
-}
-
 // ---------------------- MainWindow implementation ----------------------
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -158,12 +27,20 @@ MainWindow::MainWindow(QWidget *parent)
     preview->setFrameShape(QFrame::Box);
 
     btnPaletteRGB = new QPushButton("Выбрать цвет (палитра)");
+    btnSwatches = new QPushButton("Библиотека образцов…");
+    btnSoftProof = new QPushButton("Пробный оттиск изображения…");
+    swatchLabel = new QLabel;
+    swatchLabel->setWordWrap(true);
+    swatchLabel->setFixedWidth(200);
 
     // левая колонка
     QVBoxLayout *leftVBox = new QVBoxLayout;
     leftVBox->addWidget(new QLabel("Цвет"));
     leftVBox->addWidget(preview, 0, Qt::AlignHCenter);
     leftVBox->addWidget(btnPaletteRGB, 0, Qt::AlignHCenter);
+    leftVBox->addWidget(btnSwatches, 0, Qt::AlignHCenter);
+    leftVBox->addWidget(swatchLabel, 0, Qt::AlignHCenter);
+    leftVBox->addWidget(btnSoftProof, 0, Qt::AlignHCenter);
     leftVBox->addStretch();
 
     auto addRowTo = [](QVBoxLayout *target, const QString &label, QSlider *s, QLineEdit *e){
@@ -177,7 +54,7 @@ MainWindow::MainWindow(QWidget *parent)
     };
 
     // ---------- RGB ----------
-    QGroupBox *gRGB = new QGroupBox("RGB (0..255)");
+    gRGB = new QGroupBox("RGB (0..255)");
     sR = new QSlider(Qt::Horizontal); sR->setRange(0,255);
     sG = new QSlider(Qt::Horizontal); sG->setRange(0,255);
     sB = new QSlider(Qt::Horizontal); sB->setRange(0,255);
@@ -191,7 +68,7 @@ MainWindow::MainWindow(QWidget *parent)
     gRGB->setLayout(lg);
 
     // ---------- LAB ----------
-    QGroupBox *gLab = new QGroupBox("LAB (L:0..100, a:-128..127, b:-128..127)");
+    gLab = new QGroupBox("LAB (L:0..100, a:-128..127, b:-128..127)");
     sL = new QSlider(Qt::Horizontal); sL->setRange(0,100);
     sa = new QSlider(Qt::Horizontal); sa->setRange(-128,127);
     sb = new QSlider(Qt::Horizontal); sb->setRange(-128,127);
@@ -202,10 +79,13 @@ MainWindow::MainWindow(QWidget *parent)
     addRowTo(ll,"L",sL,eL);
     addRowTo(ll,"a",sa,ea);
     addRowTo(ll,"b",sb,eb);
+    cbGamutMap = new QCheckBox("Вне охвата RGB — уменьшать хрому, а не обрезать каналы");
+    cbGamutMap->setChecked(true);
+    ll->addWidget(cbGamutMap);
     gLab->setLayout(ll);
 
     // ---------- CMYK ----------
-    QGroupBox *gCmyk = new QGroupBox("CMYK (0..100 %)");
+    gCmyk = new QGroupBox("CMYK (0..100 %)");
     sC = new QSlider(Qt::Horizontal); sC->setRange(0,100);
     sM = new QSlider(Qt::Horizontal); sM->setRange(0,100);
     sY = new QSlider(Qt::Horizontal); sY->setRange(0,100);
@@ -219,8 +99,46 @@ MainWindow::MainWindow(QWidget *parent)
     addRowTo(lc,"M",sM,eM);
     addRowTo(lc,"Y",sY,eY);
     addRowTo(lc,"K",sK,eK);
+    separation = std::make_unique<CmykSeparation>(SeparationParams(), TableBuild::Later);
+    cmykLab = std::make_unique<CmykLabTransform>(cmykToLab, CmykLabTransform::GRID, "cmykToLab",
+                                                 CmykLabTransform::BUILTIN_KEY, TableBuild::Later);
+    cbInkLimit = new QCheckBox(QString("GCR с ограничением TAC %1 %").arg(int(std::round(separation->params().tac * 100))));
+    tacLabel = new QLabel;
+    QHBoxLayout *lt = new QHBoxLayout;
+    lt->addWidget(cbInkLimit);
+    lt->addStretch();
+    lt->addWidget(tacLabel);
+    lc->addLayout(lt);
     gCmyk->setLayout(lc);
 
+    // прямые преобразования; Lab -> CMYK граф строит через RGB
+    spaceRgb = graph.addSpace("RGB");
+    spaceLab = graph.addSpace("Lab");
+    spaceCmyk = graph.addSpace("CMYK");
+    auto toRgb = [](const ColorValue &v){ return RGB{ int(v.c[0]), int(v.c[1]), int(v.c[2]) }; };
+    auto toCmyk = [](const ColorValue &v){ return CMYK{ v.c[0], v.c[1], v.c[2], v.c[3] }; };
+    graph.addConversion(spaceRgb, spaceLab, [toRgb](const ColorValue &v){
+        Lab lab = rgbToLab(toRgb(v));
+        return ColorValue{ { lab.L, lab.a, lab.b, 0.0 } };
+    });
+    graph.addConversion(spaceRgb, spaceCmyk, [this, toRgb](const ColorValue &v){
+        CMYK cmyk = separate(toRgb(v));
+        return ColorValue{ { cmyk.c, cmyk.m, cmyk.y, cmyk.k } };
+    });
+    graph.addConversion(spaceLab, spaceRgb, [this](const ColorValue &v){
+        GamutMapped m = labToRgbMapped({ v.c[0], v.c[1], v.c[2] },
+                                       cbGamutMap->isChecked() ? GamutMapping::Chroma : GamutMapping::Clip);
+        return ColorValue{ { double(m.rgb.r), double(m.rgb.g), double(m.rgb.b), 0.0 }, m.outOfGamut, m.dE };
+    });
+    graph.addConversion(spaceCmyk, spaceRgb, [toCmyk](const ColorValue &v){
+        RGB rgb = cmykToRgb(toCmyk(v));
+        return ColorValue{ { double(rgb.r), double(rgb.g), double(rgb.b), 0.0 } };
+    });
+    graph.addConversion(spaceCmyk, spaceLab, [this, toCmyk](const ColorValue &v){
+        Lab lab = cmykLab->convert(toCmyk(v));
+        return ColorValue{ { lab.L, lab.a, lab.b, 0.0 } };
+    });
+
 
     QVBoxLayout *rightVBox = new QVBoxLayout;
     rightVBox->addWidget(gRGB);
@@ -317,6 +235,20 @@ MainWindow::MainWindow(QWidget *parent)
     connect(eK, &QLineEdit::editingFinished, this, [this](){ if(!internalUpdate) onCmykEditChanged(); });
 
     connect(btnPaletteRGB, &QPushButton::clicked, this, &MainWindow::onOpenColorDialog);
+    connect(btnSwatches, &QPushButton::clicked, this, &MainWindow::onOpenSwatchLibrary);
+    connect(btnSoftProof, &QPushButton::clicked, this, &MainWindow::onSoftProofImage);
+    connect(cbInkLimit, &QCheckBox::toggled, this, [this](bool){
+        // другое цветоделение: CMYK пересчитается из заданного цвета; если задан
+        // сам CMYK, invalidate ничего не делает. Источник не трогаем — иначе
+        // набранные Lab/CMYK заменились бы 8-битным RGB со слайдеров
+        graph.invalidate(spaceCmyk);
+        refreshViews();
+    });
+    connect(cbGamutMap, &QCheckBox::toggled, this, [this](bool){
+        // другой перевод Lab -> RGB; важен, только когда цвет задан в Lab
+        graph.invalidate(spaceRgb);
+        refreshViews();
+    });
 
     // цвет по умолчанию - белый
     setInternalUpdate(true);
@@ -328,7 +260,49 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow() {}
 
+void MainWindow::warmUpTables(TableBuild build) {
+    warmUpTimer.start();
+    separation->buildTables(build);
+    cmykLab->buildTables(build);
+
+    // о готовности фоновых таблиц узнаём опросом, чтобы не трогать виджеты из чужого потока
+    QTimer *poll = new QTimer(this);
+    connect(poll, &QTimer::timeout, this, [this, poll](){
+        if (!separation->tablesReady() || !cmykLab->tablesReady()) return;
+        poll->deleteLater();
+        qInfo().noquote() << QString("tables ready: %1 ms").arg(warmUpTimer.elapsed());
+        for (const LutCache::Metric &m : LutCache::metrics())
+            qInfo().noquote() << QString("  %1: %2 KB, %3 %4 ms")
+                                 .arg(QString::fromStdString(m.name)).arg(m.bytes / 1024)
+                                 .arg(m.fromCache ? "load" : "build")
+                                 .arg(m.fromCache ? m.loadMs : m.buildMs + m.loadMs, 0, 'f', 2);
+    });
+    poll->start(10);
+}
+
+void MainWindow::logFirstDrag(const QElapsedTimer &timer) {
+    if (firstDragLogged) return;
+    firstDragLogged = true;
+    qInfo().noquote() << QString("first drag: %1 ms (tables %2)")
+                         .arg(timer.nsecsElapsed() / 1e6, 0, 'f', 3)
+                         .arg(cmykLab->tablesReady() ? "ready" : "not ready, exact path");
+}
+
+CMYK MainWindow::separate(const RGB &rgb) const {
+    return cbInkLimit->isChecked() ? separation->separate(rgb) : rgbToCmyk(rgb);
+}
+
+void MainWindow::showTac(const CMYK &cmyk) {
+    double tac = totalAreaCoverage(cmyk);
+    tacLabel->setText(QString("TAC: %1 %").arg(int(std::round(tac * 100))));
+    // сравниваем в целых процентах, как показано пользователю
+    bool over = std::round(tac * 100) > std::round(separation->params().tac * 100);
+    tacLabel->setStyleSheet(over ? "color: red; font-weight: bold;" : "");
+}
+
 void MainWindow::onRgbSliderChanged() {
+    QElapsedTimer timer;
+    timer.start();
     int r = sR->value(), g = sG->value(), b = sB->value();
     setInternalUpdate(true);
     eR->setText(QString::number(r));
@@ -336,6 +310,7 @@ void MainWindow::onRgbSliderChanged() {
     eB->setText(QString::number(b));
     setInternalUpdate(false);
     setFromRGB(r,g,b);
+    logFirstDrag(timer);
 }
 
 void MainWindow::onRgbEditChanged() {
@@ -347,6 +322,8 @@ void MainWindow::onRgbEditChanged() {
 }
 
 void MainWindow::onLabSliderChanged() {
+    QElapsedTimer timer;
+    timer.start();
     double L = sL->value(), a = sa->value(), b = sb->value();
     setInternalUpdate(true);
     eL->setText(QString::number(int(std::round(L))));
@@ -354,6 +331,7 @@ void MainWindow::onLabSliderChanged() {
     eb->setText(QString::number(int(std::round(b))));
     setInternalUpdate(false);
     setFromLab(L,a,b);
+    logFirstDrag(timer);
 }
 
 void MainWindow::onLabEditChanged() {
@@ -365,6 +343,8 @@ void MainWindow::onLabEditChanged() {
 }
 
 void MainWindow::onCmykSliderChanged() {
+    QElapsedTimer timer;
+    timer.start();
     double c = sC->value()/100.0, m = sM->value()/100.0, y = sY->value()/100.0, k = sK->value()/100.0;
     setInternalUpdate(true);
     eC->setText(QString::number(sC->value()));
@@ -373,6 +353,7 @@ void MainWindow::onCmykSliderChanged() {
     eK->setText(QString::number(sK->value()));
     setInternalUpdate(false);
     setFromCmyk(c,m,y,k);
+    logFirstDrag(timer);
 }
 
 void MainWindow::onCmykEditChanged() {
@@ -394,49 +375,152 @@ void MainWindow::onOpenColorDialog() {
     setFromRGB(r,g,b);
 }
 
+void MainWindow::onOpenSwatchLibrary() {
+    QString path = QFileDialog::getOpenFileName(this, "Библиотека образцов", QString(), "Библиотеки образцов (*.swl)");
+    if (path.isEmpty()) return;
+    auto library = std::make_unique<SwatchLibrary>();
+    std::string error;
+    if (!library->open(QDir::toNativeSeparators(path).toStdString(), &error) || library->size() == 0) {
+        QMessageBox::warning(this, "Библиотека образцов",
+                             error.empty() ? QString("В библиотеке нет образцов.") : QString::fromStdString(error));
+        return;
+    }
+    swatches = std::move(library);
+    btnSwatches->setToolTip(QString("%1: %2 образцов").arg(QFileInfo(path).fileName()).arg(swatches->size()));
+    shownSwatch = 0;
+    refreshViews();
+}
+
+// Оригинал, оттиск с текущим цветоделением (флажок GCR/TAC) и карта ΔE между ними.
+void MainWindow::onSoftProofImage() {
+    QString path = QFileDialog::getOpenFileName(this, "Пробный оттиск", QString(),
+                                                "Изображения (*.png *.jpg *.jpeg *.bmp *.tif *.tiff)");
+    if (path.isEmpty()) return;
+    QImage src(path);
+    if (src.isNull()) {
+        QMessageBox::warning(this, "Пробный оттиск", "Не удалось открыть " + path);
+        return;
+    }
+    src = src.convertToFormat(QImage::Format_RGB888);
+    QImage proofImage(src.size(), QImage::Format_RGB888), heat(src.size(), QImage::Format_RGB888);
+
+    const bool inkLimit = cbInkLimit->isChecked();
+    SoftProof proof([this, inkLimit](double r, double g, double b){
+        return inkLimit ? separation->separate(r, g, b) : unitRgbToCmyk(r, g, b);
+    }, [this](const CMYK &cmyk){ return cmykLab->convert(cmyk); });
+
+    auto view = [](QImage &img){ return ImageView<uint8_t>(img.bits(), img.width(), img.height(), 3, img.bytesPerLine()); };
+    QElapsedTimer timer;
+    timer.start();
+    SoftProof::Stats st = proof.proofImage(ImageView<const uint8_t>(src.constBits(), src.width(), src.height(), 3, src.bytesPerLine()),
+                                           view(proofImage), view(heat));
+    const qint64 elapsed = timer.elapsed();
+    InkCoverageOptions inkOptions;
+    inkOptions.tac = separation->params().tac;
+    inkOptions.separation = inkLimit ? separation.get() : nullptr;
+    const InkCoverage ink = measureInkCoverage(ImageView<const uint8_t>(src.constBits(), src.width(), src.height(), 3, src.bytesPerLine()),
+                                               inkOptions);
+
+    QDialog *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("Пробный оттиск — " + QFileInfo(path).fileName());
+    QHBoxLayout *images = new QHBoxLayout;
+    auto addImage = [images](const QString &caption, const QImage &img){
+        QVBoxLayout *column = new QVBoxLayout;
+        QLabel *picture = new QLabel;
+        picture->setPixmap(QPixmap::fromImage(img).scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        column->addWidget(new QLabel(caption), 0, Qt::AlignHCenter);
+        column->addWidget(picture, 0, Qt::AlignHCenter);
+        images->addLayout(column);
+    };
+    addImage("Оригинал", src);
+    addImage(inkLimit ? "Оттиск (GCR, TAC)" : "Оттиск", proofImage);
+    addImage("ΔE (синий 0 → красный ≥ 10)", heat);
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+    layout->addLayout(images);
+    layout->addWidget(new QLabel(QString("%1×%2, %3 мс: ΔE средний %4, максимальный %5, больше 2 — %6 % пикселей")
+                                 .arg(src.width()).arg(src.height()).arg(elapsed)
+                                 .arg(st.mean, 0, 'f', 2).arg(st.max, 0, 'f', 2)
+                                 .arg(st.count ? 100.0 * st.over / st.count : 0.0, 0, 'f', 1)));
+    layout->addWidget(new QLabel(QString("Краски: C %1 %, M %2 %, Y %3 %, K %4 %; TAC средний %5 %, максимальный %6 %, больше %7 % — %8 % пикселей")
+                                 .arg(100.0 * ink.mean[0], 0, 'f', 1).arg(100.0 * ink.mean[1], 0, 'f', 1)
+                                 .arg(100.0 * ink.mean[2], 0, 'f', 1).arg(100.0 * ink.mean[3], 0, 'f', 1)
+                                 .arg(100.0 * ink.meanTac, 0, 'f', 0).arg(100.0 * ink.maxTac, 0, 'f', 0)
+                                 .arg(100.0 * inkOptions.tac, 0, 'f', 0)
+                                 .arg(ink.count ? 100.0 * ink.overTac / ink.count : 0.0, 0, 'f', 2)));
+    dialog->show();
+}
+
 
-void MainWindow::setFromRGB(int r, int g, int b) {
-    // preview
-    preview->setStyleSheet(QString("background-color: rgb(%1,%2,%3);").arg(r).arg(g).arg(b));
+bool MainWindow::takeUpdate(int space, const QWidget *view, uint64_t &shown) {
+    if (!view->isVisibleTo(this)) return false;
+    graph.get(space);
+    if (graph.version(space) == shown) return false;
+    shown = graph.version(space);
+    return true;
+}
 
-    RGB rgb{r,g,b};
-    CMYK cmyk = rgbToCmyk(rgb);
-    Lab lab = rgbToLab(rgb);
+// Переписываем только видимые группы и только если значение их узла
+// изменилось с прошлого показа. Виджеты группы-источника уже выставил тот,
+// кто задал значение.
+void MainWindow::refreshViews() {
+    if (takeUpdate(spaceRgb, preview, shownPreview)) {
+        const ColorValue &v = graph.get(spaceRgb);
+        preview->setStyleSheet(QString("background-color: rgb(%1,%2,%3);").arg(int(v.c[0])).arg(int(v.c[1])).arg(int(v.c[2])));
+        if (v.clipped) {
+            warningLabel->setText(QString(cbGamutMap->isChecked()
+                                          ? "Внимание: цвет LAB вне охвата RGB — хрома уменьшена до границы, сдвиг ΔE = %1."
+                                          : "Внимание: при преобразовании LAB → RGB некоторые значения вышли за 0..255 — выполнено обрезание, сдвиг ΔE = %1.")
+                                  .arg(v.moved, 0, 'f', 1));
+        } else {
+            warningLabel->clear();
+        }
+    }
 
     setInternalUpdate(true);
-    sC->setValue(int(std::round(cmyk.c * 100.0)));
-    sM->setValue(int(std::round(cmyk.m * 100.0)));
-    sY->setValue(int(std::round(cmyk.y * 100.0)));
-    sK->setValue(int(std::round(cmyk.k * 100.0)));
-    eC->setText(QString::number(int(std::round(cmyk.c*100))));
-    eM->setText(QString::number(int(std::round(cmyk.m*100))));
-    eY->setText(QString::number(int(std::round(cmyk.y*100))));
-    eK->setText(QString::number(int(std::round(cmyk.k*100))));
+    if (takeUpdate(spaceRgb, gRGB, shownRgb) && graph.source() != spaceRgb) {
+        const ColorValue &v = graph.get(spaceRgb);
+        showRgb({ int(v.c[0]), int(v.c[1]), int(v.c[2]) });
+    }
+    if (takeUpdate(spaceLab, gLab, shownLab) && graph.source() != spaceLab) {
+        const ColorValue &v = graph.get(spaceLab);
+        showLab({ v.c[0], v.c[1], v.c[2] });
+    }
+    if (takeUpdate(spaceCmyk, gCmyk, shownCmyk)) {
+        const ColorValue &v = graph.get(spaceCmyk);
+        CMYK cmyk{ v.c[0], v.c[1], v.c[2], v.c[3] };
+        if (graph.source() != spaceCmyk) showCmyk(cmyk);
+        showTac(cmyk);
+    }
+    setInternalUpdate(false);
+
+    // поиск по индексу библиотеки — микросекунды даже на сотнях тысяч образцов
+    if (swatches && takeUpdate(spaceLab, swatchLabel, shownSwatch)) {
+        const ColorValue &v = graph.get(spaceLab);
+        double dE = 0.0;
+        Swatch s = swatches->at(swatches->nearest({ v.c[0], v.c[1], v.c[2] }, &dE));
+        swatchLabel->setText(QString("<span style=\"background-color: rgb(%1,%2,%3);\">&nbsp;&nbsp;&nbsp;&nbsp;</span> %4<br>ΔE %5")
+                             .arg(s.rgb.r).arg(s.rgb.g).arg(s.rgb.b)
+                             .arg(QString::fromUtf8(s.name.data(), int(s.name.size())).toHtmlEscaped())
+                             .arg(dE, 0, 'f', 2));
+    }
+}
 
+void MainWindow::showRgb(const RGB &rgb) {
+    sR->setValue(rgb.r); sG->setValue(rgb.g); sB->setValue(rgb.b);
+    eR->setText(QString::number(rgb.r)); eG->setText(QString::number(rgb.g)); eB->setText(QString::number(rgb.b));
+}
+
+void MainWindow::showLab(const Lab &lab) {
     sL->setValue(int(std::round(lab.L)));
     sa->setValue(int(std::round(lab.a)));
     sb->setValue(int(std::round(lab.b)));
     eL->setText(QString::number(int(std::round(lab.L))));
     ea->setText(QString::number(int(std::round(lab.a))));
     eb->setText(QString::number(int(std::round(lab.b))));
-    setInternalUpdate(false);
-
-    warningLabel->clear();
 }
 
-void MainWindow::setFromLab(double L, double a_, double b_) {
-    Lab lab{L, a_, b_};
-    auto [rgb, clipped] = labToRgb(lab);
-
-    preview->setStyleSheet(QString("background-color: rgb(%1,%2,%3);").arg(rgb.r).arg(rgb.g).arg(rgb.b));
-
-    CMYK cmyk = rgbToCmyk(rgb);
-
-    setInternalUpdate(true);
-
-    sR->setValue(rgb.r); sG->setValue(rgb.g); sB->setValue(rgb.b);
-    eR->setText(QString::number(rgb.r)); eG->setText(QString::number(rgb.g)); eB->setText(QString::number(rgb.b));
-
+void MainWindow::showCmyk(const CMYK &cmyk) {
     sC->setValue(int(std::round(cmyk.c * 100.0)));
     sM->setValue(int(std::round(cmyk.m * 100.0)));
     sY->setValue(int(std::round(cmyk.y * 100.0)));
@@ -445,34 +529,19 @@ void MainWindow::setFromLab(double L, double a_, double b_) {
     eM->setText(QString::number(int(std::round(cmyk.m*100))));
     eY->setText(QString::number(int(std::round(cmyk.y*100))));
     eK->setText(QString::number(int(std::round(cmyk.k*100))));
-    setInternalUpdate(false);
-
-    if (clipped) {
-        warningLabel->setText("Внимание: при преобразовании LAB → RGB некоторые значения вышли за 0..255 — выполнено обрезание.");
-    } else {
-        warningLabel->clear();
-    }
 }
 
-void MainWindow::setFromCmyk(double c, double m, double y, double k) {
-    CMYK cmyk{c,m,y,k};
-    RGB rgb = cmykToRgb(cmyk);
-    Lab lab = rgbToLab(rgb);
-
-    preview->setStyleSheet(QString("background-color: rgb(%1,%2,%3);").arg(rgb.r).arg(rgb.g).arg(rgb.b));
-
-    setInternalUpdate(true);
-
-    sR->setValue(rgb.r); sG->setValue(rgb.g); sB->setValue(rgb.b);
-    eR->setText(QString::number(rgb.r)); eG->setText(QString::number(rgb.g)); eB->setText(QString::number(rgb.b));
+void MainWindow::setFromRGB(int r, int g, int b) {
+    graph.set(spaceRgb, ColorValue{ { double(r), double(g), double(b), 0.0 } });
+    refreshViews();
+}
 
-    sL->setValue(int(std::round(lab.L)));
-    sa->setValue(int(std::round(lab.a)));
-    sb->setValue(int(std::round(lab.b)));
-    eL->setText(QString::number(int(std::round(lab.L))));
-    ea->setText(QString::number(int(std::round(lab.a))));
-    eb->setText(QString::number(int(std::round(lab.b))));
-    setInternalUpdate(false);
+void MainWindow::setFromLab(double L, double a_, double b_) {
+    graph.set(spaceLab, ColorValue{ { L, a_, b_, 0.0 } });
+    refreshViews();
+}
 
-    warningLabel->clear();
+void MainWindow::setFromCmyk(double c, double m, double y, double k) {
+    graph.set(spaceCmyk, ColorValue{ { c, m, y, k } });
+    refreshViews();
 }
@@ -1,12 +1,25 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QElapsedTimer>
 #include <QMainWindow>
+#include <memory>
+
+#include "background.h"
+#include "colorgraph.h"
 
 class QSlider;
 class QLineEdit;
 class QPushButton;
 class QLabel;
+class QCheckBox;
+class QGroupBox;
+class CmykSeparation;
+class CmykLabTransform;
+class SwatchLibrary;
+struct CMYK;
+struct RGB;
+struct Lab;
 
 class MainWindow : public QMainWindow
 {
@@ -15,6 +28,10 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // Таблицы не строятся в конструкторе, чтобы окно появилось сразу; до их
+    // готовности преобразования идут по точным формулам.
+    void warmUpTables(TableBuild build);
+
 private slots:
     void onRgbSliderChanged();
     void onRgbEditChanged();
@@ -23,9 +40,14 @@ private slots:
     void onCmykSliderChanged();
     void onCmykEditChanged();
     void onOpenColorDialog();
+    void onOpenSwatchLibrary();
+    void onSoftProofImage();
 
 private:
     QWidget *centralWidget;
+    QGroupBox *gRGB;
+    QGroupBox *gLab;
+    QGroupBox *gCmyk;
 
     // RGB
     QSlider *sR;
@@ -35,6 +57,7 @@ private:
     QLineEdit *eG;
     QLineEdit *eB;
     QPushButton *btnPaletteRGB;
+    QPushButton *btnSoftProof;
 
     // LAB
     QSlider *sL;
@@ -53,17 +76,45 @@ private:
     QLineEdit *eM;
     QLineEdit *eY;
     QLineEdit *eK;
+    QCheckBox *cbGamutMap;
+    QCheckBox *cbInkLimit;
+    QLabel *tacLabel;
+    std::unique_ptr<CmykSeparation> separation;
+    std::unique_ptr<CmykLabTransform> cmykLab;
 
     QLabel *preview;
     QLabel *warningLabel;
 
+    // библиотека образцов: ближайший к текущему цвету по ΔE
+    QPushButton *btnSwatches;
+    QLabel *swatchLabel;
+    std::unique_ptr<SwatchLibrary> swatches;
+
     bool internalUpdate = false;
     void setInternalUpdate(bool v) { internalUpdate = v; }
 
+    // метрики запуска: когда готовы таблицы и сколько занял первый сдвиг ползунка
+    QElapsedTimer warmUpTimer;
+    bool firstDragLogged = false;
+    void logFirstDrag(const QElapsedTimer &timer);
+
+
+    // RGB, Lab и CMYK — узлы графа; пересчитывается только то, что показано
+    ColorGraph graph;
+    int spaceRgb, spaceLab, spaceCmyk;
+    // версии узлов, которые сейчас выведены в виджеты
+    uint64_t shownPreview = 0, shownRgb = 0, shownLab = 0, shownCmyk = 0, shownSwatch = 0;
+    bool takeUpdate(int space, const QWidget *view, uint64_t &shown);
+    void refreshViews();
+    void showRgb(const RGB &rgb);
+    void showLab(const Lab &lab);
+    void showCmyk(const CMYK &cmyk);
 
     void setFromRGB(int r, int g, int b);
     void setFromLab(double L, double a, double b);
     void setFromCmyk(double c, double m, double y, double k);
+    CMYK separate(const RGB &rgb) const;
+    void showTac(const CMYK &cmyk);
 };
 
 #endif // MAINWINDOW_H
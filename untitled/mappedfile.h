@@ -0,0 +1,33 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Файл, отображённый в память только для чтения (mmap / MapViewOfFile).
+// Отображение открывается за O(1): страницы подгружаются при первом обращении
+// и делятся между процессами через page cache.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // пустой файл не отображается
+    bool open(const std::string &path);
+
+    const uint8_t *data() const { return base; }
+    std::size_t size() const { return length; }
+
+private:
+    const uint8_t *base = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    void *file = nullptr;       // HANDLE
+    void *mapping = nullptr;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,115 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+thread_local bool insideWorker = false;
+
+class ThreadPool {
+public:
+    ThreadPool() {
+        unsigned n = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 1; i < n; ++i)
+            threads.emplace_back([this]{ workerLoop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto &t : threads) t.join();
+    }
+
+    int size() const { return int(threads.size()) + 1; }
+
+    // false — пул занят заданием другого потока (например, другой стадии конвейера)
+    bool tryRun(int count, int grain, const std::function<void(int,int)> &fn) {
+        std::unique_lock<std::mutex> jobLock(jobMutex, std::try_to_lock);
+        if (!jobLock.owns_lock()) return false;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            jobFn = &fn;
+            jobCount = count;
+            jobGrain = grain;
+            next = 0;
+            busy = int(threads.size());
+            ++generation;
+        }
+        cv.notify_all();
+
+        insideWorker = true;
+        runChunks();
+        insideWorker = false;
+
+        std::unique_lock<std::mutex> lock(m);
+        doneCv.wait(lock, [this]{ return busy == 0; });
+        jobFn = nullptr;
+        return true;
+    }
+
+private:
+    void runChunks() {
+        for (;;) {
+            int begin = next.fetch_add(jobGrain);
+            if (begin >= jobCount) break;
+            (*jobFn)(begin, std::min(jobCount, begin + jobGrain));
+        }
+    }
+
+    void workerLoop() {
+        insideWorker = true;
+        unsigned seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&]{ return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+            }
+            runChunks();
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (--busy == 0) doneCv.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex jobMutex;
+    std::mutex m;
+    std::condition_variable cv, doneCv;
+    const std::function<void(int,int)> *jobFn = nullptr;
+    int jobCount = 0, jobGrain = 1, busy = 0;
+    std::atomic<int> next{0};
+    unsigned generation = 0;
+    bool stop = false;
+};
+
+ThreadPool &pool() {
+    static ThreadPool p;
+    return p;
+}
+
+}
+
+int workerCount() {
+    return pool().size();
+}
+
+void parallelFor(int count, int grain, const std::function<void(int, int)> &fn) {
+    if (count <= 0) return;
+    grain = std::max(1, grain);
+    // пока пул занят, вызывающий поток не ждёт его, а работает сам
+    if (insideWorker || count <= grain || pool().size() == 1 || !pool().tryRun(count, grain, fn)) {
+        for (int b = 0; b < count; b += grain) fn(b, std::min(count, b + grain));
+    }
+}
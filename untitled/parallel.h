@@ -0,0 +1,18 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+// Число строк изображения, которое поток берёт за раз.
+const int ROWS_PER_TASK = 16;
+
+// Число потоков пула (включая вызывающий).
+int workerCount();
+
+// Делит [0, count) на куски по grain элементов и выполняет fn(begin, end)
+// на общем пуле потоков. Возвращает управление, когда все куски готовы.
+// Вложенные вызовы из рабочих потоков выполняются последовательно, как и вызовы
+// из другого потока, пока пул занят (стадии конвейера не ждут друг друга).
+void parallelFor(int count, int grain, const std::function<void(int, int)> &fn);
+
+#endif // PARALLEL_H
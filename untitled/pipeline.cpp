@@ -0,0 +1,17 @@
+#include "pipeline.h"
+#include "simdpixels.h"
+
+
+void pipelineBackOff(int &spins) {
+    // очередь обычно освобождается за микросекунды — первые попытки без системных вызовов
+    if (spins < 64) {
+#ifdef COLOR_SSE2
+        _mm_pause();
+#endif
+    } else if (spins < 128) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    ++spins;
+}
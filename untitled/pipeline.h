@@ -0,0 +1,179 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Ограниченная очередь без блокировок: один поток кладёт, один забирает.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : slots(capacity + 1) {}
+
+    bool tryPush(const T &v) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        const std::size_t n = t + 1 == slots.size() ? 0 : t + 1;
+        if (n == head.load(std::memory_order_acquire)) return false;
+        slots[t] = v;
+        tail.store(n, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &v) {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        v = slots[h];
+        head.store(h + 1 == slots.size() ? 0 : h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots;
+    // голова и хвост в разных строках кэша — потоки не мешают друг другу
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+struct StageStats {
+    std::size_t items = 0;
+    double busy = 0.0;          // секунды внутри функции стадии
+    double waitInput = 0.0;     // ждала предыдущую стадию
+    double waitOutput = 0.0;    // ждала свободный буфер (подпор от следующей)
+};
+
+struct PipelineStats {
+    double seconds = 0.0;
+    StageStats stages[3];       // чтение, перевод, запись
+    bool failed = false;        // стадия вернула ошибку, конвейер остановлен
+    int failedStage = -1;       // первая отказавшая стадия (0..2)
+    std::string error;          // её сообщение
+
+    double utilisation(int stage) const { return seconds > 0.0 ? stages[stage].busy / seconds : 0.0; }
+};
+
+// Что вернула стадия чтения: очередной буфер, конец входа или ошибку.
+enum class Decoded { Item, End, Failed };
+
+// Ожидание в очереди: сначала крутимся, потом уступаем процессор, потом спим.
+void pipelineBackOff(int &spins);
+
+// Три стадии в трёх потоках (запись — в вызывающем), между ними по depth буферов
+// In и Out, которые ходят по кругу: заполненные вперёд, свободные назад. Когда
+// свободных нет, стадия ждёт — так медленная запись сдерживает чтение, а память
+// не растёт. decode возвращает Decoded::End, когда вход кончился. Ошибка любой
+// стадии (Decoded::Failed, false от convert или encode, текст — в error)
+// останавливает весь конвейер; в результате — failed и стадия с её сообщением.
+// Время работы ограничено самой медленной стадией, а не суммой всех трёх.
+template<typename In, typename Out>
+PipelineStats runPipeline(int depth, const std::function<Decoded(In &, std::string *)> &decode,
+                          const std::function<bool(In &, Out &, std::string *)> &convert,
+                          const std::function<bool(Out &, std::string *)> &encode)
+{
+    using Clock = std::chrono::steady_clock;
+    auto since = [](Clock::time_point t){ return std::chrono::duration<double>(Clock::now() - t).count(); };
+
+    const std::size_t n = std::size_t(depth > 0 ? depth : 1);
+    std::vector<In> ins(n);
+    std::vector<Out> outs(n);
+    // в полные очереди кроме буферов попадает ещё конец потока (nullptr)
+    BoundedQueue<In *> freeIn(n), fullIn(n + 1);
+    BoundedQueue<Out *> freeOut(n), fullOut(n + 1);
+    for (In &x : ins) freeIn.tryPush(&x);
+    for (Out &x : outs) freeOut.tryPush(&x);
+    std::atomic<bool> stop{false};
+    // первая ошибка выигрывает; сообщения у каждой стадии свои, без гонки
+    std::atomic<int> failedStage{-1};
+    std::string errors[3];
+    auto fail = [&](int stage){
+        int none = -1;
+        failedStage.compare_exchange_strong(none, stage);
+        stop = true;
+    };
+
+    // после остановки стадия больше ничего не берёт, даже если в очереди что-то есть
+    auto pop = [&](auto &q, auto &item, double &waited){
+        const Clock::time_point t = Clock::now();
+        for (int spins = 0; ; pipelineBackOff(spins)) {
+            if (stop.load(std::memory_order_relaxed)) return false;
+            if (q.tryPop(item)) break;
+        }
+        waited += since(t);
+        return true;
+    };
+    // места в очереди всегда хватает: буферов не больше её ёмкости
+    auto push = [](auto &q, auto item){ for (int spins = 0; !q.tryPush(item); ) pipelineBackOff(spins); };
+
+    PipelineStats stats;
+    const Clock::time_point start = Clock::now();
+
+    std::thread decoder([&]{
+        StageStats &s = stats.stages[0];
+        for (;;) {
+            In *x;
+            if (!pop(freeIn, x, s.waitOutput)) return;
+            const Clock::time_point t = Clock::now();
+            const Decoded r = decode(*x, &errors[0]);
+            s.busy += since(t);
+            if (r == Decoded::Failed) {
+                fail(0);
+                return;
+            }
+            if (r == Decoded::End) break;
+            ++s.items;
+            push(fullIn, x);
+        }
+        push(fullIn, static_cast<In *>(nullptr));
+    });
+
+    std::thread converter([&]{
+        StageStats &s = stats.stages[1];
+        for (;;) {
+            In *x;
+            Out *y;
+            if (!pop(fullIn, x, s.waitInput)) return;
+            if (!x) break;
+            if (!pop(freeOut, y, s.waitOutput)) return;
+            const Clock::time_point t = Clock::now();
+            const bool ok = convert(*x, *y, &errors[1]);
+            s.busy += since(t);
+            push(freeIn, x);
+            if (!ok) {
+                fail(1);
+                return;
+            }
+            ++s.items;
+            push(fullOut, y);
+        }
+        push(fullOut, static_cast<Out *>(nullptr));
+    });
+
+    StageStats &s = stats.stages[2];
+    for (;;) {
+        Out *y;
+        if (!pop(fullOut, y, s.waitInput) || !y) break;
+        const Clock::time_point t = Clock::now();
+        const bool ok = encode(*y, &errors[2]);
+        s.busy += since(t);
+        push(freeOut, y);
+        if (!ok) {
+            fail(2);
+            break;
+        }
+        ++s.items;
+    }
+    stop = true;
+    decoder.join();
+    converter.join();
+    stats.seconds = since(start);
+    stats.failedStage = failedStage.load();
+    stats.failed = stats.failedStage >= 0;
+    if (stats.failed) stats.error = errors[stats.failedStage];
+    return stats;
+}
+
+#endif // PIPELINE_H
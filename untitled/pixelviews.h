@@ -0,0 +1,211 @@
+#ifndef PIXELVIEWS_H
+#define PIXELVIEWS_H
+
+#include "arena.h"
+#include "batchconvert.h"
+#include "colormodels.h"
+#include "imagebuffer.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Ленивые цепочки над изображением в духе диапазонов C++20 (проект на C++17):
+//
+//     using namespace PixelViews;
+//     Summary s = summarize(pixels(image) | toXyz() | toLab() | deltaE(ref));
+//
+// Цепочка только запоминает шаги. Считается она в терминальной операции
+// (forEachChunk, writeTo, summarize) кусками по CHUNK пикселей строки: кусок
+// проходит все шаги через буферы арены, не выходя из кэша, так что промежуточных
+// плоскостей на всё изображение нет. Каждый шаг — вызов пакетного ядра из batchconvert.
+namespace PixelViews {
+
+const int CHUNK = 256;
+
+// Кусок значений; channels > 1 только у исходных отсчётов изображения.
+template<typename T>
+struct Span {
+    const T *data;
+    std::size_t count;
+    int channels;
+};
+
+// Шаги: Out — тип результата, operator() считает один кусок.
+struct ToXyz {
+    using Out = XYZ;
+    void operator()(const Span<uint8_t> &in, XYZ *out) const { rgbToXyzBatch(in.data, in.channels, out, in.count); }
+    void operator()(const Span<uint16_t> &in, XYZ *out) const { rgb16ToXyzBatch(in.data, in.channels, out, in.count); }
+};
+
+struct ToLab {
+    using Out = Lab;
+    void operator()(const Span<XYZ> &in, Lab *out) const { xyzToLabBatch(in.data, out, in.count); }
+};
+
+struct ToLab8 {
+    using Out = Lab8;
+    void operator()(const Span<XYZ> &in, Lab8 *out) const { xyzToLab8Batch(in.data, out, in.count); }
+};
+
+struct ToLab16 {
+    using Out = Lab16;
+    void operator()(const Span<XYZ> &in, Lab16 *out) const { xyzToLab16Batch(in.data, out, in.count); }
+};
+
+struct DeltaE {
+    using Out = double;
+    Lab ref;
+    void operator()(const Span<Lab> &in, double *out) const { deltaEBatch(in.data, ref, out, in.count); }
+};
+
+// произвольный поэлементный шаг: fn(const In &) -> Out; на исходных отсчётах
+// берётся первый канал пикселя, все каналы видит mapPixel
+template<typename In, typename O, typename Fn>
+struct Map {
+    using Out = O;
+    Fn fn;
+    void operator()(const Span<In> &in, O *out) const {
+        const std::size_t step = std::size_t(in.channels);
+        for (std::size_t i = 0; i < in.count; ++i) out[i] = fn(in.data[i * step]);
+    }
+};
+
+// шаг по пикселям источника: fn(const In *pixel) -> Out, pixel — channels отсчётов
+template<typename In, typename O, typename Fn>
+struct MapPixel {
+    using Out = O;
+    Fn fn;
+    void operator()(const Span<In> &in, O *out) const {
+        const std::size_t step = std::size_t(in.channels);
+        for (std::size_t i = 0; i < in.count; ++i) out[i] = fn(in.data + i * step);
+    }
+};
+
+inline ToXyz toXyz() { return {}; }
+inline ToLab toLab() { return {}; }
+inline ToLab8 toLab8() { return {}; }
+inline ToLab16 toLab16() { return {}; }
+inline DeltaE deltaE(const Lab &ref) { return { ref }; }
+template<typename In, typename Fn>
+Map<In, std::invoke_result_t<Fn, const In &>, Fn> map(Fn fn) { return { fn }; }
+template<typename In, typename Fn>
+MapPixel<In, std::invoke_result_t<Fn, const In *>, Fn> mapPixel(Fn fn) { return { fn }; }
+
+// тип результата последнего шага цепочки
+template<typename T, typename... Steps>
+struct LastOut { using type = T; };
+template<typename T, typename S, typename... Rest>
+struct LastOut<T, S, Rest...> { using type = typename LastOut<typename S::Out, Rest...>::type; };
+
+// Источник и шаги; ничего не считает до терминальной операции.
+template<typename T, typename... Steps>
+struct View {
+    using Out = typename LastOut<T, Steps...>::type;
+    ImageView<const T> image;
+    std::tuple<Steps...> steps;
+};
+
+template<typename T>
+View<std::remove_const_t<T>> pixels(const ImageView<T> &image) { return { image, {} }; }
+
+template<typename T, typename... Steps, typename Step>
+View<T, Steps..., Step> operator|(const View<T, Steps...> &v, Step step) {
+    return { v.image, std::tuple_cat(v.steps, std::make_tuple(std::move(step))) };
+}
+
+namespace detail {
+
+template<std::size_t I, typename Tuple, typename In, typename Sink>
+void runChunk(const Tuple &steps, void *const *buffers, const Span<In> &in, Sink &sink) {
+    if constexpr (I == std::tuple_size_v<Tuple>) {
+        sink(in);
+    } else {
+        using Out = typename std::tuple_element_t<I, Tuple>::Out;
+        Out *out = static_cast<Out *>(buffers[I]);
+        std::get<I>(steps)(in, out);
+        runChunk<I + 1>(steps, buffers, Span<Out>{ out, in.count, 1 }, sink);
+    }
+}
+
+// строки y0..y1; sink(const Span<Out> &, int y, int x) получает результаты кусков
+template<typename T, typename... Steps, typename Sink>
+void evaluateRows(const View<T, Steps...> &v, int y0, int y1, Sink sink) {
+    ArenaScope scratch;
+    void *buffers[sizeof...(Steps) + 1] = {};
+    std::size_t i = 0;
+    ((buffers[i++] = scratch.allocate<typename Steps::Out>(CHUNK)), ...);
+    (void)i;
+
+    const int ch = v.image.channels;
+    for (int y = y0; y < y1; ++y) {
+        for (int x = 0; x < v.image.width; x += CHUNK) {
+            int n = std::min(CHUNK, v.image.width - x);
+            auto toSink = [&](const auto &out){ sink(out, y, x); };
+            runChunk<0>(v.steps, buffers, Span<T>{ v.image.row(y) + std::ptrdiff_t(x) * ch, std::size_t(n), ch }, toSink);
+        }
+    }
+}
+
+}
+
+// Последовательный обход: fn(const Out *values, std::size_t n, int y, int x).
+template<typename V, typename Fn>
+void forEachChunk(const V &v, Fn fn) {
+    detail::evaluateRows(v, 0, v.image.height, [&](const auto &out, int y, int x){ fn(out.data, out.count, y, x); });
+}
+
+// Результат в изображение того же размера (по одному элементу Out на пиксель); строки параллельно.
+template<typename V>
+void writeTo(const V &v, const ImageView<typename V::Out> &dst) {
+    parallelFor(v.image.height, ROWS_PER_TASK, [&](int y0, int y1){
+        detail::evaluateRows(v, y0, y1, [&](const auto &out, int y, int x){
+            std::copy(out.data, out.data + out.count, dst.row(y) + x);
+        });
+    });
+}
+
+// Сводка по скалярной цепочке (например, ΔE): строки параллельно.
+struct Summary {
+    std::size_t count = 0;
+    std::size_t over = 0;    // значений больше порога
+    double sum = 0.0;
+    double max = 0.0;
+    double mean() const { return count ? sum / double(count) : 0.0; }
+};
+
+template<typename V>
+Summary summarize(const V &v, double threshold = 0.0) {
+    static_assert(std::is_arithmetic_v<typename V::Out>, "summarize нужна скалярная цепочка");
+    ArenaScope scratch;
+    Summary *perRow = scratch.allocate<Summary>(std::size_t(std::max(0, v.image.height)));
+    parallelFor(v.image.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y) perRow[y] = Summary();
+        detail::evaluateRows(v, y0, y1, [&](const auto &out, int y, int){
+            Summary &s = perRow[y];
+            for (std::size_t i = 0; i < out.count; ++i) {
+                double d = double(out.data[i]);
+                s.sum += d;
+                s.max = std::max(s.max, d);
+                s.over += d > threshold ? 1 : 0;
+            }
+            s.count += out.count;
+        });
+    });
+    Summary total;
+    for (int y = 0; y < v.image.height; ++y) {
+        total.count += perRow[y].count;
+        total.over += perRow[y].over;
+        total.sum += perRow[y].sum;
+        total.max = std::max(total.max, perRow[y].max);
+    }
+    return total;
+}
+
+}
+
+#endif // PIXELVIEWS_H
@@ -0,0 +1,131 @@
+#include "separation.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+const int CURVE_SIZE = 1024;
+// UCR: насыщенность (max - min из C0, M0, Y0), на которой чёрный пропадает совсем
+const double UCR_NEUTRAL_RANGE = 0.3;
+
+// CMY без чёрного -> CMYK с заданным K; RGB = (1 - C)(1 - K) при этом не меняется
+CMYK withBlack(double c0, double m0, double y0, double k) {
+    if (k >= 1.0 - 1e-12) return {0.0, 0.0, 0.0, 1.0};
+    double s = 1.0 / (1.0 - k);
+    return { std::max(0.0, (c0 - k) * s), std::max(0.0, (m0 - k) * s), std::max(0.0, (y0 - k) * s), k };
+}
+
+}
+
+CmykSeparation::CmykSeparation(const SeparationParams &params, TableBuild build)
+    : p(params), blackCurve(CURVE_SIZE + 1)
+{
+    const double start = std::clamp(p.blackStart, 0.0, 0.999);
+    for (int i = 0; i <= CURVE_SIZE; ++i) {
+        double gray = double(i) / CURVE_SIZE;
+        double t = std::clamp((gray - start) / (1.0 - start), 0.0, 1.0);
+        blackCurve[i] = float(std::clamp(p.blackAmount, 0.0, 1.0) * gray * t);
+    }
+    buildTables(build);
+}
+
+void CmykSeparation::buildTables(TableBuild build) {
+    lut.run(build, [this]{
+        uint64_t key = LutCache::hashValue(int(p.method));
+        key = LutCache::hashValue(p.blackStart, key);
+        key = LutCache::hashValue(p.blackAmount, key);
+        key = LutCache::hashValue(p.tac, key);
+        // В узлах храним C(1 - K), M(1 - K), Y(1 - K) и K: у тёмных цветов сами C/M/Y
+        // резко меняются (деление на 1 - K), а эти произведения гладкие и хорошо
+        // интерполируются. Деление выполняется уже после интерполяции.
+        Lut3D t(GRID, 4);
+        t.fillCached("separation", key, [this](double r, double g, double b, float *out){
+            CMYK c = separate(r, g, b);
+            double w = 1.0 - c.k;
+            out[0] = float(c.c * w); out[1] = float(c.m * w); out[2] = float(c.y * w); out[3] = float(c.k);
+        });
+        return t;
+    });
+}
+
+double CmykSeparation::blackFor(double gray) const {
+    double pos = std::clamp(gray, 0.0, 1.0) * CURVE_SIZE;
+    int i = std::min(int(pos), CURVE_SIZE - 1);
+    double f = pos - i;
+    return blackCurve[i] + f * (blackCurve[i + 1] - blackCurve[i]);
+}
+
+CMYK CmykSeparation::separate(const RGB &rgb) const {
+    return separate(rgb.r / 255.0, rgb.g / 255.0, rgb.b / 255.0);
+}
+
+CMYK CmykSeparation::separate(double r, double g, double b) const {
+    const double c0 = 1.0 - r, m0 = 1.0 - g, y0 = 1.0 - b;
+    const double gray = std::min({c0, m0, y0});
+    double k = blackFor(gray);
+    if (p.method == SeparationParams::Method::UCR) {
+        // под-цветовое удаление действует только в нейтральных тонах:
+        // с насыщенностью чёрный убывает и у насыщенных цветов равен нулю
+        double chroma = std::max({c0, m0, y0}) - gray;
+        k *= std::clamp(1.0 - chroma / UCR_NEUTRAL_RANGE, 0.0, 1.0);
+    }
+    k = std::min(k, gray);
+
+    CMYK res = withBlack(c0, m0, y0, k);
+    if (totalAreaCoverage(res) <= p.tac) return res;
+
+    // сначала добавляем чёрный вплоть до полной замены серой составляющей
+    CMYK full = withBlack(c0, m0, y0, gray);
+    if (totalAreaCoverage(full) <= p.tac) {
+        double lo = k, hi = gray;
+        for (int it = 0; it < 30; ++it) {
+            double mid = 0.5 * (lo + hi);
+            if (totalAreaCoverage(withBlack(c0, m0, y0, mid)) > p.tac) lo = mid;
+            else hi = mid;
+        }
+        return withBlack(c0, m0, y0, hi);
+    }
+
+    // этого мало — пропорционально уменьшаем цветные краски
+    double cmy = full.c + full.m + full.y;
+    double s = cmy > 0.0 ? std::max(0.0, p.tac - full.k) / cmy : 0.0;
+    return { full.c * s, full.m * s, full.y * s, std::min(full.k, p.tac) };
+}
+
+void CmykSeparation::separateBatch(const uint8_t *rgb, int channels, CMYK *cmyk, std::size_t count) const {
+    const Lut3D *t = lut.get();
+    if (!t) {
+        for (std::size_t i = 0; i < count; ++i, rgb += channels)
+            cmyk[i] = separate(rgb[0] / 255.0, rgb[1] / 255.0, rgb[2] / 255.0);
+        return;
+    }
+    const std::size_t BLOCK = 256;
+    const float tac = float(p.tac);
+    float v[BLOCK * 4];
+    for (std::size_t i0 = 0; i0 < count; i0 += BLOCK) {
+        std::size_t m = std::min(BLOCK, count - i0);
+        t->lookup8(rgb + i0 * channels, channels, v, m);
+        for (std::size_t i = 0; i < m; ++i) {
+            const float *q = v + 4 * i;
+            float inv = q[3] < 1.0f - 1e-6f ? 1.0f / (1.0f - q[3]) : 0.0f;
+            float c = std::min(1.0f, q[0] * inv), mg = std::min(1.0f, q[1] * inv), y = std::min(1.0f, q[2] * inv);
+            // интерполяция между узлами может слегка превысить предел
+            float cmy = c + mg + y;
+            if (cmy + q[3] > tac && cmy > 0.0f) {
+                float s = std::max(0.0f, tac - q[3]) / cmy;
+                c *= s; mg *= s; y *= s;
+            }
+            cmyk[i0 + i] = { c, mg, y, q[3] };
+        }
+    }
+}
+
+void CmykSeparation::separateImage(const ImageView<const uint8_t> &rgb, const ImageView<CMYK> &cmyk) const {
+    parallelFor(rgb.height, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y)
+            separateBatch(rgb.row(y), rgb.channels, cmyk.row(y), std::size_t(rgb.width));
+    });
+}
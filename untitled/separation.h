@@ -0,0 +1,55 @@
+#ifndef SEPARATION_H
+#define SEPARATION_H
+
+#include "background.h"
+#include "colormodels.h"
+#include "imagebuffer.h"
+#include "lut.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Параметры цветоделения с генерацией чёрного и ограничением суммы красок.
+struct SeparationParams {
+    // UCR — чёрный только в почти нейтральных тонах, GCR — и в насыщенных тёмных
+    enum class Method { UCR, GCR };
+
+    Method method = Method::GCR;
+    double blackStart = 0.2;    // с какой серой составляющей (0..1) начинается чёрный
+    double blackAmount = 1.0;   // доля серой составляющей, уходящая в K в самых тёмных тонах
+    double tac = 3.0;           // предел C+M+Y+K (3.0 = 300 %)
+};
+
+static inline double totalAreaCoverage(const CMYK &c) { return c.c + c.m + c.y + c.k; }
+
+// Цветоделение RGB -> CMYK по кривой чёрного (1D) с UCR/GCR и пределом TAC.
+// Одиночные цвета считаются точно по кривым, пакетные — через 3D-таблицу
+// с тетраэдрической интерполяцией; пока таблица не готова, тоже точно.
+class CmykSeparation {
+public:
+    static const int GRID = 33;
+
+    explicit CmykSeparation(const SeparationParams &params = SeparationParams(),
+                            TableBuild build = TableBuild::Now);
+
+    void buildTables(TableBuild build);
+    bool tablesReady() const { return lut.get() != nullptr; }
+
+    const SeparationParams &params() const { return p; }
+
+    CMYK separate(const RGB &rgb) const;
+    CMYK separate(double r, double g, double b) const;   // sRGB 0..1
+
+    void separateBatch(const uint8_t *rgb, int channels, CMYK *cmyk, std::size_t count) const;
+    void separateImage(const ImageView<const uint8_t> &rgb, const ImageView<CMYK> &cmyk) const;
+
+private:
+    double blackFor(double gray) const;
+
+    SeparationParams p;
+    std::vector<float> blackCurve;   // K по серой составляющей
+    BackgroundValue<Lut3D> lut;
+};
+
+#endif // SEPARATION_H
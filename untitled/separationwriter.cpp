@@ -0,0 +1,164 @@
+#include "separationwriter.h"
+#include "arena.h"
+#include "batchconvert.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+namespace {
+
+const int TILE = 256;
+const std::size_t PAGE = 4096;
+const std::size_t PLANE_BUFFER = 1 << 20;     // байт на плоскость до записи
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+std::size_t roundUp(std::size_t v, std::size_t to) { return (v + to - 1) / to * to; }
+
+// тайл CMYK8 в четыре строки плоскостей, в кодировке PGM (255 - краска)
+void scatter(const CMYK8 *cmyk, int n, uint8_t *c, uint8_t *m, uint8_t *y, uint8_t *k) {
+    for (int i = 0; i < n; ++i) {
+        c[i] = uint8_t(255 - cmyk[i].c);
+        m[i] = uint8_t(255 - cmyk[i].m);
+        y[i] = uint8_t(255 - cmyk[i].y);
+        k[i] = uint8_t(255 - cmyk[i].k);
+    }
+}
+
+}
+
+const char SeparationWriter::PLANES[4] = { 'C', 'M', 'Y', 'K' };
+
+SeparationWriter::~SeparationWriter() {
+    abandon();
+}
+
+void SeparationWriter::abandon() {
+    for (std::FILE *&f : files) {
+        if (f) std::fclose(f);
+        f = nullptr;
+    }
+}
+
+void SeparationWriter::discard() {
+    abandon();
+    if (toFile)
+        for (const std::string &name : names)
+            if (!name.empty()) std::remove(name.c_str());
+    toFile = false;
+}
+
+bool SeparationWriter::open(const std::array<std::string, 4> &paths, int width, int height,
+                            const CmykSeparation *separation, std::string *error) {
+    abandon();
+    if (width <= 0 || height <= 0) return fail(error, "пустое изображение");
+    this->width = width;
+    this->height = height;
+    this->separation = separation;
+    names = {};
+    toFile = false;
+    rows = 0;
+    filled = 0;
+
+    bufferRows = int(std::max<std::size_t>(1, PLANE_BUFFER / std::size_t(width)));
+    bufferRows = std::min(bufferRows, height);
+    const std::size_t planeBytes = roundUp(std::size_t(bufferRows) * std::size_t(width), PAGE);
+    storage.assign(planeBytes * 4 + PAGE, 0);
+    // начало каждого буфера — на границе страницы
+    uint8_t *base = storage.data() + (PAGE - reinterpret_cast<std::uintptr_t>(storage.data()) % PAGE) % PAGE;
+    for (int p = 0; p < 4; ++p) planes[p] = base + planeBytes * std::size_t(p);
+
+    for (int p = 0; p < 4; ++p) {
+        files[std::size_t(p)] = std::fopen(paths[std::size_t(p)].c_str(), "wb");
+        if (!files[std::size_t(p)]) {
+            discard();
+            return fail(error, "не удалось создать " + paths[std::size_t(p)]);
+        }
+        // в names — только созданные нами файлы: их и удаляет discard
+        names[std::size_t(p)] = paths[std::size_t(p)];
+        toFile = true;
+        // буферы у нас свои, второй слой копирования в stdio не нужен
+        std::setvbuf(files[std::size_t(p)], nullptr, _IONBF, 0);
+        if (std::fprintf(files[std::size_t(p)], "P5\n%d %d\n255\n", width, height) < 0) {
+            discard();
+            return fail(error, "ошибка записи " + paths[std::size_t(p)]);
+        }
+    }
+    return true;
+}
+
+bool SeparationWriter::flush(std::string *error) {
+    const std::size_t bytes = std::size_t(filled) * std::size_t(width);
+    for (int p = 0; p < 4; ++p) {
+        if (std::fwrite(planes[p], 1, bytes, files[std::size_t(p)]) != bytes)
+            return fail(error, "ошибка записи " + names[std::size_t(p)]);
+    }
+    filled = 0;
+    return true;
+}
+
+bool SeparationWriter::add(const ImageView<const uint8_t> &rgb, std::string *error) {
+    if (!files[0]) return fail(error, "файлы цветоделения не открыты");
+    if (rgb.width != width) return fail(error, "ширина полосы не совпадает с изображением");
+    if (rows + rgb.height > height) return fail(error, "строк больше, чем в заголовке");
+
+    for (int y = 0; y < rgb.height; ) {
+        const int n = std::min(rgb.height - y, bufferRows - filled);
+        const int y0 = y, at = filled;
+        parallelFor(n, ROWS_PER_TASK, [&](int r0, int r1){
+            ArenaScope scratch;
+            CMYK8 *cmyk8 = scratch.allocate<CMYK8>(TILE);
+            CMYK *cmyk = separation ? scratch.allocate<CMYK>(TILE) : nullptr;
+            for (int r = r0; r < r1; ++r) {
+                const uint8_t *src = rgb.row(y0 + r);
+                const std::size_t offset = std::size_t(at + r) * std::size_t(width);
+                for (int x0 = 0; x0 < width; x0 += TILE) {
+                    const int m = std::min(TILE, width - x0);
+                    const uint8_t *in = src + std::ptrdiff_t(x0) * rgb.channels;
+                    if (separation) {
+                        separation->separateBatch(in, rgb.channels, cmyk, std::size_t(m));
+                        for (int i = 0; i < m; ++i) cmyk8[i] = encodeCmyk8(cmyk[i]);
+                    } else {
+                        rgbToCmyk8Batch(in, rgb.channels, cmyk8, std::size_t(m));
+                    }
+                    const std::size_t o = offset + std::size_t(x0);
+                    scatter(cmyk8, m, planes[0] + o, planes[1] + o, planes[2] + o, planes[3] + o);
+                }
+            }
+        });
+        y += n;
+        rows += n;
+        filled += n;
+        if (filled == bufferRows && !flush(error)) return false;
+    }
+    return true;
+}
+
+bool SeparationWriter::close(std::string *error) {
+    if (!files[0]) return fail(error, "файлы цветоделения не открыты");
+    if (filled > 0 && !flush(error)) return false;
+    bool ok = rows == height;
+    std::string bad;
+    for (int p = 0; p < 4; ++p) {
+        if (std::fclose(files[std::size_t(p)]) != 0 && bad.empty()) bad = names[std::size_t(p)];
+        files[std::size_t(p)] = nullptr;
+    }
+    if (!bad.empty()) ok = fail(error, "ошибка записи " + bad);
+    else if (!ok) fail(error, "записано строк меньше, чем в заголовке");
+    toFile = !ok;       // готовые файлы discard уже не удалит
+    return ok;
+}
+
+bool writeSeparationPlanes(const ImageView<const uint8_t> &rgb, const std::array<std::string, 4> &paths,
+                           const CmykSeparation *separation, std::string *error) {
+    SeparationWriter writer;
+    if (writer.open(paths, rgb.width, rgb.height, separation, error) && writer.add(rgb, error) && writer.close(error))
+        return true;
+    writer.discard();
+    return false;
+}
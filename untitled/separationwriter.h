@@ -0,0 +1,61 @@
+#ifndef SEPARATIONWRITER_H
+#define SEPARATIONWRITER_H
+
+#include "imagebuffer.h"
+#include "separation.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Запись цветоделения в четыре полутоновых файла PGM (P5), по одному на краску,
+// за один проход по RGB. Строки приходят полосами; каждая полоса переводится
+// в CMYK8 тайлами и сразу раскладывается по буферам плоскостей, буферы
+// (выровнены на страницу, целое число строк) уходят в файлы одним fwrite.
+// Как в разделении каналов в редакторах: 0 — 100 % краски, 255 — бумага.
+class SeparationWriter {
+public:
+    static const char PLANES[4];      // 'C', 'M', 'Y', 'K'
+
+    SeparationWriter() = default;
+    ~SeparationWriter();
+    SeparationWriter(const SeparationWriter &) = delete;
+    SeparationWriter &operator=(const SeparationWriter &) = delete;
+
+    // paths — файлы C, M, Y, K; separation == nullptr — простое rgbToCmyk
+    bool open(const std::array<std::string, 4> &paths, int width, int height,
+              const CmykSeparation *separation = nullptr, std::string *error = nullptr);
+    // очередные строки изображения (8 бит, 3 или 4 канала), строки полосы — параллельно
+    bool add(const ImageView<const uint8_t> &rgb, std::string *error = nullptr);
+    // false, если записаны не все строки или файл не закрылся
+    bool close(std::string *error = nullptr);
+    // бросить запись после ошибки (в том числе после неудачного close): файлы удаляются
+    void discard();
+
+    int rowsWritten() const { return rows; }
+
+private:
+    bool flush(std::string *error);
+    void abandon();
+
+    std::array<std::FILE *, 4> files{};
+    std::array<std::string, 4> names;
+    const CmykSeparation *separation = nullptr;
+    int width = 0;
+    int height = 0;
+    int rows = 0;
+    std::vector<uint8_t> storage;     // четыре буфера плоскостей подряд
+    uint8_t *planes[4] = {};
+    int bufferRows = 0;               // строк в буфере каждой плоскости
+    int filled = 0;
+    bool toFile = false;              // созданные файлы ещё можно удалить
+};
+
+// Всё изображение целиком; paths — как у SeparationWriter::open.
+bool writeSeparationPlanes(const ImageView<const uint8_t> &rgb, const std::array<std::string, 4> &paths,
+                           const CmykSeparation *separation = nullptr, std::string *error = nullptr);
+
+#endif // SEPARATIONWRITER_H
@@ -0,0 +1,169 @@
+#ifndef SIMDPIXELS_H
+#define SIMDPIXELS_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COLOR_SSE2 1
+#endif
+
+// Разбор packed RGB/RGBA (8 бит) на три строки int16 и обратная сборка.
+// Альфа при разборе пропускается, при сборке записывается 255.
+
+#ifdef COLOR_SSE2
+// 16 пикселей RGB: 48 байт -> три регистра по 16 байт (r, g, b)
+static inline void loadDeinterleave3(const uint8_t *p, __m128i &a, __m128i &b, __m128i &c) {
+    __m128i t00 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i t01 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16));
+    __m128i t02 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 32));
+
+    __m128i t10 = _mm_unpacklo_epi8(t00, _mm_unpackhi_epi64(t01, t01));
+    __m128i t11 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t00, t00), t02);
+    __m128i t12 = _mm_unpacklo_epi8(t01, _mm_unpackhi_epi64(t02, t02));
+
+    __m128i t20 = _mm_unpacklo_epi8(t10, _mm_unpackhi_epi64(t11, t11));
+    __m128i t21 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t10, t10), t12);
+    __m128i t22 = _mm_unpacklo_epi8(t11, _mm_unpackhi_epi64(t12, t12));
+
+    __m128i t30 = _mm_unpacklo_epi8(t20, _mm_unpackhi_epi64(t21, t21));
+    __m128i t31 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t20, t20), t22);
+    __m128i t32 = _mm_unpacklo_epi8(t21, _mm_unpackhi_epi64(t22, t22));
+
+    a = _mm_unpacklo_epi8(t30, _mm_unpackhi_epi64(t31, t31));
+    b = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t30, t30), t32);
+    c = _mm_unpacklo_epi8(t31, _mm_unpackhi_epi64(t32, t32));
+}
+
+// 16 пикселей RGBA: 64 байта -> r, g, b
+static inline void loadDeinterleave4(const uint8_t *p, __m128i &a, __m128i &b, __m128i &c) {
+    const __m128i lowByte = _mm_set1_epi32(0xff);
+    __m128i v[4];
+    for (int i = 0; i < 4; ++i) v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * i));
+    __m128i ch[3];
+    for (int k = 0; k < 3; ++k) {
+        __m128i w0 = _mm_and_si128(_mm_srli_epi32(v[0], 8 * k), lowByte);
+        __m128i w1 = _mm_and_si128(_mm_srli_epi32(v[1], 8 * k), lowByte);
+        __m128i w2 = _mm_and_si128(_mm_srli_epi32(v[2], 8 * k), lowByte);
+        __m128i w3 = _mm_and_si128(_mm_srli_epi32(v[3], 8 * k), lowByte);
+        ch[k] = _mm_packus_epi16(_mm_packs_epi32(w0, w1), _mm_packs_epi32(w2, w3));
+    }
+    a = ch[0]; b = ch[1]; c = ch[2];
+}
+
+// r, g, b по 16 байт -> 48 байт RGB
+static inline void storeInterleave3(uint8_t *p, __m128i a, __m128i b, __m128i c) {
+    const __m128i z = _mm_setzero_si128();
+    __m128i ab0 = _mm_unpacklo_epi8(a, b);
+    __m128i ab1 = _mm_unpackhi_epi8(a, b);
+    __m128i c0 = _mm_unpacklo_epi8(c, z);
+    __m128i c1 = _mm_unpackhi_epi8(c, z);
+
+    // 16 слов по 32 бита вида r g b 0
+    __m128i q[4] = { _mm_unpacklo_epi16(ab0, c0), _mm_unpackhi_epi16(ab0, c0),
+                     _mm_unpacklo_epi16(ab1, c1), _mm_unpackhi_epi16(ab1, c1) };
+    // сжатие 4 пикселей по 4 байта в 12 байт внутри каждого регистра
+    const __m128i m0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
+    for (int i = 0; i < 4; ++i) {
+        __m128i x = q[i];
+        q[i] = _mm_or_si128(_mm_or_si128(_mm_and_si128(x, m0),
+                                         _mm_srli_si128(_mm_and_si128(x, _mm_slli_si128(m0, 4)), 1)),
+                            _mm_or_si128(_mm_srli_si128(_mm_and_si128(x, _mm_slli_si128(m0, 8)), 2),
+                                         _mm_srli_si128(_mm_and_si128(x, _mm_slli_si128(m0, 12)), 3)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_or_si128(q[0], _mm_slli_si128(q[1], 12)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 16), _mm_or_si128(_mm_srli_si128(q[1], 4), _mm_slli_si128(q[2], 8)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 32), _mm_or_si128(_mm_srli_si128(q[2], 8), _mm_slli_si128(q[3], 4)));
+}
+
+// r, g, b по 16 байт -> 64 байта RGBA (альфа 255)
+static inline void storeInterleave4(uint8_t *p, __m128i a, __m128i b, __m128i c) {
+    const __m128i ff = _mm_set1_epi8(char(0xff));
+    __m128i ab0 = _mm_unpacklo_epi8(a, b), ab1 = _mm_unpackhi_epi8(a, b);
+    __m128i cf0 = _mm_unpacklo_epi8(c, ff), cf1 = _mm_unpackhi_epi8(c, ff);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi16(ab0, cf0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 16), _mm_unpackhi_epi16(ab0, cf0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 32), _mm_unpacklo_epi16(ab1, cf1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 48), _mm_unpackhi_epi16(ab1, cf1));
+}
+#endif
+
+static inline void deinterleaveRgb8(const uint8_t *src, int channels, int16_t *R, int16_t *G, int16_t *B, int n) {
+    int x = 0;
+#ifdef COLOR_SSE2
+    const __m128i z = _mm_setzero_si128();
+    for (; x + 16 <= n; x += 16) {
+        __m128i r, g, b;
+        if (channels == 4) loadDeinterleave4(src + 4 * x, r, g, b);
+        else loadDeinterleave3(src + 3 * x, r, g, b);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(R + x), _mm_unpacklo_epi8(r, z));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(R + x + 8), _mm_unpackhi_epi8(r, z));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(G + x), _mm_unpacklo_epi8(g, z));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(G + x + 8), _mm_unpackhi_epi8(g, z));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(B + x), _mm_unpacklo_epi8(b, z));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(B + x + 8), _mm_unpackhi_epi8(b, z));
+    }
+#endif
+    for (const uint8_t *p = src + channels * x; x < n; ++x, p += channels) {
+        R[x] = p[0]; G[x] = p[1]; B[x] = p[2];
+    }
+}
+
+// Значения R, G, B должны уже лежать в 0..255.
+static inline void interleaveRgb8(const int16_t *R, const int16_t *G, const int16_t *B, uint8_t *dst, int channels, int n) {
+    int x = 0;
+#ifdef COLOR_SSE2
+    for (; x + 16 <= n; x += 16) {
+        __m128i r = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(R + x)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(R + x + 8)));
+        __m128i g = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(G + x)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(G + x + 8)));
+        __m128i b = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(B + x)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(B + x + 8)));
+        if (channels == 4) storeInterleave4(dst + 4 * x, r, g, b);
+        else storeInterleave3(dst + 3 * x, r, g, b);
+    }
+#endif
+    for (uint8_t *p = dst + channels * x; x < n; ++x, p += channels) {
+        p[0] = uint8_t(R[x]); p[1] = uint8_t(G[x]); p[2] = uint8_t(B[x]);
+        if (channels == 4) p[3] = 255;
+    }
+}
+
+// Перенос строки отсчётов между хранением (uint8/uint16) и рабочим int16.
+// Значения при записи уже должны лежать в допустимом диапазоне.
+static inline void loadSamples(const uint8_t *src, int16_t *dst, int n) {
+    int x = 0;
+#ifdef COLOR_SSE2
+    const __m128i z = _mm_setzero_si128();
+    for (; x + 16 <= n; x += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_unpacklo_epi8(v, z));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 8), _mm_unpackhi_epi8(v, z));
+    }
+#endif
+    for (; x < n; ++x) dst[x] = src[x];
+}
+
+static inline void loadSamples(const uint16_t *src, int16_t *dst, int n) {
+    std::memcpy(dst, src, std::size_t(n) * sizeof(int16_t));
+}
+
+static inline void storeSamples(const int16_t *src, uint8_t *dst, int n) {
+    int x = 0;
+#ifdef COLOR_SSE2
+    for (; x + 16 <= n; x += 16) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x + 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < n; ++x) dst[x] = uint8_t(src[x]);
+}
+
+static inline void storeSamples(const int16_t *src, uint16_t *dst, int n) {
+    std::memcpy(dst, src, std::size_t(n) * sizeof(int16_t));
+}
+
+#endif // SIMDPIXELS_H
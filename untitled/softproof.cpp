@@ -0,0 +1,195 @@
+#include "softproof.h"
+#include "arena.h"
+#include "parallel.h"
+#include "simdpixels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+const int OUTPUTS = 8;
+const int TILE = 256;
+
+static inline uint8_t toByte(float v01) {
+    return uint8_t(std::clamp(int(v01 * 255.0f + 0.5f), 0, 255));
+}
+
+// палитра карты ΔE: синий -> зелёный -> красный
+struct HeatPalette {
+    uint8_t rgb[256][3];
+    HeatPalette() {
+        for (int i = 0; i < 256; ++i) {
+            float t = i / 255.0f;
+            rgb[i][0] = toByte(t < 0.5f ? 0.0f : 2.0f * t - 1.0f);
+            rgb[i][1] = toByte(t < 0.5f ? 2.0f * t : 2.0f - 2.0f * t);
+            rgb[i][2] = toByte(t < 0.5f ? 1.0f - 2.0f * t : 0.0f);
+        }
+    }
+};
+
+// первые три значения v (0..1) в байты
+static inline void storeRgb(const float *v, uint8_t *px) {
+#ifdef COLOR_SSE2
+    // округление и насыщение упаковкой вместо трёх clamp
+    __m128i q = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(v), _mm_set1_ps(255.0f)));
+    q = _mm_packs_epi32(q, q);
+    q = _mm_packus_epi16(q, q);
+    uint32_t bytes = uint32_t(_mm_cvtsi128_si32(q));
+    px[0] = uint8_t(bytes); px[1] = uint8_t(bytes >> 8); px[2] = uint8_t(bytes >> 16);
+#else
+    px[0] = toByte(v[0]); px[1] = toByte(v[1]); px[2] = toByte(v[2]);
+#endif
+}
+
+Lab unitRgbToLab(double r, double g, double b) {
+    return xyzToLab(linearRgbToXyz(invGamma(r), invGamma(g), invGamma(b)));
+}
+
+}
+
+SoftProof::SoftProof(const Separation &separate, const Printer &print, TableBuild build)
+    : separate(separate), print(print)
+{
+    buildTables(build);
+}
+
+SoftProof::SoftProof(const Separation &separate, const Printer &print, const std::string &cacheName,
+                     uint64_t cacheKey, TableBuild build)
+    : separate(separate), print(print), cacheName(cacheName), cacheKey(cacheKey)
+{
+    buildTables(build);
+}
+
+void SoftProof::node(double r, double g, double b, float *out) const {
+    const Lab original = unitRgbToLab(r, g, b);
+    const Lab printed = print(separate(r, g, b));
+    double lr, lg, lb;
+    xyzToLinearRgb(labToXyz(printed), lr, lg, lb);
+    // оттиск вне охвата экрана показываем обрезанным
+    out[0] = float(gammaSRGB(std::clamp(lr, 0.0, 1.0)));
+    out[1] = float(gammaSRGB(std::clamp(lg, 0.0, 1.0)));
+    out[2] = float(gammaSRGB(std::clamp(lb, 0.0, 1.0)));
+    out[3] = 0.0f;
+    out[4] = float(printed.L - original.L);
+    out[5] = float(printed.a - original.a);
+    out[6] = float(printed.b - original.b);
+    out[7] = 0.0f;
+}
+
+void SoftProof::buildTables(TableBuild build) {
+    lut.run(build, [this]{
+        Lut3D t(GRID, OUTPUTS);
+        auto fn = [this](double r, double g, double b, float *out){ node(r, g, b, out); };
+        if (cacheName.empty()) t.fill(fn);
+        else t.fillCached(cacheName, cacheKey, fn);
+        return t;
+    });
+}
+
+RGB SoftProof::proof(const RGB &rgb, double *dE) const {
+    const Lab printed = print(separate(rgb.r / 255.0, rgb.g / 255.0, rgb.b / 255.0));
+    if (dE) *dE = deltaE76(rgbToLab(rgb), printed);
+    return labToRgb(printed).first;
+}
+
+SoftProof::Stats SoftProof::proofImage(const ImageView<const uint8_t> &rgb, const ImageView<uint8_t> &proof,
+                                       const ImageView<uint8_t> &heat, double heatMax, double threshold) const {
+    return run(rgb, proof, heat, ImageView<float>(), heatMax, threshold);
+}
+
+SoftProof::Stats SoftProof::proofDeltaE(const ImageView<const uint8_t> &rgb, const ImageView<uint8_t> &proof,
+                                        const ImageView<float> &dE, double threshold) const {
+    return run(rgb, proof, ImageView<uint8_t>(), dE, 10.0, threshold);
+}
+
+const uint8_t *SoftProof::heatColor(double dE, double heatMax) {
+    static const HeatPalette palette;
+    return palette.rgb[std::clamp(int(dE * 255.0 / std::max(heatMax, 1e-6)), 0, 255)];
+}
+
+SoftProof::Stats SoftProof::run(const ImageView<const uint8_t> &rgb, const ImageView<uint8_t> &proof,
+                                const ImageView<uint8_t> &heat, const ImageView<float> &dEOut, double heatMax,
+                                double threshold) const {
+    const Lut3D *t = lut.get();
+    const float heatScale = float(255.0 / std::max(heatMax, 1e-6));
+    static const HeatPalette palette;
+
+    struct Partial { std::size_t over = 0; double sum = 0.0; float max = 0.0f; };
+    std::vector<Partial> rows(std::size_t(std::max(0, rgb.height)));
+
+    parallelFor(rgb.height, ROWS_PER_TASK, [&](int y0, int y1){
+        ArenaScope scratch;
+        float *v = scratch.allocate<float>(std::size_t(TILE) * OUTPUTS);
+        float *dE = scratch.allocate<float>(TILE);
+        for (int y = y0; y < y1; ++y) {
+            // сумма по строке в локальных: запись байтов через uint8_t * иначе
+            // заставляет компилятор перечитывать их из памяти на каждом пикселе
+            std::size_t over = 0;
+            double sum = 0.0;
+            float maxDe = 0.0f;
+            const uint8_t *src = rgb.row(y);
+            uint8_t *dst = proof.data ? proof.row(y) : nullptr;
+            uint8_t *hm = heat.data ? heat.row(y) : nullptr;
+            float *de = dEOut.data ? dEOut.row(y) : nullptr;
+            for (int x0 = 0; x0 < rgb.width; x0 += TILE) {
+                const int n = std::min(TILE, rgb.width - x0);
+                const uint8_t *in = src + std::ptrdiff_t(x0) * rgb.channels;
+                if (t) {
+                    t->lookup8(in, rgb.channels, v, std::size_t(n));
+                } else {
+                    // таблицы ещё нет — тот же узел, но точно для каждого пикселя
+                    for (int i = 0; i < n; ++i)
+                        node(in[i * rgb.channels] / 255.0, in[i * rgb.channels + 1] / 255.0,
+                             in[i * rgb.channels + 2] / 255.0, v + i * OUTPUTS);
+                }
+                // ΔE тайла: квадраты, затем корни по четыре
+                for (int i = 0; i < n; ++i) {
+                    const float *o = v + i * OUTPUTS;
+                    dE[i] = o[4] * o[4] + o[5] * o[5] + o[6] * o[6];
+                }
+                int i = 0;
+#ifdef COLOR_SSE2
+                for (; i + 4 <= n; i += 4) _mm_storeu_ps(dE + i, _mm_sqrt_ps(_mm_loadu_ps(dE + i)));
+#endif
+                for (; i < n; ++i) dE[i] = std::sqrt(dE[i]);
+                if (de) std::copy(dE, dE + n, de + x0);
+
+                float tileSum = 0.0f;
+                for (i = 0; i < n; ++i) {
+                    const float *o = v + i * OUTPUTS;
+                    const float d = dE[i];
+                    tileSum += d;
+                    maxDe = std::max(maxDe, d);
+                    over += d > threshold ? 1 : 0;
+                    if (dst) {
+                        uint8_t *px = dst + std::ptrdiff_t(x0 + i) * proof.channels;
+                        storeRgb(o, px);
+                        if (proof.channels == 4) px[3] = rgb.channels == 4 ? in[i * 4 + 3] : 255;
+                    }
+                    if (hm) {
+                        uint8_t *px = hm + std::ptrdiff_t(x0 + i) * heat.channels;
+                        const uint8_t *c = palette.rgb[std::min(int(d * heatScale), 255)];
+                        px[0] = c[0]; px[1] = c[1]; px[2] = c[2];
+                        if (heat.channels == 4) px[3] = 255;
+                    }
+                }
+                sum += tileSum;
+            }
+            rows[std::size_t(y)] = { over, sum, maxDe };
+        }
+    });
+
+    Stats s;
+    s.count = std::size_t(std::max(0, rgb.width)) * rows.size();
+    double sum = 0.0;
+    for (const Partial &p : rows) {
+        s.over += p.over;
+        sum += p.sum;
+        s.max = std::max(s.max, double(p.max));
+    }
+    s.mean = s.count ? sum / double(s.count) : 0.0;
+    return s;
+}
@@ -0,0 +1,74 @@
+#ifndef SOFTPROOF_H
+#define SOFTPROOF_H
+
+#include "background.h"
+#include "colormodels.h"
+#include "imagebuffer.h"
+#include "lut.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Пробный оттиск на экране: RGB -> CMYK (цветоделение) -> Lab печати -> RGB.
+// Весь круг вместе с разницей Lab оригинала и оттиска сведён в одну 3D-таблицу
+// (8 выходов: RGB оттиска и ΔL, Δa, Δb), так что изображение проходит за одно
+// чтение таблицы на пиксель, а карта ΔE считается в том же проходе.
+class SoftProof {
+public:
+    static const int GRID = 33;
+    // sRGB 0..1 -> CMYK; например rgbToCmyk или CmykSeparation::separate
+    using Separation = std::function<CMYK(double r, double g, double b)>;
+    // что получится на печати; по умолчанию простая модель cmykToLab
+    using Printer = std::function<Lab(const CMYK &)>;
+
+    struct Stats {
+        std::size_t count = 0;
+        std::size_t over = 0;       // пикселей с ΔE больше порога
+        double mean = 0.0;
+        double max = 0.0;
+    };
+
+    // без кэша: таблица строится заново
+    explicit SoftProof(const Separation &separate, const Printer &print = cmykToLab,
+                       TableBuild build = TableBuild::Now);
+    // cacheName — имя таблицы в LutCache, cacheKey — хэш параметров цветоделения
+    // и печати; по самим функциям его не вывести (как в CmykLabTransform)
+    SoftProof(const Separation &separate, const Printer &print, const std::string &cacheName, uint64_t cacheKey,
+              TableBuild build = TableBuild::Now);
+
+    void buildTables(TableBuild build);
+    bool tablesReady() const { return lut.get() != nullptr; }
+
+    // Точный круг для одного цвета; dE — между оригиналом и оттиском.
+    RGB proof(const RGB &rgb, double *dE = nullptr) const;
+
+    // rgb — 8-битные пиксели (3 или 4 канала). proof и heat (RGB 3 или 4 канала)
+    // можно не задавать (data == nullptr). В heat ΔE от 0 до heatMax идёт
+    // от синего через зелёный к красному.
+    Stats proofImage(const ImageView<const uint8_t> &rgb, const ImageView<uint8_t> &proof,
+                     const ImageView<uint8_t> &heat, double heatMax = 10.0, double threshold = 2.0) const;
+    // То же, но вместо карты цветом — ΔE каждого пикселя (float, 1 канал):
+    // для своей обработки карты, например по соседям (softProofTiled).
+    Stats proofDeltaE(const ImageView<const uint8_t> &rgb, const ImageView<uint8_t> &proof,
+                      const ImageView<float> &dE, double threshold = 2.0) const;
+
+    // цвет карты для ΔE (3 байта): от синего при 0 через зелёный к красному при heatMax
+    static const uint8_t *heatColor(double dE, double heatMax = 10.0);
+
+private:
+    Stats run(const ImageView<const uint8_t> &rgb, const ImageView<uint8_t> &proof, const ImageView<uint8_t> &heat,
+              const ImageView<float> &dE, double heatMax, double threshold) const;
+
+    // 8 выходов узла: R, G, B оттиска (sRGB 0..1), 0, ΔL, Δa, Δb, 0
+    void node(double r, double g, double b, float *out) const;
+
+    Separation separate;
+    Printer print;
+    std::string cacheName;
+    uint64_t cacheKey = 0;
+    BackgroundValue<Lut3D> lut;
+};
+
+#endif // SOFTPROOF_H
@@ -0,0 +1,248 @@
+#include "swatchlibrary.h"
+#include "colorlist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+
+
+struct SwatchRecord {
+    float lab[3];
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    uint8_t rgb[3];
+    uint8_t axis;           // ось разбиения узла: 0 — L, 1 — a, 2 — b
+    CMYK16 cmyk;
+    uint16_t reserved;
+};
+static_assert(sizeof(SwatchRecord) == 32, "запись библиотеки — 32 байта");
+
+namespace {
+
+const uint32_t FORMAT_VERSION = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t formatVersion;
+    uint64_t count;
+    uint64_t recordsOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint64_t reserved[3];
+};
+static_assert(sizeof(Header) == 64, "заголовок библиотеки — 64 байта");
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+// Неявное k-d дерево: корень [lo, hi) — медиана по оси наибольшего разброса.
+void buildTree(SwatchRecord *r, std::size_t lo, std::size_t hi) {
+    if (hi - lo <= 1) {
+        if (hi > lo) r[lo].axis = 0;
+        return;
+    }
+    float mn[3], mx[3];
+    for (int k = 0; k < 3; ++k) mn[k] = mx[k] = r[lo].lab[k];
+    for (std::size_t i = lo + 1; i < hi; ++i)
+        for (int k = 0; k < 3; ++k) {
+            mn[k] = std::min(mn[k], r[i].lab[k]);
+            mx[k] = std::max(mx[k], r[i].lab[k]);
+        }
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+        if (mx[k] - mn[k] > mx[axis] - mn[axis]) axis = k;
+
+    const std::size_t mid = lo + (hi - lo) / 2;
+    std::nth_element(r + lo, r + mid, r + hi, [axis](const SwatchRecord &x, const SwatchRecord &y){
+        return x.lab[axis] < y.lab[axis];
+    });
+    r[mid].axis = uint8_t(axis);
+    buildTree(r, lo, mid);
+    buildTree(r, mid + 1, hi);
+}
+
+struct Best {
+    std::size_t index = 0;
+    float d2 = INFINITY;
+};
+
+void search(const SwatchRecord *r, std::size_t lo, std::size_t hi, const float q[3], Best &best) {
+    while (lo < hi) {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        const SwatchRecord &node = r[mid];
+        const float dL = q[0] - node.lab[0], da = q[1] - node.lab[1], db = q[2] - node.lab[2];
+        const float d2 = dL * dL + da * da + db * db;
+        if (d2 < best.d2) { best.d2 = d2; best.index = mid; }
+
+        const int axis = node.axis < 3 ? node.axis : 0;     // испорченный файл не должен ронять поиск
+        const float diff = q[axis] - node.lab[axis];
+        // сначала сторона запроса, другая — только если шар поиска пересекает плоскость
+        std::size_t nearLo = lo, nearHi = mid, farLo = mid + 1, farHi = hi;
+        if (diff > 0) { std::swap(nearLo, farLo); std::swap(nearHi, farHi); }
+        search(r, nearLo, nearHi, q, best);
+        if (diff * diff >= best.d2) return;
+        lo = farLo;
+        hi = farHi;
+    }
+}
+
+std::string trim(const char *first, const char *last) {
+    while (first < last && (*first == ' ' || *first == '"')) ++first;
+    while (last > first && (last[-1] == ' ' || last[-1] == '"')) --last;
+    return std::string(first, last);
+}
+
+bool toEntry(const char *first, const char *last, SwatchEntry &e) {
+    const char *sep = static_cast<const char *>(std::memchr(first, '\t', std::size_t(last - first)));
+    if (!sep) sep = static_cast<const char *>(std::memchr(first, ',', std::size_t(last - first)));
+    if (!sep) return false;
+    ListSpace space;
+    double v[4];
+    if (!parseColor(sep + 1, last, ListSpace::RGB, space, v)) return false;
+    e.name = trim(first, sep);
+    if (e.name.empty()) return false;
+    switch (space) {
+    case ListSpace::Hex:
+    case ListSpace::RGB:
+        e.rgb = { int(v[0] + 0.5), int(v[1] + 0.5), int(v[2] + 0.5) };
+        e.lab = rgbToLab(e.rgb);
+        e.cmyk = rgbToCmyk(e.rgb);
+        break;
+    case ListSpace::Lab:
+        e.lab = { v[0], v[1], v[2] };
+        e.rgb = labToRgb(e.lab).first;
+        e.cmyk = rgbToCmyk(e.rgb);
+        break;
+    case ListSpace::CMYK:
+        e.cmyk = { v[0] / 100.0, v[1] / 100.0, v[2] / 100.0, v[3] / 100.0 };
+        e.rgb = cmykToRgb(e.cmyk);
+        e.lab = cmykToLab(e.cmyk);
+        break;
+    }
+    return true;
+}
+
+}
+
+bool readSwatchList(const std::string &path, std::vector<SwatchEntry> &entries, std::string *error) {
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) return fail(error, "не удалось открыть " + path);
+    entries.clear();
+    std::string line;
+    char buf[4096];
+    bool eof = false;
+    while (!eof) {
+        // строка целиком, какой бы длинной она ни была
+        line.clear();
+        for (;;) {
+            if (!std::fgets(buf, sizeof(buf), f)) { eof = true; break; }
+            line += buf;
+            if (!line.empty() && line.back() == '\n') break;
+        }
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        SwatchEntry e;
+        if (toEntry(line.data(), line.data() + line.size(), e)) entries.push_back(std::move(e));
+    }
+    const bool readError = std::ferror(f) != 0;
+    std::fclose(f);
+    if (readError) return fail(error, "ошибка чтения " + path);
+    return !entries.empty() || fail(error, "в списке нет ни одного образца");
+}
+
+bool writeSwatchLibrary(const std::string &path, std::vector<SwatchEntry> entries, std::string *error) {
+    if (entries.size() > UINT32_MAX) return fail(error, "слишком много образцов");
+    std::vector<SwatchRecord> records(entries.size());
+    std::string names;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const SwatchEntry &e = entries[i];
+        SwatchRecord &r = records[i];
+        std::memset(&r, 0, sizeof(r));
+        r.lab[0] = float(e.lab.L);
+        r.lab[1] = float(e.lab.a);
+        r.lab[2] = float(e.lab.b);
+        r.nameOffset = uint32_t(names.size());
+        r.nameLength = uint16_t(std::min<std::size_t>(e.name.size(), UINT16_MAX));
+        r.rgb[0] = uint8_t(clampInt(e.rgb.r, 0, 255));
+        r.rgb[1] = uint8_t(clampInt(e.rgb.g, 0, 255));
+        r.rgb[2] = uint8_t(clampInt(e.rgb.b, 0, 255));
+        r.cmyk = encodeCmyk16(e.cmyk);
+        names.append(e.name, 0, r.nameLength);
+        if (names.size() > UINT32_MAX) return fail(error, "слишком длинные имена");
+    }
+    buildTree(records.data(), 0, records.size());
+
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "SWLB", 4);
+    h.formatVersion = FORMAT_VERSION;
+    h.count = records.size();
+    h.recordsOffset = sizeof(Header);
+    h.namesOffset = h.recordsOffset + records.size() * sizeof(SwatchRecord);
+    h.namesSize = names.size();
+
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) return fail(error, "не удалось создать " + path);
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+              std::fwrite(records.data(), sizeof(SwatchRecord), records.size(), f) == records.size() &&
+              std::fwrite(names.data(), 1, names.size(), f) == names.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) {
+        std::remove(path.c_str());
+        return fail(error, "ошибка записи " + path);
+    }
+    return true;
+}
+
+bool SwatchLibrary::open(const std::string &path, std::string *error) {
+    auto m = std::make_unique<MappedFile>();
+    if (!m->open(path)) return fail(error, "не удалось открыть " + path);
+    Header h;
+    if (m->size() < sizeof(h)) return fail(error, "не библиотека образцов: " + path);
+    std::memcpy(&h, m->data(), sizeof(h));
+    if (std::memcmp(h.magic, "SWLB", 4) != 0) return fail(error, "не библиотека образцов: " + path);
+    if (h.formatVersion != FORMAT_VERSION) return fail(error, "неподдерживаемая версия библиотеки: " + path);
+    if (h.recordsOffset != sizeof(Header) || h.count > (m->size() - sizeof(Header)) / sizeof(SwatchRecord) ||
+        h.namesOffset != h.recordsOffset + h.count * sizeof(SwatchRecord) ||
+        h.namesSize != m->size() - h.namesOffset)
+        return fail(error, "повреждённая библиотека образцов: " + path);
+
+    records = reinterpret_cast<const SwatchRecord *>(m->data() + h.recordsOffset);
+    names = reinterpret_cast<const char *>(m->data() + h.namesOffset);
+    count = std::size_t(h.count);
+    namesSize = std::size_t(h.namesSize);
+    file = std::move(m);
+    return true;
+}
+
+Swatch SwatchLibrary::at(std::size_t i) const {
+    const SwatchRecord &r = records[i];
+    Swatch s;
+    // ссылка на имя за пределы файла (испорченный файл) даёт пустое имя
+    if (std::size_t(r.nameOffset) + r.nameLength <= namesSize) s.name = std::string_view(names + r.nameOffset, r.nameLength);
+    s.rgb = { r.rgb[0], r.rgb[1], r.rgb[2] };
+    s.lab = { r.lab[0], r.lab[1], r.lab[2] };
+    s.cmyk = decodeCmyk16(r.cmyk);
+    return s;
+}
+
+std::size_t SwatchLibrary::nearest(const Lab &lab, double *dE) const {
+    const float q[3] = { float(lab.L), float(lab.a), float(lab.b) };
+    Best best;
+    search(records, 0, count, q, best);
+    if (dE) *dE = std::sqrt(double(best.d2));
+    return best.index;
+}
+
+void SwatchLibrary::nearestBatch(const Lab *lab, uint32_t *index, float *dE, std::size_t n) const {
+    for (std::size_t i = 0; i < n; ++i) {
+        const float q[3] = { float(lab[i].L), float(lab[i].a), float(lab[i].b) };
+        Best best;
+        search(records, 0, count, q, best);
+        index[i] = uint32_t(best.index);
+        if (dE) dE[i] = std::sqrt(best.d2);
+    }
+}
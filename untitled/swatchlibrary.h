@@ -0,0 +1,67 @@
+#ifndef SWATCHLIBRARY_H
+#define SWATCHLIBRARY_H
+
+#include "colormodels.h"
+#include "mappedfile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Библиотека именованных образцов в двоичном файле (.swl):
+//   заголовок | записи по 32 байта | имена подряд (UTF-8, без нулей)
+// В записи — Lab (float), RGB, CMYK16, ссылка на имя и ось разбиения.
+// Записи уложены неявным k-d деревом по Lab: корень поддиапазона [lo, hi) —
+// запись (lo + hi) / 2, левее неё по оси разбиения значения не больше, правее —
+// не меньше. Поэтому индекс ближайшего соседа — это сам порядок записей, и файл
+// открывается отображением за O(1), без разбора и построения.
+struct SwatchEntry {
+    std::string name;
+    RGB rgb;
+    Lab lab;
+    CMYK cmyk;
+};
+
+// Образец из открытой библиотеки; name указывает в отображённый файл.
+struct Swatch {
+    std::string_view name;
+    RGB rgb;
+    Lab lab;
+    CMYK cmyk;
+};
+
+// Текстовый список "имя<TAB>цвет" или "имя,цвет"; цвет — в любой записи
+// colorlist (#hex, rgb(), lab(), cmyk() или три числа RGB). Строки без цвета
+// (заголовки) пропускаются. Lab и CMYK досчитываются из заданного цвета.
+bool readSwatchList(const std::string &path, std::vector<SwatchEntry> &entries, std::string *error = nullptr);
+
+// Строит индекс (переставляет entries) и пишет библиотеку.
+bool writeSwatchLibrary(const std::string &path, std::vector<SwatchEntry> entries, std::string *error = nullptr);
+
+struct SwatchRecord;
+
+class SwatchLibrary {
+public:
+    // Проверяются только заголовок и размеры частей — время не зависит от числа образцов.
+    bool open(const std::string &path, std::string *error = nullptr);
+    bool isOpen() const { return file != nullptr; }
+
+    std::size_t size() const { return count; }
+    Swatch at(std::size_t i) const;
+
+    // Ближайший образец по ΔE76; библиотека не должна быть пустой.
+    std::size_t nearest(const Lab &lab, double *dE = nullptr) const;
+    void nearestBatch(const Lab *lab, uint32_t *index, float *dE, std::size_t n) const;
+
+private:
+    std::unique_ptr<MappedFile> file;
+    const SwatchRecord *records = nullptr;
+    const char *names = nullptr;
+    std::size_t count = 0;
+    std::size_t namesSize = 0;
+};
+
+#endif // SWATCHLIBRARY_H
@@ -0,0 +1,97 @@
+#include "check.h"
+#include "adjustments.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// Вход: случайные пиксели и несколько насыщенных, на которых срабатывают обрезки.
+// Нейтральных нет: у них тон и rgb -> cmyk у чёрного зависят от знака нуля,
+// и float с double расходятся законно.
+std::vector<uint8_t> samplePixels() {
+    std::vector<uint8_t> rgb = { 180, 108, 90, 255, 0, 0, 0, 255, 0, 0, 0, 255, 250, 240, 10, 20, 30, 200 };
+    std::mt19937 rng(64);
+    while (rgb.size() < 3 * 2000) {
+        const uint8_t r = uint8_t(rng()), g = uint8_t(rng()), b = uint8_t(rng());
+        if (r == g && g == b) continue;
+        rgb.insert(rgb.end(), { r, g, b });
+    }
+    return rgb;
+}
+
+// скомпилированная программа против пошагового эталона на всех трёх выходах
+void compareWithStepwise(const AdjustmentChain &chain) {
+    const std::vector<uint8_t> rgb = samplePixels();
+    const std::size_t count = rgb.size() / 3;
+    const CompiledAdjustment compiled = chain.compile();
+
+    std::vector<uint8_t> outRgb(count * 3);
+    std::vector<double> expected(count * 4);
+    compiled.applyRgb(rgb.data(), 3, outRgb.data(), 3, count);
+    chain.applyStepwise(rgb.data(), 3, AdjustSpace::RGB, expected.data(), count);
+    int worst = 0;
+    for (std::size_t i = 0; i < count * 3; ++i) {
+        const int e = int(std::lround(std::min(std::max(expected[i], 0.0), 1.0) * 255.0));
+        worst = std::max(worst, std::abs(outRgb[i] - e));
+    }
+    CHECK(worst <= 1);
+
+    std::vector<Lab> outLab(count);
+    compiled.applyLab(rgb.data(), 3, outLab.data(), count);
+    chain.applyStepwise(rgb.data(), 3, AdjustSpace::Lab, expected.data(), count);
+    double worstLab = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        worstLab = std::max({ worstLab, std::abs(outLab[i].L - expected[i * 3]), std::abs(outLab[i].a - expected[i * 3 + 1]),
+                              std::abs(outLab[i].b - expected[i * 3 + 2]) });
+    }
+    CHECK(worstLab < 0.1);
+
+    std::vector<CMYK> outCmyk(count);
+    compiled.applyCmyk(rgb.data(), 3, outCmyk.data(), count);
+    chain.applyStepwise(rgb.data(), 3, AdjustSpace::CMYK, expected.data(), count);
+    // CMY у тёмных цветов плохо обусловлены (делятся на 1 - K), сравниваем цвет, который они дают
+    double worstCmyk = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const double got[4] = { outCmyk[i].c, outCmyk[i].m, outCmyk[i].y, outCmyk[i].k };
+        const double *e = &expected[i * 4];
+        for (int c = 0; c < 3; ++c)
+            worstCmyk = std::max(worstCmyk, std::abs((1.0 - got[c]) * (1.0 - got[3]) - (1.0 - e[c]) * (1.0 - e[3])));
+    }
+    CHECK(worstCmyk < 2e-3);
+}
+
+}
+
+
+TEST(adjustmentMatchesStepwise) {
+    compareWithStepwise(AdjustmentChain().to(AdjustSpace::Lab).add(0, 5).scaleChroma(0.9).to(AdjustSpace::CMYK));
+    compareWithStepwise(AdjustmentChain().scale(0, 1.2).add(2, -0.1).to(AdjustSpace::LCh).rotateHue(30).scaleChroma(1.3));
+    compareWithStepwise(AdjustmentChain().to(AdjustSpace::CMYK).scale(3, 0.8).to(AdjustSpace::Lab).add(1, 10));
+}
+
+// переходы через обрезку не сокращаются
+TEST(adjustmentKeepsClippingHops) {
+    const AdjustmentChain repro = AdjustmentChain().to(AdjustSpace::Lab).scaleChroma(3).to(AdjustSpace::RGB)
+                                      .to(AdjustSpace::Lab).scaleChroma(1 / 3.0);
+    compareWithStepwise(repro);
+    CHECK(repro.compile().describe(AdjustSpace::RGB) == "rgb>lab affine lab>rgb rgb>lab affine lab>rgb");
+
+    // RGB выходит за 0..1, переход в Lab и обратно обрезает его
+    const AdjustmentChain overRgb = AdjustmentChain().add(0, 0.5).to(AdjustSpace::Lab).to(AdjustSpace::RGB).add(0, -0.5);
+    compareWithStepwise(overRgb);
+    CHECK(overRgb.compile().describe(AdjustSpace::RGB) == "affine clamp clamp clamp affine");
+
+    // C < 0 в LCh обнуляется переходом в Lab
+    const AdjustmentChain negativeChroma = AdjustmentChain().to(AdjustSpace::LCh).add(1, -200).to(AdjustSpace::Lab)
+                                               .to(AdjustSpace::LCh).add(1, 20);
+    compareWithStepwise(negativeChroma);
+
+    // точные пары по-прежнему выбрасываются
+    CHECK(AdjustmentChain().to(AdjustSpace::LCh).to(AdjustSpace::Lab).add(0, 1).compile().describe(AdjustSpace::Lab) ==
+          "rgb>lab affine");
+    CHECK(AdjustmentChain().to(AdjustSpace::Lab).to(AdjustSpace::RGB).compile().kernelCount(AdjustSpace::RGB) == 0);
+}
@@ -0,0 +1,108 @@
+#include "arena.h"
+#include "check.h"
+
+#include <cstring>
+
+
+namespace {
+
+const std::size_t INITIAL = 256 * 1024;
+
+bool aligned(const void *p, std::size_t align) { return reinterpret_cast<uintptr_t>(p) % align == 0; }
+
+// задание с вложенными областями, которому мало одного начального блока
+void job(ScratchArena &arena) {
+    ArenaScope outer(arena);
+    uint8_t *rows = outer.allocate<uint8_t>(100 * 1024);
+    std::memset(rows, 1, 100 * 1024);
+    for (int tile = 0; tile < 4; ++tile) {
+        ArenaScope inner(arena);
+        float *a = inner.allocate<float>(40 * 1024);
+        float *b = inner.allocate<float>(60 * 1024);
+        std::memset(a, 2, 40 * 1024 * sizeof(float));
+        std::memset(b, 3, 60 * 1024 * sizeof(float));
+    }
+}
+
+}
+
+// вложенная область откатывает только своё: следующая получает ту же память
+TEST(arenaNestedScopes) {
+    ScratchArena arena;
+    ArenaScope outer(arena);
+    int *kept = outer.allocate<int>(100);
+    const std::size_t afterOuter = arena.usedBytes();
+    void *first;
+    {
+        ArenaScope inner(arena);
+        first = inner.allocate<double>(1000);
+        CHECK(arena.usedBytes() >= afterOuter + 1000 * sizeof(double));
+        {
+            ArenaScope deeper(arena);
+            deeper.allocate<char>(5000);
+        }
+        CHECK(arena.usedBytes() < afterOuter + 1000 * sizeof(double) + 64);
+    }
+    CHECK(arena.usedBytes() == afterOuter);
+    {
+        ArenaScope inner(arena);
+        CHECK(inner.allocate<double>(1000) == first);
+    }
+    CHECK(arena.mark().offset == afterOuter);
+    CHECK(kept != nullptr);
+}
+
+// не поместилось в блок — новый блок; старые указатели остаются в силе
+TEST(arenaOverflowsIntoNewBlock) {
+    ScratchArena arena;
+    const std::size_t blockBytes = INITIAL;
+    uint8_t *a = arena.allocate<uint8_t>(blockBytes * 3 / 4);
+    std::memset(a, 0xaa, blockBytes * 3 / 4);
+    CHECK(arena.heapAllocations() == 1);
+    uint8_t *b = arena.allocate<uint8_t>(blockBytes / 2);
+    std::memset(b, 0xbb, blockBytes / 2);
+    CHECK(arena.heapAllocations() == 2);
+    CHECK(arena.mark().block == 1);
+    CHECK(arena.reservedBytes() >= blockBytes * 3);     // второй блок — не меньше удвоенного
+    CHECK(a[0] == 0xaa && a[blockBytes * 3 / 4 - 1] == 0xaa);
+    CHECK(b + blockBytes / 2 <= a || b >= a + blockBytes * 3 / 4);
+    // занятое считается с учётом брошенного хвоста первого блока
+    CHECK(arena.usedBytes() >= blockBytes + blockBytes / 2);
+
+    // больше любого блока — блок под размер
+    uint8_t *huge = arena.allocate<uint8_t>(blockBytes * 8);
+    std::memset(huge, 0xcc, blockBytes * 8);
+    CHECK(arena.heapAllocations() == 3);
+    CHECK(arena.highWaterBytes() >= blockBytes * 9);
+}
+
+TEST(arenaAlignment) {
+    ScratchArena arena;
+    CHECK(aligned(arena.allocate(1, 1), 1));
+    CHECK(aligned(arena.allocate(3, 8), 8));
+    CHECK(aligned(arena.allocate(10), 64));
+    CHECK(aligned(arena.allocate(7, 4096), 4096));
+    CHECK(aligned(arena.allocate<double>(3), 64));
+    // выравнивание сохраняется и в новом блоке
+    CHECK(aligned(arena.allocate(INITIAL * 2, 4096), 4096));
+    CHECK(aligned(arena.allocate(5, 256), 256));
+}
+
+// после полного отката блоки сливаются в один такого же общего размера:
+// второе такое же задание не обращается к куче
+TEST(arenaSteadyStateWithoutHeap) {
+    ScratchArena arena;
+    job(arena);
+    CHECK(arena.usedBytes() == 0);
+    CHECK(arena.mark().block == 0);
+    const std::size_t heap = arena.heapAllocations();
+    const std::size_t reserved = arena.reservedBytes();
+    CHECK(heap > 2);                                  // несколько блоков и слитый
+    CHECK(arena.highWaterBytes() <= reserved);
+
+    for (int i = 0; i < 3; ++i) {
+        job(arena);
+        CHECK(arena.heapAllocations() == heap);
+        CHECK(arena.reservedBytes() == reserved);
+    }
+}
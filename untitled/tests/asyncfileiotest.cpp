@@ -0,0 +1,113 @@
+#include "asyncfileio.h"
+#include "check.h"
+
+#include <filesystem>
+#include <map>
+#include <vector>
+
+
+namespace {
+
+// пишет files файлов, читает их обратно плюс пустой и несуществующий
+void roundTrip(bool preferUring) {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "colour-tests-asyncfileio";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    const std::size_t files = 40;
+    std::map<std::size_t, std::vector<uint8_t>> expected;
+    {
+        AsyncFileIO io(8, preferUring);
+        for (std::size_t i = 0; i < files; ++i) {
+            std::vector<uint8_t> data(i * 977 + (i == 3 ? 0 : 1));
+            for (std::size_t k = 0; k < data.size(); ++k) data[k] = uint8_t(k * 31 + i);
+            expected[i] = data;
+            io.write(i, (dir / (std::to_string(i) + ".bin")).string(), std::move(data));
+        }
+        AsyncFileIO::Result r;
+        std::size_t done = 0;
+        while (io.wait(r)) {
+            CHECK(r.write && r.error.empty() && r.data.empty());
+            ++done;
+        }
+        CHECK(done == files);
+    }
+
+    AsyncFileIO io(8, preferUring);
+    for (std::size_t i = 0; i < files; ++i) io.read(i, (dir / (std::to_string(i) + ".bin")).string());
+    io.read(files, (dir / "missing.bin").string());
+    AsyncFileIO::Result r;
+    std::size_t done = 0;
+    while (io.wait(r)) {
+        ++done;
+        if (r.id == files) {
+            CHECK(!r.error.empty());
+            continue;
+        }
+        CHECK(r.error.empty());
+        CHECK(r.data == expected[r.id]);
+    }
+    CHECK(done == files + 1);
+    CHECK(io.pending() == 0);
+    std::filesystem::remove_all(dir);
+}
+
+}
+
+
+TEST(asyncFileIoUringRoundTrip) {
+    roundTrip(true);
+}
+
+TEST(asyncFileIoThreadsRoundTrip) {
+    roundTrip(false);
+}
+
+// запись в несуществующий каталог — ошибка в результате, а не зависание
+TEST(asyncFileIoWriteError) {
+    AsyncFileIO io(4);
+    io.write(1, (std::filesystem::temp_directory_path() / "colour-tests-no-such-dir" / "x.bin").string(),
+             std::vector<uint8_t>(10, 1));
+    AsyncFileIO::Result r;
+    REQUIRE(io.wait(r));
+    CHECK(r.id == 1 && !r.error.empty());
+    CHECK(!io.wait(r));
+}
+
+// кольцо отказало посреди работы: запросы в полёте не теряются и не считаются
+// неудачными — их заново выполняют потоки
+TEST(asyncFileIoFallBackMidFlight) {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "colour-tests-asyncfileio-fallback";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::size_t files = 24;
+    auto content = [](std::size_t i){
+        std::vector<uint8_t> data(200000 + i * 4099);
+        for (std::size_t k = 0; k < data.size(); ++k) data[k] = uint8_t(k * 13 + i);
+        return data;
+    };
+
+    for (bool reading : { false, true }) {
+        AsyncFileIO io(8);
+        for (std::size_t i = 0; i < files; ++i) {
+            const std::string path = (dir / (std::to_string(i) + ".bin")).string();
+            if (reading) io.read(i, path);
+            else io.write(i, path, content(i));
+        }
+        AsyncFileIO::Result r;
+        std::size_t done = 0;
+        REQUIRE(io.wait(r));
+        CHECK(r.error.empty());
+        ++done;
+        io.fallBackToThreads();
+        CHECK(io.backend() == AsyncFileIO::Backend::Threads);
+        while (io.wait(r)) {
+            CHECK(r.error.empty());
+            CHECK(r.write == !reading);
+            if (reading) CHECK(r.data == content(r.id));
+            ++done;
+        }
+        CHECK(done == files);
+    }
+    std::filesystem::remove_all(dir);
+}
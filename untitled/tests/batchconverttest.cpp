@@ -0,0 +1,175 @@
+#include "check.h"
+#include "batchconvert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+
+// на месте — то же, что через отдельный буфер, в том числе при строках с запасом
+TEST(inPlaceMatchesBatch) {
+    const int width = 1500, height = 37, stride = width * 3 + 5;
+    std::vector<uint8_t> pixels(std::size_t(stride) * height);
+    std::mt19937 rng(60);
+    for (uint8_t &v : pixels) v = uint8_t(rng());
+    const std::vector<uint8_t> source = pixels;
+
+    REQUIRE(rgbToLab8ImageInPlace(ImageView<uint8_t>(pixels.data(), width, height, 3, stride)));
+    std::vector<Lab8> expected(width);
+    for (int y = 0; y < height; ++y) {
+        rgbToLab8Batch(source.data() + std::size_t(y) * stride, 3, expected.data(), width);
+        const uint8_t *row = pixels.data() + std::size_t(y) * stride;
+        CHECK(std::equal(row, row + width * 3, reinterpret_cast<const uint8_t *>(expected.data())));
+        CHECK(std::equal(row + width * 3, row + stride, source.data() + std::size_t(y) * stride + width * 3));
+    }
+
+    const std::vector<uint8_t> lab = pixels;
+    std::size_t clipped = 0, expectedClipped = 0;
+    REQUIRE(lab8ToRgbImageInPlace(ImageView<uint8_t>(pixels.data(), width, height, 3, stride), &clipped));
+    std::vector<uint8_t> rgb(std::size_t(width) * 3);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *row = lab.data() + std::size_t(y) * stride;
+        expectedClipped += lab8ToRgbBatch(reinterpret_cast<const Lab8 *>(row), rgb.data(), 3, width);
+        CHECK(std::equal(rgb.begin(), rgb.end(), pixels.data() + std::size_t(y) * stride));
+    }
+    CHECK(clipped == expectedClipped);
+}
+
+// число каналов не то, что ждёт преобразование: буфер не трогается
+TEST(inPlaceRejectsChannelMismatch) {
+    Image<uint8_t> rgba(64, 4, 4);
+    for (std::size_t i = 0; i < rgba.pixels.size(); ++i) rgba.pixels[i] = uint8_t(i * 7);
+    const std::vector<uint8_t> before = rgba.pixels;
+    CHECK(!rgbToLab8ImageInPlace(rgba.view()));
+    CHECK(!lab8ToRgbImageInPlace(rgba.view()));
+    CHECK(rgba.pixels == before);
+
+    Image<uint8_t> rgb(64, 4, 3);
+    CHECK(!rgbaToCmyk8ImageInPlace(rgb.view()));
+    CHECK(rgbaToCmyk8ImageInPlace(rgba.view()));
+
+    Image<uint16_t> rgb16(16, 2, 4);
+    CHECK(!rgb16ToLab16ImageInPlace(rgb16.view()));
+    CHECK(!lab16ToRgb16ImageInPlace(rgb16.view()));
+}
+
+namespace {
+
+// случайные RGB16 плюс вся шкала серого с шагом 16
+std::vector<uint16_t> rgb16Samples(std::size_t count) {
+    std::vector<uint16_t> rgb(count * 3);
+    std::mt19937 rng(52);
+    for (uint16_t &v : rgb) v = uint16_t(rng());
+    for (std::size_t i = 0; i < 4096 && i < count; ++i) rgb[i * 3] = rgb[i * 3 + 1] = rgb[i * 3 + 2] = uint16_t(i * 16);
+    return rgb;
+}
+
+int maxDiff(int a, int b) { return a > b ? a - b : b - a; }
+
+}
+
+// линеаризация по таблице на 65536 значений — как формула в double
+TEST(rgb16ToXyzMatchesScalar) {
+    const std::size_t n = 65536;
+    std::vector<uint16_t> rgb(n * 3);
+    for (std::size_t i = 0; i < n; ++i) {
+        rgb[i * 3] = uint16_t(i); rgb[i * 3 + 1] = uint16_t(65535 - i); rgb[i * 3 + 2] = uint16_t(i * 7);
+    }
+    std::vector<XYZ> xyz(n);
+    rgb16ToXyzBatch(rgb.data(), 3, xyz.data(), n);
+    double worst = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const XYZ e = rgb16ToXyz(RGB16{ rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2] });
+        worst = std::max({ worst, std::fabs(e.X - xyz[i].X), std::fabs(e.Y - xyz[i].Y), std::fabs(e.Z - xyz[i].Z) });
+    }
+    CHECK(worst < 1e-4);
+}
+
+// пакетные 16-битные пути отличаются от точных не больше чем на код
+TEST(batch16MatchesScalar) {
+    const std::size_t n = 100000;
+    const std::vector<uint16_t> rgb = rgb16Samples(n);
+    std::vector<Lab16> lab(n);
+    std::vector<CMYK16> cmyk(n);
+    std::vector<uint16_t> back(n * 3), fromCmyk(n * 3);
+    rgb16ToLab16Batch(rgb.data(), 3, lab.data(), n);
+    lab16ToRgb16Batch(lab.data(), back.data(), 3, n);
+    rgb16ToCmyk16Batch(rgb.data(), 3, cmyk.data(), n);
+    cmyk16ToRgb16Batch(cmyk.data(), fromCmyk.data(), 3, n);
+
+    int labDiff = 0, rgbDiff = 0, cmykDiff = 0, cmykRgbDiff = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const RGB16 p{ rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2] };
+        const Lab16 l = encodeLab16(rgb16ToLab(p));
+        labDiff = std::max({ labDiff, maxDiff(l.L, lab[i].L), maxDiff(l.a, lab[i].a), maxDiff(l.b, lab[i].b) });
+        const RGB16 r = labToRgb16(decodeLab16(lab[i])).first;
+        rgbDiff = std::max({ rgbDiff, maxDiff(r.r, back[i * 3]), maxDiff(r.g, back[i * 3 + 1]), maxDiff(r.b, back[i * 3 + 2]) });
+        const CMYK16 c = encodeCmyk16(rgb16ToCmyk(p));
+        cmykDiff = std::max({ cmykDiff, maxDiff(c.c, cmyk[i].c), maxDiff(c.m, cmyk[i].m), maxDiff(c.y, cmyk[i].y),
+                              maxDiff(c.k, cmyk[i].k) });
+        const RGB16 k = cmykToRgb16(decodeCmyk16(cmyk[i]));
+        cmykRgbDiff = std::max({ cmykRgbDiff, maxDiff(k.r, fromCmyk[i * 3]), maxDiff(k.g, fromCmyk[i * 3 + 1]),
+                                 maxDiff(k.b, fromCmyk[i * 3 + 2]) });
+    }
+    CHECK(labDiff <= 1);
+    CHECK(rgbDiff <= 1);
+    CHECK(cmykDiff <= 1);
+    CHECK(cmykRgbDiff <= 1);
+}
+
+// RGB16 -> Lab16 -> RGB16 без перехода через 8 бит: ошибка меньше половины
+// 8-битного шага (257 кодов) даже у насыщенных цветов, у серых — единицы кодов
+TEST(rgb16Lab16RoundTrip) {
+    const std::size_t n = 200000;
+    const std::vector<uint16_t> rgb = rgb16Samples(n);
+    std::vector<Lab16> lab(n);
+    std::vector<uint16_t> back(n * 3);
+    rgb16ToLab16Batch(rgb.data(), 3, lab.data(), n);
+    lab16ToRgb16Batch(lab.data(), back.data(), 3, n);
+    int grey = 0, worst = 0;
+    for (std::size_t i = 0; i < n * 3; ++i) {
+        const int d = maxDiff(rgb[i], back[i]);
+        worst = std::max(worst, d);
+        if (i < 4096 * 3) grey = std::max(grey, d);
+    }
+    CHECK(grey <= 8);
+    CHECK(worst < 128);
+
+    // CMYK16 туда и обратно без потерь
+    std::vector<CMYK16> cmyk(n);
+    rgb16ToCmyk16Batch(rgb.data(), 3, cmyk.data(), n);
+    cmyk16ToRgb16Batch(cmyk.data(), back.data(), 3, n);
+    CHECK(back == rgb);
+}
+
+// Lab8 вне диапазона и NaN: блоки по 16 и хвост кодируют одинаково, с обрезкой
+TEST(lab8PackSaturatesEverywhere) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const XYZ extremes[] = { { 1e8, 50.0, 50.0 }, { 1e25, 50.0, 50.0 }, { 50.0, 1e8, 50.0 }, { 50.0, 50.0, 1e8 },
+                             { 1.0, 1.0, 1e25 }, { 0.0, 1e8, 0.0 }, { nan, 50.0, 50.0 }, { 50.0, nan, 50.0 },
+                             { 200.0, 300.0, 100.0 } };
+    const std::size_t n = 69;     // кусок 64 (четыре блока SIMD) и хвост из 5
+    std::vector<XYZ> xyz(n);
+    std::vector<Lab8> lab(n);
+    for (const XYZ &v : extremes) {
+        std::fill(xyz.begin(), xyz.end(), v);
+        xyzToLab8Batch(xyz.data(), lab.data(), n);
+        bool same = true;
+        for (const Lab8 &l : lab) same = same && l.L == lab[0].L && l.a == lab[0].a && l.b == lab[0].b;
+        CHECK(same);
+    }
+    std::fill(xyz.begin(), xyz.end(), XYZ{ 1e8, 50.0, 50.0 });
+    xyzToLab8Batch(xyz.data(), lab.data(), n);
+    CHECK(lab[0].a == 255 && lab[n - 1].a == 255);
+    std::fill(xyz.begin(), xyz.end(), XYZ{ 50.0, 1e8, 50.0 });
+    xyzToLab8Batch(xyz.data(), lab.data(), n);
+    CHECK(lab[0].a == 0 && lab[0].b == 255 && lab[0].L == 255);
+
+    // сама кодировка: NaN и огромные значения обрезаются, а не переполняют int
+    const Lab8 big = encodeLab8({ 1e12, 1e12, -1e12 });
+    CHECK(big.L == 255 && big.a == 255 && big.b == 0);
+    const Lab8 none = encodeLab8({ double(nan), double(nan), double(nan) });
+    CHECK(none.L == 0 && none.a == 0 && none.b == 0);
+}
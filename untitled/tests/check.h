@@ -0,0 +1,24 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+// Проверки движка без сторонних библиотек: TEST(имя) регистрирует функцию,
+// CHECK(условие) отмечает провал и идёт дальше, REQUIRE — выходит из теста.
+// Запуск: tests [часть имени]; код возврата — число провалившихся тестов.
+
+int registerTest(const char *name, void (*fn)());
+void reportFailure(const char *file, int line, const char *expr);
+
+#define TEST(name) \
+    static void name(); \
+    static const int name##Registered = registerTest(#name, name); \
+    static void name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) reportFailure(__FILE__, __LINE__, #cond); } while (0)
+
+#define REQUIRE(cond) \
+    do { if (!(cond)) { reportFailure(__FILE__, __LINE__, #cond); return; } } while (0)
+
+#endif // CHECK_H
@@ -0,0 +1,38 @@
+#include "check.h"
+#include "cmyklab.h"
+#include "lutcache.h"
+
+#include <cmath>
+#include <filesystem>
+
+
+// таблица в кэше под тем же именем, но с другим ключом, не подхватывается — даже
+// если характеризации совпадают в узлах 0, 0.5, 1 и расходятся только между ними
+TEST(cmykLabCacheFollowsCharacterization) {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "colour-tests-cmyklab";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    LutCache::setDirectory(dir.string());
+
+    const CMYK probe = { 0.3, 0.2, 0.1, 0.4 };
+    auto midtones = [](const CMYK &c){
+        Lab lab = cmykToLab(c);
+        const double s = std::sin(2.0 * 3.14159265358979323846 * c.c);
+        lab.L -= 10.0 * s * s;
+        return lab;
+    };
+    const CmykLabTransform plain(cmykToLab, 9, "cmykLabTest", 1);
+    const CmykLabTransform gained(midtones, 9, "cmykLabTest", 2);
+    const CmykLabTransform darker([](const CMYK &c){ Lab lab = cmykToLab(c); lab.L *= 0.9; return lab; }, 9,
+                                  "cmykLabTest", 3);
+    const CmykLabTransform again(cmykToLab, 9, "cmykLabTest", 1);
+    const CMYK quarter = { 0.25, 0.2, 0.1, 0.4 };
+    CHECK(std::abs(gained.convert(quarter).L - midtones(quarter).L) < 0.5);
+    CHECK(std::abs(gained.convert(quarter).L - plain.convert(quarter).L) > 5.0);
+    CHECK(std::abs(darker.convert(probe).L - 0.9 * cmykToLab(probe).L) < 0.5);
+    CHECK(std::abs(again.convert(probe).L - plain.convert(probe).L) < 1e-6);
+    CHECK(std::abs(plain.convert(probe).L - cmykToLab(probe).L) < 0.5);
+
+    LutCache::setDirectory(std::string());
+    std::filesystem::remove_all(dir);
+}
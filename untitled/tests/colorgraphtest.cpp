@@ -0,0 +1,107 @@
+#include "check.h"
+#include "colorgraph.h"
+
+
+namespace {
+
+// цепочка A -> B -> C -> D и короткий путь A -> D; обратно D -> A.
+// Каждое преобразование прибавляет к первой компоненте и считает вызовы.
+struct Chain {
+    ColorGraph graph;
+    int a, b, c, d;
+    int calls[4][4] = {};
+
+    Chain() {
+        a = graph.addSpace("A");
+        b = graph.addSpace("B");
+        c = graph.addSpace("C");
+        d = graph.addSpace("D");
+        link(a, b, 1.0);
+        link(b, c, 10.0);
+        link(c, d, 100.0);
+        link(a, d, 1000.0);
+        link(d, a, -1000.0);
+    }
+
+    void link(int from, int to, double add) {
+        graph.addConversion(from, to, [this, from, to, add](const ColorValue &v){
+            ++calls[from][to];
+            ColorValue r = v;
+            r.c[0] += add;
+            return r;
+        });
+    }
+
+    static ColorValue value(double x) { return ColorValue{ { x, 0.0, 0.0, 0.0 } }; }
+};
+
+}
+
+// преобразования вызываются только при запросе и один раз на изменение
+TEST(colorGraphLazyConversions) {
+    Chain g;
+    g.graph.set(g.a, Chain::value(1.0));
+    CHECK(g.graph.conversions() == 0);
+    CHECK(g.graph.isDirty(g.b) && g.graph.isDirty(g.c) && g.graph.isDirty(g.d));
+
+    CHECK(g.graph.get(g.c).c[0] == 12.0);
+    CHECK(g.graph.conversions() == 2);            // A -> B -> C, D не тронут
+    CHECK(g.graph.isDirty(g.d));
+    g.graph.get(g.c);
+    g.graph.get(g.b);
+    CHECK(g.graph.conversions() == 2);            // уже посчитаны
+
+    // то же значение в том же источнике — ничего не пересчитывается
+    const uint64_t version = g.graph.version(g.c);
+    g.graph.set(g.a, Chain::value(1.0));
+    CHECK(!g.graph.isDirty(g.c));
+    g.graph.set(g.a, Chain::value(2.0));
+    CHECK(g.graph.isDirty(g.c));
+    CHECK(g.graph.get(g.c).c[0] == 13.0);
+    CHECK(g.graph.version(g.c) == version + 1);
+    CHECK(g.graph.conversions() == 4);
+}
+
+// кратчайшая цепочка: D считается прямо из A, а не через B и C;
+// при равной длине — от источника
+TEST(colorGraphShortestPath) {
+    Chain g;
+    g.graph.set(g.a, Chain::value(0.0));
+    CHECK(g.graph.get(g.d).c[0] == 1000.0);
+    CHECK(g.calls[g.a][g.d] == 1 && g.calls[g.c][g.d] == 0 && g.calls[g.a][g.b] == 0);
+
+    // источник D: A через D -> A, B через A
+    g.graph.set(g.d, Chain::value(5000.0));
+    CHECK(g.graph.get(g.b).c[0] == 4001.0);
+    CHECK(g.calls[g.d][g.a] == 1 && g.calls[g.a][g.b] == 1);
+    // C: от уже посчитанного B один шаг
+    CHECK(g.graph.get(g.c).c[0] == 4011.0);
+    CHECK(g.calls[g.b][g.c] == 1);
+}
+
+// invalidate помечает узел и всё, что посчитано через него; источник не трогается
+TEST(colorGraphInvalidation) {
+    Chain g;
+    g.graph.set(g.a, Chain::value(0.0));
+    g.graph.get(g.c);
+    g.graph.get(g.d);
+    CHECK(!g.graph.isDirty(g.b) && !g.graph.isDirty(g.c) && !g.graph.isDirty(g.d));
+
+    g.graph.invalidate(g.b);
+    CHECK(g.graph.isDirty(g.b) && g.graph.isDirty(g.c));
+    CHECK(!g.graph.isDirty(g.d));                 // D посчитан из A, не через B
+    CHECK(g.graph.get(g.c).c[0] == 11.0);
+    CHECK(g.calls[g.a][g.b] == 2 && g.calls[g.b][g.c] == 2);
+
+    // источник не пересчитывается и остаётся источником
+    g.graph.invalidate(g.a);
+    CHECK(!g.graph.isDirty(g.a) && !g.graph.isDirty(g.b));
+    CHECK(g.graph.source() == g.a);
+    CHECK(g.graph.get(g.a).c[0] == 0.0);
+
+    // без изменения значения версия не растёт
+    const uint64_t version = g.graph.version(g.c);
+    g.graph.invalidate(g.c);
+    g.graph.get(g.c);
+    CHECK(g.graph.version(g.c) == version);
+}
@@ -0,0 +1,113 @@
+#include "check.h"
+#include "colorlist.h"
+
+#include <cstring>
+#include <string>
+
+
+namespace {
+
+bool parse(const char *line, ListSpace &space, double v[4], ListSpace bare = ListSpace::RGB) {
+    return parseColor(line, line + std::strlen(line), bare, space, v);
+}
+
+// список через временные файлы; результат — весь вывод
+std::string convert(const std::string &input, const ColorListOptions &options, ColorListStats *stats = nullptr) {
+    std::FILE *in = std::tmpfile(), *out = std::tmpfile();
+    std::fwrite(input.data(), 1, input.size(), in);
+    std::rewind(in);
+    std::string result;
+    if (convertColorList(in, out, options, stats)) {
+        std::rewind(out);
+        char buf[4096];
+        std::size_t n;
+        while ((n = std::fread(buf, 1, sizeof(buf), out)) > 0) result.append(buf, n);
+    }
+    std::fclose(in);
+    std::fclose(out);
+    return result;
+}
+
+}
+
+
+TEST(colorListParsesNotations) {
+    ListSpace s;
+    double v[4];
+    REQUIRE(parse("name,#ff8000", s, v));
+    CHECK(s == ListSpace::Hex && v[0] == 255 && v[1] == 128 && v[2] == 0);
+    REQUIRE(parse("#f80", s, v));
+    CHECK(v[0] == 255 && v[1] == 136 && v[2] == 0);
+    REQUIRE(parse("x; rgb(255, 128, 0)", s, v));
+    CHECK(s == ListSpace::RGB && v[1] == 128);
+    REQUIRE(parse("lab(50.5, 10, -20)", s, v));
+    CHECK(s == ListSpace::Lab && v[0] == 50.5 && v[2] == -20);
+    REQUIRE(parse("cmyk(10%, 20%, 30%, 40%)", s, v));
+    CHECK(s == ListSpace::CMYK && v[3] == 40);
+    REQUIRE(parse("{\"name\": \"a\", \"rgb\": [1, 2, 3]}", s, v));
+    CHECK(s == ListSpace::RGB && v[0] == 1 && v[2] == 3);
+    REQUIRE(parse("1\t2\t3", s, v));
+    CHECK(s == ListSpace::RGB && v[1] == 2);
+    REQUIRE(parse("rgb(300, -5, 0)", s, v));
+    CHECK(v[0] == 255 && v[1] == 0);
+}
+
+TEST(colorListRejectsMalformed) {
+    ListSpace s;
+    double v[4];
+    CHECK(!parse("rgb(nan, 0, 0)", s, v));
+    CHECK(!parse("lab(inf, 0, 0)", s, v));
+    CHECK(!parse("lab(50, -infinity, 0)", s, v));
+    CHECK(!parse("cmyk(0, 0, 0, NaN)", s, v));
+    CHECK(!parse("nan,1,2", s, v));
+    CHECK(!parse("rgb(1, 2)", s, v));
+    CHECK(!parse("1,2,3,4", s, v));
+    CHECK(!parse("#12345", s, v));
+    CHECK(!parse("name,value", s, v));
+    CHECK(!parse("", s, v));
+
+    // строки с nan/inf считаются испорченными и дают пустые строки вывода
+    ColorListOptions options;
+    options.outputs = { ListSpace::Hex, ListSpace::Lab, ListSpace::CMYK };
+    ColorListStats stats;
+    const std::string out = convert("rgb(1,2,3)\nlab(nan,0,0)\nlab(1e300, 0, 0)\nrgb(inf,0,0)\n", options, &stats);
+    CHECK(stats.rows == 4);
+    CHECK(stats.invalid == 2);
+    CHECK(out.find("nan") == std::string::npos && out.find("inf") == std::string::npos);
+}
+
+// RGB -> Lab с запасом знаков -> RGB возвращает исходные коды
+TEST(colorListRoundTrip) {
+    std::string input;
+    for (int i = 0; i < 500; ++i) {
+        const int r = i * 37 % 256, g = i * 91 % 256, b = i * 53 % 256;
+        input += "rgb(" + std::to_string(r) + ", " + std::to_string(g) + ", " + std::to_string(b) + ")\n";
+    }
+    ColorListOptions toLab;
+    toLab.outputs = { ListSpace::Lab };
+    toLab.precision = 4;
+    ColorListStats stats;
+    const std::string lab = convert(input, toLab, &stats);
+    CHECK(stats.rows == 500 && stats.invalid == 0);
+
+    ColorListOptions toRgb;
+    toRgb.outputs = { ListSpace::RGB };
+    toRgb.bareInput = ListSpace::Lab;
+    const std::string rgb = convert(lab, toRgb, &stats);
+    CHECK(stats.rows == 500 && stats.invalid == 0);
+
+    std::size_t at = 0, line = 0, mismatched = 0;
+    while (at < rgb.size()) {
+        std::size_t end = rgb.find('\n', at);
+        ListSpace s;
+        double v[4];
+        const std::string row = rgb.substr(at, end - at);
+        if (!parse(row.c_str(), s, v)) { ++mismatched; break; }
+        const int i = int(line);
+        mismatched += v[0] != i * 37 % 256 || v[1] != i * 91 % 256 || v[2] != i * 53 % 256;
+        ++line;
+        at = end + 1;
+    }
+    CHECK(line == 500);
+    CHECK(mismatched == 0);
+}
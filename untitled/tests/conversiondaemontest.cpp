@@ -0,0 +1,92 @@
+#include "conversiondaemon.h"
+#include "check.h"
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+
+namespace {
+
+std::string socketPath(const char *name) {
+    return (std::filesystem::temp_directory_path() / (std::string("colour-tests-") + name + "-"
+            + std::to_string(::getpid()) + ".sock")).string();
+}
+
+std::vector<uint8_t> gradient(std::size_t pixels, int channels) {
+    std::vector<uint8_t> rgb(pixels * std::size_t(channels));
+    for (std::size_t i = 0; i < rgb.size(); ++i) rgb[i] = uint8_t(i * 37 + i / 7);
+    return rgb;
+}
+
+}
+
+TEST(conversionDaemonCopyAndShared) {
+    const std::string path = socketPath("daemon");
+    ConversionDaemon daemon;
+    std::string error;
+    REQUIRE(daemon.listen(path, &error));
+    std::thread server([&daemon]{ daemon.serve(); });
+
+    const std::size_t pixels = 5000;
+    const std::vector<uint8_t> rgb = gradient(pixels, 3);
+    std::vector<uint8_t> expected(pixels * daemonOutputBytes(DaemonTarget::Cmyk8));
+    daemonConvert(rgb.data(), 3, pixels, DaemonTarget::Cmyk8, expected.data());
+
+    // несколько подключений подряд — потоки отключившихся забираются по ходу
+    for (int round = 0; round < 3; ++round) {
+        DaemonClient client;
+        REQUIRE(client.connect(path, &error));
+        std::vector<uint8_t> out;
+        CHECK(client.convertCopy(rgb.data(), 3, pixels, DaemonTarget::Cmyk8, &out, &error));
+        CHECK(out == expected);
+    }
+
+    DaemonClient client;
+    REQUIRE(client.connect(path, &error));
+    SharedBuffer in, out;
+    REQUIRE(in.create(rgb.size(), &error));
+    REQUIRE(out.create(expected.size(), &error));
+    std::memcpy(in.data(), rgb.data(), rgb.size());
+    CHECK(client.convertShared(in, 3, pixels, DaemonTarget::Cmyk8, out, &error));
+    CHECK(std::memcmp(out.data(), expected.data(), expected.size()) == 0);
+
+#ifdef __linux__
+    // запечатанный буфер уменьшить нельзя, увеличить — можно
+    CHECK(::ftruncate(in.handle(), off_t(rgb.size() / 2)) != 0);
+    CHECK(::ftruncate(in.handle(), off_t(rgb.size() * 2)) == 0);
+#endif
+
+    daemon.stop();
+    server.join();
+    std::filesystem::remove(path);
+}
+
+TEST(conversionDaemonRejectsLargeCopy) {
+    const std::string path = socketPath("daemon-limit");
+    ConversionDaemon daemon(1);
+    std::string error;
+    REQUIRE(daemon.listen(path, &error));
+    std::thread server([&daemon]{ daemon.serve(); });
+
+    // 3 + 3 байта на пиксель: 100000 пикселей вмещаются в 1 МБ, 200000 — нет
+    const std::vector<uint8_t> rgb = gradient(200000, 3);
+    {
+        DaemonClient client;
+        REQUIRE(client.connect(path, &error));
+        std::vector<uint8_t> out;
+        CHECK(client.convertCopy(rgb.data(), 3, 100000, DaemonTarget::Lab8, &out, &error));
+        CHECK(out.size() == 100000 * daemonOutputBytes(DaemonTarget::Lab8));
+        error.clear();
+        CHECK(!client.convertCopy(rgb.data(), 3, 200000, DaemonTarget::Lab8, &out, &error));
+        CHECK(!error.empty());
+    }
+
+    daemon.stop();
+    server.join();
+    std::filesystem::remove(path);
+}
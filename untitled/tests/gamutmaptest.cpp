@@ -0,0 +1,101 @@
+#include "check.h"
+#include "gamutmap.h"
+
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+double hueDeg(double a, double b) {
+    double h = std::atan2(b, a) * (180.0 / PI);
+    return h < 0.0 ? h + 360.0 : h;
+}
+
+double hueDiff(double x, double y) {
+    double d = std::fabs(x - y);
+    return d > 180.0 ? 360.0 - d : d;
+}
+
+}
+
+// Chroma: уменьшается только хрома — до границы охвата, L и тон остаются
+// (после округления до 8 бит — в пределах долей единицы и градуса)
+TEST(gamutChromaKeepsLightnessAndHue) {
+    // синий за охватом, жёлтый выступ границы (там таблица промахивается и нужна бисекция),
+    // тёмный красный, светлый зелёный
+    for (const Lab &in : { Lab{ 50, 100, -100 }, Lab{ 95, -10, 110 }, Lab{ 96.9, -20, 120 },
+                           Lab{ 30, 80, 80 }, Lab{ 70, -120, 0 } }) {
+        const GamutMapped m = labToRgbMapped(in, GamutMapping::Chroma);
+        CHECK(m.outOfGamut);
+
+        // цвет, в который отобразили: та же L и тон, хрома меньше ровно на dE
+        const double C = std::hypot(in.a, in.b), c = C - m.dE;
+        const double limit = maxChroma(in.L, hueDeg(in.a, in.b));
+        CHECK(c > limit - 0.5 && c < limit + 0.1);
+        const Lab mapped{ in.L, in.a * c / C, in.b * c / C };
+        const RGB rgb = labToRgb(mapped).first;
+        CHECK(rgb.r == m.rgb.r && rgb.g == m.rgb.g && rgb.b == m.rgb.b);
+        // чуть дальше по хроме — уже за охватом
+        CHECK(labToRgb(Lab{ in.L, in.a * (c + 0.5) / C, in.b * (c + 0.5) / C }).second);
+
+        const Lab out = rgbToLab(m.rgb);
+        CHECK(std::fabs(out.L - in.L) < 0.5);
+        CHECK(hueDiff(hueDeg(out.a, out.b), hueDeg(in.a, in.b)) < 1.0);
+    }
+
+    // цвета в охвате не трогаются
+    for (const Lab &in : { Lab{ 50, 20, -30 }, Lab{ 90, 0, 0 }, Lab{ 0, 0, 0 } }) {
+        const GamutMapped m = labToRgbMapped(in, GamutMapping::Chroma);
+        const RGB rgb = labToRgb(in).first;
+        CHECK(!m.outOfGamut);
+        CHECK(rgb.r == m.rgb.r && rgb.g == m.rgb.g && rgb.b == m.rgb.b);
+    }
+}
+
+// Clip совпадает с обычным labToRgb, пакет — с одиночным вызовом
+TEST(gamutClipMatchesLabToRgb) {
+    std::vector<Lab> lab;
+    for (double L = 0.0; L <= 100.0; L += 5.0)
+        for (double a = -128.0; a < 128.0; a += 16.0)
+            for (double b = -128.0; b < 128.0; b += 16.0) lab.push_back({ L, a, b });
+
+    for (GamutMapping mode : { GamutMapping::Clip, GamutMapping::Chroma }) {
+        std::vector<uint8_t> rgb(lab.size() * 3);
+        std::size_t outside = labToRgbMappedBatch(lab.data(), rgb.data(), 3, lab.size(), mode);
+        std::size_t expected = 0;
+        for (std::size_t i = 0; i < lab.size(); ++i) {
+            const GamutMapped m = labToRgbMapped(lab[i], mode);
+            CHECK(rgb[i * 3] == m.rgb.r && rgb[i * 3 + 1] == m.rgb.g && rgb[i * 3 + 2] == m.rgb.b);
+            expected += m.outOfGamut ? 1 : 0;
+            if (mode == GamutMapping::Clip) {
+                const auto plain = labToRgb(lab[i]);
+                CHECK(m.rgb.r == plain.first.r && m.rgb.g == plain.first.g && m.rgb.b == plain.first.b);
+                CHECK(m.outOfGamut == plain.second);
+            }
+        }
+        CHECK(outside == expected);
+        CHECK(outside > lab.size() / 2);
+    }
+}
+
+// таблица границы: в среднем сотые доли, больше единицы — только у острых выступов
+// (жёлтый, синий), которые отображение досчитывает бисекцией
+TEST(gamutTableFollowsBoundary) {
+    std::size_t n = 0, off = 0;
+    double sum = 0.0;
+    for (double L = 1.0; L < 100.0; L += 0.7)
+        for (double h = 0.0; h < 360.0; h += 1.3) {
+            const double d = std::fabs(maxChromaTable(L, h) - maxChroma(L, h));
+            sum += d;
+            off += d > 1.0 ? 1 : 0;
+            ++n;
+            if (L < 90.0) CHECK(d < 2.0);
+        }
+    CHECK(sum / double(n) < 0.02);
+    CHECK(off * 1000 < n);
+
+    CHECK(maxChroma(0.0, 30.0) == 0.0 && maxChroma(100.0, 30.0) == 0.0);
+}
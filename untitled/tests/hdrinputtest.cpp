@@ -0,0 +1,123 @@
+#include "check.h"
+#include "hdrinput.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+std::string tempPath(const char *name) {
+    return (std::filesystem::temp_directory_path() / (std::string("colour-tests-") + name)).string();
+}
+
+void writeFile(const std::string &path, const std::string &header, const std::vector<float> &data, bool swap) {
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    std::fwrite(header.data(), 1, header.size(), f);
+    for (float v : data) {
+        uint8_t b[4];
+        std::memcpy(b, &v, 4);
+        if (swap) { std::swap(b[0], b[3]); std::swap(b[1], b[2]); }
+        std::fwrite(b, 1, 4, f);
+    }
+    std::fclose(f);
+}
+
+bool littleEndian() {
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+}
+
+// запись и чтение: значения вне 0..1 сохраняются, строки остаются на местах
+TEST(pfmRoundTrip) {
+    Image<float> rgb(5, 3, 3);
+    for (std::size_t i = 0; i < rgb.pixels.size(); ++i) rgb.pixels[i] = float(i) * 0.37f - 2.0f;
+    const std::string path = tempPath("rgb.pfm");
+    std::string error;
+    REQUIRE(savePfm(path, rgb.view(), &error));
+    Image<float> back;
+    REQUIRE(loadPfm(path, back, &error));
+    CHECK(back.width == 5 && back.height == 3 && back.channels == 3);
+    CHECK(back.pixels == rgb.pixels);
+
+    // Pf — серый, при чтении разворачивается в RGB
+    Image<float> grey(4, 2, 1);
+    for (std::size_t i = 0; i < grey.pixels.size(); ++i) grey.pixels[i] = float(i) + 0.5f;
+    REQUIRE(savePfm(path, grey.view(), &error));
+    REQUIRE(loadPfm(path, back, &error));
+    REQUIRE(back.width == 4 && back.height == 2 && back.channels == 3);
+    bool same = true;
+    for (int y = 0; y < 2; ++y)
+        for (int x = 0; x < 4; ++x)
+            for (int c = 0; c < 3; ++c) same = same && back.view().row(y)[x * 3 + c] == grey.view().row(y)[x];
+    CHECK(same);
+    std::filesystem::remove(path);
+}
+
+// оба порядка байт: знак масштаба говорит, какой записан
+TEST(pfmByteOrder) {
+    // в файле строки снизу вверх: первая записанная — нижняя
+    const std::vector<float> data = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f,
+                                      -1.5f, 0.25f, 100.0f, 7.0f, 8.0f, 9.0f };
+    const std::string path = tempPath("order.pfm");
+    for (int big = 0; big < 2; ++big) {
+        writeFile(path, big ? "PF\n2 2\n1.0\n" : "PF\n2 2\n-1.0\n", data, bool(big) == littleEndian());
+        Image<float> img;
+        std::string error;
+        REQUIRE(loadPfm(path, img, &error));
+        REQUIRE(img.width == 2 && img.height == 2);
+        CHECK(std::memcmp(img.view().row(1), data.data(), 6 * sizeof(float)) == 0);
+        CHECK(std::memcmp(img.view().row(0), data.data() + 6, 6 * sizeof(float)) == 0);
+    }
+
+    // Pf в обратном порядке байт
+    writeFile(path, "Pf\n3 1\n1.0\n", { 0.5f, -0.5f, 2.0f }, littleEndian());
+    Image<float> img;
+    REQUIRE(loadPfm(path, img, nullptr));
+    CHECK(img.pixels == std::vector<float>({ 0.5f, 0.5f, 0.5f, -0.5f, -0.5f, -0.5f, 2.0f, 2.0f, 2.0f }));
+    std::filesystem::remove(path);
+}
+
+// заголовок с огромными размерами и коротким телом — ошибка, а не попытка выделить память
+TEST(pfmRejectsHostileHeader) {
+    const std::string path = tempPath("hostile.pfm");
+    writeFile(path, "PF\n2147483647 2147483647\n-1.0\n", { 1.0f, 2.0f, 3.0f }, false);
+    Image<float> img;
+    std::string error;
+    CHECK(!loadPfm(path, img, &error));
+    CHECK(!error.empty());
+
+    writeFile(path, "Pf\n4 4\n-1.0\n", std::vector<float>(15, 1.0f), false);
+    CHECK(!loadPfm(path, img, nullptr));
+    writeFile(path, "Pf\n4 4\n-1.0\n", std::vector<float>(16, 1.0f), false);
+    CHECK(loadPfm(path, img, nullptr));
+    std::filesystem::remove(path);
+}
+
+// линейный вход не обрезается: ярче белого — L > 100, отрицательный — Y < 0
+TEST(linearInputUnclamped) {
+    const float rgb[] = { 2.0f, 2.0f, 2.0f, -0.1f, -0.1f, -0.1f, 1.0f, 1.0f, 1.0f };
+    Lab lab[3];
+    XYZ xyz[3];
+    linearFloatToLabBatch(rgb, 3, lab, 3);
+    linearFloatToXyzBatch(rgb, 3, xyz, 3);
+    CHECK(lab[0].L > 100.0);
+    CHECK(xyz[1].Y < 0.0);
+    CHECK(lab[1].L < 0.0);
+    CHECK(lab[2].L > 99.9 && lab[2].L < 100.1);
+
+    // half: 2.0 = 0x4000, -0.1 ~ 0xae66
+    const uint16_t half[] = { 0x4000, 0x4000, 0x4000, 0xae66, 0xae66, 0xae66 };
+    Lab hl[2];
+    linearHalfToLabBatch(half, 3, hl, 2);
+    CHECK(hl[0].L > 100.0 && hl[0].L - lab[0].L < 0.01 && lab[0].L - hl[0].L < 0.01);
+    CHECK(hl[1].L < 0.0);
+}
@@ -0,0 +1,215 @@
+#include "check.h"
+#include "iccprofile.h"
+#include "icctransform.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// Минимальный профиль в памяти: заголовок, таблица тегов, тела тегов с выравниванием на 4.
+struct ProfileWriter {
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> tags;
+
+    static void put32(std::vector<uint8_t> &b, uint32_t v) {
+        for (int s = 24; s >= 0; s -= 8) b.push_back(uint8_t(v >> s));
+    }
+    static void put16(std::vector<uint8_t> &b, uint16_t v) {
+        b.push_back(uint8_t(v >> 8));
+        b.push_back(uint8_t(v));
+    }
+    static void putSig(std::vector<uint8_t> &b, const char *s) { b.insert(b.end(), s, s + 4); }
+    static void putFixed(std::vector<uint8_t> &b, double v) { put32(b, uint32_t(int32_t(std::lround(v * 65536.0)))); }
+
+    void xyz(const char *tag, double x, double y, double z) {
+        std::vector<uint8_t> b;
+        putSig(b, "XYZ ");
+        put32(b, 0);
+        putFixed(b, x); putFixed(b, y); putFixed(b, z);
+        tags.emplace_back(tag, b);
+    }
+    // para функции 3 с параметрами sRGB
+    void srgbCurve(const char *tag) {
+        std::vector<uint8_t> b;
+        putSig(b, "para");
+        put32(b, 0);
+        put16(b, 3); put16(b, 0);
+        for (double v : { 2.4, 1.0 / 1.055, 0.055 / 1.055, 1.0 / 12.92, 0.04045 }) putFixed(b, v);
+        tags.emplace_back(tag, b);
+    }
+    void raw(const char *tag, std::vector<uint8_t> body) { tags.emplace_back(tag, std::move(body)); }
+
+    std::vector<uint8_t> build(const char *space, const char *pcs) const {
+        std::vector<uint8_t> out(128, 0);
+        out[8] = 4;
+        std::memcpy(&out[12], "mntr", 4);
+        std::memcpy(&out[16], space, 4);
+        std::memcpy(&out[20], pcs, 4);
+        std::memcpy(&out[36], "acsp", 4);
+        put32(out, uint32_t(tags.size()));
+        std::size_t at = 128 + 4 + 12 * tags.size();
+        std::vector<uint8_t> bodies;
+        for (const auto &t : tags) {
+            putSig(out, t.first.c_str());
+            put32(out, uint32_t(at + bodies.size()));
+            put32(out, uint32_t(t.second.size()));
+            bodies.insert(bodies.end(), t.second.begin(), t.second.end());
+            while (bodies.size() % 4) bodies.push_back(0);
+        }
+        out.insert(out.end(), bodies.begin(), bodies.end());
+        const uint32_t size = uint32_t(out.size());
+        for (int i = 0; i < 4; ++i) out[i] = uint8_t(size >> (24 - 8 * i));
+        return out;
+    }
+};
+
+std::vector<uint8_t> srgbProfile() {
+    ProfileWriter w;
+    // основные цвета sRGB, адаптированные к D50
+    w.xyz("rXYZ", 0.4361, 0.2225, 0.0139);
+    w.xyz("gXYZ", 0.3851, 0.7169, 0.0971);
+    w.xyz("bXYZ", 0.1431, 0.0606, 0.7141);
+    w.srgbCurve("rTRC");
+    w.srgbCurve("gTRC");
+    w.srgbCurve("bTRC");
+    w.xyz("wtpt", 0.9642, 1.0, 0.8249);
+    return w.build("RGB ", "XYZ ");
+}
+
+// mft2 с тождественными кривыми; grid == 2 даёт CLUT, где узел (r,g,b) — Lab v2 от L = 100 r
+std::vector<uint8_t> lut16Tag(int inChannels, int grid, std::size_t clutEntries) {
+    std::vector<uint8_t> b;
+    ProfileWriter::putSig(b, "mft2");
+    ProfileWriter::put32(b, 0);
+    b.push_back(uint8_t(inChannels)); b.push_back(3); b.push_back(uint8_t(grid)); b.push_back(0);
+    for (int i = 0; i < 9; ++i) ProfileWriter::putFixed(b, i % 4 == 0 ? 1.0 : 0.0);
+    ProfileWriter::put16(b, 2); ProfileWriter::put16(b, 2);
+    for (int c = 0; c < inChannels; ++c) { ProfileWriter::put16(b, 0); ProfileWriter::put16(b, 0xFFFF); }
+    for (std::size_t i = 0; i < clutEntries; ++i) {
+        const bool high = (i / 4) & 1;      // старший вход сетки 2x2x2 — красный
+        ProfileWriter::put16(b, high ? 0xFF00 : 0);
+        ProfileWriter::put16(b, 0x8000);
+        ProfileWriter::put16(b, 0x8000);
+    }
+    for (int c = 0; c < 3; ++c) { ProfileWriter::put16(b, 0); ProfileWriter::put16(b, 0xFFFF); }
+    return b;
+}
+
+double deltaE(const Lab &a, const Lab &b) {
+    return std::sqrt((a.L - b.L) * (a.L - b.L) + (a.a - b.a) * (a.a - b.a) + (a.b - b.b) * (a.b - b.b));
+}
+
+}
+
+
+TEST(iccMatrixTrcMatchesSrgb) {
+    const std::vector<uint8_t> bytes = srgbProfile();
+    IccProfile profile;
+    std::string error;
+    REQUIRE(parseIccProfile(bytes.data(), bytes.size(), profile, &error));
+    CHECK(profile.colorSpace() == IccColorSpace::RGB);
+    CHECK(profile.majorVersion() == 4);
+
+    const int samples[][3] = { {255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {255, 255, 255}, {128, 64, 200}, {10, 10, 10} };
+    for (const auto &s : samples) {
+        const double device[3] = { s[0] / 255.0, s[1] / 255.0, s[2] / 255.0 };
+        const Lab lab = profile.toLab(device, RenderingIntent::RelativeColorimetric);
+        CHECK(deltaE(lab, rgbToLab({ s[0], s[1], s[2] })) < 1.5);
+
+        double back[3];
+        profile.fromLab(lab, RenderingIntent::RelativeColorimetric, back);
+        for (int i = 0; i < 3; ++i) CHECK(std::abs(back[i] - device[i]) < 1e-3);
+    }
+}
+
+TEST(iccLut16Parses) {
+    ProfileWriter w;
+    w.raw("A2B0", lut16Tag(3, 2, 8));
+    const std::vector<uint8_t> bytes = w.build("RGB ", "Lab ");
+    IccProfile profile;
+    REQUIRE(parseIccProfile(bytes.data(), bytes.size(), profile));
+    const double redOn[3] = { 1.0, 0.0, 0.0 }, redOff[3] = { 0.0, 1.0, 1.0 };
+    const Lab high = profile.toLab(redOn, RenderingIntent::Perceptual);
+    const Lab low = profile.toLab(redOff, RenderingIntent::Perceptual);
+    CHECK(std::abs(high.L - 100.0) < 0.5 && std::abs(high.a) < 1.0 && std::abs(high.b) < 1.0);
+    CHECK(std::abs(low.L) < 0.5);
+}
+
+// сетка из заголовка не должна приводить к выделению памяти сверх размера тега
+TEST(iccRejectsOversizedClut) {
+    for (int inChannels : { 3, 8 }) {
+        ProfileWriter w;
+        w.raw("A2B0", lut16Tag(inChannels, 255, 8));
+        const std::vector<uint8_t> bytes = w.build("RGB ", "Lab ");
+        IccProfile profile;
+        std::string error;
+        CHECK(!parseIccProfile(bytes.data(), bytes.size(), profile, &error));
+        CHECK(!error.empty());
+    }
+
+    // mAB: кривые B, CLUT 255^3 при теге в сотню байт
+    std::vector<uint8_t> b;
+    ProfileWriter::putSig(b, "mAB ");
+    ProfileWriter::put32(b, 0);
+    b.push_back(3); b.push_back(3); b.push_back(0); b.push_back(0);
+    ProfileWriter::put32(b, 32);     // B
+    ProfileWriter::put32(b, 0);
+    ProfileWriter::put32(b, 0);
+    ProfileWriter::put32(b, 68);     // CLUT
+    ProfileWriter::put32(b, 0);
+    for (int i = 0; i < 3; ++i) { ProfileWriter::putSig(b, "curv"); ProfileWriter::put32(b, 0); ProfileWriter::put32(b, 0); }
+    for (int i = 0; i < 16; ++i) b.push_back(i < 3 ? 255 : 0);
+    b.push_back(2); b.push_back(0); b.push_back(0); b.push_back(0);
+    ProfileWriter w;
+    w.raw("A2B0", b);
+    const std::vector<uint8_t> bytes = w.build("RGB ", "Lab ");
+    IccProfile profile;
+    CHECK(!parseIccProfile(bytes.data(), bytes.size(), profile));
+}
+
+// обрезанный и испорченный профиль либо разбирается, либо отклоняется — без выхода за буфер
+TEST(iccMalformedInput) {
+    ProfileWriter w;
+    w.raw("A2B0", lut16Tag(3, 2, 8));
+    const std::vector<uint8_t> valid = w.build("RGB ", "Lab ");
+    for (std::size_t n = 0; n < valid.size(); ++n) {
+        std::vector<uint8_t> cut(valid.begin(), valid.begin() + n);
+        IccProfile profile;
+        CHECK(!parseIccProfile(cut.data(), cut.size(), profile));
+    }
+
+    std::mt19937 rng(56);
+    for (int it = 0; it < 2000; ++it) {
+        std::vector<uint8_t> bytes = valid;
+        for (int k = 0; k < 4; ++k) bytes[128 + rng() % (bytes.size() - 128)] = uint8_t(rng());
+        IccProfile profile;
+        if (parseIccProfile(bytes.data(), bytes.size(), profile) && profile.canConvertToLab(RenderingIntent::Perceptual)) {
+            const double device[3] = { 0.5, 0.5, 0.5 };
+            profile.toLab(device, RenderingIntent::Perceptual);
+        }
+    }
+}
+
+TEST(iccLabBatchOnlyForLabInput) {
+    const std::vector<uint8_t> bytes = srgbProfile();
+    IccProfile profile;
+    REQUIRE(parseIccProfile(bytes.data(), bytes.size(), profile));
+
+    const Lab lab[2] = { { 50.0, 20.0, -10.0 }, { 90.0, -5.0, 30.0 } };
+    float out[6] = {};
+    const IccTransform fromRgb(&profile, nullptr, RenderingIntent::RelativeColorimetric);
+    CHECK(!fromRgb.applyLabBatch(lab, out, 2));
+    CHECK(out[0] == 0.0f);
+
+    const IccTransform toRgb(nullptr, &profile, RenderingIntent::RelativeColorimetric);
+    REQUIRE(toRgb.applyLabBatch(lab, out, 2));
+    for (int i = 0; i < 2; ++i) {
+        const double src[3] = { lab[i].L, lab[i].a, lab[i].b };
+        double expected[3];
+        toRgb.apply(src, expected);
+        for (int c = 0; c < 3; ++c) CHECK(std::abs(out[3 * i + c] - expected[c]) < 1e-6);
+    }
+}
@@ -0,0 +1,81 @@
+#include "check.h"
+#include "colormodels.h"
+#include "inkcoverage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+Image<uint8_t> noise(int w, int h, int channels, unsigned seed) {
+    Image<uint8_t> image(w, h, channels);
+    std::mt19937 rng(seed);
+    for (uint8_t &v : image.pixels) v = uint8_t(rng());
+    return image;
+}
+
+}
+
+
+// полосы неровной высоты и деление по столбцам дают то же, что попиксельный расчёт
+TEST(inkCoverageStripsMatchReference) {
+    const int w = 1000, h = 90;
+    const Image<uint8_t> rgba = noise(w, h, 4, 69);
+    InkCoverageOptions options;
+    options.heatWidth = 7;      // клетки 143 px: строк карты в полосе мало, режется по столбцам
+    options.tac = 2.5;
+
+    InkCoverageMeter meter(w, h, options);
+    for (int y = 0; y < h; y += 37) {
+        const int rows = std::min(37, h - y);
+        meter.add(ImageView<const uint8_t>(rgba.pixels.data() + std::size_t(y) * w * 4, w, rows, 4, w * 4), y);
+    }
+    const InkCoverage c = meter.result();
+    const InkCoverage whole = measureInkCoverage(rgba.view(), options);
+
+    REQUIRE(c.count == std::size_t(w * h));
+    REQUIRE(c.heatWidth == 7 && c.heatHeight == 1);
+    std::vector<double> cellSum(7, 0.0), cellMax(7, 0.0);
+    double sum[4] = {}, tacSum = 0.0, tacMax = 0.0;
+    std::size_t over = 0;
+    std::vector<uint64_t> histogram(InkCoverage::HISTOGRAM_BINS, 0);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            const uint8_t *p = rgba.view().row(y) + x * 4;
+            const CMYK k = rgbToCmyk(RGB{ p[0], p[1], p[2] });
+            const double tac = k.c + k.m + k.y + k.k;
+            sum[0] += k.c; sum[1] += k.m; sum[2] += k.y; sum[3] += k.k;
+            tacSum += tac;
+            tacMax = std::max(tacMax, tac);
+            over += tac > 2.5 + 1e-6 ? 1 : 0;
+            ++histogram[std::size_t(std::min(int(float(tac) * 100.0f + 0.5f), InkCoverage::HISTOGRAM_BINS - 1))];
+            cellSum[std::size_t(x / c.cell)] += tac;
+            cellMax[std::size_t(x / c.cell)] = std::max(cellMax[std::size_t(x / c.cell)], tac);
+        }
+    for (int i = 0; i < 4; ++i) CHECK(std::abs(c.mean[i] - sum[i] / double(w * h)) < 1e-4);
+    CHECK(std::abs(c.meanTac - tacSum / double(w * h)) < 1e-4);
+    CHECK(std::abs(c.maxTac - tacMax) < 1e-4);
+    CHECK(c.overTac == over);
+    CHECK(c.histogram == histogram);
+    for (int x = 0; x < 7; ++x) {
+        const int cols = std::min(w, (x + 1) * c.cell) - x * c.cell;
+        CHECK(std::abs(c.heatMean[std::size_t(x)] - cellSum[std::size_t(x)] / double(cols * h)) < 1e-4);
+        CHECK(std::abs(c.heatMax[std::size_t(x)] - cellMax[std::size_t(x)]) < 1e-4);
+    }
+
+    CHECK(whole.count == c.count && whole.overTac == c.overTac && whole.histogram == c.histogram);
+    CHECK(whole.heatMax == c.heatMax);
+    CHECK(std::abs(whole.meanTac - c.meanTac) < 1e-9);
+}
+
+// строки вне изображения не считаются
+TEST(inkCoverageIgnoresRowsOutside) {
+    const Image<uint8_t> rgb = noise(64, 20, 3, 70);
+    InkCoverageMeter meter(64, 10);
+    meter.add(rgb.view(), 0);       // 20 строк, в изображении 10
+    meter.add(rgb.view(), -5);
+    CHECK(meter.result().count == std::size_t(64 * 10));
+}
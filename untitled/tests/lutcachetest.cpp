@@ -0,0 +1,41 @@
+#include "check.h"
+#include "lutcache.h"
+
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+
+// несколько писателей одной таблицы: каждый получает целые данные, временных файлов не остаётся
+TEST(lutCacheConcurrentWriters) {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "colour-tests-lutcache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    LutCache::setDirectory(dir.string());
+
+    const std::size_t count = 1 << 16;
+    std::vector<int> good(4, 0);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&, t]{
+            auto table = LutCache::obtain("lutCacheTest", 57, count, [count](float *v){
+                for (std::size_t i = 0; i < count; ++i) v[i] = float(i);
+            });
+            bool ok = true;
+            for (std::size_t i = 0; i < count; ++i) ok = ok && table.get()[i] == float(i);
+            good[std::size_t(t)] = ok;
+        });
+    }
+    for (std::thread &w : writers) w.join();
+    for (int ok : good) CHECK(ok);
+
+    int files = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        CHECK(entry.path().extension() == ".lut");
+        ++files;
+    }
+    CHECK(files == 1);
+
+    LutCache::setDirectory(std::string());
+    std::filesystem::remove_all(dir);
+}
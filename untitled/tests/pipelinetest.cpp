@@ -0,0 +1,145 @@
+#include "check.h"
+#include "pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+const int DEPTH = 3;
+
+struct Item { int index = -1; std::vector<int> data; };
+
+void pause(int microseconds) { std::this_thread::sleep_for(std::chrono::microseconds(microseconds)); }
+
+// конвейер над count элементами; fail* — номер элемента, на котором стадия
+// отказывает (-1 — нигде); encodeDelay — медленная запись
+struct Run {
+    int count = 100;
+    int failDecode = -1, failConvert = -1, failEncode = -1;
+    int encodeDelay = 0;
+
+    std::atomic<int> decoded{0}, converted{0}, written{0};
+    std::vector<int> encoded;   // только из потока записи
+    int maxInFlight = 0;        // прочитано, но ещё не записано
+
+    PipelineStats go() {
+        int next = 0;
+        return runPipeline<Item, Item>(DEPTH,
+            [&](Item &x, std::string *error){
+                if (next == count) return Decoded::End;
+                if (next == failDecode) {
+                    *error = "decode";
+                    return Decoded::Failed;
+                }
+                x.index = next++;
+                x.data.assign(64, x.index);
+                maxInFlight = std::max(maxInFlight, ++decoded - written);
+                // чуть неровное время чтения, чтобы стадии не шли в ногу
+                if (x.index % 7 == 0) pause(50);
+                return Decoded::Item;
+            },
+            [&](Item &x, Item &y, std::string *error){
+                if (x.index == failConvert) {
+                    *error = "convert";
+                    return false;
+                }
+                y.index = x.index;
+                y.data = x.data;
+                for (int &v : y.data) v *= 2;
+                ++converted;
+                if (x.index % 5 == 0) pause(30);
+                return true;
+            },
+            [&](Item &y, std::string *error){
+                if (y.index == failEncode) {
+                    *error = "encode";
+                    return false;
+                }
+                if (encodeDelay) pause(encodeDelay);
+                bool ok = true;
+                for (int v : y.data) ok = ok && v == y.index * 2;
+                encoded.push_back(ok ? y.index : -1);
+                ++written;
+                return true;
+            });
+    }
+};
+
+}
+
+// всё доходит до записи в исходном порядке и без порчи, результат — успех
+TEST(pipelineKeepsOrder) {
+    Run r;
+    const PipelineStats stats = r.go();
+    CHECK(!stats.failed);
+    CHECK(stats.failedStage == -1 && stats.error.empty());
+    REQUIRE(int(r.encoded.size()) == r.count);
+    for (int i = 0; i < r.count; ++i) CHECK(r.encoded[std::size_t(i)] == i);
+    for (int i = 0; i < 3; ++i) CHECK(stats.stages[i].items == std::size_t(r.count));
+
+    // пустой вход — тоже успех
+    Run empty;
+    empty.count = 0;
+    CHECK(!empty.go().failed);
+    CHECK(empty.encoded.empty());
+}
+
+// медленная запись сдерживает чтение: прочитанных, но не записанных — не больше
+// буферов на обеих сторонах, чтение ждёт свободный буфер
+TEST(pipelineBackPressure) {
+    Run r;
+    r.count = 40;
+    r.encodeDelay = 2000;
+    const PipelineStats stats = r.go();
+    CHECK(!stats.failed);
+    CHECK(int(r.encoded.size()) == r.count);
+    CHECK(r.maxInFlight <= 2 * DEPTH + 1);
+    CHECK(stats.stages[0].waitOutput > stats.stages[0].busy);
+    CHECK(stats.utilisation(2) > 0.5);
+}
+
+// ошибка любой стадии останавливает весь конвейер: потоки завершаются, стадия
+// и сообщение — в результате, после ошибки стадии больше почти ничего не делают
+TEST(pipelineStopsOnFailure) {
+    {
+        Run r;
+        r.failDecode = 10;
+        const PipelineStats stats = r.go();
+        CHECK(stats.failed && stats.failedStage == 0 && stats.error == "decode");
+        CHECK(r.decoded == 10);
+        CHECK(int(r.encoded.size()) <= 10);
+    }
+    {
+        Run r;
+        r.failConvert = 10;
+        const PipelineStats stats = r.go();
+        CHECK(stats.failed && stats.failedStage == 1 && stats.error == "convert");
+        CHECK(r.converted == 10);
+        CHECK(int(r.encoded.size()) <= 10);
+        CHECK(r.decoded <= 10 + 2 * DEPTH + 1);
+    }
+    {
+        Run r;
+        r.failEncode = 10;
+        r.encodeDelay = 200;
+        const PipelineStats stats = r.go();
+        CHECK(stats.failed && stats.failedStage == 2 && stats.error == "encode");
+        CHECK(int(r.encoded.size()) == 10);
+        CHECK(r.decoded <= 10 + 2 * DEPTH + 1);
+        CHECK(r.converted <= 10 + DEPTH + 1);
+    }
+    // отказ на первом же элементе
+    {
+        Run r;
+        r.failDecode = 0;
+        const PipelineStats stats = r.go();
+        CHECK(stats.failed && stats.failedStage == 0);
+        CHECK(r.encoded.empty());
+    }
+}
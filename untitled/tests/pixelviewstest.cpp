@@ -0,0 +1,77 @@
+#include "check.h"
+#include "pixelviews.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+Image<uint8_t> noise(int w, int h, int channels, unsigned seed) {
+    Image<uint8_t> image(w, h, channels);
+    std::mt19937 rng(seed);
+    for (uint8_t &v : image.pixels) v = uint8_t(rng());
+    return image;
+}
+
+}
+
+
+// цепочка с ΔE на RGBA совпадает с попиксельным расчётом
+TEST(pixelViewsDeltaE) {
+    const Image<uint8_t> rgba = noise(700, 33, 4, 63);
+    const Lab ref = { 50.0, 10.0, -20.0 };
+    const PixelViews::Summary s = PixelViews::summarize(
+        PixelViews::pixels(rgba.view()) | PixelViews::toXyz() | PixelViews::toLab() | PixelViews::deltaE(ref), 40.0);
+
+    double sum = 0.0, max = 0.0;
+    std::size_t over = 0;
+    for (std::size_t i = 0; i < rgba.pixels.size(); i += 4) {
+        const uint8_t *p = &rgba.pixels[i];
+        const double d = deltaE76(rgbToLab(RGB{ p[0], p[1], p[2] }), ref);
+        sum += d;
+        max = std::max(max, d);
+        over += d > 40.0 ? 1 : 0;
+    }
+    CHECK(s.count == rgba.pixels.size() / 4);
+    CHECK(std::abs(s.mean() - sum / double(s.count)) < 1e-3);
+    CHECK(std::abs(s.max - max) < 1e-2);
+    CHECK(std::abs(double(s.over) - double(over)) <= 2.0);
+}
+
+// map на исходных отсчётах идёт по пикселям, а не по байтам; mapPixel видит все каналы
+TEST(pixelViewsMapHonoursChannels) {
+    const Image<uint8_t> rgba = noise(300, 7, 4, 64);
+    double red = 0.0, alpha = 0.0;
+    for (std::size_t i = 0; i < rgba.pixels.size(); i += 4) {
+        red += rgba.pixels[i];
+        alpha += rgba.pixels[i + 3];
+    }
+    using namespace PixelViews;
+    const Summary first = summarize(pixels(rgba.view()) | map<uint8_t>([](uint8_t v){ return double(v); }));
+    const Summary last = summarize(pixels(rgba.view()) | mapPixel<uint8_t>([](const uint8_t *p){ return double(p[3]); }));
+    CHECK(first.count == std::size_t(300 * 7));
+    CHECK(first.sum == red);
+    CHECK(last.sum == alpha);
+
+    // шаг после шага: значения уже по одному на пиксель
+    const Summary lightness = summarize(pixels(rgba.view()) | toXyz() | toLab() | map<Lab>([](const Lab &l){ return l.L; }));
+    double expected = 0.0;
+    for (std::size_t i = 0; i < rgba.pixels.size(); i += 4)
+        expected += rgbToLab(RGB{ rgba.pixels[i], rgba.pixels[i + 1], rgba.pixels[i + 2] }).L;
+    CHECK(std::abs(lightness.sum - expected) / double(lightness.count) < 1e-3);
+}
+
+TEST(pixelViewsWriteTo) {
+    const Image<uint8_t> rgb = noise(517, 19, 3, 65);
+    Image<Lab8> lab(517, 19, 1);
+    PixelViews::writeTo(PixelViews::pixels(rgb.view()) | PixelViews::toXyz() | PixelViews::toLab8(), lab.view());
+    std::vector<Lab8> expected(lab.pixels.size());
+    rgbToLab8Batch(rgb.pixels.data(), 3, expected.data(), expected.size());
+    int worst = 0;
+    for (std::size_t i = 0; i < expected.size(); ++i)
+        worst = std::max({ worst, std::abs(lab.pixels[i].L - expected[i].L), std::abs(lab.pixels[i].a - expected[i].a),
+                           std::abs(lab.pixels[i].b - expected[i].b) });
+    CHECK(worst <= 1);
+}
@@ -0,0 +1,109 @@
+#include "check.h"
+#include "separation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+// сетка RGB с шагом 5 плюс тёмные насыщенные цвета, где предел срабатывает чаще всего
+std::vector<uint8_t> rgbGrid() {
+    std::vector<uint8_t> rgb;
+    for (int r = 0; r < 256; r += 5)
+        for (int g = 0; g < 256; g += 5)
+            for (int b = 0; b < 256; b += 5) rgb.insert(rgb.end(), { uint8_t(r), uint8_t(g), uint8_t(b) });
+    rgb.insert(rgb.end(), { 0, 0, 25, 0, 0, 0, 25, 0, 0, 10, 0, 30, 0, 0, 255, 1, 2, 3 });
+    return rgb;
+}
+
+std::vector<SeparationParams> paramSets() {
+    std::vector<SeparationParams> sets;
+    for (auto method : { SeparationParams::Method::GCR, SeparationParams::Method::UCR })
+        for (double tac : { 3.0, 2.4, 1.5 })
+            for (double amount : { 1.0, 0.5, 0.0 }) {
+                SeparationParams p;
+                p.method = method;
+                p.tac = tac;
+                p.blackAmount = amount;
+                sets.push_back(p);
+            }
+    return sets;
+}
+
+}
+
+// точный путь: бисекция по K и пропорциональное уменьшение CMY держат предел
+TEST(separationExactRespectsTac) {
+    const std::vector<uint8_t> rgb = rgbGrid();
+    const std::size_t n = rgb.size() / 3;
+    std::vector<CMYK> cmyk(n);
+    for (const SeparationParams &p : paramSets()) {
+        CmykSeparation separation(p, TableBuild::Later);
+        separation.separateBatch(rgb.data(), 3, cmyk.data(), n);
+        double worst = 0.0;
+        for (const CMYK &c : cmyk) worst = std::max(worst, totalAreaCoverage(c));
+        CHECK(worst <= p.tac + 1e-9);
+    }
+
+    // чистый синий при 150 %: чёрного нет, остаётся только уменьшить C и M
+    SeparationParams p;
+    p.tac = 1.5;
+    const CMYK blue = CmykSeparation(p, TableBuild::Later).separate(RGB{ 0, 0, 255 });
+    CHECK(blue.k == 0.0 && std::fabs(blue.c - 0.75) < 1e-9 && std::fabs(blue.m - 0.75) < 1e-9);
+    // чёрный при 150 %: только K
+    const CMYK black = CmykSeparation(p, TableBuild::Later).separate(RGB{ 0, 0, 0 });
+    CHECK(totalAreaCoverage(black) <= 1.5 + 1e-9 && black.k > 0.99);
+}
+
+// путь через 3D-таблицу: после интерполяции предел тоже не превышается,
+// от точного на оттиске отличается меньше чем на 5 % там, где предел не работает,
+// в среднем по сетке — меньше 0,3 %
+TEST(separationLutRespectsTac) {
+    const std::vector<uint8_t> rgb = rgbGrid();
+    const std::size_t n = rgb.size() / 3;
+    std::vector<CMYK> exact(n), table(n);
+    for (const SeparationParams &p : paramSets()) {
+        CmykSeparation slow(p, TableBuild::Later), fast(p);
+        REQUIRE(fast.tablesReady());
+        slow.separateBatch(rgb.data(), 3, exact.data(), n);
+        fast.separateBatch(rgb.data(), 3, table.data(), n);
+
+        double worst = 0.0, maxDiff = 0.0, sumDiff = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            worst = std::max(worst, totalAreaCoverage(table[i]));
+            // сравниваем то, что видно на оттиске: (1 - C)(1 - K) по каждой краске и K
+            const CMYK &a = exact[i], &b = table[i];
+            auto ink = [](double v, double k){ return (1.0 - v) * (1.0 - k); };
+            const double d = std::max({ std::fabs(ink(a.c, a.k) - ink(b.c, b.k)), std::fabs(ink(a.m, a.k) - ink(b.m, b.k)),
+                                        std::fabs(ink(a.y, a.k) - ink(b.y, b.k)), std::fabs(a.k - b.k) });
+            sumDiff += d;
+            // у границы предела точное решение меняется скачком — там таблица не обязана совпадать
+            if (totalAreaCoverage(a) < p.tac - 0.1) maxDiff = std::max(maxDiff, d);
+        }
+        CHECK(worst <= p.tac + 1e-5);
+        CHECK(maxDiff < 0.05);
+        CHECK(sumDiff / double(n) < 0.003);
+    }
+}
+
+// UCR: чёрный только в почти нейтральных тонах; GCR: и в насыщенных тёмных
+TEST(separationUcrAndGcrBlack) {
+    SeparationParams ucr, gcr;
+    ucr.method = SeparationParams::Method::UCR;
+    gcr.method = SeparationParams::Method::GCR;
+    const CmykSeparation u(ucr, TableBuild::Later), g(gcr, TableBuild::Later);
+
+    for (RGB gray : { RGB{ 0, 0, 0 }, RGB{ 40, 40, 40 }, RGB{ 100, 100, 100 }, RGB{ 40, 45, 50 } }) {
+        CHECK(u.separate(gray).k > 0.2);
+        CHECK(g.separate(gray).k > 0.2);
+    }
+    for (RGB dark : { RGB{ 0, 0, 80 }, RGB{ 90, 0, 0 }, RGB{ 0, 90, 0 }, RGB{ 100, 0, 100 } }) {
+        CHECK(u.separate(dark).k == 0.0);
+        CHECK(g.separate(dark).k > 0.1);
+    }
+    // светлые тона без серой составляющей — без чёрного у обоих
+    CHECK(u.separate(RGB{ 255, 200, 220 }).k == 0.0);
+    CHECK(g.separate(RGB{ 255, 200, 220 }).k == 0.0);
+}
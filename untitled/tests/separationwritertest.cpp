@@ -0,0 +1,145 @@
+#include "batchconvert.h"
+#include "check.h"
+#include "separationwriter.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+// ширина 8192 — в буфер плоскости входит 128 строк: при 300 строках буфер
+// сбрасывается дважды посреди полос и ещё раз в close
+const int W = 8192, H = 300;
+
+std::array<std::string, 4> planePaths(const std::string &prefix) {
+    std::array<std::string, 4> paths;
+    for (int p = 0; p < 4; ++p)
+        paths[std::size_t(p)] = (std::filesystem::temp_directory_path() /
+                                 ("colour-tests-" + prefix + '-' + SeparationWriter::PLANES[p] + ".pgm")).string();
+    return paths;
+}
+
+std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+bool anyExists(const std::array<std::string, 4> &paths) {
+    for (const std::string &p : paths)
+        if (std::filesystem::exists(p)) return true;
+    return false;
+}
+
+Image<uint8_t> testImage() {
+    Image<uint8_t> rgb(W, H, 3);
+    for (std::size_t i = 0; i < rgb.pixels.size(); ++i) rgb.pixels[i] = uint8_t(i * 7 + (i >> 11));
+    return rgb;
+}
+
+// полосами неровной высоты, чтобы границы полос не совпадали с буфером
+bool writeInStrips(SeparationWriter &writer, const Image<uint8_t> &rgb, int rows, std::string *error) {
+    const ImageView<const uint8_t> view(rgb.pixels.data(), rgb.width, rgb.height, rgb.channels,
+                                        std::ptrdiff_t(rgb.width) * rgb.channels);
+    for (int y = 0; y < rows; y += 37) {
+        const int n = std::min(37, rows - y);
+        if (!writer.add(ImageView<const uint8_t>(view.row(y), view.width, n, view.channels, view.stride), error)) return false;
+    }
+    return true;
+}
+
+}
+
+// заголовки P5 и плоскости = 255 - краска, как у rgbToCmyk8Batch
+TEST(separationWriterPlanes) {
+    const Image<uint8_t> rgb = testImage();
+    const std::array<std::string, 4> paths = planePaths("planes");
+    SeparationWriter writer;
+    std::string error;
+    REQUIRE(writer.open(paths, W, H, nullptr, &error));
+    REQUIRE(writeInStrips(writer, rgb, H, &error));
+    CHECK(writer.rowsWritten() == H);
+    REQUIRE(writer.close(&error));
+
+    std::vector<CMYK8> cmyk(std::size_t(W) * H);
+    rgbToCmyk8Batch(rgb.pixels.data(), 3, cmyk.data(), cmyk.size());
+    const std::string header = "P5\n" + std::to_string(W) + ' ' + std::to_string(H) + "\n255\n";
+    for (int p = 0; p < 4; ++p) {
+        const std::string file = readFile(paths[std::size_t(p)]);
+        REQUIRE(file.size() == header.size() + cmyk.size());
+        CHECK(file.compare(0, header.size(), header) == 0);
+        std::size_t bad = 0;
+        for (std::size_t i = 0; i < cmyk.size(); ++i) {
+            const uint8_t ink = p == 0 ? cmyk[i].c : p == 1 ? cmyk[i].m : p == 2 ? cmyk[i].y : cmyk[i].k;
+            bad += uint8_t(file[header.size() + i]) != uint8_t(255 - ink) ? 1 : 0;
+        }
+        CHECK(bad == 0);
+    }
+    for (const std::string &p : paths) std::filesystem::remove(p);
+}
+
+// с пределом красок — то же, что separateBatch + encodeCmyk8
+TEST(separationWriterWithSeparation) {
+    const Image<uint8_t> rgb = testImage();
+    const std::array<std::string, 4> paths = planePaths("tac");
+    SeparationParams params;
+    params.tac = 2.4;
+    const CmykSeparation separation(params);
+    std::string error;
+    REQUIRE(writeSeparationPlanes(ImageView<const uint8_t>(rgb.pixels.data(), W, H, 3, std::ptrdiff_t(W) * 3),
+                                  paths, &separation, &error));
+
+    std::vector<CMYK> cmyk(std::size_t(W) * H);
+    separation.separateBatch(rgb.pixels.data(), 3, cmyk.data(), cmyk.size());
+    const std::string k = readFile(paths[3]), c = readFile(paths[0]);
+    const std::size_t header = k.size() - cmyk.size();
+    std::size_t bad = 0;
+    for (std::size_t i = 0; i < cmyk.size(); ++i) {
+        const CMYK8 e = encodeCmyk8(cmyk[i]);
+        bad += uint8_t(k[header + i]) != uint8_t(255 - e.k) || uint8_t(c[header + i]) != uint8_t(255 - e.c) ? 1 : 0;
+    }
+    CHECK(bad == 0);
+    for (const std::string &p : paths) std::filesystem::remove(p);
+}
+
+// недописанные плоскости discard удаляет; готовые после close — нет
+TEST(separationWriterDiscard) {
+    const Image<uint8_t> rgb = testImage();
+    const std::array<std::string, 4> paths = planePaths("discard");
+    std::string error;
+    {
+        SeparationWriter writer;
+        REQUIRE(writer.open(paths, W, H, nullptr, &error));
+        REQUIRE(writeInStrips(writer, rgb, 200, &error));    // один сброс буфера уже был
+        CHECK(!writer.close(&error));
+        CHECK(!error.empty());
+        writer.discard();
+        CHECK(!anyExists(paths));
+    }
+    {
+        SeparationWriter writer;
+        REQUIRE(writer.open(paths, W, H, nullptr, &error));
+        REQUIRE(writeInStrips(writer, rgb, 100, &error));
+        writer.discard();
+        CHECK(!anyExists(paths));
+    }
+    {
+        SeparationWriter writer;
+        REQUIRE(writer.open(paths, W, H, nullptr, &error));
+        REQUIRE(writeInStrips(writer, rgb, H, &error));
+        REQUIRE(writer.close(&error));
+        writer.discard();
+        for (const std::string &p : paths) CHECK(std::filesystem::exists(p));
+        for (const std::string &p : paths) std::filesystem::remove(p);
+    }
+
+    // последний файл не создаётся: три уже созданных удаляются
+    std::array<std::string, 4> blocked = planePaths("blocked");
+    blocked[3] = (std::filesystem::temp_directory_path() / "colour-tests-no-such-dir" / "K.pgm").string();
+    SeparationWriter writer;
+    CHECK(!writer.open(blocked, W, H, nullptr, &error));
+    CHECK(!anyExists(blocked));
+}
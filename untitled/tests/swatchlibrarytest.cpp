@@ -0,0 +1,122 @@
+#include "check.h"
+#include "swatchlibrary.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+struct TempDir {
+    std::filesystem::path path;
+    TempDir() : path(std::filesystem::temp_directory_path() / "colour-tests-swatches") {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~TempDir() { std::filesystem::remove_all(path); }
+    std::string file(const char *name) const { return (path / name).string(); }
+};
+
+void writeText(const std::string &path, const std::string &text) {
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+std::vector<char> readBytes(const std::string &path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::string &path, const std::vector<char> &bytes) {
+    std::ofstream(path, std::ios::binary).write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+}
+
+
+// список -> библиотека -> открытие: все образцы на месте, поиск совпадает с перебором
+TEST(swatchLibraryRoundTrip) {
+    TempDir dir;
+    std::string list = "name,colour\n";
+    std::mt19937 rng(66);
+    for (int i = 0; i < 3000; ++i) {
+        const int r = int(rng() % 256), g = int(rng() % 256), b = int(rng() % 256);
+        list += "sw" + std::to_string(i) + ",rgb(" + std::to_string(r) + "," + std::to_string(g) + "," + std::to_string(b) + ")\n";
+    }
+    list += "labbed\tlab(50, 20, -30)\ncmyked,cmyk(10%, 20%, 30%, 40%)\nbroken,rgb(nan, 0, 0)\n";
+    writeText(dir.file("list.csv"), list);
+
+    std::vector<SwatchEntry> entries;
+    REQUIRE(readSwatchList(dir.file("list.csv"), entries));
+    CHECK(entries.size() == 3002);
+    REQUIRE(writeSwatchLibrary(dir.file("lib.swl"), entries));
+
+    SwatchLibrary lib;
+    std::string error;
+    REQUIRE(lib.open(dir.file("lib.swl"), &error));
+    REQUIRE(lib.size() == entries.size());
+
+    std::size_t missing = 0;
+    for (const SwatchEntry &e : entries) {
+        double dE = 1.0;
+        const Swatch s = lib.at(lib.nearest(e.lab, &dE));
+        missing += dE > 1e-4;
+        if (s.name == e.name) CHECK(s.rgb.r == e.rgb.r && s.rgb.g == e.rgb.g && s.rgb.b == e.rgb.b);
+    }
+    CHECK(missing == 0);
+
+    std::size_t wrong = 0;
+    for (int q = 0; q < 500; ++q) {
+        const Lab lab = { double(rng() % 100), double(rng() % 200) - 100.0, double(rng() % 200) - 100.0 };
+        double best = INFINITY, dE = 0.0;
+        for (std::size_t i = 0; i < lib.size(); ++i) best = std::min(best, deltaE76(lib.at(i).lab, lab));
+        lib.nearest(lab, &dE);
+        wrong += std::abs(dE - best) > 1e-3;
+    }
+    CHECK(wrong == 0);
+}
+
+// обрезанный, чужой или испорченный файл не открывается или не роняет поиск
+TEST(swatchLibraryMalformed) {
+    TempDir dir;
+    writeText(dir.file("list.csv"), "a,#ff0000\nb,#00ff00\nc,#0000ff\nd,lab(50,0,0)\n");
+    std::vector<SwatchEntry> entries;
+    REQUIRE(readSwatchList(dir.file("list.csv"), entries));
+    REQUIRE(writeSwatchLibrary(dir.file("lib.swl"), entries));
+    const std::vector<char> valid = readBytes(dir.file("lib.swl"));
+
+    for (std::size_t n = 0; n < valid.size(); ++n) {
+        writeBytes(dir.file("cut.swl"), std::vector<char>(valid.begin(), valid.begin() + std::ptrdiff_t(n)));
+        SwatchLibrary lib;
+        CHECK(!lib.open(dir.file("cut.swl")));
+    }
+
+    std::vector<char> wrongMagic = valid;
+    wrongMagic[0] = 'X';
+    writeBytes(dir.file("magic.swl"), wrongMagic);
+    SwatchLibrary lib;
+    std::string error;
+    CHECK(!lib.open(dir.file("magic.swl"), &error));
+    CHECK(!error.empty());
+
+    // испорченные записи и имена: открытие проходит (проверяется только заголовок), поиск не выходит за файл
+    std::mt19937 rng(67);
+    for (int it = 0; it < 200; ++it) {
+        std::vector<char> bytes = valid;
+        for (int k = 0; k < 8; ++k) bytes[64 + rng() % (bytes.size() - 64)] = char(rng());
+        writeBytes(dir.file("bad.swl"), bytes);
+        SwatchLibrary bad;
+        if (!bad.open(dir.file("bad.swl"))) continue;
+        const std::size_t i = bad.nearest({ 50.0, 10.0, 10.0 });
+        CHECK(i < bad.size());
+        (void)bad.at(i).name.size();
+    }
+
+    writeText(dir.file("empty.csv"), "name,colour\nonly,header\n");
+    CHECK(!readSwatchList(dir.file("empty.csv"), entries, &error));
+    CHECK(!readSwatchList(dir.file("absent.csv"), entries));
+}
@@ -0,0 +1,47 @@
+#include "check.h"
+
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+struct TestCase {
+    const char *name;
+    void (*fn)();
+};
+
+std::vector<TestCase> &registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+int failures = 0;
+
+}
+
+int registerTest(const char *name, void (*fn)()) {
+    registry().push_back({ name, fn });
+    return 0;
+}
+
+void reportFailure(const char *file, int line, const char *expr) {
+    std::fprintf(stderr, "  %s:%d: CHECK(%s)\n", file, line, expr);
+    ++failures;
+}
+
+int main(int argc, char *argv[]) {
+    int failed = 0, run = 0;
+    for (const TestCase &t : registry()) {
+        if (argc > 1 && !std::strstr(t.name, argv[1])) continue;
+        const int before = failures;
+        t.fn();
+        ++run;
+        if (failures != before) {
+            ++failed;
+            std::fprintf(stderr, "FAIL %s\n", t.name);
+        }
+    }
+    std::fprintf(stderr, "%d tests, %d failed\n", run, failed);
+    return failed;
+}
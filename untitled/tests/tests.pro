@@ -0,0 +1,65 @@
+# Проверки движка: консольная программа без Qt, собирается вместе с исходниками
+# из ../ (всё, кроме окна). Запуск: tests [часть имени теста].
+
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= qt app_bundle
+TARGET = tests
+
+INCLUDEPATH += ..
+unix: LIBS += -pthread
+
+SOURCES += \
+    testmain.cpp \
+    adjustmentstest.cpp \
+    arenatest.cpp \
+    asyncfileiotest.cpp \
+    batchconverttest.cpp \
+    cmyklabtest.cpp \
+    colorgraphtest.cpp \
+    colorlisttest.cpp \
+    conversiondaemontest.cpp \
+    gamutmaptest.cpp \
+    hdrinputtest.cpp \
+    icctest.cpp \
+    inkcoveragetest.cpp \
+    lutcachetest.cpp \
+    pipelinetest.cpp \
+    pixelviewstest.cpp \
+    separationtest.cpp \
+    separationwritertest.cpp \
+    swatchlibrarytest.cpp \
+    tiffiotest.cpp \
+    tiledimagetest.cpp \
+    ycbcrtest.cpp \
+    ../adjustments.cpp \
+    ../arena.cpp \
+    ../asyncfileio.cpp \
+    ../batchconvert.cpp \
+    ../cmyklab.cpp \
+    ../colorgraph.cpp \
+    ../colorlist.cpp \
+    ../colormodels.cpp \
+    ../colorplanes.cpp \
+    ../conversiondaemon.cpp \
+    ../gamutmap.cpp \
+    ../hdrinput.cpp \
+    ../iccprofile.cpp \
+    ../icctransform.cpp \
+    ../inkcoverage.cpp \
+    ../lut.cpp \
+    ../lutcache.cpp \
+    ../mappedfile.cpp \
+    ../parallel.cpp \
+    ../pipeline.cpp \
+    ../separation.cpp \
+    ../separationwriter.cpp \
+    ../softproof.cpp \
+    ../swatchlibrary.cpp \
+    ../tiffconvert.cpp \
+    ../tiffio.cpp \
+    ../tiledimage.cpp \
+    ../ycbcr.cpp
+
+HEADERS += \
+    check.h
@@ -0,0 +1,218 @@
+#include "check.h"
+#include "tiffconvert.h"
+#include "tiffio.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// полосы шума вперемешку с ровными участками: и LZW, и PackBits есть что сжимать и что копировать
+std::vector<uint8_t> samples(int w, int h, int channels, int bits, unsigned seed) {
+    std::vector<uint8_t> v(std::size_t(w) * std::size_t(h) * std::size_t(channels) * std::size_t(bits / 8));
+    std::mt19937 rng(seed);
+    for (std::size_t i = 0; i < v.size(); ++i) v[i] = (i / 97) % 3 == 0 ? uint8_t(i / 500) : uint8_t(rng());
+    return v;
+}
+
+std::vector<uint8_t> writeMemory(const std::vector<uint8_t> &pixels, int w, int h, int channels, int bits,
+                                 const TiffWriteOptions &options) {
+    std::vector<uint8_t> out;
+    TiffWriter writer;
+    const std::size_t row = std::size_t(w) * std::size_t(channels) * std::size_t(bits / 8);
+    const TiffPhotometric photometric = channels == 4 ? TiffPhotometric::Separated : TiffPhotometric::RGB;
+    if (!writer.openMemory(&out, w, h, channels, bits, photometric, options)) return {};
+    // кусками неровной высоты
+    for (int y = 0; y < h; y += 37)
+        if (!writer.writeRows(pixels.data() + std::size_t(y) * row, std::ptrdiff_t(row), std::min(37, h - y))) return {};
+    if (!writer.close()) return {};
+    return out;
+}
+
+bool readMemory(const std::vector<uint8_t> &file, std::vector<uint8_t> &pixels, std::string *error = nullptr,
+                TiffInfo *info = nullptr) {
+    TiffReader reader;
+    if (!reader.openMemory(std::make_shared<const std::vector<uint8_t>>(file), "test.tif", error)) return false;
+    if (info) *info = reader.info();
+    const std::size_t row = reader.info().rowBytes();
+    pixels.assign(row * std::size_t(reader.info().height), 0);
+    return reader.readRows(0, reader.info().height, pixels.data(), std::ptrdiff_t(row), error);
+}
+
+// значение тега в каталоге little-endian TIFF от TiffWriter (SHORT или LONG, одно значение)
+void patchTag(std::vector<uint8_t> &file, uint16_t tag, uint32_t value) {
+    uint32_t ifd;
+    std::memcpy(&ifd, &file[4], 4);
+    uint16_t count;
+    std::memcpy(&count, &file[ifd], 2);
+    for (uint16_t i = 0; i < count; ++i) {
+        uint8_t *e = &file[ifd + 2 + 12u * i];
+        uint16_t t, type;
+        std::memcpy(&t, e, 2);
+        std::memcpy(&type, e + 2, 2);
+        if (t != tag) continue;
+        if (type == 3) {
+            const uint16_t s = uint16_t(value);
+            std::memcpy(e + 8, &s, 2);
+        } else {
+            std::memcpy(e + 8, &value, 4);
+        }
+    }
+}
+
+uint32_t tagValue(const std::vector<uint8_t> &file, uint16_t tag) {
+    uint32_t ifd;
+    std::memcpy(&ifd, &file[4], 4);
+    uint16_t count;
+    std::memcpy(&count, &file[ifd], 2);
+    for (uint16_t i = 0; i < count; ++i) {
+        const uint8_t *e = &file[ifd + 2 + 12u * i];
+        uint16_t t;
+        std::memcpy(&t, e, 2);
+        uint32_t v;
+        std::memcpy(&v, e + 8, 4);
+        if (t == tag) return v;
+    }
+    return 0;
+}
+
+}
+
+
+// запись и чтение для всех видов сжатия, 8 и 16 бит, полосами, одной полосой и тайлами
+TEST(tiffRoundTrip) {
+    const int w = 203, h = 150;
+    const TiffCompression kinds[] = { TiffCompression::None, TiffCompression::LZW, TiffCompression::PackBits };
+    for (TiffCompression kind : kinds)
+        for (int bits : { 8, 16 })
+            for (int layout = 0; layout < 3; ++layout) {
+                const int channels = layout == 2 ? 4 : 3;
+                const std::vector<uint8_t> pixels = samples(w, h, channels, bits, unsigned(bits + layout));
+                TiffWriteOptions options;
+                options.compression = kind;
+                options.predictor = kind == TiffCompression::LZW;
+                if (layout == 1) options.rowsPerStrip = h;
+                if (layout == 2) options.tileSize = 32;
+                const std::vector<uint8_t> file = writeMemory(pixels, w, h, channels, bits, options);
+                REQUIRE(!file.empty());
+                std::vector<uint8_t> back;
+                TiffInfo info;
+                std::string error;
+                CHECK(readMemory(file, back, &error, &info));
+                CHECK(info.compression == kind);
+                CHECK(info.tiled == (layout == 2));
+                CHECK(back == pixels);
+            }
+}
+
+// одна несжатая полоса на всё изображение читается любыми кусками строк
+TEST(tiffSingleStripRowRanges) {
+    const int w = 120, h = 300;
+    const std::vector<uint8_t> pixels = samples(w, h, 3, 16, 71);
+    TiffWriteOptions options;
+    options.compression = TiffCompression::None;
+    options.rowsPerStrip = h;
+    const std::vector<uint8_t> file = writeMemory(pixels, w, h, 3, 16, options);
+    TiffReader reader;
+    REQUIRE(reader.openMemory(std::make_shared<const std::vector<uint8_t>>(file), "single.tif"));
+    REQUIRE(reader.info().blockHeight == h);
+    const std::size_t row = reader.info().rowBytes();
+    std::vector<uint8_t> part(row * 50);
+    for (int y : { 250, 0, 123, 299 }) {
+        const int n = std::min(50, h - y);
+        REQUIRE(reader.readRows(y, n, part.data(), std::ptrdiff_t(row)));
+        CHECK(std::memcmp(part.data(), pixels.data() + std::size_t(y) * row, row * std::size_t(n)) == 0);
+    }
+}
+
+// испорченные файлы — ошибка, а не падение
+TEST(tiffMalformedInput) {
+    const int w = 64, h = 40;
+    const std::vector<uint8_t> pixels = samples(w, h, 3, 8, 72);
+    TiffWriteOptions lzw;
+    const std::vector<uint8_t> good = writeMemory(pixels, w, h, 3, 8, lzw);
+    REQUIRE(!good.empty());
+    std::vector<uint8_t> back;
+    std::string error;
+
+    CHECK(!readMemory(std::vector<uint8_t>(good.begin(), good.begin() + 6), back, &error));
+    CHECK(!readMemory(std::vector<uint8_t>(good.begin(), good.begin() + std::ptrdiff_t(good.size() / 2)), back, &error));
+    std::vector<uint8_t> notTiff = good;
+    notTiff[0] = 'X';
+    CHECK(!readMemory(notTiff, back, &error));
+    std::vector<uint8_t> farIfd = good;
+    const uint32_t far = uint32_t(good.size() + 100);
+    std::memcpy(&farIfd[4], &far, 4);
+    CHECK(!readMemory(farIfd, back, &error));
+
+    // данные полос — мусор: LZW не распаковывается
+    std::vector<uint8_t> garbage = good;
+    std::fill(garbage.begin() + 8, garbage.begin() + 8 + std::ptrdiff_t(tagValue(good, 279)), uint8_t(0xFF));
+    error.clear();
+    CHECK(!readMemory(garbage, back, &error));
+    CHECK(!error.empty());
+
+    // сжатая полоса на гигабайт отвергается при открытии
+    std::vector<uint8_t> huge = good;
+    patchTag(huge, 256, 20000);
+    patchTag(huge, 257, 20000);
+    patchTag(huge, 278, 20000);
+    TiffReader reader;
+    error.clear();
+    CHECK(!reader.openMemory(std::make_shared<const std::vector<uint8_t>>(huge), "huge.tif", &error));
+    CHECK(error.find("МБ") != std::string::npos);
+
+    // несжатая полоса короче, чем заявлено строками
+    TiffWriteOptions none;
+    none.compression = TiffCompression::None;
+    none.rowsPerStrip = h;
+    std::vector<uint8_t> shortStrip = writeMemory(pixels, w, h, 3, 8, none);
+    patchTag(shortStrip, 279, uint32_t(w * 3 * (h - 1)));
+    CHECK(!readMemory(shortStrip, back, &error));
+}
+
+// при ошибке чтения convertTiff не оставляет недописанный файл
+TEST(tiffConvertRemovesPartialOutput) {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "colour-tests-tiff";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const int w = 80, h = 600;
+    const std::vector<uint8_t> pixels = samples(w, h, 3, 8, 73);
+    TiffWriteOptions options;
+    options.rowsPerStrip = 16;
+    std::vector<uint8_t> file = writeMemory(pixels, w, h, 3, 8, options);
+    REQUIRE(!file.empty());
+    const std::string in = (dir / "in.tif").string(), out = (dir / "out.tif").string();
+    auto save = [](const std::string &path, const std::vector<uint8_t> &data){
+        std::FILE *f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+        return std::fclose(f) == 0 && ok;
+    };
+
+    // целый файл: та же модель — те же отсчёты
+    REQUIRE(save(in, file));
+    std::string error;
+    REQUIRE(convertTiff(in, out, TiffPhotometric::RGB, TiffWriteOptions(), &error));
+    TiffReader check;
+    REQUIRE(check.open(out, &error));
+    std::vector<uint8_t> back(pixels.size());
+    REQUIRE(check.readRows(0, h, back.data(), w * 3, &error));
+    CHECK(back == pixels);
+
+    // полосы во второй половине испорчены — перевод падает на середине, out удалён
+    std::filesystem::remove(out);
+    std::fill(file.begin() + std::ptrdiff_t(file.size() / 2), file.begin() + std::ptrdiff_t(file.size() / 2 + 500),
+              uint8_t(0xFF));
+    REQUIRE(save(in, file));
+    TiffReader corrupt;
+    CHECK(corrupt.open(in, &error));
+    CHECK(!convertTiff(in, out, TiffPhotometric::CIELab, TiffWriteOptions(), &error));
+    CHECK(!std::filesystem::exists(out));
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,142 @@
+#include "check.h"
+#include "parallel.h"
+#include "tiledimage.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+std::vector<uint8_t> noise(std::size_t bytes, unsigned seed) {
+    std::vector<uint8_t> v(bytes);
+    std::mt19937 rng(seed);
+    for (uint8_t &b : v) b = uint8_t(rng());
+    return v;
+}
+
+}
+
+
+// бюджет в пару тайлов: параллельное чтение идёт через вытеснение и загрузку с диска
+TEST(tiledImageSpillsUnderSmallBudget) {
+    const int w = 700, h = 500;
+    const std::vector<uint8_t> pixels = noise(std::size_t(w) * h * 3, 74);
+    TiledImageOptions options;
+    options.tileSize = 64;
+    options.memoryBudget = 1;       // сколько-то тайлов на поток всё равно дадут
+    TiledImage image;
+    REQUIRE(image.create(w, h, 3, 8, options));
+    REQUIRE(image.writeRect(0, 0, w, h, pixels.data(), w * 3));
+
+    std::atomic<int> bad{0};
+    parallelFor(image.tileCount(), 1, [&](int t0, int t1){
+        for (int t = t0; t < t1; ++t) {
+            TileRef tile = image.acquire(t, false);
+            if (!tile) {
+                ++bad;
+                continue;
+            }
+            for (int y = 0; y < tile.height; ++y)
+                if (std::memcmp(tile.row(y), &pixels[(std::size_t(tile.y + y) * w + std::size_t(tile.x)) * 3],
+                                std::size_t(tile.width) * 3) != 0) ++bad;
+        }
+    });
+    CHECK(bad == 0);
+    const TileCacheStats s = image.stats();
+    CHECK(s.spills > 0);
+    CHECK(s.loads > 0);
+
+    std::vector<uint8_t> back(pixels.size());
+    REQUIRE(image.readRect(0, 0, w, h, back.data(), w * 3));
+    CHECK(back == pixels);
+}
+
+// файл обмена в заданном каталоге не виден по имени и не трогает чужие файлы
+TEST(tiledImageSpillDirectoryLeavesNoFiles) {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "colour-tests-tiles";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    {
+        std::FILE *other = std::fopen((dir / "tiles-other.spill").string().c_str(), "wb");
+        REQUIRE(other);
+        std::fputs("keep", other);
+        std::fclose(other);
+    }
+    TiledImageOptions options;
+    options.tileSize = 32;
+    options.memoryBudget = 1;
+    options.spillDirectory = dir.string();
+    TiledImage a, b;
+    REQUIRE(a.create(200, 200, 1, 8, options));
+    REQUIRE(b.create(200, 200, 1, 8, options));
+    const std::vector<uint8_t> pixels = noise(200 * 200, 75);
+    REQUIRE(a.writeRect(0, 0, 200, 200, pixels.data(), 200));
+    std::vector<uint8_t> back(pixels.size());
+    REQUIRE(a.readRect(0, 0, 200, 200, back.data(), 200));
+    CHECK(back == pixels);
+    CHECK(a.stats().spills > 0);
+
+    int files = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        CHECK(entry.path().filename() == "tiles-other.spill");
+        ++files;
+    }
+    CHECK(files == 1);
+    CHECK(std::filesystem::file_size(dir / "tiles-other.spill") == 4);
+    std::filesystem::remove_all(dir);
+}
+
+// оттиск по тайлам совпадает с оттиском целого изображения; карта без окна — ΔE пикселя
+TEST(tiledSoftProofMatchesWholeImage) {
+    const int w = 300, h = 170;
+    const std::vector<uint8_t> pixels = noise(std::size_t(w) * h * 3, 76);
+    const SoftProof proof([](double r, double g, double b){ return unitRgbToCmyk(r, g, b); });
+
+    std::vector<uint8_t> proofed(pixels.size());
+    std::vector<float> dE(std::size_t(w) * h);
+    const SoftProof::Stats whole = proof.proofDeltaE(ImageView<const uint8_t>(pixels.data(), w, h, 3, w * 3),
+                                                     ImageView<uint8_t>(proofed.data(), w, h, 3, w * 3),
+                                                     ImageView<float>(dE.data(), w, h, 1, w));
+
+    TiledImageOptions options;
+    options.tileSize = 64;
+    TiledImage rgb, out, heat;
+    REQUIRE(rgb.create(w, h, 3, 8, options));
+    REQUIRE(rgb.writeRect(0, 0, w, h, pixels.data(), w * 3));
+    SoftProof::Stats tiled;
+    REQUIRE(softProofTiled(rgb, proof, out, &heat, &tiled, 0, options));
+
+    std::vector<uint8_t> back(pixels.size()), map(pixels.size());
+    REQUIRE(out.readRect(0, 0, w, h, back.data(), w * 3));
+    REQUIRE(heat.readRect(0, 0, w, h, map.data(), w * 3));
+    CHECK(back == proofed);
+    CHECK(tiled.count == whole.count);
+    CHECK(tiled.over == whole.over);
+    CHECK(std::abs(tiled.mean - whole.mean) < 1e-6);
+    CHECK(tiled.max == whole.max);
+    int off = 0;
+    for (std::size_t i = 0; i < dE.size(); ++i) {
+        const uint8_t *c = SoftProof::heatColor(dE[i]);
+        for (int k = 0; k < 3; ++k) off += std::abs(int(map[i * 3 + std::size_t(k)]) - int(c[k])) > 2;
+    }
+    CHECK(off == 0);
+
+    // однородное изображение: окно не меняет карту, в том числе у краёв и стыков тайлов
+    std::vector<uint8_t> flat(pixels.size());
+    for (std::size_t i = 0; i < flat.size(); i += 3) { flat[i] = 200; flat[i + 1] = 30; flat[i + 2] = 90; }
+    REQUIRE(rgb.writeRect(0, 0, w, h, flat.data(), w * 3));
+    REQUIRE(softProofTiled(rgb, proof, out, &heat, nullptr, 3, options));
+    REQUIRE(heat.readRect(0, 0, w, h, map.data(), w * 3));
+    double d = 0.0;
+    proof.proof(RGB{ 200, 30, 90 }, &d);
+    const uint8_t *c = SoftProof::heatColor(d);
+    off = 0;
+    for (std::size_t i = 0; i < map.size(); i += 3)
+        for (int k = 0; k < 3; ++k) off += std::abs(int(map[i + std::size_t(k)]) - int(c[k])) > 2;
+    CHECK(off == 0);
+}
@@ -0,0 +1,92 @@
+#include "check.h"
+#include "ycbcr.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+
+namespace {
+
+Image<uint8_t> noiseImage(int w, int h, int channels, unsigned seed) {
+    Image<uint8_t> img(w, h, channels);
+    for (uint8_t &v : img.pixels) {
+        seed = seed * 1103515245u + 12345u;
+        v = uint8_t(seed >> 16);
+    }
+    return img;
+}
+
+const YCbCrMatrix MATRICES[] = { YCbCrMatrix::BT601, YCbCrMatrix::BT709, YCbCrMatrix::BT2020 };
+const YCbCrRange RANGES[] = { YCbCrRange::Full, YCbCrRange::Limited };
+
+}
+
+// целочисленное ядро против точного расчёта в double, 4:4:4 без усреднения
+TEST(ycbcrKernelMatchesExact) {
+    const Image<uint8_t> rgb = noiseImage(67, 9, 3, 1);
+    for (YCbCrMatrix m : MATRICES)
+        for (YCbCrRange r : RANGES)
+            for (int bits : { 8, 10 }) {
+                YCbCrFormat fmt;
+                fmt.matrix = m;
+                fmt.range = r;
+                fmt.bitDepth = bits;
+                fmt.subsampling = ChromaSubsampling::S444;
+                int worst = 0;
+                auto check = [&](auto &frame) {
+                    rgbToYCbCr(rgb.view(), frame.view(), fmt);
+                    for (int y = 0; y < rgb.height; ++y)
+                        for (int x = 0; x < rgb.width; ++x) {
+                            const uint8_t *p = rgb.view().row(y) + x * 3;
+                            const YCbCr e = rgbToYCbCr(RGB{ p[0], p[1], p[2] }, fmt);
+                            worst = std::max({ worst, std::abs(int(frame.y.view().row(y)[x]) - e.y),
+                                               std::abs(int(frame.cb.view().row(y)[x]) - e.cb),
+                                               std::abs(int(frame.cr.view().row(y)[x]) - e.cr) });
+                        }
+                };
+                if (bits == 8) {
+                    YCbCrFrame<uint8_t> frame(rgb.width, rgb.height, fmt.subsampling);
+                    check(frame);
+                } else {
+                    YCbCrFrame<uint16_t> frame(rgb.width, rgb.height, fmt.subsampling);
+                    check(frame);
+                }
+                CHECK(worst <= 1);
+            }
+}
+
+// RGB -> YCbCr -> RGB: 4:4:4 почти без потерь, у 4:2:0 однотонные блоки 2x2 сохраняются
+TEST(ycbcrRoundTrip) {
+    for (ChromaSubsampling s : { ChromaSubsampling::S444, ChromaSubsampling::S422, ChromaSubsampling::S420 })
+        for (int channels : { 3, 4 }) {
+            Image<uint8_t> rgb = noiseImage(70, 11, channels, 7);
+            if (s != ChromaSubsampling::S444) {
+                // цвет постоянен в каждом блоке 2x2, нечётные края — тоже
+                for (int y = 0; y < rgb.height; ++y)
+                    for (int x = 0; x < rgb.width; ++x)
+                        for (int c = 0; c < channels; ++c)
+                            rgb.view().row(y)[x * channels + c] = rgb.view().row(y / 2 * 2)[x / 2 * 2 * channels + c];
+            }
+            YCbCrFormat fmt;
+            fmt.range = YCbCrRange::Full;
+            fmt.subsampling = s;
+            YCbCrFrame<uint8_t> frame(rgb.width, rgb.height, s);
+            rgbToYCbCr(rgb.view(), frame.view(), fmt);
+            Image<uint8_t> back(rgb.width, rgb.height, channels);
+            yCbCrToRgb(frame.view(), back.view(), fmt);
+            int worst = 0;
+            for (int y = 0; y < rgb.height; ++y)
+                for (int x = 0; x < rgb.width; ++x)
+                    for (int c = 0; c < 3; ++c)
+                        worst = std::max(worst, std::abs(rgb.view().row(y)[x * channels + c] - back.view().row(y)[x * channels + c]));
+            CHECK(worst <= 2);
+        }
+}
+
+TEST(ycbcrChromaSize) {
+    CHECK(chromaWidth(71, ChromaSubsampling::S444) == 71);
+    CHECK(chromaWidth(71, ChromaSubsampling::S422) == 36);
+    CHECK(chromaHeight(71, ChromaSubsampling::S422) == 71);
+    CHECK(chromaWidth(71, ChromaSubsampling::S420) == 36);
+    CHECK(chromaHeight(71, ChromaSubsampling::S420) == 36);
+}
@@ -0,0 +1,262 @@
+#include "tiffconvert.h"
+#include "arena.h"
+#include "batchconvert.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+// строк за один проход чтение -> перевод -> запись (не меньше ряда блоков файла)
+const int STRIP_ROWS = 256;
+// полос в пути между стадиями
+const int PIPELINE_DEPTH = 3;
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+// Строк в полосе конвейера: целое число рядов блоков источника, чтобы каждый
+// распаковывался один раз. Ряд выше STRIP_ROWS (например, одна полоса на всё
+// изображение) так не делится: несжатый читается прямо по строкам, сжатый
+// распаковывается один раз в кэш TiffReader, и куски идут из кэша.
+int stripRows(const TiffInfo &info) {
+    if (info.blockHeight > STRIP_ROWS) return std::min(info.height, STRIP_ROWS);
+    return std::min(info.height, STRIP_ROWS / info.blockHeight * info.blockHeight);
+}
+
+bool colourModel(TiffPhotometric p) {
+    return p == TiffPhotometric::RGB || p == TiffPhotometric::CIELab || p == TiffPhotometric::Separated;
+}
+
+}
+
+TiffRowConverter::TiffRowConverter(const TiffInfo &src, TiffPhotometric to)
+    : in(src), to(to)
+{
+    outChannels = to == TiffPhotometric::Separated ? 4 : 3;
+    ok = colourModel(src.photometric) && colourModel(to) && (src.bits == 8 || src.bits == 16);
+}
+
+std::size_t TiffRowConverter::outputRowBytes() const {
+    return std::size_t(in.width) * std::size_t(outChannels) * std::size_t(in.bits / 8);
+}
+
+void TiffRowConverter::convertRow(const uint8_t *src, uint8_t *dst) const {
+    const std::size_t n = std::size_t(in.width);
+    const int ch = in.channels;
+    if (in.photometric == to && ch == outChannels) {
+        std::memcpy(dst, src, outputRowBytes());
+        return;
+    }
+    ArenaScope scratch;
+    if (in.bits == 8) {
+        // RGB источника; для Lab и CMYK — через временную строку
+        const uint8_t *rgb = src;
+        int rgbChannels = ch;
+        if (in.photometric == TiffPhotometric::CIELab) {
+            Lab8 *lab = scratch.allocate<Lab8>(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                const uint8_t *p = src + i * std::size_t(ch);
+                lab[i] = { p[0], uint8_t(p[1] ^ 0x80), uint8_t(p[2] ^ 0x80) };
+            }
+            uint8_t *buf = scratch.allocate<uint8_t>(n * 3);
+            lab8ToRgbBatch(lab, buf, 3, n);
+            rgb = buf;
+            rgbChannels = 3;
+        } else if (in.photometric == TiffPhotometric::Separated) {
+            CMYK *cmyk = scratch.allocate<CMYK>(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                const uint8_t *p = src + i * std::size_t(ch);
+                cmyk[i] = decodeCmyk8({ p[0], p[1], p[2], p[3] });
+            }
+            uint8_t *buf = scratch.allocate<uint8_t>(n * 3);
+            cmykToRgbBatch(cmyk, buf, 3, n);
+            rgb = buf;
+            rgbChannels = 3;
+        }
+        switch (to) {
+        case TiffPhotometric::CIELab:
+            rgbToLab8Batch(rgb, rgbChannels, reinterpret_cast<Lab8 *>(dst), n);
+            iccLabToTiff(dst, 8, 3, n);
+            break;
+        case TiffPhotometric::Separated:
+            rgbToCmyk8Batch(rgb, rgbChannels, reinterpret_cast<CMYK8 *>(dst), n);
+            break;
+        default:
+            for (std::size_t i = 0; i < n; ++i)
+                std::memcpy(dst + 3 * i, rgb + i * std::size_t(rgbChannels), 3);
+            break;
+        }
+        return;
+    }
+
+    const uint16_t *s16 = reinterpret_cast<const uint16_t *>(src);
+    const uint16_t *rgb = s16;
+    int rgbChannels = ch;
+    if (in.photometric == TiffPhotometric::CIELab) {
+        Lab16 *lab = scratch.allocate<Lab16>(n);
+        for (std::size_t i = 0; i < n; ++i) std::memcpy(&lab[i], s16 + i * std::size_t(ch), sizeof(Lab16));
+        tiffLabToIcc(reinterpret_cast<uint8_t *>(lab), 16, 3, n);
+        uint16_t *buf = scratch.allocate<uint16_t>(n * 3);
+        lab16ToRgb16Batch(lab, buf, 3, n);
+        rgb = buf;
+        rgbChannels = 3;
+    } else if (in.photometric == TiffPhotometric::Separated) {
+        CMYK16 *cmyk = scratch.allocate<CMYK16>(n);
+        for (std::size_t i = 0; i < n; ++i) std::memcpy(&cmyk[i], s16 + i * std::size_t(ch), sizeof(CMYK16));
+        uint16_t *buf = scratch.allocate<uint16_t>(n * 3);
+        cmyk16ToRgb16Batch(cmyk, buf, 3, n);
+        rgb = buf;
+        rgbChannels = 3;
+    }
+    uint16_t *d16 = reinterpret_cast<uint16_t *>(dst);
+    switch (to) {
+    case TiffPhotometric::CIELab:
+        rgb16ToLab16Batch(rgb, rgbChannels, reinterpret_cast<Lab16 *>(d16), n);
+        iccLabToTiff(dst, 16, 3, n);
+        break;
+    case TiffPhotometric::Separated:
+        rgb16ToCmyk16Batch(rgb, rgbChannels, reinterpret_cast<CMYK16 *>(d16), n);
+        break;
+    default:
+        for (std::size_t i = 0; i < n; ++i)
+            std::memcpy(d16 + 3 * i, rgb + i * std::size_t(rgbChannels), 3 * sizeof(uint16_t));
+        break;
+    }
+}
+
+void TiffRowConverter::convert(const uint8_t *src, std::ptrdiff_t srcStride, uint8_t *dst, std::ptrdiff_t dstStride,
+                               int rows) const {
+    parallelFor(rows, ROWS_PER_TASK, [&](int y0, int y1){
+        for (int y = y0; y < y1; ++y) convertRow(src + std::ptrdiff_t(y) * srcStride, dst + std::ptrdiff_t(y) * dstStride);
+    });
+}
+
+bool convertTiff(const std::string &in, const std::string &out, TiffPhotometric to,
+                 const TiffWriteOptions &options, std::string *error, PipelineStats *stats) {
+    TiffReader reader;
+    if (!reader.open(in, error)) return false;
+    const TiffInfo &info = reader.info();
+    TiffRowConverter converter(info, to);
+    if (!converter.supported()) return fail(error, "перевод из этой цветовой модели не поддерживается: " + in);
+
+    TiffWriter writer;
+    if (!writer.open(out, info.width, info.height, converter.outputChannels(), info.bits, to, options, error)) {
+        writer.discard();
+        return false;
+    }
+    const int strip = stripRows(info);
+    const std::size_t inRow = info.rowBytes(), outRow = converter.outputRowBytes();
+
+    // чтение, перевод и запись полос идут одновременно в трёх потоках
+    struct Strip { int y = 0; int rows = 0; std::vector<uint8_t> data; };
+    int next = 0;
+    const PipelineStats run = runPipeline<Strip, Strip>(PIPELINE_DEPTH,
+        [&](Strip &s, std::string *stageError){
+            if (next >= info.height) return Decoded::End;
+            s.y = next;
+            s.rows = std::min(strip, info.height - next);
+            next += s.rows;
+            s.data.resize(inRow * std::size_t(s.rows));
+            return reader.readRows(s.y, s.rows, s.data.data(), std::ptrdiff_t(inRow), stageError) ? Decoded::Item
+                                                                                                  : Decoded::Failed;
+        },
+        [&](Strip &src, Strip &dst, std::string *){
+            dst.y = src.y;
+            dst.rows = src.rows;
+            dst.data.resize(outRow * std::size_t(src.rows));
+            converter.convert(src.data.data(), std::ptrdiff_t(inRow), dst.data.data(), std::ptrdiff_t(outRow), src.rows);
+            return true;
+        },
+        [&](Strip &s, std::string *stageError){
+            return writer.writeRows(s.data.data(), std::ptrdiff_t(outRow), s.rows, stageError);
+        });
+    if (stats) *stats = run;
+    // недописанный файл не оставляем
+    if (run.failed) {
+        writer.discard();
+        return fail(error, run.error);
+    }
+    if (writer.close(error)) return true;
+    writer.discard();
+    return false;
+}
+
+bool convertTiffMemory(const std::shared_ptr<const std::vector<uint8_t>> &in, const std::string &name,
+                       TiffPhotometric to, const TiffWriteOptions &options, std::vector<uint8_t> *out,
+                       std::string *error) {
+    TiffReader reader;
+    if (!reader.openMemory(in, name, error)) return false;
+    const TiffInfo &info = reader.info();
+    TiffRowConverter converter(info, to);
+    if (!converter.supported()) return fail(error, "перевод из этой цветовой модели не поддерживается: " + name);
+
+    TiffWriter writer;
+    if (!writer.openMemory(out, info.width, info.height, converter.outputChannels(), info.bits, to, options, error))
+        return false;
+    const int strip = stripRows(info);
+    const std::size_t inRow = info.rowBytes(), outRow = converter.outputRowBytes();
+    std::vector<uint8_t> src(inRow * std::size_t(strip)), dst(outRow * std::size_t(strip));
+    for (int y = 0; y < info.height; y += strip) {
+        const int n = std::min(strip, info.height - y);
+        if (!reader.readRows(y, n, src.data(), std::ptrdiff_t(inRow), error)) return false;
+        converter.convert(src.data(), std::ptrdiff_t(inRow), dst.data(), std::ptrdiff_t(outRow), n);
+        if (!writer.writeRows(dst.data(), std::ptrdiff_t(outRow), n, error)) return false;
+    }
+    return writer.close(error);
+}
+
+TiffBatchStats convertTiffFiles(const std::vector<TiffFileJob> &jobs, TiffPhotometric to,
+                                const TiffWriteOptions &options, int depth, bool preferUring) {
+    const auto start = std::chrono::steady_clock::now();
+    TiffBatchStats stats;
+    AsyncFileIO io(depth, preferUring);
+    stats.backend = io.backend();
+
+    // чтения держим впереди перевода, но не больше depth: записи тоже занимают память
+    std::size_t next = 0, reading = 0;
+    auto refill = [&]{
+        for (; next < jobs.size() && reading < std::size_t(depth) && io.pending() < 2 * std::size_t(depth); ++next, ++reading)
+            io.read(next, jobs[next].input);
+    };
+    refill();
+
+    AsyncFileIO::Result r;
+    while (io.wait(r)) {
+        if (r.write) {
+            if (r.error.empty()) ++stats.converted;
+            else {
+                ++stats.failed;
+                stats.errors.push_back(r.error);
+            }
+            refill();
+            continue;
+        }
+        --reading;
+        refill();
+        if (!r.error.empty()) {
+            ++stats.failed;
+            stats.errors.push_back(r.error);
+            continue;
+        }
+        stats.bytesRead += r.data.size();
+        auto data = std::make_shared<const std::vector<uint8_t>>(std::move(r.data));
+        std::vector<uint8_t> out;
+        std::string error;
+        if (!convertTiffMemory(data, r.path, to, options, &out, &error)) {
+            ++stats.failed;
+            stats.errors.push_back(r.path + ": " + error);
+            continue;
+        }
+        stats.bytesWritten += out.size();
+        io.write(r.id, jobs[r.id].output, std::move(out));
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
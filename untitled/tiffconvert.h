@@ -0,0 +1,70 @@
+#ifndef TIFFCONVERT_H
+#define TIFFCONVERT_H
+
+#include "asyncfileio.h"
+#include "pipeline.h"
+#include "tiffio.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Перевод строк TIFF из одной модели в другую той же разрядности (8 или 16 бит).
+// Источник — RGB, CIELab или CMYK с src.channels отсчётами на пиксель, результат —
+// 3 (RGB, Lab) или 4 (CMYK) отсчёта; Lab в кодировке TIFF. Всё, кроме RGB,
+// идёт через RGB пакетными функциями batchconvert.h (Lab -> RGB — labToRgb).
+class TiffRowConverter {
+public:
+    TiffRowConverter(const TiffInfo &src, TiffPhotometric to);
+
+    bool supported() const { return ok; }
+    int outputChannels() const { return outChannels; }
+    std::size_t outputRowBytes() const;
+
+    // строки параллельно
+    void convert(const uint8_t *src, std::ptrdiff_t srcStride, uint8_t *dst, std::ptrdiff_t dstStride, int rows) const;
+
+private:
+    void convertRow(const uint8_t *src, uint8_t *dst) const;
+
+    TiffInfo in;
+    TiffPhotometric to;
+    int outChannels = 3;
+    bool ok = false;
+};
+
+// in -> out полосами: чтение, перевод и запись — стадии конвейера (pipeline.h),
+// в памяти — несколько полос. stats (если задан) получает загрузку стадий.
+bool convertTiff(const std::string &in, const std::string &out, TiffPhotometric to,
+                 const TiffWriteOptions &options = TiffWriteOptions(), std::string *error = nullptr,
+                 PipelineStats *stats = nullptr);
+
+// Тот же перевод для файла, уже прочитанного в память; результат — в out.
+bool convertTiffMemory(const std::shared_ptr<const std::vector<uint8_t>> &in, const std::string &name,
+                       TiffPhotometric to, const TiffWriteOptions &options, std::vector<uint8_t> *out,
+                       std::string *error = nullptr);
+
+struct TiffFileJob {
+    std::string input;
+    std::string output;
+};
+
+struct TiffBatchStats {
+    AsyncFileIO::Backend backend = AsyncFileIO::Backend::Threads;
+    std::size_t converted = 0;
+    std::size_t failed = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    double seconds = 0.0;
+    std::vector<std::string> errors;    // по одной строке на неудачный файл
+};
+
+// Пакет файлов: чтение и запись идут через AsyncFileIO (до depth файлов в полёте
+// в каждую сторону), перевод — в вызывающем потоке, строки файла параллельно.
+TiffBatchStats convertTiffFiles(const std::vector<TiffFileJob> &jobs, TiffPhotometric to,
+                                const TiffWriteOptions &options = TiffWriteOptions(),
+                                int depth = 32, bool preferUring = true);
+
+#endif // TIFFCONVERT_H
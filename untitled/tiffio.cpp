@@ -0,0 +1,768 @@
+#include "tiffio.h"
+#include "arena.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+
+namespace {
+
+enum Tag : uint16_t {
+    IMAGE_WIDTH = 256, IMAGE_LENGTH = 257, BITS_PER_SAMPLE = 258, COMPRESSION = 259,
+    PHOTOMETRIC = 262, STRIP_OFFSETS = 273, SAMPLES_PER_PIXEL = 277, ROWS_PER_STRIP = 278,
+    STRIP_BYTE_COUNTS = 279, PLANAR_CONFIG = 284, PREDICTOR = 317, TILE_WIDTH = 322,
+    TILE_LENGTH = 323, TILE_OFFSETS = 324, TILE_BYTE_COUNTS = 325, INK_SET = 332, SAMPLE_FORMAT = 339
+};
+enum Type : uint16_t { BYTE = 1, SHORT = 3, LONG = 4 };
+
+const int LZW_CLEAR = 256;
+const int LZW_EOI = 257;
+const int LZW_FIRST = 258;
+const int LZW_MAX_BITS = 12;
+// запись: полосы собираются в группу примерно такого размера и сжимаются параллельно
+const std::size_t STRIP_GROUP_BYTES = 4 << 20;
+// чтение: сжатый ряд блоков распаковывается целиком, больше этого — отказ
+const std::size_t MAX_BAND_BYTES = std::size_t(256) << 20;
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+static inline uint16_t swap16(uint16_t v) { return uint16_t((v >> 8) | (v << 8)); }
+
+void swapSamples(uint8_t *p, std::size_t bytes) {
+    for (std::size_t i = 0; i + 1 < bytes; i += 2) std::swap(p[i], p[i + 1]);
+}
+
+// предсказатель 2: разность с тем же отсчётом соседнего пикселя слева
+void undoPredictor(uint8_t *p, int bits, int channels, int width, int rows, std::size_t rowBytes) {
+    for (int y = 0; y < rows; ++y, p += rowBytes) {
+        const std::size_t n = std::size_t(width) * std::size_t(channels);
+        if (bits == 8) {
+            for (std::size_t i = std::size_t(channels); i < n; ++i) p[i] = uint8_t(p[i] + p[i - channels]);
+        } else {
+            uint16_t *s = reinterpret_cast<uint16_t *>(p);
+            for (std::size_t i = std::size_t(channels); i < n; ++i) s[i] = uint16_t(s[i] + s[i - channels]);
+        }
+    }
+}
+
+void applyPredictor(uint8_t *p, int bits, int channels, int width, int rows, std::size_t rowBytes) {
+    for (int y = 0; y < rows; ++y, p += rowBytes) {
+        const std::size_t n = std::size_t(width) * std::size_t(channels);
+        if (bits == 8) {
+            for (std::size_t i = n; i-- > std::size_t(channels); ) p[i] = uint8_t(p[i] - p[i - channels]);
+        } else {
+            uint16_t *s = reinterpret_cast<uint16_t *>(p);
+            for (std::size_t i = n; i-- > std::size_t(channels); ) s[i] = uint16_t(s[i] - s[i - channels]);
+        }
+    }
+}
+
+std::size_t unpackBits(const uint8_t *in, std::size_t n, uint8_t *out, std::size_t outN) {
+    std::size_t i = 0, o = 0;
+    while (i < n && o < outN) {
+        const int c = int8_t(in[i++]);
+        if (c >= 0) {
+            const std::size_t len = std::min({ std::size_t(c) + 1, n - i, outN - o });
+            std::memcpy(out + o, in + i, len);
+            i += std::size_t(c) + 1;
+            o += len;
+        } else if (c != -128 && i < n) {
+            const std::size_t len = std::min(std::size_t(1 - c), outN - o);
+            std::memset(out + o, in[i++], len);
+            o += len;
+        }
+    }
+    return o;
+}
+
+// PackBits построчно: по TIFF серия не переходит через границу строки
+void packBits(const uint8_t *in, std::size_t n, std::vector<uint8_t> &out) {
+    std::size_t i = 0;
+    while (i < n) {
+        std::size_t j = i + 1;
+        while (j < n && j - i < 128 && in[j] == in[i]) ++j;
+        if (j - i >= 3) {
+            out.push_back(uint8_t(int8_t(1 - int(j - i))));
+            out.push_back(in[i]);
+            i = j;
+            continue;
+        }
+        std::size_t k = i;
+        while (k < n && k - i < 128 && !(k + 2 < n && in[k] == in[k + 1] && in[k] == in[k + 2])) ++k;
+        out.push_back(uint8_t(k - i - 1));
+        out.insert(out.end(), in + i, in + k);
+        i = k;
+    }
+}
+
+// LZW в варианте TIFF: коды 9..12 бит старшими битами вперёд, ширина растёт на код раньше.
+// Строка словаря всегда уже лежит в выходе целиком (предыдущая строка плюс
+// первый байт следующей), так что словарь — это пары (смещение, длина).
+std::size_t lzwDecode(const uint8_t *in, std::size_t n, uint8_t *out, std::size_t outN, bool *broken) {
+    uint32_t offset[4096];
+    uint16_t length[4096];
+    std::size_t i = 0, o = 0;
+    uint32_t bits = 0;
+    int have = 0, width = 9, next = LZW_FIRST;
+    int prev = -1;
+    uint32_t prevOffset = 0;
+    uint16_t prevLength = 0;
+    *broken = false;
+    while (o < outN) {
+        while (have < width && i < n) { bits = (bits << 8) | in[i++]; have += 8; }
+        if (have < width) break;
+        const int code = int((bits >> (have - width)) & ((1u << width) - 1));
+        have -= width;
+        if (code == LZW_EOI) break;
+        if (code == LZW_CLEAR) {
+            width = 9;
+            next = LZW_FIRST;
+            prev = -1;
+            continue;
+        }
+        const uint32_t at = uint32_t(o);
+        uint16_t len;
+        if (code < 256) {
+            out[o++] = uint8_t(code);
+            len = 1;
+        } else if (prev >= 0 && code < next) {
+            len = length[code];
+            const std::size_t m = std::min(std::size_t(len), outN - o);
+            std::memcpy(out + o, out + offset[code], m);
+            o += m;
+        } else if (prev >= 0 && code == next) {
+            // строка, которая только сейчас попадёт в словарь: предыдущая + её первый байт
+            len = uint16_t(prevLength + 1);
+            const std::size_t m = std::min(std::size_t(prevLength), outN - o);
+            std::memcpy(out + o, out + prevOffset, m);
+            o += m;
+            if (o < outN) out[o++] = out[prevOffset];
+        } else {
+            *broken = true;
+            break;
+        }
+        if (prev >= 0 && next < 4096) {
+            offset[next] = prevOffset;
+            length[next] = uint16_t(prevLength + 1);
+            ++next;
+            if (next >= (1 << width) - 1 && width < LZW_MAX_BITS) ++width;
+        }
+        prev = code;
+        prevOffset = at;
+        prevLength = len;
+    }
+    return o;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t> &out) : out(out) {}
+    void put(int code, int width) {
+        bits = (bits << width) | uint32_t(code);
+        have += width;
+        while (have >= 8) { out.push_back(uint8_t(bits >> (have - 8))); have -= 8; }
+    }
+    void finish() { if (have > 0) out.push_back(uint8_t(bits << (8 - have))); have = 0; }
+private:
+    std::vector<uint8_t> &out;
+    uint32_t bits = 0;
+    int have = 0;
+};
+
+void lzwEncode(const uint8_t *in, std::size_t n, std::vector<uint8_t> &out) {
+    // открытая адресация; очистка словаря — сменой поколения, а не обнулением
+    const uint32_t HASH = 1 << 13;
+    struct Slot { uint32_t key; uint16_t code; uint16_t generation; };
+    static thread_local std::vector<Slot> table(HASH, Slot{ 0, 0, 0 });
+    static thread_local uint16_t generation = 0;
+    auto reset = [&]{
+        if (++generation == 0) {
+            std::fill(table.begin(), table.end(), Slot{ 0, 0, 0 });
+            generation = 1;
+        }
+    };
+    reset();
+
+    BitWriter w(out);
+    int width = 9, next = LZW_FIRST;
+    w.put(LZW_CLEAR, width);
+    if (n == 0) {
+        w.put(LZW_EOI, width);
+        w.finish();
+        return;
+    }
+    int prefix = in[0];
+    for (std::size_t i = 1; i < n; ++i) {
+        const uint32_t key = (uint32_t(prefix) << 8) | in[i];
+        uint32_t h = (key * 2654435761u) >> 19;
+        for (;;) {
+            const Slot &s = table[h];
+            if (s.generation != generation || s.key == key) break;
+            h = (h + 1) & (HASH - 1);
+        }
+        if (table[h].generation == generation) {
+            prefix = table[h].code;
+            continue;
+        }
+        w.put(prefix, width);
+        table[h] = { key, uint16_t(next), generation };
+        ++next;
+        if (next == 4094) {
+            w.put(LZW_CLEAR, width);
+            width = 9;
+            next = LZW_FIRST;
+            reset();
+        } else if (next > (1 << width) - 1 && width < LZW_MAX_BITS) {
+            ++width;
+        }
+        prefix = in[i];
+    }
+    w.put(prefix, width);
+    // декодер добавит ещё одну строку — ширина для EOI уже новая
+    ++next;
+    if (next == 4094) {
+        w.put(LZW_CLEAR, width);
+        width = 9;
+    } else if (next > (1 << width) - 1 && width < LZW_MAX_BITS) {
+        ++width;
+    }
+    w.put(LZW_EOI, width);
+    w.finish();
+}
+
+// чтение каталога
+struct Reader {
+    const uint8_t *d;
+    std::size_t n;
+    bool swap;
+    uint16_t u16(std::size_t at) const { uint16_t v; std::memcpy(&v, d + at, 2); return swap ? swap16(v) : v; }
+    uint32_t u32(std::size_t at) const {
+        uint32_t v;
+        std::memcpy(&v, d + at, 4);
+        return swap ? (uint32_t(swap16(uint16_t(v))) << 16) | swap16(uint16_t(v >> 16)) : v;
+    }
+};
+
+struct Entry {
+    uint16_t tag = 0;
+    std::vector<uint32_t> values;
+};
+
+const Entry *findTag(const std::vector<Entry> &entries, uint16_t tag) {
+    for (const Entry &e : entries)
+        if (e.tag == tag) return &e;
+    return nullptr;
+}
+
+uint32_t tagValue(const std::vector<Entry> &entries, uint16_t tag, uint32_t fallback) {
+    const Entry *e = findTag(entries, tag);
+    return e && !e->values.empty() ? e->values[0] : fallback;
+}
+
+}
+
+bool TiffReader::open(const std::string &path, std::string *error) {
+    auto mapped = std::make_shared<MappedFile>();
+    if (!mapped->open(path)) {
+        owner.reset();
+        base = nullptr;
+        return fail(error, "не удалось открыть " + path);
+    }
+    owner = mapped;
+    base = mapped->data();
+    length = mapped->size();
+    return parse(path, error);
+}
+
+bool TiffReader::openMemory(const std::shared_ptr<const std::vector<uint8_t>> &data, const std::string &name,
+                            std::string *error) {
+    owner = data;
+    base = data ? data->data() : nullptr;
+    length = data ? data->size() : 0;
+    return parse(name, error);
+}
+
+bool TiffReader::parse(const std::string &path, std::string *error) {
+    cache.clear();
+    cachedBand = -1;
+    const uint8_t *d = base;
+    const std::size_t n = length;
+    if (!d) return fail(error, "не TIFF: " + path);
+    if (n < 8 || !((d[0] == 'I' && d[1] == 'I') || (d[0] == 'M' && d[1] == 'M')))
+        return fail(error, "не TIFF: " + path);
+    swap = d[0] == 'M';
+    Reader r{ d, n, swap };
+    if (r.u16(2) != 42) return fail(error, "не TIFF (BigTIFF не поддерживается): " + path);
+
+    const std::size_t ifd = r.u32(4);
+    if (ifd + 2 > n) return fail(error, "повреждённый TIFF: " + path);
+    const std::size_t count = r.u16(ifd);
+    if (ifd + 2 + count * 12 > n) return fail(error, "повреждённый TIFF: " + path);
+    std::vector<Entry> entries;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t at = ifd + 2 + i * 12;
+        const uint16_t type = r.u16(at + 2);
+        const uint32_t num = r.u32(at + 4);
+        const std::size_t size = type == BYTE ? 1 : type == SHORT ? 2 : type == LONG ? 4 : 0;
+        if (size == 0) continue;            // остальные типы нам не нужны
+        std::size_t src = at + 8;
+        if (std::size_t(num) * size > 4) {
+            src = r.u32(at + 8);
+            if (src + std::size_t(num) * size > n) return fail(error, "повреждённый TIFF: " + path);
+        }
+        Entry e;
+        e.tag = r.u16(at);
+        e.values.resize(num);
+        for (uint32_t k = 0; k < num; ++k)
+            e.values[k] = size == 1 ? d[src + k] : size == 2 ? r.u16(src + 2 * k) : r.u32(src + 4 * k);
+        entries.push_back(std::move(e));
+    }
+
+    inf = TiffInfo();
+    inf.width = int(tagValue(entries, IMAGE_WIDTH, 0));
+    inf.height = int(tagValue(entries, IMAGE_LENGTH, 0));
+    inf.channels = int(tagValue(entries, SAMPLES_PER_PIXEL, 1));
+    const Entry *bits = findTag(entries, BITS_PER_SAMPLE);
+    inf.bits = bits && !bits->values.empty() ? int(bits->values[0]) : 1;
+    if (inf.width <= 0 || inf.height <= 0 || inf.width > (1 << 24) || inf.height > (1 << 24) ||
+        inf.channels < 1 || inf.channels > 8)
+        return fail(error, "неподдерживаемый размер TIFF: " + path);
+    if (inf.bits != 8 && inf.bits != 16) return fail(error, "поддерживаются только 8 и 16 бит: " + path);
+    if (bits)
+        for (uint32_t b : bits->values)
+            if (int(b) != inf.bits) return fail(error, "разная разрядность каналов: " + path);
+    if (tagValue(entries, SAMPLE_FORMAT, 1) != 1) return fail(error, "поддерживаются только целые отсчёты: " + path);
+    if (tagValue(entries, PLANAR_CONFIG, 1) != 1) return fail(error, "каналы по отдельным плоскостям не поддерживаются: " + path);
+
+    const uint32_t photometric = tagValue(entries, PHOTOMETRIC, 0xFFFF);
+    const int needChannels = photometric == 1 ? 1 : photometric == 2 || photometric == 8 ? 3 : photometric == 5 ? 4 : 0;
+    if (needChannels == 0) return fail(error, "неподдерживаемый PhotometricInterpretation: " + path);
+    if (inf.channels < needChannels) return fail(error, "мало каналов для цветовой модели: " + path);
+    inf.photometric = TiffPhotometric(photometric);
+
+    const uint32_t compression = tagValue(entries, COMPRESSION, 1);
+    if (compression != 1 && compression != 5 && compression != 32773)
+        return fail(error, "неподдерживаемое сжатие TIFF: " + path);
+    inf.compression = TiffCompression(compression);
+    const uint32_t predictor = tagValue(entries, PREDICTOR, 1);
+    if (predictor != 1 && predictor != 2) return fail(error, "неподдерживаемый предсказатель TIFF: " + path);
+    inf.predictor = predictor == 2;
+
+    const Entry *offs, *counts;
+    std::size_t blocks;
+    inf.tiled = findTag(entries, TILE_WIDTH) != nullptr;
+    if (inf.tiled) {
+        inf.blockWidth = int(tagValue(entries, TILE_WIDTH, 0));
+        inf.blockHeight = int(tagValue(entries, TILE_LENGTH, 0));
+        if (inf.blockWidth <= 0 || inf.blockHeight <= 0 || inf.blockWidth > (1 << 16) || inf.blockHeight > (1 << 16))
+            return fail(error, "повреждённый TIFF: " + path);
+        blocksAcross = (inf.width + inf.blockWidth - 1) / inf.blockWidth;
+        blocks = std::size_t(blocksAcross) * std::size_t((inf.height + inf.blockHeight - 1) / inf.blockHeight);
+        offs = findTag(entries, TILE_OFFSETS);
+        counts = findTag(entries, TILE_BYTE_COUNTS);
+    } else {
+        inf.blockWidth = inf.width;
+        inf.blockHeight = int(std::min<uint32_t>(tagValue(entries, ROWS_PER_STRIP, uint32_t(inf.height)), uint32_t(inf.height)));
+        if (inf.blockHeight <= 0) return fail(error, "повреждённый TIFF: " + path);
+        blocksAcross = 1;
+        blocks = std::size_t((inf.height + inf.blockHeight - 1) / inf.blockHeight);
+        offs = findTag(entries, STRIP_OFFSETS);
+        counts = findTag(entries, STRIP_BYTE_COUNTS);
+    }
+    if (!offs || !counts || offs->values.size() < blocks || counts->values.size() < blocks)
+        return fail(error, "повреждённый TIFF: " + path);
+    offsets.assign(offs->values.begin(), offs->values.begin() + std::ptrdiff_t(blocks));
+    byteCounts.assign(counts->values.begin(), counts->values.begin() + std::ptrdiff_t(blocks));
+    for (std::size_t i = 0; i < blocks; ++i)
+        if (std::size_t(offsets[i]) + byteCounts[i] > n) return fail(error, "TIFF обрезан: " + path);
+    // несжатые полосы читаются по строкам, сжатые ряды блоков — только целиком
+    if ((inf.compression != TiffCompression::None || inf.tiled)
+            && inf.rowBytes() * std::size_t(inf.blockHeight) > MAX_BAND_BYTES)
+        return fail(error, "ряд блоков TIFF больше " + std::to_string(MAX_BAND_BYTES >> 20) + " МБ: " + path);
+    return true;
+}
+
+// блок (полоса или тайл) в out: blockWidth x rows пикселей, отсчёты в порядке машины
+bool TiffReader::decodeBlock(std::size_t index, uint8_t *out, int rows, std::string *error) const {
+    const std::size_t rowBytes = std::size_t(inf.blockWidth) * std::size_t(inf.channels) * std::size_t(inf.bits / 8);
+    const std::size_t need = rowBytes * std::size_t(rows);
+    const uint8_t *in = base + offsets[index];
+    const std::size_t n = byteCounts[index];
+    std::size_t got = 0;
+    bool broken = false;
+    switch (inf.compression) {
+    case TiffCompression::None:
+        got = std::min(n, need);
+        std::memcpy(out, in, got);
+        break;
+    case TiffCompression::PackBits:
+        got = unpackBits(in, n, out, need);
+        break;
+    case TiffCompression::LZW:
+        if (n >= 2 && in[0] == 0 && (in[1] & 1)) return fail(error, "LZW старого образца (до TIFF 6) не поддерживается");
+        got = lzwDecode(in, n, out, need, &broken);
+        break;
+    }
+    if (broken || got < need) return fail(error, "повреждённый блок TIFF №" + std::to_string(index));
+    if (swap && inf.bits == 16) swapSamples(out, need);
+    if (inf.predictor) undoPredictor(out, inf.bits, inf.channels, inf.blockWidth, rows, rowBytes);
+    return true;
+}
+
+bool TiffReader::decodeBand(int band, uint8_t *out, std::string *error) const {
+    const int rows = std::min(inf.blockHeight, inf.height - band * inf.blockHeight);
+    if (!inf.tiled) return decodeBlock(std::size_t(band), out, rows, error);
+
+    // тайлы всегда полного размера, лишнее справа и снизу отбрасываем
+    const std::size_t pixel = std::size_t(inf.channels) * std::size_t(inf.bits / 8);
+    const std::size_t tileRow = std::size_t(inf.blockWidth) * pixel;
+    ArenaScope scratch;
+    uint8_t *tile = scratch.allocate<uint8_t>(tileRow * std::size_t(inf.blockHeight));
+    for (int t = 0; t < blocksAcross; ++t) {
+        if (!decodeBlock(std::size_t(band) * std::size_t(blocksAcross) + std::size_t(t), tile, inf.blockHeight, error))
+            return false;
+        const std::size_t x = std::size_t(t) * std::size_t(inf.blockWidth);
+        const std::size_t bytes = std::min(std::size_t(inf.blockWidth), std::size_t(inf.width) - x) * pixel;
+        for (int y = 0; y < rows; ++y)
+            std::memcpy(out + std::size_t(y) * inf.rowBytes() + x * pixel, tile + std::size_t(y) * tileRow, bytes);
+    }
+    return true;
+}
+
+bool TiffReader::readRows(int y, int count, uint8_t *dst, std::ptrdiff_t stride, std::string *error) {
+    if (!base) return fail(error, "TIFF не открыт");
+    if (y < 0 || count <= 0 || y + count > inf.height) return fail(error, "строки вне изображения");
+    const std::size_t rowBytes = inf.rowBytes();
+    if (!inf.tiled && inf.compression == TiffCompression::None) {
+        // несжатые полосы — прямо из файла нужными строками, даже если полоса одна на всё изображение
+        for (int row = y; row < y + count; ++row) {
+            const std::size_t band = std::size_t(row / inf.blockHeight);
+            const std::size_t at = std::size_t(row % inf.blockHeight) * rowBytes;
+            if (at + rowBytes > byteCounts[band]) return fail(error, "повреждённый блок TIFF №" + std::to_string(band));
+            uint8_t *out = dst + std::ptrdiff_t(row - y) * stride;
+            std::memcpy(out, base + offsets[band] + at, rowBytes);
+            if (swap && inf.bits == 16) swapSamples(out, rowBytes);
+            if (inf.predictor) undoPredictor(out, inf.bits, inf.channels, inf.width, 1, rowBytes);
+        }
+        return true;
+    }
+    const std::size_t bandBytes = rowBytes * std::size_t(inf.blockHeight);
+    const int b0 = y / inf.blockHeight, b1 = (y + count - 1) / inf.blockHeight;
+    const bool keep = b1 != cachedBand;
+    // последний ряд распаковывается в запасной буфер — кэш в это время ещё читают
+    std::vector<uint8_t> next(keep ? bandBytes : 0);
+
+    std::mutex lock;
+    std::string firstError;
+    parallelFor(b1 - b0 + 1, 1, [&](int i0, int i1){
+        for (int b = b0 + i0; b < b0 + i1; ++b) {
+            ArenaScope scratch;
+            const uint8_t *src;
+            std::string e;
+            if (b == cachedBand) {
+                src = cache.data();
+            } else {
+                uint8_t *buf = b == b1 ? next.data() : scratch.allocate<uint8_t>(bandBytes);
+                if (!decodeBand(b, buf, &e)) {
+                    std::lock_guard<std::mutex> g(lock);
+                    if (firstError.empty()) firstError = e;
+                    return;
+                }
+                src = buf;
+            }
+            const int top = b * inf.blockHeight;
+            const int from = std::max(y, top), to = std::min(y + count, top + inf.blockHeight);
+            for (int row = from; row < to; ++row)
+                std::memcpy(dst + std::ptrdiff_t(row - y) * stride, src + std::size_t(row - top) * rowBytes, rowBytes);
+        }
+    });
+    if (!firstError.empty()) return fail(error, firstError);
+    if (keep) {
+        cache.swap(next);
+        cachedBand = b1;
+    }
+    return true;
+}
+
+TiffWriter::~TiffWriter() {
+    if (f) std::fclose(f);
+}
+
+void TiffWriter::discard() {
+    if (f) std::fclose(f);
+    f = nullptr;
+    if (memory) memory->clear();
+    memory = nullptr;
+    if (toFile) std::remove(name.c_str());
+    toFile = false;
+}
+
+bool TiffWriter::put(const void *data, std::size_t size, std::string *error) {
+    if (memory) {
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        memory->insert(memory->end(), p, p + size);
+    } else if (std::fwrite(data, 1, size, f) != size) {
+        return fail(error, "ошибка записи " + name);
+    }
+    position += size;
+    if (position > UINT32_MAX) return fail(error, "TIFF больше 4 ГБ не поддерживается: " + name);
+    return true;
+}
+
+bool TiffWriter::open(const std::string &path, int width, int height, int channels, int bits, TiffPhotometric photometric,
+                      const TiffWriteOptions &options, std::string *error) {
+    if (f) std::fclose(f);
+    f = nullptr;
+    memory = nullptr;
+    if (!setUp(width, height, channels, bits, photometric, options, error)) return false;
+    name = path;
+    toFile = false;
+    f = std::fopen(path.c_str(), "wb");
+    if (!f) return fail(error, "не удалось создать " + path);
+    toFile = true;
+    std::setvbuf(f, nullptr, _IOFBF, 1 << 20);
+    return putHeader(error);
+}
+
+bool TiffWriter::openMemory(std::vector<uint8_t> *out, int width, int height, int channels, int bits,
+                            TiffPhotometric photometric, const TiffWriteOptions &options, std::string *error) {
+    if (f) std::fclose(f);
+    f = nullptr;
+    memory = nullptr;
+    if (!setUp(width, height, channels, bits, photometric, options, error)) return false;
+    name = "TIFF в памяти";
+    toFile = false;
+    memory = out;
+    memory->clear();
+    return putHeader(error);
+}
+
+bool TiffWriter::putHeader(std::string *error) {
+    position = 0;
+    // смещение каталога (байты 4..7) допишется в close
+    const uint8_t header[8] = { 'I', 'I', 42, 0, 0, 0, 0, 0 };
+    return put(header, sizeof(header), error);
+}
+
+bool TiffWriter::setUp(int width, int height, int channels, int bits, TiffPhotometric photometric,
+                       const TiffWriteOptions &options, std::string *error) {
+    if (width <= 0 || height <= 0 || width > (1 << 24) || height > (1 << 24)) return fail(error, "неподдерживаемый размер");
+    if (channels < 1 || channels > 8 || (bits != 8 && bits != 16)) return fail(error, "неподдерживаемый формат отсчётов");
+    if (options.tileSize < 0 || options.tileSize % 16 != 0) return fail(error, "размер тайла должен быть кратен 16");
+
+    inf = TiffInfo();
+    inf.width = width;
+    inf.height = height;
+    inf.channels = channels;
+    inf.bits = bits;
+    inf.photometric = photometric;
+    inf.compression = options.compression;
+    inf.predictor = options.predictor && options.compression == TiffCompression::LZW;
+    inf.tiled = options.tileSize > 0;
+    int bandHeight;
+    if (inf.tiled) {
+        inf.blockWidth = inf.blockHeight = options.tileSize;
+        blocksAcross = (width + options.tileSize - 1) / options.tileSize;
+        bandHeight = options.tileSize;
+    } else {
+        inf.blockWidth = width;
+        inf.blockHeight = options.rowsPerStrip > 0 ? options.rowsPerStrip
+                                                   : int(std::max<std::size_t>(1, (64 << 10) / inf.rowBytes()));
+        inf.blockHeight = std::min(inf.blockHeight, height);
+        blocksAcross = 1;
+        const std::size_t group = std::max<std::size_t>(1, STRIP_GROUP_BYTES / (inf.rowBytes() * std::size_t(inf.blockHeight)));
+        bandHeight = int(std::min<std::size_t>(std::size_t(inf.blockHeight) * group, std::size_t(height)));
+    }
+    band.assign(inf.rowBytes() * std::size_t(bandHeight), 0);
+    bandRows = 0;
+    rows = 0;
+    offsets.clear();
+    byteCounts.clear();
+    return true;
+}
+
+bool TiffWriter::writeRows(const uint8_t *src, std::ptrdiff_t stride, int count, std::string *error) {
+    if (!f && !memory) return fail(error, "TIFF не открыт для записи");
+    if (count < 0 || rows + bandRows + count > inf.height) return fail(error, "строк больше, чем в заголовке");
+    const std::size_t rowBytes = inf.rowBytes();
+    const int capacity = int(band.size() / rowBytes);
+    for (int i = 0; i < count; ++i) {
+        std::memcpy(band.data() + std::size_t(bandRows) * rowBytes, src + std::ptrdiff_t(i) * stride, rowBytes);
+        if (++bandRows == capacity && !flushBand(error)) return false;
+    }
+    return true;
+}
+
+// накопленные строки — в блоки; блоки сжимаются параллельно, пишутся по порядку
+bool TiffWriter::flushBand(std::string *error) {
+    if (bandRows == 0) return true;
+    const std::size_t rowBytes = inf.rowBytes();
+    const std::size_t pixel = std::size_t(inf.channels) * std::size_t(inf.bits / 8);
+    const std::size_t blockRow = std::size_t(inf.blockWidth) * pixel;
+    const int down = inf.tiled ? 1 : (bandRows + inf.blockHeight - 1) / inf.blockHeight;
+    const int blocks = inf.tiled ? blocksAcross : down;
+    std::vector<std::vector<uint8_t>> packed(static_cast<std::size_t>(blocks));
+
+    parallelFor(blocks, 1, [&](int i0, int i1){
+        for (int i = i0; i < i1; ++i) {
+            ArenaScope scratch;
+            // тайлы дополняются нулями до полного размера, последняя полоса бывает короче
+            const int blockRows = inf.tiled ? inf.blockHeight : std::min(inf.blockHeight, bandRows - i * inf.blockHeight);
+            const std::size_t bytes = blockRow * std::size_t(blockRows);
+            uint8_t *raw = scratch.allocate<uint8_t>(bytes);
+            if (inf.tiled) {
+                std::memset(raw, 0, bytes);
+                const std::size_t x = std::size_t(i) * std::size_t(inf.blockWidth);
+                const std::size_t width = std::min(std::size_t(inf.blockWidth), std::size_t(inf.width) - x) * pixel;
+                for (int y = 0; y < bandRows; ++y)
+                    std::memcpy(raw + std::size_t(y) * blockRow, band.data() + std::size_t(y) * rowBytes + x * pixel, width);
+            } else {
+                std::memcpy(raw, band.data() + std::size_t(i) * std::size_t(inf.blockHeight) * rowBytes, bytes);
+            }
+            if (inf.predictor) applyPredictor(raw, inf.bits, inf.channels, inf.blockWidth, blockRows, blockRow);
+
+            std::vector<uint8_t> &out = packed[std::size_t(i)];
+            switch (inf.compression) {
+            case TiffCompression::None:
+                out.assign(raw, raw + bytes);
+                break;
+            case TiffCompression::PackBits:
+                out.reserve(bytes + bytes / 128 + std::size_t(blockRows));
+                for (int y = 0; y < blockRows; ++y) packBits(raw + std::size_t(y) * blockRow, blockRow, out);
+                break;
+            case TiffCompression::LZW:
+                out.reserve(bytes / 2);
+                lzwEncode(raw, bytes, out);
+                break;
+            }
+        }
+    });
+
+    for (const std::vector<uint8_t> &out : packed) {
+        offsets.push_back(uint32_t(position));
+        byteCounts.push_back(uint32_t(out.size()));
+        if (!put(out.data(), out.size(), error)) return false;
+    }
+    rows += bandRows;
+    bandRows = 0;
+    return true;
+}
+
+bool TiffWriter::close(std::string *error) {
+    if (!f && !memory) return fail(error, "TIFF не открыт для записи");
+    bool ok = flushBand(error);
+    if (ok && rows != inf.height) ok = fail(error, "записано строк меньше, чем в заголовке");
+
+    struct Out { uint16_t tag, type; uint32_t count, value; };
+    std::vector<Out> entries;
+    const uint8_t zero[2] = { 0, 0 };
+    // массив длиннее 4 байт — перед каталогом, в записи только смещение
+    auto array = [&](uint16_t tag, uint16_t type, const std::vector<uint32_t> &v){
+        if (!ok) return;
+        const std::size_t size = type == SHORT ? 2 : 4;
+        if (v.size() * size <= 4) {
+            uint32_t inl = 0;
+            if (type == SHORT) {
+                uint16_t s[2] = { 0, 0 };
+                for (std::size_t i = 0; i < v.size(); ++i) s[i] = uint16_t(v[i]);
+                std::memcpy(&inl, s, 4);
+            } else if (!v.empty()) {
+                inl = v[0];
+            }
+            entries.push_back({ tag, type, uint32_t(v.size()), inl });
+            return;
+        }
+        if (position % 2) ok = put(zero, 1, error);
+        const uint32_t at = uint32_t(position);
+        for (uint32_t x : v) {
+            if (!ok) return;
+            if (type == SHORT) { uint16_t s = uint16_t(x); ok = put(&s, 2, error); }
+            else ok = put(&x, 4, error);
+        }
+        entries.push_back({ tag, type, uint32_t(v.size()), at });
+    };
+    auto value = [&](uint16_t tag, uint16_t type, uint32_t v){ array(tag, type, { v }); };
+
+    value(IMAGE_WIDTH, LONG, uint32_t(inf.width));
+    value(IMAGE_LENGTH, LONG, uint32_t(inf.height));
+    array(BITS_PER_SAMPLE, SHORT, std::vector<uint32_t>(std::size_t(inf.channels), uint32_t(inf.bits)));
+    value(COMPRESSION, SHORT, uint32_t(inf.compression));
+    value(PHOTOMETRIC, SHORT, uint32_t(inf.photometric));
+    if (!inf.tiled) array(STRIP_OFFSETS, LONG, offsets);
+    value(SAMPLES_PER_PIXEL, SHORT, uint32_t(inf.channels));
+    if (!inf.tiled) {
+        value(ROWS_PER_STRIP, LONG, uint32_t(inf.blockHeight));
+        array(STRIP_BYTE_COUNTS, LONG, byteCounts);
+    }
+    value(PLANAR_CONFIG, SHORT, 1);
+    if (inf.predictor) value(PREDICTOR, SHORT, 2);
+    if (inf.tiled) {
+        value(TILE_WIDTH, LONG, uint32_t(inf.blockWidth));
+        value(TILE_LENGTH, LONG, uint32_t(inf.blockHeight));
+        array(TILE_OFFSETS, LONG, offsets);
+        array(TILE_BYTE_COUNTS, LONG, byteCounts);
+    }
+    if (inf.photometric == TiffPhotometric::Separated) value(INK_SET, SHORT, 1);
+
+    if (ok && position % 2) ok = put(zero, 1, error);
+    const uint32_t ifd = uint32_t(position);
+    if (ok) {
+        const uint16_t n = uint16_t(entries.size());
+        ok = put(&n, 2, error);
+        for (const Out &e : entries) {
+            if (!ok) break;
+            ok = put(&e.tag, 2, error) && put(&e.type, 2, error) && put(&e.count, 4, error) && put(&e.value, 4, error);
+        }
+        const uint32_t end = 0;
+        ok = ok && put(&end, 4, error);
+    }
+    if (memory) {
+        if (ok) std::memcpy(memory->data() + 4, &ifd, 4);
+        memory = nullptr;
+        return ok;
+    }
+    if (ok && (std::fseek(f, 4, SEEK_SET) != 0 || std::fwrite(&ifd, 4, 1, f) != 1))
+        ok = fail(error, "ошибка записи " + name);
+    if (std::fclose(f) != 0 && ok) ok = fail(error, "ошибка записи " + name);
+    f = nullptr;
+    toFile = !ok;       // готовый файл discard уже не удалит
+    return ok;
+}
+
+void tiffLabToIcc(uint8_t *samples, int bits, int channels, std::size_t count) {
+    if (bits == 8) {
+        // a, b со знаком -> со сдвигом +128
+        for (std::size_t i = 0; i < count; ++i, samples += channels) {
+            samples[1] ^= 0x80;
+            samples[2] ^= 0x80;
+        }
+        return;
+    }
+    uint16_t *s = reinterpret_cast<uint16_t *>(samples);
+    for (std::size_t i = 0; i < count; ++i, s += channels) {
+        for (int c = 1; c < 3; ++c) {
+            // a * 256 со знаком -> (a + 128) * 257
+            const uint32_t v = uint32_t(int(int16_t(s[c])) + 32768);
+            s[c] = uint16_t(std::min<uint32_t>((v * 257 + 128) >> 8, 65535));
+        }
+    }
+}
+
+void iccLabToTiff(uint8_t *samples, int bits, int channels, std::size_t count) {
+    if (bits == 8) {
+        tiffLabToIcc(samples, bits, channels, count);
+        return;
+    }
+    uint16_t *s = reinterpret_cast<uint16_t *>(samples);
+    for (std::size_t i = 0; i < count; ++i, s += channels) {
+        for (int c = 1; c < 3; ++c) {
+            const uint32_t v = (uint32_t(s[c]) * 256 + 128) / 257;
+            s[c] = uint16_t(int(v) - 32768);
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef TIFFIO_H
+#define TIFFIO_H
+
+#include "mappedfile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Базовый TIFF без сторонних библиотек: RGB, CIELab (PhotometricInterpretation = 8)
+// и CMYK (Separated), 8 или 16 бит, без сжатия / PackBits / LZW (с предсказателем
+// по горизонтали), полосы или тайлы, отсчёты вперемешку (PlanarConfiguration = 1).
+// Чтение и запись идут по блокам (полосам или рядам тайлов) — изображение целиком
+// в памяти не собирается.
+
+enum class TiffPhotometric : uint16_t { MinIsBlack = 1, RGB = 2, Separated = 5, CIELab = 8 };
+enum class TiffCompression : uint16_t { None = 1, LZW = 5, PackBits = 32773 };
+
+struct TiffInfo {
+    int width = 0;
+    int height = 0;
+    int channels = 0;           // SamplesPerPixel
+    int bits = 0;               // 8 или 16
+    TiffPhotometric photometric = TiffPhotometric::RGB;
+    TiffCompression compression = TiffCompression::None;
+    bool predictor = false;     // Predictor = 2
+    bool tiled = false;
+    int blockWidth = 0;         // полоса: ширина изображения x RowsPerStrip; иначе тайл
+    int blockHeight = 0;
+
+    std::size_t rowBytes() const { return std::size_t(width) * std::size_t(channels) * std::size_t(bits / 8); }
+};
+
+// Отсчёты 16 бит выдаются в порядке байтов машины. Lab — в кодировке TIFF
+// (L 0..255 / 0..65535, a и b со знаком), см. tiffLabToIcc.
+class TiffReader {
+public:
+    bool open(const std::string &path, std::string *error = nullptr);
+    // файл, уже прочитанный в память (например, пакетным вводом asyncfileio.h)
+    bool openMemory(const std::shared_ptr<const std::vector<uint8_t>> &data, const std::string &name,
+                    std::string *error = nullptr);
+    const TiffInfo &info() const { return inf; }
+
+    // строки y .. y + count - 1; ряды блоков распаковываются параллельно,
+    // последний затронутый ряд остаётся в кэше для следующего вызова. Несжатые
+    // полосы копируются построчно, без кэша; сжатый ряд блоков больше 256 МБ
+    // отвергается уже при открытии.
+    bool readRows(int y, int count, uint8_t *dst, std::ptrdiff_t stride, std::string *error = nullptr);
+
+private:
+    bool parse(const std::string &path, std::string *error);
+    bool decodeBand(int band, uint8_t *out, std::string *error) const;
+    bool decodeBlock(std::size_t index, uint8_t *out, int rows, std::string *error) const;
+
+    std::shared_ptr<const void> owner;   // MappedFile или буфер в памяти
+    const uint8_t *base = nullptr;
+    std::size_t length = 0;
+    TiffInfo inf;
+    bool swap = false;                 // файл big-endian
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> byteCounts;
+    int blocksAcross = 1;
+    std::vector<uint8_t> cache;        // последний ряд блоков
+    int cachedBand = -1;
+};
+
+struct TiffWriteOptions {
+    TiffCompression compression = TiffCompression::LZW;
+    bool predictor = true;      // только с LZW
+    int rowsPerStrip = 0;       // 0 — около 64 КБ на полосу
+    int tileSize = 0;           // кратно 16; 0 — полосы
+};
+
+// Пишет little-endian TIFF; каталог (IFD) — в конце файла при close.
+class TiffWriter {
+public:
+    TiffWriter() = default;
+    ~TiffWriter();
+    TiffWriter(const TiffWriter &) = delete;
+    TiffWriter &operator=(const TiffWriter &) = delete;
+
+    bool open(const std::string &path, int width, int height, int channels, int bits, TiffPhotometric photometric,
+              const TiffWriteOptions &options = TiffWriteOptions(), std::string *error = nullptr);
+    // в out вместо файла; out заполнен после close
+    bool openMemory(std::vector<uint8_t> *out, int width, int height, int channels, int bits, TiffPhotometric photometric,
+                    const TiffWriteOptions &options = TiffWriteOptions(), std::string *error = nullptr);
+    const TiffInfo &info() const { return inf; }
+
+    // очередные строки, отсчёты — как у TiffReader::readRows
+    bool writeRows(const uint8_t *src, std::ptrdiff_t stride, int count, std::string *error = nullptr);
+    bool close(std::string *error = nullptr);
+    // бросить запись после ошибки: файл (в том числе после неудачного close) удаляется
+    void discard();
+
+private:
+    bool setUp(int width, int height, int channels, int bits, TiffPhotometric photometric,
+               const TiffWriteOptions &options, std::string *error);
+    bool putHeader(std::string *error);
+    bool flushBand(std::string *error);
+    bool put(const void *data, std::size_t size, std::string *error);
+
+    std::FILE *f = nullptr;
+    std::vector<uint8_t> *memory = nullptr;
+    std::string name;
+    bool toFile = false;               // name — путь файла
+    TiffInfo inf;
+    int blocksAcross = 1;
+    std::vector<uint8_t> band;
+    int bandRows = 0;                  // строк в текущем ряду блоков
+    int rows = 0;
+    uint64_t position = 0;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> byteCounts;
+};
+
+// Lab в кодировке TIFF <-> ICC (Lab8 / Lab16 из colormodels.h), на месте
+void tiffLabToIcc(uint8_t *samples, int bits, int channels, std::size_t count);
+void iccLabToTiff(uint8_t *samples, int bits, int channels, std::size_t count);
+
+#endif // TIFFIO_H
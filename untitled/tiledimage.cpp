@@ -0,0 +1,574 @@
+#include "tiledimage.h"
+#include "parallel.h"
+#include "tiffconvert.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+bool fail(std::string *error, const std::string &msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+// Временный файл в каталоге: имя уникально и создаётся исключительно (чужой
+// файл не будет открыт и обрезан), после открытия имени нет — файл исчезнет
+// вместе с дескриптором, даже если процесс упадёт.
+std::FILE *openSpill(const std::string &dir) {
+#ifdef _WIN32
+    // удалить открытый файл Windows не даёт; _O_TEMPORARY удаляет его при закрытии
+    static std::atomic<unsigned> serial{0};
+    char name[64];
+    std::snprintf(name, sizeof(name), "/tiles-%d-%u.spill", _getpid(), serial++);
+    const int fd = _open((dir + name).c_str(), _O_CREAT | _O_EXCL | _O_RDWR | _O_BINARY | _O_TEMPORARY,
+                         _S_IREAD | _S_IWRITE);
+    if (fd < 0) return nullptr;
+    std::FILE *f = _fdopen(fd, "w+b");
+    if (!f) _close(fd);
+    return f;
+#else
+    std::string path = dir + "/tiles-XXXXXX";
+    const int fd = ::mkstemp(&path[0]);
+    if (fd < 0) return nullptr;
+    ::unlink(path.c_str());
+    std::FILE *f = ::fdopen(fd, "w+b");
+    if (!f) ::close(fd);
+    return f;
+#endif
+}
+
+// первая ошибка из параллельных задач
+struct FirstError {
+    std::mutex lock;
+    std::atomic<bool> failed{false};
+    std::string message;
+
+    void set(const std::string &msg) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!failed.exchange(true)) message = msg;
+    }
+};
+
+}
+
+TileRef &TileRef::operator=(TileRef &&other) noexcept {
+    if (this != &other) {
+        release();
+        x = other.x;
+        y = other.y;
+        width = other.width;
+        height = other.height;
+        image = other.image;
+        index = other.index;
+        pixels = other.pixels;
+        rowBytes = other.rowBytes;
+        other.image = nullptr;
+        other.pixels = nullptr;
+    }
+    return *this;
+}
+
+void TileRef::release() {
+    if (image) image->unpin(index);
+    image = nullptr;
+    pixels = nullptr;
+}
+
+TiledImage::~TiledImage() {
+    closeSpill();
+}
+
+void TiledImage::closeSpill() {
+    if (spill) std::fclose(spill);
+    spill = nullptr;
+}
+
+bool TiledImage::create(int width, int height, int channels, int bits, const TiledImageOptions &options,
+                        std::string *error) {
+    closeSpill();
+    if (width <= 0 || height <= 0) return fail(error, "пустое изображение");
+    if (channels < 1 || channels > 4 || (bits != 8 && bits != 16)) return fail(error, "неподдерживаемый формат отсчётов");
+    if (options.tileSize < 16) return fail(error, "тайл меньше 16 пикселей");
+    w = width;
+    h = height;
+    ch = channels;
+    depth = bits;
+    tile = options.tileSize;
+    across = (w + tile - 1) / tile;
+    down = (h + tile - 1) / tile;
+    tileBytes = std::size_t(tile) * std::size_t(tile) * pixelBytes();
+    // меньше, чем потоков, нельзя: каждый держит хотя бы один тайл
+    maxSlots = std::max<std::size_t>(options.memoryBudget / tileBytes, std::size_t(workerCount()) * 2);
+
+    entries.assign(std::size_t(across) * std::size_t(down), Entry());
+    slots.clear();
+    freeSlots.clear();
+    lru.clear();
+    resident = 0;
+    counters = TileCacheStats();
+
+    spill = options.spillDirectory.empty() ? std::tmpfile() : openSpill(options.spillDirectory);
+    if (!spill) return fail(error, "не удалось создать временный файл для тайлов");
+    return true;
+}
+
+TileRef TiledImage::acquire(int tx, int ty, bool write, std::string *error) {
+    return acquire(ty * across + tx, write, error);
+}
+
+TileRef TiledImage::acquire(int index, bool write, std::string *error) {
+    std::unique_lock<std::mutex> guard(lock);
+    Entry &e = entries[std::size_t(index)];
+    exchanged.wait(guard, [&e]{ return !e.busy; });
+    if (e.slot >= 0) {
+        ++counters.hits;
+        if (e.pins == 0) lru.erase(e.lru);
+    } else {
+        ++counters.misses;
+        // кто обратится к тайлу, пока его буфер ищется и читается, ждёт, а не грузит второй раз
+        e.busy = true;
+        int slot = -1;
+        bool ok = obtainSlot(guard, slot, error);
+        if (ok) {
+            uint8_t *p = slots[std::size_t(slot)].get();
+            if (e.onDisk) {
+                guard.unlock();
+                ok = transfer(index, p, false, error);
+                guard.lock();
+                if (ok) ++counters.loads;
+                else freeSlots.push_back(slot);
+            } else {
+                std::memset(p, 0, tileBytes);
+            }
+        }
+        if (ok) {
+            e.slot = slot;
+            ++resident;
+            counters.peakResident = std::max(counters.peakResident, resident);
+        }
+        e.busy = false;
+        exchanged.notify_all();
+        if (!ok) return TileRef();
+    }
+    ++e.pins;
+    if (write) e.dirty = true;
+
+    TileRef ref;
+    ref.image = this;
+    ref.index = index;
+    ref.pixels = slots[std::size_t(e.slot)].get();
+    ref.rowBytes = std::ptrdiff_t(std::size_t(tile) * pixelBytes());
+    ref.x = index % across * tile;
+    ref.y = index / across * tile;
+    ref.width = std::min(tile, w - ref.x);
+    ref.height = std::min(tile, h - ref.y);
+    return ref;
+}
+
+void TiledImage::unpin(int index) {
+    std::lock_guard<std::mutex> guard(lock);
+    Entry &e = entries[std::size_t(index)];
+    if (--e.pins == 0) e.lru = lru.insert(lru.end(), index);
+}
+
+// под guard; пока изменённый тайл вытесняется на диск, блокировка отпущена
+bool TiledImage::obtainSlot(std::unique_lock<std::mutex> &guard, int &slot, std::string *error) {
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        return true;
+    }
+    if (slots.size() >= maxSlots && !lru.empty()) {
+        const int victim = lru.front();
+        lru.pop_front();
+        Entry &v = entries[std::size_t(victim)];
+        if (v.dirty) {
+            v.busy = true;
+            uint8_t *p = slots[std::size_t(v.slot)].get();
+            guard.unlock();
+            const bool ok = transfer(victim, p, true, error);
+            guard.lock();
+            v.busy = false;
+            exchanged.notify_all();
+            if (!ok) {
+                // тайл остался в памяти, незакреплённым
+                v.lru = lru.insert(lru.begin(), victim);
+                return false;
+            }
+            v.dirty = false;
+            v.onDisk = true;
+            ++counters.spills;
+        }
+        slot = v.slot;
+        v.slot = -1;
+        --resident;
+        return true;
+    }
+    // все тайлы закреплены: лучше выйти за бюджет, чем ждать друг друга
+    if (slots.size() >= maxSlots) ++counters.overBudget;
+    slots.emplace_back(new uint8_t[tileBytes]);
+    slot = int(slots.size() - 1);
+    return true;
+}
+
+// без общей блокировки: тайл помечен busy, буфер p его; место в файле — по номеру,
+// файл разреженный
+bool TiledImage::transfer(int index, uint8_t *p, bool write, std::string *error) {
+    const uint64_t offset = uint64_t(index) * tileBytes;
+#ifdef _WIN32
+    std::lock_guard<std::mutex> guard(spillLock);
+    if (_fseeki64(spill, static_cast<long long>(offset), SEEK_SET) != 0)
+        return fail(error, "ошибка позиционирования во временном файле");
+    const std::size_t done = write ? std::fwrite(p, 1, tileBytes, spill) : std::fread(p, 1, tileBytes, spill);
+    if (done != tileBytes) return fail(error, write ? "ошибка записи тайла на диск" : "ошибка чтения тайла с диска");
+#else
+    // pread / pwrite не трогают общую позицию — тайлы обмениваются параллельно
+    const int fd = fileno(spill);
+    for (std::size_t done = 0; done < tileBytes; ) {
+        const ssize_t r = write ? ::pwrite(fd, p + done, tileBytes - done, off_t(offset + done))
+                                : ::pread(fd, p + done, tileBytes - done, off_t(offset + done));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return fail(error, write ? "ошибка записи тайла на диск" : "ошибка чтения тайла с диска");
+        done += std::size_t(r);
+    }
+#endif
+    return true;
+}
+
+TileCacheStats TiledImage::stats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return counters;
+}
+
+bool TiledImage::readRect(int x, int y, int width, int height, uint8_t *dst, std::ptrdiff_t stride,
+                          std::string *error) {
+    if (x < 0 || y < 0 || width < 0 || height < 0 || x + width > w || y + height > h)
+        return fail(error, "прямоугольник за пределами изображения");
+    const std::size_t px = pixelBytes();
+    for (int ty = y / tile; ty * tile < y + height; ++ty) {
+        for (int tx = x / tile; tx * tile < x + width; ++tx) {
+            TileRef t = acquire(tx, ty, false, error);
+            if (!t) return false;
+            const int x0 = std::max(x, t.x), x1 = std::min(x + width, t.x + t.width);
+            const int y0 = std::max(y, t.y), y1 = std::min(y + height, t.y + t.height);
+            for (int yy = y0; yy < y1; ++yy)
+                std::memcpy(dst + std::ptrdiff_t(yy - y) * stride + std::size_t(x0 - x) * px,
+                            t.row(yy - t.y) + std::size_t(x0 - t.x) * px, std::size_t(x1 - x0) * px);
+        }
+    }
+    return true;
+}
+
+bool TiledImage::writeRect(int x, int y, int width, int height, const uint8_t *src, std::ptrdiff_t stride,
+                           std::string *error) {
+    if (x < 0 || y < 0 || width < 0 || height < 0 || x + width > w || y + height > h)
+        return fail(error, "прямоугольник за пределами изображения");
+    const std::size_t px = pixelBytes();
+    for (int ty = y / tile; ty * tile < y + height; ++ty) {
+        for (int tx = x / tile; tx * tile < x + width; ++tx) {
+            TileRef t = acquire(tx, ty, true, error);
+            if (!t) return false;
+            const int x0 = std::max(x, t.x), x1 = std::min(x + width, t.x + t.width);
+            const int y0 = std::max(y, t.y), y1 = std::min(y + height, t.y + t.height);
+            for (int yy = y0; yy < y1; ++yy)
+                std::memcpy(t.row(yy - t.y) + std::size_t(x0 - t.x) * px,
+                            src + std::ptrdiff_t(yy - y) * stride + std::size_t(x0 - x) * px, std::size_t(x1 - x0) * px);
+        }
+    }
+    return true;
+}
+
+bool readTiffTiled(const std::string &path, TiledImage &image, TiffInfo *info, const TiledImageOptions &options,
+                   std::string *error) {
+    TiffReader reader;
+    if (!reader.open(path, error)) return false;
+    const TiffInfo &in = reader.info();
+    if (info) *info = in;
+    if (!image.create(in.width, in.height, in.channels, in.bits, options, error)) return false;
+    // полоса в высоту тайла: каждый тайл пишется один раз и может сразу уйти на диск
+    const std::size_t rowBytes = in.rowBytes();
+    std::vector<uint8_t> strip(rowBytes * std::size_t(image.tileSize()));
+    for (int y = 0; y < in.height; y += image.tileSize()) {
+        const int n = std::min(image.tileSize(), in.height - y);
+        if (!reader.readRows(y, n, strip.data(), std::ptrdiff_t(rowBytes), error)) return false;
+        if (!image.writeRect(0, y, in.width, n, strip.data(), std::ptrdiff_t(rowBytes), error)) return false;
+    }
+    return true;
+}
+
+bool writeTiffTiled(TiledImage &image, const std::string &path, TiffPhotometric photometric,
+                    const TiffWriteOptions &options, std::string *error) {
+    TiffWriter writer;
+    if (!writer.open(path, image.width(), image.height(), image.channels(), image.bits(), photometric, options, error))
+        return false;
+    const std::size_t rowBytes = std::size_t(image.width()) * image.pixelBytes();
+    std::vector<uint8_t> strip(rowBytes * std::size_t(image.tileSize()));
+    for (int y = 0; y < image.height(); y += image.tileSize()) {
+        const int n = std::min(image.tileSize(), image.height() - y);
+        if (!image.readRect(0, y, image.width(), n, strip.data(), std::ptrdiff_t(rowBytes), error)) return false;
+        if (!writer.writeRows(strip.data(), std::ptrdiff_t(rowBytes), n, error)) return false;
+    }
+    return writer.close(error);
+}
+
+bool convertTiled(TiledImage &src, TiffPhotometric from, TiledImage &dst, TiffPhotometric to,
+                  const TiledImageOptions &options, std::string *error) {
+    // строка перевода — строка тайла
+    TiffInfo info;
+    info.width = src.tileSize();
+    info.height = src.tileSize();
+    info.channels = src.channels();
+    info.bits = src.bits();
+    info.photometric = from;
+    const TiffRowConverter converter(info, to);
+    if (!converter.supported()) return fail(error, "перевод из этой цветовой модели не поддерживается");
+
+    TiledImageOptions grid = options;
+    grid.tileSize = src.tileSize();
+    if (!dst.create(src.width(), src.height(), converter.outputChannels(), src.bits(), grid, error)) return false;
+
+    FirstError failure;
+    parallelFor(src.tileCount(), 1, [&](int t0, int t1){
+        for (int t = t0; t < t1 && !failure.failed; ++t) {
+            std::string e;
+            TileRef in = src.acquire(t, false, &e);
+            TileRef out = in ? dst.acquire(t, true, &e) : TileRef();
+            if (!out) {
+                failure.set(e);
+                return;
+            }
+            // внутри задачи пула строки идут последовательно
+            converter.convert(in.data(), in.stride(), out.data(), out.stride(), in.height);
+        }
+    });
+    return failure.failed ? fail(error, failure.message) : true;
+}
+
+bool softProofTiled(TiledImage &rgb, const SoftProof &proof, TiledImage &out, TiledImage *heat,
+                    SoftProof::Stats *stats, int radius, const TiledImageOptions &options, std::string *error) {
+    if (rgb.bits() != 8 || (rgb.channels() != 3 && rgb.channels() != 4))
+        return fail(error, "ожидается RGB 8 бит");
+    radius = std::max(0, radius);
+    TiledImageOptions grid = options;
+    grid.tileSize = rgb.tileSize();
+    if (!out.create(rgb.width(), rgb.height(), 3, 8, grid, error)) return false;
+    if (heat && !heat->create(rgb.width(), rgb.height(), 3, 8, grid, error)) return false;
+
+    const int ch = rgb.channels();
+    const double threshold = 2.0;
+    struct Partial { std::size_t over = 0; double sum = 0.0; float max = 0.0f; };
+    std::vector<Partial> partial(std::size_t(rgb.tileCount()));
+    FirstError failure;
+    parallelFor(rgb.tileCount(), 1, [&](int t0, int t1){
+        std::vector<uint8_t> src, proofed;
+        std::vector<float> dE;
+        std::vector<double> area;
+        for (int t = t0; t < t1 && !failure.failed; ++t) {
+            std::string e;
+            TileRef o = out.acquire(t, true, &e);
+            TileRef hm = o && heat ? heat->acquire(t, true, &e) : TileRef();
+            if (!o || (heat && !hm)) {
+                failure.set(e);
+                return;
+            }
+            // тайл с полями: соседи крайних пикселей для окна карты
+            const int x0 = std::max(0, o.x - radius), y0 = std::max(0, o.y - radius);
+            const int x1 = std::min(rgb.width(), o.x + o.width + radius);
+            const int y1 = std::min(rgb.height(), o.y + o.height + radius);
+            const int rw = x1 - x0, rh = y1 - y0;
+            src.resize(std::size_t(rw) * std::size_t(rh) * std::size_t(ch));
+            proofed.resize(std::size_t(rw) * std::size_t(rh) * 3);
+            dE.resize(std::size_t(rw) * std::size_t(rh));
+            if (!rgb.readRect(x0, y0, rw, rh, src.data(), std::ptrdiff_t(rw) * ch, &e)) {
+                failure.set(e);
+                return;
+            }
+            // внутри задачи пула строки идут последовательно
+            proof.proofDeltaE(ImageView<const uint8_t>(src.data(), rw, rh, ch, std::ptrdiff_t(rw) * ch),
+                              ImageView<uint8_t>(proofed.data(), rw, rh, 3, std::ptrdiff_t(rw) * 3),
+                              ImageView<float>(dE.data(), rw, rh, 1, rw), threshold);
+
+            Partial &p = partial[std::size_t(t)];
+            const int ox = o.x - x0, oy = o.y - y0;
+            for (int y = 0; y < o.height; ++y) {
+                const float *d = dE.data() + std::size_t(y + oy) * std::size_t(rw) + std::size_t(ox);
+                for (int x = 0; x < o.width; ++x) {
+                    p.sum += d[x];
+                    p.max = std::max(p.max, d[x]);
+                    p.over += d[x] > threshold ? 1 : 0;
+                }
+                std::memcpy(o.row(y), proofed.data() + (std::size_t(y + oy) * std::size_t(rw) + std::size_t(ox)) * 3,
+                            std::size_t(o.width) * 3);
+            }
+            if (!hm) continue;
+
+            // суммы по прямоугольникам: окно любого размера за четыре чтения
+            area.assign(std::size_t(rw + 1) * std::size_t(rh + 1), 0.0);
+            for (int y = 0; y < rh; ++y) {
+                double line = 0.0;
+                for (int x = 0; x < rw; ++x) {
+                    line += dE[std::size_t(y) * std::size_t(rw) + std::size_t(x)];
+                    area[std::size_t(y + 1) * std::size_t(rw + 1) + std::size_t(x + 1)] =
+                        area[std::size_t(y) * std::size_t(rw + 1) + std::size_t(x + 1)] + line;
+                }
+            }
+            for (int y = 0; y < hm.height; ++y) {
+                // окно обрезается краем изображения
+                const int wy0 = std::max(0, y + oy - radius), wy1 = std::min(rh, y + oy + radius + 1);
+                uint8_t *px = hm.row(y);
+                for (int x = 0; x < hm.width; ++x, px += 3) {
+                    const int wx0 = std::max(0, x + ox - radius), wx1 = std::min(rw, x + ox + radius + 1);
+                    auto at = [&](int yy, int xx){ return area[std::size_t(yy) * std::size_t(rw + 1) + std::size_t(xx)]; };
+                    const double sum = at(wy1, wx1) - at(wy0, wx1) - at(wy1, wx0) + at(wy0, wx0);
+                    const uint8_t *c = SoftProof::heatColor(sum / double((wy1 - wy0) * (wx1 - wx0)));
+                    px[0] = c[0]; px[1] = c[1]; px[2] = c[2];
+                }
+            }
+        }
+    });
+    if (failure.failed) return fail(error, failure.message);
+
+    if (stats) {
+        *stats = SoftProof::Stats();
+        stats->count = std::size_t(rgb.width()) * std::size_t(rgb.height());
+        double sum = 0.0;
+        for (const Partial &p : partial) {
+            stats->over += p.over;
+            sum += p.sum;
+            stats->max = std::max(stats->max, double(p.max));
+        }
+        stats->mean = stats->count ? sum / double(stats->count) : 0.0;
+    }
+    return true;
+}
+
+namespace {
+
+template<typename T>
+bool equalize(TiledImage &lab, std::string *error) {
+    const std::size_t bins = std::size_t(1) << (8 * sizeof(T));
+    const int ch = lab.channels();
+    std::vector<uint64_t> histogram(bins, 0);
+    std::mutex merge;
+    FirstError failure;
+
+    parallelFor(lab.tileCount(), 1, [&](int t0, int t1){
+        std::vector<uint64_t> local(bins, 0);
+        for (int t = t0; t < t1 && !failure.failed; ++t) {
+            std::string e;
+            TileRef tile = lab.acquire(t, false, &e);
+            if (!tile) {
+                failure.set(e);
+                return;
+            }
+            for (int y = 0; y < tile.height; ++y) {
+                const T *p = reinterpret_cast<const T *>(tile.row(y));
+                for (int x = 0; x < tile.width; ++x) ++local[p[std::size_t(x) * std::size_t(ch)]];
+            }
+        }
+        std::lock_guard<std::mutex> guard(merge);
+        for (std::size_t i = 0; i < bins; ++i) histogram[i] += local[i];
+    });
+    if (failure.failed) return fail(error, failure.message);
+
+    // накопленная гистограмма без самого тёмного занятого уровня: он остаётся чёрным
+    std::vector<T> map(bins);
+    const uint64_t total = uint64_t(lab.width()) * uint64_t(lab.height());
+    uint64_t first = 0, cdf = 0;
+    for (std::size_t i = 0; i < bins && !first; ++i) first = histogram[i];
+    const double top = double(bins - 1);
+    for (std::size_t i = 0; i < bins; ++i) {
+        cdf += histogram[i];
+        map[i] = total > first ? T(std::lround(double(cdf > first ? cdf - first : 0) / double(total - first) * top))
+                               : T(i);
+    }
+
+    parallelFor(lab.tileCount(), 1, [&](int t0, int t1){
+        for (int t = t0; t < t1 && !failure.failed; ++t) {
+            std::string e;
+            TileRef tile = lab.acquire(t, true, &e);
+            if (!tile) {
+                failure.set(e);
+                return;
+            }
+            for (int y = 0; y < tile.height; ++y) {
+                T *p = reinterpret_cast<T *>(tile.row(y));
+                for (int x = 0; x < tile.width; ++x) p[std::size_t(x) * std::size_t(ch)] = map[p[std::size_t(x) * std::size_t(ch)]];
+            }
+        }
+    });
+    return failure.failed ? fail(error, failure.message) : true;
+}
+
+template<typename T>
+bool quantize(TiledImage &image, int levels, std::string *error) {
+    const int ch = image.channels();
+    const std::size_t n = std::size_t(image.width()) * std::size_t(ch);
+    const float top = float((std::size_t(1) << (8 * sizeof(T))) - 1);
+    const float step = top / float(levels - 1);
+    const float inverse = float(levels - 1) / top;
+    // ошибки текущей и следующей строки, по каналу на пиксель, с полем в пиксель с каждой стороны
+    std::vector<float> current(n + 2 * std::size_t(ch), 0.0f), next(current.size(), 0.0f);
+
+    std::vector<TileRef> band(std::size_t(image.tilesAcross()));
+    for (int ty = 0; ty < image.tilesDown(); ++ty) {
+        for (int tx = 0; tx < image.tilesAcross(); ++tx) {
+            band[std::size_t(tx)] = image.acquire(tx, ty, true, error);
+            if (!band[std::size_t(tx)]) return false;
+        }
+        for (int y = 0; y < band[0].height; ++y) {
+            float *err = current.data() + ch;
+            float *below = next.data() + ch;
+            for (const TileRef &tile : band) {
+                T *p = reinterpret_cast<T *>(tile.row(y));
+                for (int x = 0; x < tile.width; ++x) {
+                    const std::ptrdiff_t at = std::ptrdiff_t(tile.x + x) * ch;
+                    for (int c = 0; c < ch; ++c) {
+                        T &s = p[x * ch + c];
+                        const float v = std::min(top, std::max(0.0f, float(s) + err[at + c]));
+                        const int level = int(v * inverse + 0.5f);
+                        const float q = float(level) * step;
+                        s = T(int(q + 0.5f));
+                        const float e = v - q;
+                        err[at + ch + c] += e * (7.0f / 16.0f);
+                        below[at - ch + c] += e * (3.0f / 16.0f);
+                        below[at + c] += e * (5.0f / 16.0f);
+                        below[at + ch + c] += e * (1.0f / 16.0f);
+                    }
+                }
+            }
+            std::swap(current, next);
+            std::fill(next.begin(), next.end(), 0.0f);
+        }
+        for (TileRef &tile : band) tile.release();
+    }
+    return true;
+}
+
+}
+
+bool equalizeLightness(TiledImage &lab, std::string *error) {
+    if (lab.channels() < 3) return fail(error, "ожидается Lab");
+    return lab.bits() == 8 ? equalize<uint8_t>(lab, error) : equalize<uint16_t>(lab, error);
+}
+
+bool quantizeTiled(TiledImage &image, int levels, std::string *error) {
+    if (levels < 2) return fail(error, "нужно хотя бы два уровня");
+    return image.bits() == 8 ? quantize<uint8_t>(image, levels, error) : quantize<uint16_t>(image, levels, error);
+}
@@ -0,0 +1,168 @@
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include "softproof.h"
+#include "tiffio.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Изображение больше памяти: квадратные тайлы, в памяти — только те, что влезли
+// в бюджет, остальные вытесняются (LRU) во временный файл и читаются обратно
+// при следующем обращении. Тайл, к которому ещё не обращались, — нули.
+struct TiledImageOptions {
+    std::size_t memoryBudget = std::size_t(256) << 20;   // байт на тайлы
+    int tileSize = 256;
+    std::string spillDirectory;     // пусто — std::tmpfile(); файл удаляется сразу после создания
+};
+
+struct TileCacheStats {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t loads = 0;          // прочитано с диска
+    std::size_t spills = 0;         // изменённых тайлов записано на диск
+    std::size_t peakResident = 0;   // тайлов в памяти одновременно
+    std::size_t overBudget = 0;     // раз, когда все тайлы были закреплены и бюджет превышен
+};
+
+class TiledImage;
+
+// Закреплённый тайл: пока ссылка жива, он не вытесняется. Буфер — tileSize
+// строк по tileSize пикселей; у крайних тайлов действительны width x height.
+class TileRef {
+public:
+    TileRef() = default;
+    ~TileRef() { release(); }
+    TileRef(TileRef &&other) noexcept { *this = std::move(other); }
+    TileRef &operator=(TileRef &&other) noexcept;
+    TileRef(const TileRef &) = delete;
+    TileRef &operator=(const TileRef &) = delete;
+
+    explicit operator bool() const { return image != nullptr; }
+    uint8_t *data() const { return pixels; }
+    std::ptrdiff_t stride() const { return rowBytes; }
+    uint8_t *row(int y) const { return pixels + std::ptrdiff_t(y) * rowBytes; }
+    int x = 0, y = 0;               // левый верхний пиксель в изображении
+    int width = 0, height = 0;
+
+    void release();
+
+private:
+    friend class TiledImage;
+    TiledImage *image = nullptr;
+    int index = -1;
+    uint8_t *pixels = nullptr;
+    std::ptrdiff_t rowBytes = 0;
+};
+
+// Тайлы можно закреплять из нескольких потоков (parallelFor по тайлам). Обмен
+// с диском идёт вне общей блокировки: тайл в обмене помечен (Entry::busy), кто
+// обратится к нему, ждёт конца обмена, остальные тайлы доступны как обычно.
+class TiledImage {
+public:
+    TiledImage() = default;
+    ~TiledImage();
+    TiledImage(const TiledImage &) = delete;
+    TiledImage &operator=(const TiledImage &) = delete;
+
+    // bits — 8 или 16, отсчёты вперемешку, как у TiffReader
+    bool create(int width, int height, int channels, int bits,
+                const TiledImageOptions &options = TiledImageOptions(), std::string *error = nullptr);
+
+    int width() const { return w; }
+    int height() const { return h; }
+    int channels() const { return ch; }
+    int bits() const { return depth; }
+    int tileSize() const { return tile; }
+    int tilesAcross() const { return across; }
+    int tilesDown() const { return down; }
+    int tileCount() const { return across * down; }
+    std::size_t pixelBytes() const { return std::size_t(ch) * std::size_t(depth / 8); }
+
+    // write — тайл будет изменён и при вытеснении уйдёт на диск;
+    // пустая ссылка — ошибка ввода-вывода
+    TileRef acquire(int tx, int ty, bool write, std::string *error = nullptr);
+    TileRef acquire(int index, bool write, std::string *error = nullptr);
+
+    // прямоугольник через границы тайлов (например, с полями для соседей пикселя)
+    bool readRect(int x, int y, int width, int height, uint8_t *dst, std::ptrdiff_t stride,
+                  std::string *error = nullptr);
+    bool writeRect(int x, int y, int width, int height, const uint8_t *src, std::ptrdiff_t stride,
+                   std::string *error = nullptr);
+
+    TileCacheStats stats() const;
+
+private:
+    friend class TileRef;
+    struct Entry {
+        int slot = -1;              // буфер в памяти или -1
+        int pins = 0;
+        bool dirty = false;
+        bool onDisk = false;
+        bool busy = false;          // читается с диска или вытесняется на диск
+        std::list<int>::iterator lru;   // действителен, когда pins == 0 и slot >= 0
+    };
+
+    void unpin(int index);
+    bool obtainSlot(std::unique_lock<std::mutex> &guard, int &slot, std::string *error);
+    bool transfer(int index, uint8_t *p, bool write, std::string *error);
+    void closeSpill();
+
+    int w = 0, h = 0, ch = 0, depth = 0;
+    int tile = 0, across = 0, down = 0;
+    std::size_t tileBytes = 0;
+    std::size_t maxSlots = 0;
+
+    std::vector<Entry> entries;
+    std::vector<std::unique_ptr<uint8_t[]>> slots;
+    std::vector<int> freeSlots;
+    std::list<int> lru;             // незакреплённые тайлы в памяти, в начале — давние
+    std::size_t resident = 0;
+    TileCacheStats counters;
+    mutable std::mutex lock;
+    std::condition_variable exchanged;  // тайл закончил обмен с диском
+
+    std::FILE *spill = nullptr;
+#ifdef _WIN32
+    std::mutex spillLock;           // позиция файла общая
+#endif
+};
+
+// TIFF -> тайлы полосами по высоте тайла; info — параметры файла
+bool readTiffTiled(const std::string &path, TiledImage &image, TiffInfo *info,
+                   const TiledImageOptions &options = TiledImageOptions(), std::string *error = nullptr);
+bool writeTiffTiled(TiledImage &image, const std::string &path, TiffPhotometric photometric,
+                    const TiffWriteOptions &options = TiffWriteOptions(), std::string *error = nullptr);
+
+// Перевод тайл за тайлом пакетными функциями (TiffRowConverter), тайлы параллельно.
+// dst создаётся с той же сеткой и параметрами кэша.
+bool convertTiled(TiledImage &src, TiffPhotometric from, TiledImage &dst, TiffPhotometric to,
+                  const TiledImageOptions &options = TiledImageOptions(), std::string *error = nullptr);
+
+// Пробный оттиск по тайлам (rgb — 8 бит, 3 или 4 канала): out — RGB оттиска,
+// heat (nullptr — не нужна) — карта ΔE, усреднённая по окну (2 * radius + 1)²:
+// одиночные выбросы бледнеют, сплошные области остаются. Тайл читается через
+// readRect с полями radius, поля у соседей считаются заново. stats — по
+// отдельным пикселям, без усреднения.
+bool softProofTiled(TiledImage &rgb, const SoftProof &proof, TiledImage &out, TiledImage *heat,
+                    SoftProof::Stats *stats = nullptr, int radius = 2,
+                    const TiledImageOptions &options = TiledImageOptions(), std::string *error = nullptr);
+
+// Выравнивание гистограммы L у Lab (первый отсчёт, 8 или 16 бит): два прохода —
+// общая гистограмма по всем тайлам, затем замена по накопленной.
+bool equalizeLightness(TiledImage &lab, std::string *error = nullptr);
+
+// levels уровней на канал (отсчёты без знака: RGB, CMYK) с рассеиванием ошибки
+// Флойда — Стейнберга. Строки идут подряд через всё изображение, в памяти — ряд
+// тайлов и две строки ошибок; бюджет меньше ряда тайлов превышается
+// (см. TileCacheStats::overBudget).
+bool quantizeTiled(TiledImage &image, int levels, std::string *error = nullptr);
+
+#endif // TILEDIMAGE_H
@@ -9,11 +9,71 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    adjustments.cpp \
+    arena.cpp \
+    asyncfileio.cpp \
+    batchconvert.cpp \
+    cmyklab.cpp \
+    colorgraph.cpp \
+    colorlist.cpp \
+    colormodels.cpp \
+    colorplanes.cpp \
+    conversiondaemon.cpp \
+    gamutmap.cpp \
+    hdrinput.cpp \
+    iccprofile.cpp \
+    icctransform.cpp \
+    inkcoverage.cpp \
+    lut.cpp \
+    lutcache.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    mappedfile.cpp \
+    parallel.cpp \
+    pipeline.cpp \
+    separation.cpp \
+    separationwriter.cpp \
+    softproof.cpp \
+    swatchlibrary.cpp \
+    tiffconvert.cpp \
+    tiffio.cpp \
+    tiledimage.cpp \
+    ycbcr.cpp
 
 HEADERS += \
-    mainwindow.h
+    adjustments.h \
+    arena.h \
+    asyncfileio.h \
+    background.h \
+    batchconvert.h \
+    cmyklab.h \
+    colorgraph.h \
+    colorlist.h \
+    colormodels.h \
+    colorplanes.h \
+    conversiondaemon.h \
+    gamutmap.h \
+    hdrinput.h \
+    iccprofile.h \
+    icctransform.h \
+    imagebuffer.h \
+    inkcoverage.h \
+    lut.h \
+    lutcache.h \
+    mainwindow.h \
+    mappedfile.h \
+    parallel.h \
+    pipeline.h \
+    pixelviews.h \
+    separation.h \
+    separationwriter.h \
+    simdpixels.h \
+    softproof.h \
+    swatchlibrary.h \
+    tiffconvert.h \
+    tiffio.h \
+    tiledimage.h \
+    ycbcr.h
 
 FORMS += \
     mainwindow.ui
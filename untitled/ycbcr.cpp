@@ -0,0 +1,311 @@
+#include "ycbcr.h"
+#include "arena.h"
+#include "parallel.h"
+#include "simdpixels.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+const int FIX_SHIFT = 13;
+
+struct Coeffs { double kr, kb; };
+
+Coeffs coeffsFor(YCbCrMatrix m) {
+    switch (m) {
+    case YCbCrMatrix::BT601:  return {0.299, 0.114};
+    case YCbCrMatrix::BT2020: return {0.2627, 0.0593};
+    case YCbCrMatrix::BT709:
+    default:                  return {0.2126, 0.0722};
+    }
+}
+
+// смещения и размах кодов Y и Cb/Cr для выбранной разрядности
+struct Ranges { double yOff, yRange, cOff, cRange; int maxCode; };
+
+Ranges rangesFor(const YCbCrFormat &fmt) {
+    int bits = fmt.bitDepth > 8 ? 10 : 8;
+    int maxCode = (1 << bits) - 1;
+    double s = double(1 << (bits - 8));
+    if (fmt.range == YCbCrRange::Full)
+        return { 0.0, double(maxCode), double(1 << (bits - 1)), double(maxCode), maxCode };
+    return { 16.0 * s, 219.0 * s, 128.0 * s, 224.0 * s, maxCode };
+}
+
+// out = clamp((M * (in - inBias) + outBias) >> shift, 0, maxOut), коэффициенты в Q13.
+// shift > FIX_SHIFT, когда вход — сумма 2^(shift - FIX_SHIFT) отсчётов, а не сам отсчёт.
+struct FixedMatrix {
+    int16_t m[3][3];
+    int16_t inBias[3];
+    int32_t outBias[3];   // включает 0.5 для округления
+    int16_t maxOut;
+    int shift;
+};
+
+FixedMatrix makeFixed(const double m[3][3], const double inBias[3], const double outBias[3], int maxOut,
+                      int shift = FIX_SHIFT) {
+    FixedMatrix f;
+    const double one = double(1 << FIX_SHIFT);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) f.m[i][j] = int16_t(std::lround(m[i][j] * one));
+        f.inBias[i] = int16_t(std::lround(inBias[i]));
+        f.outBias[i] = int32_t(std::lround(outBias[i] * double(1 << shift))) + (1 << (shift - 1));
+    }
+    f.maxOut = int16_t(maxOut);
+    f.shift = shift;
+    return f;
+}
+
+// RGB 0..255 -> коды Y, Cb, Cr; inputSumShift — log2 числа просуммированных пикселей на входе
+FixedMatrix forwardMatrix(const YCbCrFormat &fmt, int inputSumShift = 0) {
+    Coeffs k = coeffsFor(fmt.matrix);
+    Ranges r = rangesFor(fmt);
+    double kg = 1.0 - k.kr - k.kb;
+    double ys = r.yRange / 255.0, cs = r.cRange / 255.0;
+    double cb = 2.0 * (1.0 - k.kb), cr = 2.0 * (1.0 - k.kr);
+    const double m[3][3] = {
+        { k.kr * ys,              kg * ys,       k.kb * ys },
+        { -k.kr / cb * cs,       -kg / cb * cs,  (1.0 - k.kb) / cb * cs },
+        { (1.0 - k.kr) / cr * cs, -kg / cr * cs, -k.kb / cr * cs },
+    };
+    const double inBias[3] = {0, 0, 0};
+    const double outBias[3] = { r.yOff, r.cOff, r.cOff };
+    return makeFixed(m, inBias, outBias, r.maxCode, FIX_SHIFT + inputSumShift);
+}
+
+// коды Y, Cb, Cr -> RGB 0..255
+FixedMatrix inverseMatrix(const YCbCrFormat &fmt) {
+    Coeffs k = coeffsFor(fmt.matrix);
+    Ranges r = rangesFor(fmt);
+    double kg = 1.0 - k.kr - k.kb;
+    double ys = 255.0 / r.yRange, cs = 255.0 / r.cRange;
+    const double m[3][3] = {
+        { ys, 0.0,                                      2.0 * (1.0 - k.kr) * cs },
+        { ys, -2.0 * k.kb * (1.0 - k.kb) / kg * cs,     -2.0 * k.kr * (1.0 - k.kr) / kg * cs },
+        { ys, 2.0 * (1.0 - k.kb) * cs,                  0.0 },
+    };
+    const double inBias[3] = { r.yOff, r.cOff, r.cOff };
+    const double outBias[3] = {0, 0, 0};
+    return makeFixed(m, inBias, outBias, 255);
+}
+
+static inline int16_t applyScalar(const FixedMatrix &f, int row, int a, int b, int c) {
+    int32_t v = f.m[row][0] * (a - f.inBias[0]) + f.m[row][1] * (b - f.inBias[1])
+              + f.m[row][2] * (c - f.inBias[2]) + f.outBias[row];
+    return int16_t(clampInt(v >> f.shift, 0, f.maxOut));
+}
+
+// Общее ядро для прямого и обратного преобразования над тремя строками int16.
+// Считаются строки матрицы first..first+count-1, результат в out[0..count).
+void applyFixedMatrix(const int16_t *const in[3], int16_t *const out[], int n, const FixedMatrix &f,
+                      int first = 0, int count = 3) {
+    int i = 0;
+#ifdef COLOR_SSE2
+    const __m128i bias0 = _mm_set1_epi16(f.inBias[0]);
+    const __m128i bias1 = _mm_set1_epi16(f.inBias[1]);
+    const __m128i bias2 = _mm_set1_epi16(f.inBias[2]);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maxOut = _mm_set1_epi16(f.maxOut);
+    const __m128i shift = _mm_cvtsi32_si128(f.shift);
+    __m128i cAB[3], cC[3], outBias[3];
+    for (int r = 0; r < 3; ++r) {
+        cAB[r] = _mm_set1_epi32(int32_t(uint16_t(f.m[r][0])) | (int32_t(uint16_t(f.m[r][1])) << 16));
+        cC[r] = _mm_set1_epi32(int32_t(uint16_t(f.m[r][2])));
+        outBias[r] = _mm_set1_epi32(f.outBias[r]);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in[0] + i)), bias0);
+        __m128i b = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in[1] + i)), bias1);
+        __m128i c = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in[2] + i)), bias2);
+        __m128i abLo = _mm_unpacklo_epi16(a, b), abHi = _mm_unpackhi_epi16(a, b);
+        __m128i cLo = _mm_unpacklo_epi16(c, zero), cHi = _mm_unpackhi_epi16(c, zero);
+        for (int k = 0; k < count; ++k) {
+            int r = first + k;
+            __m128i lo = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(abLo, cAB[r]), _mm_madd_epi16(cLo, cC[r])), outBias[r]);
+            __m128i hi = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(abHi, cAB[r]), _mm_madd_epi16(cHi, cC[r])), outBias[r]);
+            __m128i v = _mm_packs_epi32(_mm_sra_epi32(lo, shift), _mm_sra_epi32(hi, shift));
+            v = _mm_min_epi16(_mm_max_epi16(v, zero), maxOut);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out[k] + i), v);
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        int a = in[0][i], b = in[1][i], c = in[2][i];
+        for (int k = 0; k < count; ++k) out[k][i] = applyScalar(f, first + k, a, b, c);
+    }
+}
+
+// Суммы по блокам 2x2 двух строк (для 4:2:2 обе строки совпадают); выход (n + 1) / 2 точек.
+// Деление на 4 выполняет ядро матрицы (shift на 2 больше), чтобы не терять точность.
+void sum2x2(const int16_t *a, const int16_t *b, int16_t *out, int n) {
+    int x = 0;
+#ifdef COLOR_SSE2
+    const __m128i ones = _mm_set1_epi16(1);
+    for (; 2 * x + 16 <= n; x += 8) {
+        __m128i s0 = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + 2 * x)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 2 * x)));
+        __m128i s1 = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + 2 * x + 8)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 2 * x + 8)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x),
+                         _mm_packs_epi32(_mm_madd_epi16(s0, ones), _mm_madd_epi16(s1, ones)));
+    }
+#endif
+    for (; 2 * x < n; ++x) {
+        int x1 = std::min(2 * x + 1, n - 1);
+        out[x] = int16_t(a[2 * x] + a[x1] + b[2 * x] + b[x1]);
+    }
+}
+
+// Повторение каждого отсчёта цветности на два соседних пикселя; выход n точек.
+void duplicateSamples(const int16_t *in, int16_t *out, int n) {
+    int x = 0;
+#ifdef COLOR_SSE2
+    for (; x + 16 <= n; x += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + x / 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_unpacklo_epi16(v, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x + 8), _mm_unpackhi_epi16(v, v));
+    }
+#endif
+    for (; x < n; ++x) out[x] = in[x >> 1];
+}
+
+int rowsPerChromaRow(ChromaSubsampling s) {
+    return s == ChromaSubsampling::S420 ? 2 : 1;
+}
+
+// Прямое преобразование: Y по каждому пикселю, Cb/Cr — по сумме RGB блока
+// подвыборки (матрица линейна, поэтому это то же, что усреднять Cb/Cr,
+// но ядро цветности работает на меньшем числе точек).
+template<typename T>
+void rgbToFrame(const ImageView<const uint8_t> &rgb, const YCbCrFrameView<T> &frame, const YCbCrFormat &fmt) {
+    const FixedMatrix f = forwardMatrix(fmt);
+    const FixedMatrix fSum = forwardMatrix(fmt, 2);
+    const int w = rgb.width, h = rgb.height;
+    const int vert = rowsPerChromaRow(fmt.subsampling);
+    const bool horiz = fmt.subsampling != ChromaSubsampling::S444;
+    const int cw = chromaWidth(w, fmt.subsampling);
+
+    parallelFor(chromaHeight(h, fmt.subsampling), ROWS_PER_TASK, [&](int c0, int c1){
+        ArenaScope scratch;
+        int16_t *s = scratch.allocate<int16_t>(std::size_t(w) * 12);
+        int16_t *P[2][3] = { { s, s + w, s + 2 * w }, { s + 3 * w, s + 4 * w, s + 5 * w } };
+        int16_t *Y = s + 6 * w;
+        int16_t *A[3] = { s + 7 * w, s + 8 * w, s + 9 * w };
+        int16_t *C[2] = { s + 10 * w, s + 11 * w };
+
+        for (int cy = c0; cy < c1; ++cy) {
+            int rows = 0;
+            for (int k = 0; k < vert; ++k) {
+                int y = cy * vert + k;
+                if (y >= h) break;
+                deinterleaveRgb8(rgb.row(y), rgb.channels, P[k][0], P[k][1], P[k][2], w);
+                applyFixedMatrix(P[k], &Y, w, f, 0, 1);
+                storeSamples(Y, frame.y.row(y), w);
+                ++rows;
+            }
+
+            const int16_t *const *src = P[0];
+            if (horiz) {
+                const int16_t *const *lo = rows == 2 ? P[1] : P[0];
+                for (int c = 0; c < 3; ++c) sum2x2(P[0][c], lo[c], A[c], w);
+                src = A;
+            }
+            applyFixedMatrix(src, C, cw, horiz ? fSum : f, 1, 2);
+            storeSamples(C[0], frame.cb.row(cy), cw);
+            storeSamples(C[1], frame.cr.row(cy), cw);
+        }
+    });
+}
+
+template<typename T>
+void frameToRgb(const YCbCrFrameView<const T> &frame, const ImageView<uint8_t> &rgb, const YCbCrFormat &fmt) {
+    const FixedMatrix f = inverseMatrix(fmt);
+    const int w = rgb.width, h = rgb.height;
+    const int vert = rowsPerChromaRow(fmt.subsampling);
+    const bool horiz = fmt.subsampling != ChromaSubsampling::S444;
+
+    parallelFor(chromaHeight(h, fmt.subsampling), ROWS_PER_TASK, [&](int c0, int c1){
+        ArenaScope scratch;
+        int16_t *s = scratch.allocate<int16_t>(std::size_t(w) * 6);
+        int16_t *Y = s, *Cb = s + w, *Cr = s + 2 * w;
+        int16_t *R = s + 3 * w, *G = s + 4 * w, *B = s + 5 * w;
+
+        for (int cy = c0; cy < c1; ++cy) {
+            // повторение отсчётов цветности на соседние пиксели
+            const T *scb = frame.cb.row(cy), *scr = frame.cr.row(cy);
+            if (horiz) {
+                loadSamples(scb, Y, frame.cb.width);
+                duplicateSamples(Y, Cb, w);
+                loadSamples(scr, Y, frame.cr.width);
+                duplicateSamples(Y, Cr, w);
+            } else {
+                loadSamples(scb, Cb, w);
+                loadSamples(scr, Cr, w);
+            }
+            for (int k = 0; k < vert; ++k) {
+                int y = cy * vert + k;
+                if (y >= h) break;
+                loadSamples(frame.y.row(y), Y, w);
+                const int16_t *in[3] = { Y, Cb, Cr };
+                int16_t *out[3] = { R, G, B };
+                applyFixedMatrix(in, out, w, f);
+                interleaveRgb8(R, G, B, rgb.row(y), rgb.channels, w);
+            }
+        }
+    });
+}
+
+}
+
+int chromaWidth(int width, ChromaSubsampling s) {
+    return s == ChromaSubsampling::S444 ? width : (width + 1) / 2;
+}
+
+int chromaHeight(int height, ChromaSubsampling s) {
+    return s == ChromaSubsampling::S420 ? (height + 1) / 2 : height;
+}
+
+YCbCr rgbToYCbCr(const RGB &rgb, const YCbCrFormat &fmt) {
+    Coeffs k = coeffsFor(fmt.matrix);
+    Ranges r = rangesFor(fmt);
+    double R = rgb.r / 255.0, G = rgb.g / 255.0, B = rgb.b / 255.0;
+    double Y = k.kr * R + (1.0 - k.kr - k.kb) * G + k.kb * B;
+    double Cb = (B - Y) / (2.0 * (1.0 - k.kb));
+    double Cr = (R - Y) / (2.0 * (1.0 - k.kr));
+    return { clampInt(int(std::lround(r.yOff + Y * r.yRange)), 0, r.maxCode),
+             clampInt(int(std::lround(r.cOff + Cb * r.cRange)), 0, r.maxCode),
+             clampInt(int(std::lround(r.cOff + Cr * r.cRange)), 0, r.maxCode) };
+}
+
+RGB yCbCrToRgb(const YCbCr &ycc, const YCbCrFormat &fmt) {
+    Coeffs k = coeffsFor(fmt.matrix);
+    Ranges r = rangesFor(fmt);
+    double kg = 1.0 - k.kr - k.kb;
+    double Y = (ycc.y - r.yOff) / r.yRange;
+    double Cb = (ycc.cb - r.cOff) / r.cRange;
+    double Cr = (ycc.cr - r.cOff) / r.cRange;
+    double R = Y + 2.0 * (1.0 - k.kr) * Cr;
+    double B = Y + 2.0 * (1.0 - k.kb) * Cb;
+    double G = (Y - k.kr * R - k.kb * B) / kg;
+    return { clampInt(int(std::lround(R * 255.0)), 0, 255),
+             clampInt(int(std::lround(G * 255.0)), 0, 255),
+             clampInt(int(std::lround(B * 255.0)), 0, 255) };
+}
+
+void rgbToYCbCr(const ImageView<const uint8_t> &rgb, const YCbCrFrameView<uint8_t> &frame, const YCbCrFormat &fmt) {
+    rgbToFrame(rgb, frame, fmt);
+}
+
+void rgbToYCbCr(const ImageView<const uint8_t> &rgb, const YCbCrFrameView<uint16_t> &frame, const YCbCrFormat &fmt) {
+    rgbToFrame(rgb, frame, fmt);
+}
+
+void yCbCrToRgb(const YCbCrFrameView<const uint8_t> &frame, const ImageView<uint8_t> &rgb, const YCbCrFormat &fmt) {
+    frameToRgb(frame, rgb, fmt);
+}
+
+void yCbCrToRgb(const YCbCrFrameView<const uint16_t> &frame, const ImageView<uint8_t> &rgb, const YCbCrFormat &fmt) {
+    frameToRgb(frame, rgb, fmt);
+}
@@ -0,0 +1,64 @@
+#ifndef YCBCR_H
+#define YCBCR_H
+
+#include "colormodels.h"
+#include "imagebuffer.h"
+
+#include <cstdint>
+
+enum class YCbCrMatrix { BT601, BT709, BT2020 };
+enum class YCbCrRange { Full, Limited };
+enum class ChromaSubsampling { S444, S422, S420 };
+
+struct YCbCrFormat {
+    YCbCrMatrix matrix = YCbCrMatrix::BT709;
+    YCbCrRange range = YCbCrRange::Limited;
+    int bitDepth = 8;   // 8 или 10
+    ChromaSubsampling subsampling = ChromaSubsampling::S420;
+};
+
+struct YCbCr { int y, cb, cr; };
+
+// Планарный кадр. Для 8 бит T = uint8_t, для 10 бит T = uint16_t (значения в младших битах).
+// Плоскости cb/cr имеют размер chromaWidth x chromaHeight.
+template<typename T>
+struct YCbCrFrameView {
+    PlaneView<T> y, cb, cr;
+
+    YCbCrFrameView() = default;
+    YCbCrFrameView(const PlaneView<T> &py, const PlaneView<T> &pcb, const PlaneView<T> &pcr) : y(py), cb(pcb), cr(pcr) {}
+    template<typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    YCbCrFrameView(const YCbCrFrameView<U> &o) : y(o.y), cb(o.cb), cr(o.cr) {}
+};
+
+template<typename T>
+struct YCbCrFrame {
+    Plane<T> y, cb, cr;
+
+    YCbCrFrame() = default;
+    YCbCrFrame(int w, int h, ChromaSubsampling s);
+
+    YCbCrFrameView<T> view() { return { y.view(), cb.view(), cr.view() }; }
+    YCbCrFrameView<const T> view() const { return { y.view(), cb.view(), cr.view() }; }
+};
+
+int chromaWidth(int width, ChromaSubsampling s);
+int chromaHeight(int height, ChromaSubsampling s);
+
+// Одиночный цвет, точный расчёт в double (для интерфейса и проверки ядер).
+YCbCr rgbToYCbCr(const RGB &rgb, const YCbCrFormat &fmt);
+RGB yCbCrToRgb(const YCbCr &ycc, const YCbCrFormat &fmt);
+
+// Кадры: rgb — 8-битный packed RGB/RGBA того же размера, что и плоскость Y.
+// Целочисленные ядра (SSE2, при отсутствии — скалярный вариант), строки
+// распределяются по пулу потоков.
+void rgbToYCbCr(const ImageView<const uint8_t> &rgb, const YCbCrFrameView<uint8_t> &frame, const YCbCrFormat &fmt);
+void rgbToYCbCr(const ImageView<const uint8_t> &rgb, const YCbCrFrameView<uint16_t> &frame, const YCbCrFormat &fmt);
+void yCbCrToRgb(const YCbCrFrameView<const uint8_t> &frame, const ImageView<uint8_t> &rgb, const YCbCrFormat &fmt);
+void yCbCrToRgb(const YCbCrFrameView<const uint16_t> &frame, const ImageView<uint8_t> &rgb, const YCbCrFormat &fmt);
+
+template<typename T>
+YCbCrFrame<T>::YCbCrFrame(int w, int h, ChromaSubsampling s)
+    : y(w, h), cb(chromaWidth(w, s), chromaHeight(h, s)), cr(chromaWidth(w, s), chromaHeight(h, s)) {}
+
+#endif // YCBCR_H